@@ -0,0 +1,96 @@
+/*******************************************************************************
+* check_reduce.c: this file checks the reductions of boolean expressions.
+
+* libast: C library for evaluating expressions with the abstract syntax tree.
+
+* Github repository:
+        https://github.com/cheng-zhao/libast
+
+* Copyright (c) 2020 Cheng Zhao <zhaocheng03@gmail.com>
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+
+*******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "libast.h"
+
+/* Numbers of rows to be checked, within a tile, and across chunks. */
+#define NUM_NROWS 3
+static const size_t nrows_list[NUM_NROWS] = { 100, 1000, 40000 };
+
+/* Boolean expressions, with the expected fraction of true rows. */
+#define NUM_EXP 3
+static const char *exp_list[NUM_EXP] = { "$1 >= 0", "$1 < 0", "$1 % 4 == 1" };
+static const double frac_list[NUM_EXP] = { 1, 0, 0.25 };
+
+/* Compare a reduction with the expected value, and print the failures. */
+int check(ast_t *ast, const void *const *cols, const ast_dtype_t *dtypes,
+    const size_t nrows, const ast_reduce_t op, const char *name,
+    const double expect) {
+  double result = 0;
+  if (ast_reduce(ast, NULL, cols, dtypes, nrows, op, &result)) {
+    ast_perror(ast, stderr, "Error:");
+    return 1;
+  }
+  if (result != expect) {
+    fprintf(stderr, "Failed: %s of `%s` with %zu rows: %g (expected %g)\n",
+        name, ast->exp, nrows, result, expect);
+    return 1;
+  }
+  return 0;
+}
+
+int main(void) {
+  const size_t nmax = nrows_list[NUM_NROWS - 1];
+  long *col = malloc(sizeof(long) * nmax);
+  if (!col) {
+    fprintf(stderr, "Error: failed to allocate memory.\n");
+    return 1;
+  }
+  for (size_t i = 0; i < nmax; i++) col[i] = i;
+  const void *cols[1] = { col };
+  const ast_dtype_t dtypes[1] = { AST_DTYPE_LONG };
+
+  int nfail = 0;
+  for (int i = 0; i < NUM_EXP; i++) {
+    ast_t *ast = ast_init();
+    if (!ast || ast_build(ast, exp_list[i], AST_DTYPE_BOOL, true)) {
+      ast_perror(ast, stderr, "Error:");
+      ast_destroy(ast);
+      free(col);
+      return 1;
+    }
+    for (int j = 0; j < NUM_NROWS; j++) {
+      const size_t n = nrows_list[j];
+      const double num = n * frac_list[i];
+      nfail += check(ast, cols, dtypes, n, AST_REDUCE_MIN, "MIN", num == n);
+      nfail += check(ast, cols, dtypes, n, AST_REDUCE_MAX, "MAX", num > 0);
+      nfail += check(ast, cols, dtypes, n, AST_REDUCE_COUNT, "COUNT", num);
+      nfail += check(ast, cols, dtypes, n, AST_REDUCE_MEAN, "MEAN", num / n);
+    }
+    ast_destroy(ast);
+  }
+  free(col);
+
+  if (nfail) fprintf(stderr, "%d check(s) failed.\n", nfail);
+  else printf("All checks passed.\n");
+  return nfail ? 1 : 0;
+}
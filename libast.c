@@ -28,6 +28,45 @@
 
 *******************************************************************************/
 
+/* Native code generation requires memory mapping of POSIX systems. */
+#if defined(AST_ENABLE_JIT) && defined(__x86_64__) && !defined(_WIN32)
+  #define AST_JIT_X86_64
+  #ifndef _DEFAULT_SOURCE
+    #define _DEFAULT_SOURCE             /* for MAP_ANONYMOUS */
+  #endif
+#endif
+
+/* Loading compiled C code requires the dynamic linker of POSIX systems. */
+#if defined(AST_ENABLE_DLOPEN) && !defined(_WIN32)
+  #define AST_CODEGEN_DLOPEN
+  #ifndef _DEFAULT_SOURCE
+    #define _DEFAULT_SOURCE             /* for mkstemp and fdopen */
+  #endif
+#endif
+
+/* The thread pool for multi-threaded evaluation requires POSIX threads. */
+#if defined(AST_ENABLE_PTHREAD) && !defined(_WIN32)
+  #define AST_POOL_PTHREAD
+  #ifndef _DEFAULT_SOURCE
+    #define _DEFAULT_SOURCE             /* for the number of processors */
+  #endif
+  #if defined(__linux__) && !defined(_GNU_SOURCE)
+    #define _GNU_SOURCE                 /* for the CPU affinity */
+  #endif
+#endif
+
+/* Vectorised kernels for x86 processors, selected at runtime. */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && \
+  !defined(AST_DISABLE_SIMD)
+  #define AST_SIMD_X86
+#endif
+
+/* Portable vectorised kernels with the vector extensions of GCC or Clang. */
+#if (defined(__clang__) || (defined(__GNUC__) && __GNUC__ >= 9)) && \
+  !defined(AST_DISABLE_SIMD)
+  #define AST_SIMD_VECEXT
+#endif
+
 #include <stdlib.h>
 #include <stdint.h>
 #include <stddef.h>
@@ -37,6 +76,30 @@
 #include <math.h>
 #include "libast.h"
 
+#ifdef AST_JIT_X86_64
+  #include <sys/mman.h>
+#endif
+#ifdef AST_SIMD_X86
+  #include <float.h>
+  #include <immintrin.h>
+#endif
+#ifdef AST_POOL_PTHREAD
+  #include <pthread.h>
+  #include <sched.h>
+  #include <unistd.h>
+#endif
+#ifdef AST_CODEGEN_DLOPEN
+  #include <inttypes.h>
+  #include <dlfcn.h>
+  #include <unistd.h>
+  #include <sys/stat.h>
+#endif
+
+/* Command for compiling the generated C code into a shared object. */
+#ifndef AST_CODEGEN_CC
+  #define AST_CODEGEN_CC        "cc -std=c99 -O2 -fPIC -shared"
+#endif
+
 /*============================================================================*\
                                      Macros
 \*============================================================================*/
@@ -55,6 +118,7 @@
 #define AST_ERR_EVAL            (-11)
 #define AST_ERR_NVAR            (-12)
 #define AST_ERR_MISMATCH        (-13)
+#define AST_ERR_THREAD          (-14)
 #define AST_ERR_UNKNOWN         (-99)
 
 #define AST_ERRNO(ast)          (((ast_error_t *)ast->error)->errno)
@@ -70,6 +134,120 @@
 /* Data type for numerical literals in boolean expressions. */
 #define AST_DTYPE_NUM4BOOL      (AST_DTYPE_LONG | AST_DTYPE_DOUBLE)
 
+/* Dispatch of the interpreter for compiled programs: threaded code with
+   computed goto (labels as values) if the compiler supports it, or a `switch`
+   loop otherwise. */
+#if defined(__GNUC__) && !defined(AST_DISABLE_COMPUTED_GOTO)
+  #define AST_PROG_THREADED
+  #define AST_PROG_LABEL(tok)   [tok] = &&ast_prog_lbl_##tok
+  #define AST_PROG_DISPATCH                                             \
+    static const void *const ast_prog_jmp[] = {                         \
+      AST_PROG_LABEL(AST_TOK_UNDEF), AST_PROG_LABEL(AST_TOK_NUM),       \
+      AST_PROG_LABEL(AST_TOK_STRING), AST_PROG_LABEL(AST_TOK_VAR),      \
+      AST_PROG_LABEL(AST_TOK_PAREN_LEFT),                               \
+      AST_PROG_LABEL(AST_TOK_PAREN_RIGHT), AST_PROG_LABEL(AST_TOK_ABS), \
+      AST_PROG_LABEL(AST_TOK_SQRT), AST_PROG_LABEL(AST_TOK_LN),         \
+      AST_PROG_LABEL(AST_TOK_LOG), AST_PROG_LABEL(AST_TOK_ISFINITE),    \
+      AST_PROG_LABEL(AST_TOK_NEG), AST_PROG_LABEL(AST_TOK_LNOT),        \
+      AST_PROG_LABEL(AST_TOK_BNOT), AST_PROG_LABEL(AST_TOK_EXP),        \
+      AST_PROG_LABEL(AST_TOK_MUL), AST_PROG_LABEL(AST_TOK_DIV),         \
+      AST_PROG_LABEL(AST_TOK_REM), AST_PROG_LABEL(AST_TOK_ADD),         \
+      AST_PROG_LABEL(AST_TOK_MINUS), AST_PROG_LABEL(AST_TOK_LEFT),      \
+      AST_PROG_LABEL(AST_TOK_RIGHT), AST_PROG_LABEL(AST_TOK_LT),        \
+      AST_PROG_LABEL(AST_TOK_LE), AST_PROG_LABEL(AST_TOK_GT),           \
+      AST_PROG_LABEL(AST_TOK_GE), AST_PROG_LABEL(AST_TOK_EQ),           \
+      AST_PROG_LABEL(AST_TOK_NEQ), AST_PROG_LABEL(AST_TOK_BAND),        \
+      AST_PROG_LABEL(AST_TOK_BXOR), AST_PROG_LABEL(AST_TOK_BOR),        \
+      AST_PROG_LABEL(AST_TOK_LAND), AST_PROG_LABEL(AST_TOK_LOR),        \
+      AST_PROG_LABEL(AST_TOK_FMA), AST_PROG_LABEL(AST_TOK_FMS)          \
+    };                                                                  \
+    goto *ast_prog_jmp[ip->op];
+  #define AST_PROG_CASE(tok)    ast_prog_lbl_##tok:
+  #define AST_PROG_NEXT         goto *ast_prog_jmp[(++ip)->op]
+#else
+  #define AST_PROG_DISPATCH     for (;; ip++) switch (ip->op)
+  #define AST_PROG_CASE(tok)    case tok:
+  #define AST_PROG_NEXT         continue
+#endif
+
+/* Software prefetching for batch evaluation of records with large strides:
+   the minimum stride in bytes, and the number of rows to be fetched ahead. */
+#ifdef __GNUC__
+  #define AST_PREFETCH(p)       __builtin_prefetch((p), 0, 0)
+#else
+  #define AST_PREFETCH(p)       ((void) (p))
+#endif
+#define AST_PREFETCH_STRIDE     64
+#define AST_PREFETCH_ROWS       8
+
+/* Vectorised batch evaluation: the number of rows in a tile, and the number
+   of full-size scratch tiles that can be placed on the stack. */
+#ifndef AST_TILE_ROWS
+  #define AST_TILE_ROWS         1024
+#endif
+#define AST_TILE_SLOTS          8
+
+/* Number of rows packed into a word of the bitmask. */
+#define AST_MASK_BITS           64
+
+/* Multi-threaded evaluation: the maximum number of rows in a chunk for each
+   thread, and the minimum stack size of worker threads in bytes, which hold
+   the scratch tiles. */
+#ifndef AST_POOL_ROWS
+  #define AST_POOL_ROWS         (AST_TILE_ROWS * 16)
+#endif
+#define AST_POOL_STACK          (2 * 1024 * 1024)
+
+/* Locks of the work-stealing scheduler, which are not needed without POSIX
+   threads, and the maximum number of nested splits of a range of rows. */
+#ifdef AST_POOL_PTHREAD
+  #define AST_SCHED_LOCK(x)     pthread_mutex_lock(&(x)->lock)
+  #define AST_SCHED_UNLOCK(x)   pthread_mutex_unlock(&(x)->lock)
+#else
+  #define AST_SCHED_LOCK(x)     ((void) (x))
+  #define AST_SCHED_UNLOCK(x)   ((void) (x))
+#endif
+#define AST_SCHED_DEPTH         (sizeof(size_t) * CHAR_BIT)
+
+/* Number of rows of the chunks with partial results of reductions, which
+   are merged in a fixed order, regardless of the number of threads. */
+#define AST_REDUCE_ROWS         AST_POOL_ROWS
+
+/* Maximum number of partial bins of histograms kept at the same time, which
+   limits the number of chunks of rows evaluated in a round. */
+#define AST_HIST_PART           (1 << 20)
+
+/* Capacity of the largest level of the quantile sketches, which controls
+   the accuracy, the minimum capacity of a level, and the maximum number of
+   levels.  Every level holds up to twice its capacity before compaction. */
+#ifndef AST_QUANT_K
+  #define AST_QUANT_K           256
+#endif
+#define AST_QUANT_MIN           8
+#define AST_QUANT_LEVELS        64
+#define AST_QUANT_SIZE          (AST_QUANT_K * 2)
+
+/* Maximum range of keys for direct-indexed group-by aggregations, the
+   initial number of slots of the hash tables otherwise, and the maximum
+   number of groups of chunks of rows kept at the same time, which limits
+   the number of chunks evaluated in a round. */
+#define AST_GROUP_DIRECT        (1 << 16)
+#define AST_GROUP_INIT          1024
+#define AST_GROUP_PART          (1 << 19)
+
+/* Size of the vectors of the portable kernels in bytes, which must be a
+   power of two between 8 and 256, and is the register width of the build
+   target by default. */
+#ifndef AST_VECEXT_BYTES
+  #if defined(__AVX512F__)
+    #define AST_VECEXT_BYTES    64
+  #elif defined(__AVX2__)
+    #define AST_VECEXT_BYTES    32
+  #else
+    #define AST_VECEXT_BYTES    16
+  #endif
+#endif
+
 /*============================================================================*\
                             Internal data structures
 \*============================================================================*/
@@ -108,7 +286,9 @@ typedef enum {
   AST_TOK_BXOR        = 29,     /*  `^` : bitwise XOR       */
   AST_TOK_BOR         = 30,     /*  `|` : bitwise OR        */
   AST_TOK_LAND        = 31,     /* `&&` : logical AND       */
-  AST_TOK_LOR         = 32      /* `||` : logical OR        */
+  AST_TOK_LOR         = 32,     /* `||` : logical OR        */
+  AST_TOK_FMA         = 33,     /* fused `a * b + c`        */
+  AST_TOK_FMS         = 34      /* fused `a * b - c`        */
 } ast_tok_t;
 
 /* Types of the tokens. */
@@ -199,7 +379,11 @@ static const ast_tok_attr_t ast_tok_attr[] = {
   /** AST_TOK_LAND        :     `&&`    **/
   {AST_TOKT_BOPT,    2,  2,     AST_DTYPE_BOOL,     AST_DTYPE_BOOL},
   /** AST_TOK_LOR         :     `||`    **/
-  {AST_TOKT_BOPT,    1,  2,     AST_DTYPE_BOOL,     AST_DTYPE_BOOL}
+  {AST_TOKT_BOPT,    1,  2,     AST_DTYPE_BOOL,     AST_DTYPE_BOOL},
+  /** AST_TOK_FMA         : `*` and `+` **/
+  {AST_TOKT_BOPT,    9,  2,     AST_DTYPE_REAL,     AST_DTYPE_REAL},
+  /** AST_TOK_FMS         : `*` and `-` **/
+  {AST_TOKT_BOPT,    9,  2,     AST_DTYPE_REAL,     AST_DTYPE_REAL}
 };
 
 /* Tagged union for variables with different data types. */
@@ -230,6 +414,282 @@ typedef struct ast_tree_struct {
   struct ast_tree_struct *right;        /* right child node            */
 } ast_node_t;
 
+/* Instruction of the compiled program. */
+typedef struct {
+  ast_tok_t op;                 /* type of the operation              */
+  ast_var_t value;              /* literal value or variable position */
+  long jump;                    /* target of short-circuit branches   */
+} ast_instr_t;
+
+/* Node of the closure-compiled evaluator. */
+typedef struct ast_clos_struct ast_clos_t;
+
+/* Handlers of closure nodes for different data types. */
+typedef int (*ast_clos_int_t) (const ast_clos_t *, const int *);
+typedef long (*ast_clos_long_t) (const ast_clos_t *, const long *);
+typedef float (*ast_clos_float_t) (const ast_clos_t *, const float *);
+typedef double (*ast_clos_double_t) (const ast_clos_t *, const double *);
+
+/* Argument of closure nodes: a literal, a variable, or a subtree. */
+typedef union {
+  int ival; long lval; float fval; double dval;
+  long pos;                     /* offset of the variable             */
+  const ast_clos_t *node;       /* the subtree                        */
+} ast_clos_arg_t;
+
+struct ast_clos_struct {
+  union {
+    ast_clos_int_t ival; ast_clos_long_t lval;
+    ast_clos_float_t fval; ast_clos_double_t dval;
+  } fn;                         /* handler specialised on arguments   */
+  ast_clos_arg_t a;             /* the first argument                 */
+  ast_clos_arg_t b;             /* the second argument                */
+};
+
+/* Field of a record for a variable in strided batch evaluation. */
+typedef struct {
+  size_t offset;                /* byte offset in the record          */
+  ast_dtype_t dtype;            /* native data type of the field      */
+} ast_field_t;
+
+/* Kernels applying unary, binary, and fused multiply-add operators to
+   arrays, indexed by the types of the operators, comparisons that pack the
+   results into words of bitmasks, with one bit per element, and conversions
+   of arrays, indexed by the data types of the sources. */
+typedef void (*ast_kern_uop_t) (void *, const void *, const size_t);
+typedef void (*ast_kern_bop_t) (void *, const void *, const void *,
+    const size_t);
+typedef void (*ast_kern_top_t) (void *, const void *, const void *,
+    const void *, const size_t);
+typedef struct {
+  ast_kern_uop_t uop[AST_TOK_LOR + 1];  /* kernels for unary operators  */
+  ast_kern_bop_t bop[AST_TOK_LOR + 1];  /* kernels for binary operators */
+  ast_kern_bop_t cmp[AST_TOK_LOR + 1];  /* kernels for comparisons      */
+  ast_kern_top_t fma[AST_TOK_FMS + 1];  /* kernels for multiply-add     */
+  ast_kern_uop_t cvt[AST_DTYPE_DOUBLE + 1];     /* kernels for conversions */
+} ast_kern_t;
+
+/* Kernels writing indices of the set bits of a bitmask, given the index of
+   the first bit and the number of existing indices. */
+typedef size_t (*ast_kern_idx_t) (void *, size_t, const uint64_t *,
+    const size_t, const size_t);
+
+/* Cell of scratch tiles for boolean expressions, which hold numbers or words
+   of bitmasks. */
+typedef union {
+  long lval; double dval; uint64_t bits;
+} ast_cell_t;
+
+/* Destination of batch evaluations for boolean expressions. */
+typedef struct {
+  uint64_t *mask;               /* bitmask for all rows, or NULL      */
+  void *idx;                    /* indices of selected rows, or NULL  */
+  ast_kern_idx_t sel;           /* kernel for writing the indices     */
+  size_t num;                   /* number of selected rows            */
+} ast_mask_dst_t;
+
+/* The compiled program, i.e., the AST in postfix order, as well as other
+   evaluators that are read-only on evaluation. */
+typedef struct ast_prog_struct {
+  ast_dtype_t dtype;            /* data type of the expression        */
+  long nvar;                    /* number of unique variables         */
+  const long *vidx;             /* unique indices of variables        */
+  const char *exp;              /* the expression string              */
+  int *vtype;                   /* accepted data types of variables   */
+  long ninstr;                  /* number of instructions             */
+  long depth;                   /* maximum depth of the value stack   */
+  ast_instr_t *instr;           /* list of instructions               */
+  ast_clos_t *clos;             /* closure nodes, with the root first */
+  void *code;                   /* native machine code                */
+  size_t csize;                 /* size of the machine code           */
+  void *dl;                     /* handle of the loaded shared object */
+  ast_jit_int_t ifunc;          /* native function for int type       */
+  ast_jit_long_t lfunc;         /* native function for long type      */
+  ast_jit_float_t ffunc;        /* native function for float type     */
+  ast_jit_double_t dfunc;       /* native function for double type    */
+  ast_math_t math;              /* accuracy of functions for batches  */
+  ast_simd_t simd;              /* instruction set for batches        */
+  bool fma;                     /* true with fused multiply-add       */
+} ast_prog_t;
+
+/* Job of the thread pool, which is run by threads with the indices
+   0, 1, ..., `nthreads` - 1, given the argument. */
+typedef void (*ast_pool_func_t) (void *, const int, const int);
+
+#ifdef AST_POOL_PTHREAD
+/* Worker thread of the thread pool. */
+typedef struct {
+  struct ast_pool_struct *pool; /* the thread pool                    */
+  pthread_t tid;                /* identifier of the thread           */
+  int id;                       /* index of the thread for jobs       */
+} ast_worker_t;
+#endif
+
+/* The thread pool, with persistent workers waiting for jobs, which are run
+   by the calling thread as well. */
+struct ast_pool_struct {
+  int nthreads;                 /* number of threads, with the caller */
+#ifdef AST_POOL_PTHREAD
+  ast_worker_t *worker;         /* the worker threads                 */
+  pthread_mutex_t run;          /* lock for submitting jobs           */
+  pthread_mutex_t lock;         /* lock for the states of the pool    */
+  pthread_cond_t wake;          /* condition for new jobs             */
+  pthread_cond_t done;          /* condition for finished jobs        */
+  unsigned long gen;            /* generation of the current job      */
+  int active;                   /* number of threads for the job      */
+  int busy;                     /* number of running workers          */
+  bool stop;                    /* true for terminating the workers   */
+  ast_pool_func_t func;         /* function of the job                */
+  void *arg;                    /* argument of the job                */
+#endif
+};
+
+/* Range of rows of a task for the work-stealing scheduler. */
+typedef struct {
+  size_t task;                  /* index of the task                  */
+  size_t start;                 /* index of the first row             */
+  size_t end;                   /* index after the last row           */
+} ast_range_t;
+
+/* Double-ended queue of ranges for a thread, which takes the newest range
+   from the bottom, while the other threads steal the oldest from the top. */
+typedef struct {
+  ast_range_t *range;           /* the ranges                         */
+  size_t top;                   /* index of the oldest range          */
+  size_t bottom;                /* index after the newest range       */
+  size_t cap;                   /* capacity of the queue              */
+#ifdef AST_POOL_PTHREAD
+  pthread_mutex_t lock;         /* lock for the queue                 */
+#endif
+} ast_deque_t;
+
+/* Evaluation of an expression as a task of the scheduler, given validated
+   columns of variables, with a function processing chunks of rows, given
+   the index of the thread, the first row, and the number of rows. */
+typedef struct ast_sched_task_struct ast_sched_task_t;
+typedef int (*ast_sched_func_t) (const ast_sched_task_t *, const int,
+    const size_t, const size_t);
+struct ast_sched_task_struct {
+  const ast_prog_t *prog;       /* the compiled program               */
+  void *out;                    /* output of the task                 */
+  const void **col;             /* columns indexed by the positions   */
+  ast_dtype_t *dtype;           /* data types of the columns          */
+  ast_dtype_t *vtype;           /* data types of boolean variables    */
+  size_t nrows;                 /* number of rows to be evaluated     */
+  size_t align;                 /* alignment of the first rows        */
+  size_t grain;                 /* maximum number of rows in a chunk  */
+  ast_sched_func_t func;        /* function for chunks of rows        */
+  int err;                      /* error code of the task             */
+};
+
+/* Reduction of the values of an expression, with the partial results of
+   chunks of rows. */
+typedef struct {
+  ast_reduce_t op;              /* the reduction operation            */
+  double *part;                 /* partial results of the chunks      */
+} ast_reduce_arg_t;
+
+/* Histogram of the values of an expression, with the partial bins of the
+   chunks of rows in a round, and optional expressions for selecting and
+   weighting the rows. */
+typedef struct {
+  size_t nbins;                 /* number of bins                     */
+  size_t stride;                /* distance of bins of the chunks     */
+  size_t base;                  /* first row of the round             */
+  const double *edges;          /* edges of the bins, or NULL         */
+  double min;                   /* lower edge of uniform bins         */
+  double max;                   /* upper edge of uniform bins         */
+  double scale;                 /* inverse width of uniform bins      */
+  const void *mask;             /* task for the selection, or NULL    */
+  const void *weight;           /* task for the weights, or NULL      */
+  double *count;                /* partial bins of the chunks         */
+} ast_hist_arg_t;
+
+/* Quantile sketch of the values of an expression for a thread, with levels
+   of compactors, where an item at level `h` stands for `2^h` values. */
+typedef struct {
+  double *item;                 /* items of all the levels            */
+  size_t num[AST_QUANT_LEVELS]; /* number of items at every level     */
+  size_t cap[AST_QUANT_LEVELS]; /* capacity of every level            */
+  int nlev;                     /* number of levels in use            */
+  uint64_t seed;                /* state of the random generator      */
+  double min;                   /* minimum of the values              */
+  double max;                   /* maximum of the values              */
+} ast_quant_t;
+
+/* Item of the merged quantile sketches, with the weight. */
+typedef struct {
+  double v;                     /* value of the item                  */
+  double w;                     /* weight, or the cumulative weight   */
+} ast_quant_item_t;
+
+/* Row of the top-k selection, with the value, which is negated for the
+   smallest values, so that larger values are always preferred. */
+typedef struct {
+  double v;                     /* value of the row                   */
+  size_t i;                     /* index of the row                   */
+} ast_topk_item_t;
+
+/* Top-k selection of rows, with a bounded heap for every thread, and an
+   optional expression for filtering the rows. */
+typedef struct {
+  size_t k;                     /* maximum number of rows             */
+  bool largest;                 /* true for the largest values        */
+  const void *filter;           /* task for the filter, or NULL       */
+  ast_topk_item_t *heap;        /* heaps of all the threads           */
+  size_t *num;                  /* number of rows in every heap       */
+} ast_topk_arg_t;
+
+/* Slot of the group-by aggregation, which is empty if there is no row. */
+typedef struct {
+  long key;                     /* key of the group                   */
+  double val;                   /* aggregated value                   */
+  size_t count;                 /* number of rows                     */
+} ast_group_slot_t;
+
+/* Table of groups, either indexed directly by the keys, or an
+   open-addressing hash table with linear probing. */
+typedef struct {
+  ast_group_slot_t *slot;       /* slots of the table                 */
+  size_t cap;                   /* number of slots                    */
+  size_t num;                   /* number of non-empty slots          */
+  long min;                     /* minimum key                        */
+  long max;                     /* maximum key                        */
+} ast_group_table_t;
+
+/* Group-by aggregation of the values of an expression, with the scratch
+   tables of all the threads, and the groups of the chunks of rows in a
+   round. */
+typedef struct {
+  ast_reduce_t op;              /* the aggregation operation          */
+  bool direct;                  /* true for direct indexing           */
+  long min;                     /* minimum key for direct indexing    */
+  size_t base;                  /* first row of the round             */
+  const void *value;            /* task for the values, or NULL       */
+  ast_group_table_t *table;     /* scratch tables of all the threads  */
+  ast_group_slot_t *run;        /* groups of the chunks               */
+  size_t *len;                  /* number of groups of every chunk    */
+} ast_group_arg_t;
+
+/* Buffer for the values of an expression in a tile of rows. */
+typedef union {
+  int ival[AST_TILE_ROWS];
+  long lval[AST_TILE_ROWS];
+  float fval[AST_TILE_ROWS];
+  double dval[AST_TILE_ROWS];
+  uint64_t mask[(AST_TILE_ROWS + AST_MASK_BITS - 1) / AST_MASK_BITS];
+} ast_tile_buf_t;
+
+/* The work-stealing scheduler for tasks of batch evaluations. */
+typedef struct {
+  ast_sched_task_t *task;       /* the tasks                          */
+  ast_deque_t *deque;           /* queues of ranges for the threads   */
+  size_t remain;                /* number of rows to be evaluated     */
+#ifdef AST_POOL_PTHREAD
+  pthread_mutex_t lock;         /* lock for the states of the tasks   */
+#endif
+} ast_sched_t;
+
 
 /*============================================================================*\
                         Functions for interface handling
@@ -261,6 +721,7 @@ ast_t *ast_init(void) {
   ast->vidx = NULL;
   ast->exp = NULL;
   ast->ast = NULL;
+  ast->prog = NULL;
   return ast;
 }
 
@@ -313,6 +774,134 @@ static inline void ast_set_var_value(ast_var_t *var, const void *value,
   }
 }
 
+/******************************************************************************
+Function `ast_set_var_pos`:
+  Set the value of a variable at a given position of the variable array, with
+  data type conversions.
+Arguments:
+  * `var`:      the variable array;
+  * `pos`:      position of the variable in the array;
+  * `etype`:    data type of the expression;
+  * `vtype`:    accepted data types of the variable for boolean expressions;
+  * `value`:    pointer to the value;
+  * `size`:     length of the string type variable;
+  * `dtype`:    data type of the value.
+Return:
+  NULL on success; the error message on error.
+******************************************************************************/
+static const char *ast_set_var_pos(void *var, const long pos,
+    const ast_dtype_t etype, const int vtype, const void *value,
+    const size_t size, ast_dtype_t dtype) {
+  long lval;
+  double dval;
+
+  switch (etype) {
+    case AST_DTYPE_BOOL:
+      /* Convert int to long. */
+      if (dtype == AST_DTYPE_INT) {
+        lval = (long) (*((int *) value));
+        value = &lval;
+        dtype = AST_DTYPE_LONG;
+      }
+      /* Convert float to double. */
+      else if (dtype == AST_DTYPE_FLOAT) {
+        dval = (double) (*((float *) value));
+        value = &dval;
+        dtype = AST_DTYPE_DOUBLE;
+      }
+
+      /* Raise an error if the data type is not valid for this variable. */
+      if (!(dtype & vtype)) return "unexpected data type for variable";
+      ast_set_var_value((ast_var_t *) var + pos, value, size, dtype);
+      return NULL;
+    case AST_DTYPE_INT:
+      if (dtype != etype) return "int type variable expected";
+      *((int *) var + pos) = *((int *) value);
+      return NULL;
+    case AST_DTYPE_LONG:
+      if (dtype == AST_DTYPE_LONG)
+        *((long *) var + pos) = *((long *) value);
+      /* Convert int to long. */
+      else if (dtype == AST_DTYPE_INT)
+        *((long *) var + pos) = (long) (*((int *) value));
+      else return "long type variable expected";
+      return NULL;
+    case AST_DTYPE_FLOAT:
+      if (dtype == AST_DTYPE_FLOAT)
+        *((float *) var + pos) = *((float *) value);
+      /* Convert int to float. */
+      else if (dtype == AST_DTYPE_INT)
+        *((float *) var + pos) = (float) (*((int *) value));
+      /* Convert long to float. */
+      else if (dtype == AST_DTYPE_LONG)
+        *((float *) var + pos) = (float) (*((long *) value));
+      else return "float type variable expected";
+      return NULL;
+    case AST_DTYPE_DOUBLE:
+      if (dtype == AST_DTYPE_DOUBLE)
+        *((double *) var + pos) = *((double *) value);
+      else if (dtype == AST_DTYPE_INT)
+        *((double *) var + pos) = (double) (*((int *) value));
+      else if (dtype == AST_DTYPE_LONG)
+        *((double *) var + pos) = (double) (*((long *) value));
+      else if (dtype == AST_DTYPE_FLOAT)
+        *((double *) var + pos) = (double) (*((float *) value));
+      else return "double type variable expected";
+      return NULL;
+    default:
+      return "unknown error for variable";
+  }
+}
+
+/******************************************************************************
+Function `ast_dtype_size`:
+  Size of an element with the native data type.
+Arguments:
+  * `dtype`:    the data type.
+Return:
+  The size in bytes.
+******************************************************************************/
+static inline size_t ast_dtype_size(const ast_dtype_t dtype) {
+  switch (dtype) {
+    case AST_DTYPE_BOOL: return sizeof(bool);
+    case AST_DTYPE_INT: return sizeof(int);
+    case AST_DTYPE_LONG: return sizeof(long);
+    case AST_DTYPE_FLOAT: return sizeof(float);
+    default: return sizeof(double);
+  }
+}
+
+/******************************************************************************
+Function `ast_num_cast_check`:
+  Check if a value can be converted to the data type of a numerical
+  expression, with the same rules as `ast_set_var_pos`.
+Arguments:
+  * `etype`:    data type of the expression;
+  * `dtype`:    data type of the value.
+Return:
+  NULL if the conversion is valid; the error message otherwise.
+******************************************************************************/
+static const char *ast_num_cast_check(const ast_dtype_t etype,
+    const ast_dtype_t dtype) {
+  switch (etype) {
+    case AST_DTYPE_INT:
+      if (dtype != AST_DTYPE_INT) return "int type variable expected";
+      return NULL;
+    case AST_DTYPE_LONG:
+      if (!(dtype & AST_DTYPE_INTEGER)) return "long type variable expected";
+      return NULL;
+    case AST_DTYPE_FLOAT:
+      if (dtype != AST_DTYPE_FLOAT && !(dtype & AST_DTYPE_INTEGER))
+        return "float type variable expected";
+      return NULL;
+    case AST_DTYPE_DOUBLE:
+      if (!(dtype & AST_DTYPE_NUMBER)) return "double type variable expected";
+      return NULL;
+    default:
+      return "unknown error for variable";
+  }
+}
+
 /******************************************************************************
 Function `ast_vidx_pos`:
   Find the insertion position of the variable index in a sorted index array.
@@ -404,82 +993,14 @@ int ast_set_var(ast_t *ast, const long idx, const void *value,
   /* Nothing to be done if this variable is not required. */
   const long pos = -ast_vidx_pos(ast->vidx, ast->nvar, idx) - 1;
   if (pos < 0) return 0;
-  long lval;
-  double dval;
-  ast_var_t *var;
-
-  switch (ast->dtype) {
-    case AST_DTYPE_BOOL:
-      var = (ast_var_t *) ast->var + pos;
-      /* Convert int to long. */
-      if (dtype == AST_DTYPE_INT) {
-        lval = (long) (*((int *) value));
-        value = &lval;
-        dtype = AST_DTYPE_LONG;
-      }
-      /* Convert float to double. */
-      else if (dtype == AST_DTYPE_FLOAT) {
-        dval = (double) (*((float *) value));
-        value = &dval;
-        dtype = AST_DTYPE_DOUBLE;
-      }
-
-      /* Raise an error if the data type is not valid for this variable. */
-      if (!(dtype & var->dtype)) {
-        ast_msg(ast, "unexpected data type for variable", idx, NULL);
-        return AST_ERRNO(ast) = AST_ERR_VAR;
-      }
-      ast_set_var_value(var, value, size, dtype);
-      break;
-    case AST_DTYPE_INT:
-      if (dtype != ast->dtype) {
-        ast_msg(ast, "int type variable expected", idx, NULL);
-        return AST_ERRNO(ast) = AST_ERR_VAR;
-      }
-      *((int *) ast->var + pos) = *((int *) value);
-      break;
-    case AST_DTYPE_LONG:
-      if (dtype == AST_DTYPE_LONG)
-        *((long *) ast->var + pos) = *((long *) value);
-      /* Convert int to long. */
-      else if (dtype == AST_DTYPE_INT)
-        *((long *) ast->var + pos) = (long) (*((int *) value));
-      else {
-        ast_msg(ast, "long type variable expected", idx, NULL);
-        return AST_ERRNO(ast) = AST_ERR_VAR;
-      }
-      break;
-    case AST_DTYPE_FLOAT:
-      if (dtype == AST_DTYPE_FLOAT)
-        *((float *) ast->var + pos) = *((float *) value);
-      /* Convert int to float. */
-      else if (dtype == AST_DTYPE_INT)
-        *((float *) ast->var + pos) = (float) (*((int *) value));
-      /* Convert long to float. */
-      else if (dtype == AST_DTYPE_LONG)
-        *((float *) ast->var + pos) = (float) (*((long *) value));
-      else {
-        ast_msg(ast, "float type variable expected", idx, NULL);
-        return AST_ERRNO(ast) = AST_ERR_VAR;
-      }
-      break;
-    case AST_DTYPE_DOUBLE:
-      if (dtype == AST_DTYPE_DOUBLE)
-        *((double *) ast->var + pos) = *((double *) value);
-      else if (dtype == AST_DTYPE_INT)
-        *((double *) ast->var + pos) = (double) (*((int *) value));
-      else if (dtype == AST_DTYPE_LONG)
-        *((double *) ast->var + pos) = (double) (*((long *) value));
-      else if (dtype == AST_DTYPE_FLOAT)
-        *((double *) ast->var + pos) = (double) (*((float *) value));
-      else {
-        ast_msg(ast, "double type variable expected", idx, NULL);
-        return AST_ERRNO(ast) = AST_ERR_VAR;
-      }
-      break;
-    default:
-      ast_msg(ast, "unknown error for variable", idx, NULL);
-      return AST_ERRNO(ast) = AST_ERR_VAR;
+  /* Accepted data types of variables are recorded for boolean expressions. */
+  const int vtype = (ast->dtype == AST_DTYPE_BOOL) ?
+    ((ast_var_t *) ast->var)[pos].dtype : AST_DTYPE_NULL;
+  const char *msg = ast_set_var_pos(ast->var, pos, ast->dtype, vtype, value,
+      size, dtype);
+  if (msg) {
+    ast_msg(ast, msg, idx, NULL);
+    return AST_ERRNO(ast) = AST_ERR_VAR;
   }
 
   ((ast_error_t *) ast->error)->vset[pos] = true;
@@ -863,6 +1384,26 @@ static void ast_free(ast_node_t *node) {
   free(node);
 }
 
+/******************************************************************************
+Function `ast_prog_free`:
+  Free memory allocated for the compiled program.
+Arguments:
+  * `prog`:     the compiled program.
+******************************************************************************/
+static void ast_prog_free(ast_prog_t *prog) {
+  if (!prog) return;
+  if (prog->instr) free(prog->instr);
+  if (prog->clos) free(prog->clos);
+  if (prog->vtype) free(prog->vtype);
+#ifdef AST_JIT_X86_64
+  if (prog->code) munmap(prog->code, prog->csize);
+#endif
+#ifdef AST_CODEGEN_DLOPEN
+  if (prog->dl) dlclose(prog->dl);
+#endif
+  free(prog);
+}
+
 /******************************************************************************
 Function `ast_destroy`:
   Release memory allocated for the abstract syntax tree.
@@ -878,6 +1419,7 @@ void ast_destroy(ast_t *ast) {
   if (ast->var) free(ast->var);
   if (ast->vidx) free(ast->vidx);
   ast_free((ast_node_t *) ast->ast);
+  ast_prog_free((ast_prog_t *) ast->prog);
   free(ast);
 }
 
@@ -1437,6 +1979,12 @@ static float ast_eval_float(ast_t *ast, const ast_node_t *node,
         return HUGE_VALF;
     }
   }
+  else if (node->type == AST_TOK_FMA || node->type == AST_TOK_FMS) {
+    const float v1 = ast_eval_float(ast, node->left->left, var);
+    const float v2 = ast_eval_float(ast, node->left->right, var);
+    const float v3 = ast_eval_float(ast, node->right, var);
+    return fmaf(v1, v2, (node->type == AST_TOK_FMA) ? v3 : -v3);
+  }
   else {
     const float v1 = ast_eval_float(ast, node->left, var);
     const float v2 = ast_eval_float(ast, node->right, var);
@@ -1485,6 +2033,12 @@ static double ast_eval_double(ast_t *ast, const ast_node_t *node,
         return HUGE_VAL;
     }
   }
+  else if (node->type == AST_TOK_FMA || node->type == AST_TOK_FMS) {
+    const double v1 = ast_eval_double(ast, node->left->left, var);
+    const double v2 = ast_eval_double(ast, node->left->right, var);
+    const double v3 = ast_eval_double(ast, node->right, var);
+    return fma(v1, v2, (node->type == AST_TOK_FMA) ? v3 : -v3);
+  }
   else {
     const double v1 = ast_eval_double(ast, node->left, var);
     const double v2 = ast_eval_double(ast, node->right, var);
@@ -1502,6 +2056,305 @@ static double ast_eval_double(ast_t *ast, const ast_node_t *node,
   }
 }
 
+/******************************************************************************
+Function `ast_eval_bool_uopt`:
+  Apply a unary operator to a value, for boolean type expressions.
+Arguments:
+  * `type`:     type of the operator;
+  * `v`:        the operand;
+  * `res`:      the result.
+Return:
+  Zero on success; non-zero on error.
+******************************************************************************/
+static int ast_eval_bool_uopt(const ast_tok_t type, const ast_var_t *v,
+    ast_var_t *res) {
+  const int dtype = v->dtype;
+  bool bres;
+  long lres;
+  double dres;
+
+  switch (type) {
+    case AST_TOK_LNOT:
+      if (dtype == AST_DTYPE_BOOL) bres = !v->v.bval;
+      else if (dtype == AST_DTYPE_LONG) bres = !v->v.lval;
+      else if (dtype == AST_DTYPE_DOUBLE) bres = !v->v.dval;
+      else return AST_ERR_EVAL;
+      ast_set_var_value(res, &bres, 0, AST_DTYPE_BOOL);
+      return 0;
+    case AST_TOK_NEG:
+      if (dtype == AST_DTYPE_LONG) {
+        lres = -v->v.lval;
+        ast_set_var_value(res, &lres, 0, AST_DTYPE_LONG);
+      }
+      else if (dtype == AST_DTYPE_DOUBLE) {
+        dres = -v->v.dval;
+        ast_set_var_value(res, &dres, 0, AST_DTYPE_DOUBLE);
+      }
+      else return AST_ERR_EVAL;
+      return 0;
+    case AST_TOK_ABS:
+      if (dtype == AST_DTYPE_LONG) {
+        lres = (v->v.lval < 0) ? -v->v.lval : v->v.lval;
+        ast_set_var_value(res, &lres, 0, AST_DTYPE_LONG);
+      }
+      else if (dtype == AST_DTYPE_DOUBLE) {
+        dres = fabs(v->v.dval);
+        ast_set_var_value(res, &dres, 0, AST_DTYPE_DOUBLE);
+      }
+      else return AST_ERR_EVAL;
+      return 0;
+    case AST_TOK_SQRT:
+      if (dtype == AST_DTYPE_LONG) dres = (double) v->v.lval;
+      else if (dtype == AST_DTYPE_DOUBLE) dres = v->v.dval;
+      else return AST_ERR_EVAL;
+      dres = sqrt(dres);
+      ast_set_var_value(res, &dres, 0, AST_DTYPE_DOUBLE);
+      return 0;
+    case AST_TOK_LN:
+      if (dtype == AST_DTYPE_LONG) dres = (double) v->v.lval;
+      else if (dtype == AST_DTYPE_DOUBLE) dres = v->v.dval;
+      else return AST_ERR_EVAL;
+      dres = log(dres);
+      ast_set_var_value(res, &dres, 0, AST_DTYPE_DOUBLE);
+      return 0;
+    case AST_TOK_LOG:
+      if (dtype == AST_DTYPE_LONG) dres = (double) v->v.lval;
+      else if (dtype == AST_DTYPE_DOUBLE) dres = v->v.dval;
+      else return AST_ERR_EVAL;
+      dres = log10(dres);
+      ast_set_var_value(res, &dres, 0, AST_DTYPE_DOUBLE);
+      return 0;
+    case AST_TOK_ISFINITE:
+      if (dtype == AST_DTYPE_FLOAT) bres = isfinite(v->v.fval) ? true : false;
+      else if (dtype == AST_DTYPE_DOUBLE)
+        bres = isfinite(v->v.dval) ? true : false;
+      else return AST_ERR_EVAL;
+      ast_set_var_value(res, &bres, 0, AST_DTYPE_BOOL);
+      return 0;
+    case AST_TOK_BNOT:
+      if (dtype == AST_DTYPE_LONG) {
+        lres = ~v->v.lval;
+        ast_set_var_value(res, &lres, 0, AST_DTYPE_LONG);
+      }
+      else return AST_ERR_EVAL;
+      return 0;
+    default:
+      return AST_ERR_EVAL;
+  }
+}
+
+/******************************************************************************
+Function `ast_eval_bool_bopt`:
+  Apply a binary operator to two values, for boolean type expressions.
+Arguments:
+  * `type`:     type of the operator;
+  * `x1`:       the left operand;
+  * `x2`:       the right operand;
+  * `res`:      the result.
+Return:
+  Zero on success; non-zero on error.
+******************************************************************************/
+static int ast_eval_bool_bopt(const ast_tok_t type, const ast_var_t *x1,
+    const ast_var_t *x2, ast_var_t *res) {
+  /* Work on copies, so type casting does not alter the operands. */
+  ast_var_t c1 = *x1;
+  ast_var_t c2 = *x2;
+  ast_var_t *v1 = &c1;
+  ast_var_t *v2 = &c2;
+
+  int dtype = v1->dtype;
+  /* Type cast for numerical types. */
+  if (v1->dtype != v2->dtype) {
+    if (v1->dtype == AST_DTYPE_LONG) {
+      double tmp = (double) v1->v.lval;
+      ast_set_var_value(v1, &tmp, 0, AST_DTYPE_DOUBLE);
+      dtype = AST_DTYPE_DOUBLE;
+    }
+    else if (v2->dtype == AST_DTYPE_LONG) {
+      double tmp = (double) v2->v.lval;
+      ast_set_var_value(v2, &tmp, 0, AST_DTYPE_DOUBLE);
+    }
+    else return AST_ERR_EVAL;
+  }
+  bool bres;
+  long lres;
+  double dres;
+
+  switch (type) {
+    case AST_TOK_LAND:
+      if (dtype == AST_DTYPE_BOOL) {
+        bres = v1->v.bval && v2->v.bval;
+        ast_set_var_value(res, &bres, 0, AST_DTYPE_BOOL);
+      }
+      else return AST_ERR_EVAL;
+      return 0;
+    case AST_TOK_LOR:
+      if (dtype == AST_DTYPE_BOOL) {
+        bres = v1->v.bval || v2->v.bval;
+        ast_set_var_value(res, &bres, 0, AST_DTYPE_BOOL);
+      }
+      else return AST_ERR_EVAL;
+      return 0;
+    case AST_TOK_LT:
+      if (dtype == AST_DTYPE_LONG) bres = v1->v.lval < v2->v.lval;
+      else if (dtype == AST_DTYPE_DOUBLE) bres = v1->v.dval < v2->v.dval;
+      else return AST_ERR_EVAL;
+      ast_set_var_value(res, &bres, 0, AST_DTYPE_BOOL);
+      return 0;
+    case AST_TOK_LE:
+      if (dtype == AST_DTYPE_LONG) bres = v1->v.lval <= v2->v.lval;
+      else if (dtype == AST_DTYPE_DOUBLE) bres = v1->v.dval <= v2->v.dval;
+      else return AST_ERR_EVAL;
+      ast_set_var_value(res, &bres, 0, AST_DTYPE_BOOL);
+      return 0;
+    case AST_TOK_GT:
+      if (dtype == AST_DTYPE_LONG) bres = v1->v.lval > v2->v.lval;
+      else if (dtype == AST_DTYPE_DOUBLE) bres = v1->v.dval > v2->v.dval;
+      else return AST_ERR_EVAL;
+      ast_set_var_value(res, &bres, 0, AST_DTYPE_BOOL);
+      return 0;
+    case AST_TOK_GE:
+      if (dtype == AST_DTYPE_LONG) bres = v1->v.lval >= v2->v.lval;
+      else if (dtype == AST_DTYPE_DOUBLE) bres = v1->v.dval >= v2->v.dval;
+      else return AST_ERR_EVAL;
+      ast_set_var_value(res, &bres, 0, AST_DTYPE_BOOL);
+      return 0;
+    case AST_TOK_EQ:
+      if (dtype == AST_DTYPE_BOOL) bres = v1->v.bval == v2->v.bval;
+      else if (dtype == AST_DTYPE_LONG) bres = v1->v.lval == v2->v.lval;
+      else if (dtype == AST_DTYPE_DOUBLE) bres = v1->v.dval == v2->v.dval;
+      else if (dtype == AST_DTYPE_STRING) {
+        if (v1->v.sval.len != v2->v.sval.len) bres = false;
+        else bres = !strncmp(v1->v.sval.str, v2->v.sval.str, v1->v.sval.len);
+      }
+      else return AST_ERR_EVAL;
+      ast_set_var_value(res, &bres, 0, AST_DTYPE_BOOL);
+      return 0;
+    case AST_TOK_NEQ:
+      if (dtype == AST_DTYPE_BOOL) bres = v1->v.bval != v2->v.bval;
+      else if (dtype == AST_DTYPE_LONG) bres = v1->v.lval != v2->v.lval;
+      else if (dtype == AST_DTYPE_DOUBLE) bres = v1->v.dval != v2->v.dval;
+      else if (dtype == AST_DTYPE_STRING) {
+        if (v1->v.sval.len != v2->v.sval.len) bres = true;
+        else bres = strncmp(v1->v.sval.str, v2->v.sval.str, v1->v.sval.len);
+      }
+      else return AST_ERR_EVAL;
+      ast_set_var_value(res, &bres, 0, AST_DTYPE_BOOL);
+      return 0;
+    case AST_TOK_ADD:
+      if (dtype == AST_DTYPE_LONG) {
+        lres = v1->v.lval + v2->v.lval;
+        ast_set_var_value(res, &lres, 0, AST_DTYPE_LONG);
+      }
+      else if (dtype == AST_DTYPE_DOUBLE) {
+        dres = v1->v.dval + v2->v.dval;
+        ast_set_var_value(res, &dres, 0, AST_DTYPE_DOUBLE);
+      }
+      else return AST_ERR_EVAL;
+      return 0;
+    case AST_TOK_MINUS:
+      if (dtype == AST_DTYPE_LONG) {
+        lres = v1->v.lval - v2->v.lval;
+        ast_set_var_value(res, &lres, 0, AST_DTYPE_LONG);
+      }
+      else if (dtype == AST_DTYPE_DOUBLE) {
+        dres = v1->v.dval - v2->v.dval;
+        ast_set_var_value(res, &dres, 0, AST_DTYPE_DOUBLE);
+      }
+      else return AST_ERR_EVAL;
+      return 0;
+    case AST_TOK_MUL:
+      if (dtype == AST_DTYPE_LONG) {
+        lres = v1->v.lval * v2->v.lval;
+        ast_set_var_value(res, &lres, 0, AST_DTYPE_LONG);
+      }
+      else if (dtype == AST_DTYPE_DOUBLE) {
+        dres = v1->v.dval * v2->v.dval;
+        ast_set_var_value(res, &dres, 0, AST_DTYPE_DOUBLE);
+      }
+      else return AST_ERR_EVAL;
+      return 0;
+    case AST_TOK_DIV:
+      if (dtype == AST_DTYPE_LONG) {
+        lres = v1->v.lval / v2->v.lval;
+        ast_set_var_value(res, &lres, 0, AST_DTYPE_LONG);
+      }
+      else if (dtype == AST_DTYPE_DOUBLE) {
+        dres = v1->v.dval / v2->v.dval;
+        ast_set_var_value(res, &dres, 0, AST_DTYPE_DOUBLE);
+      }
+      else return AST_ERR_EVAL;
+      return 0;
+    case AST_TOK_EXP:
+      if (dtype == AST_DTYPE_LONG) {
+        lres = 0;
+        if (v2->v.lval > UINT8_MAX) {
+          if (v1->v.lval == 1) lres = 1;
+          else if (v1->v.lval == -1) lres = 1 - 2 * (v2->v.lval & 1);
+        }
+        else {
+          int64_t tmp = ipow(v1->v.lval, v2->v.lval);
+          if (tmp <= LONG_MAX) lres = (long) tmp;
+        }
+        ast_set_var_value(res, &lres, 0, AST_DTYPE_LONG);
+      }
+      else if (dtype == AST_DTYPE_DOUBLE) {
+        dres = pow(v1->v.dval, v2->v.dval);
+        ast_set_var_value(res, &dres, 0, AST_DTYPE_DOUBLE);
+      }
+      else return AST_ERR_EVAL;
+      return 0;
+    case AST_TOK_REM:
+      if (dtype == AST_DTYPE_LONG) {
+        lres = v1->v.lval % v2->v.lval;
+        ast_set_var_value(res, &lres, 0, AST_DTYPE_LONG);
+      }
+      else if (dtype == AST_DTYPE_DOUBLE) {
+        dres = fmod(v1->v.dval, v2->v.dval);
+        ast_set_var_value(res, &dres, 0, AST_DTYPE_DOUBLE);
+      }
+      else return AST_ERR_EVAL;
+      return 0;
+    case AST_TOK_LEFT:
+      if (dtype == AST_DTYPE_LONG) {
+        lres = v1->v.lval << v2->v.lval;
+        ast_set_var_value(res, &lres, 0, AST_DTYPE_LONG);
+      }
+      else return AST_ERR_EVAL;
+      return 0;
+    case AST_TOK_RIGHT:
+      if (dtype == AST_DTYPE_LONG) {
+        lres = v1->v.lval >> v2->v.lval;
+        ast_set_var_value(res, &lres, 0, AST_DTYPE_LONG);
+      }
+      else return AST_ERR_EVAL;
+      return 0;
+    case AST_TOK_BAND:
+      if (dtype == AST_DTYPE_LONG) {
+        lres = v1->v.lval & v2->v.lval;
+        ast_set_var_value(res, &lres, 0, AST_DTYPE_LONG);
+      }
+      else return AST_ERR_EVAL;
+      return 0;
+    case AST_TOK_BXOR:
+      if (dtype == AST_DTYPE_LONG) {
+        lres = v1->v.lval ^ v2->v.lval;
+        ast_set_var_value(res, &lres, 0, AST_DTYPE_LONG);
+      }
+      else return AST_ERR_EVAL;
+      return 0;
+    case AST_TOK_BOR:
+      if (dtype == AST_DTYPE_LONG) {
+        lres = v1->v.lval | v2->v.lval;
+        ast_set_var_value(res, &lres, 0, AST_DTYPE_LONG);
+      }
+      else return AST_ERR_EVAL;
+      return 0;
+    default:
+      return AST_ERR_EVAL;
+  }
+}
+
 /******************************************************************************
 Function `ast_eval_bool`:
   Evaluate the value in bool type, given the abstract syntax tree.
@@ -1512,54 +2365,126 @@ Arguments:
 static void ast_eval_bool(ast_t *ast, ast_node_t *node) {
   if (AST_IS_ERROR(ast)) return;
   if (ast_tok_attr[node->type].argc == 0) return;
+
+  /* Evaluate the left child node. */
+  if (ast_tok_attr[node->left->type].argc != 0)
+    ast_eval_bool(ast, node->left);
+  if (AST_IS_ERROR(ast)) return;
+
+  const ast_var_t *v1, *v2;
+  if (node->left->type == AST_TOK_VAR)
+    v1 = (ast_var_t *) ast->var + node->left->value.v.lval;
+  else v1 = &node->left->value;
+
   /* Unary operators. */
   if (ast_tok_attr[node->type].argc == 1) {
-    /* The child node is not evaluated. */
-    if (ast_tok_attr[node->left->type].argc != 0)
-      ast_eval_bool(ast, node->left);
-    if (AST_IS_ERROR(ast)) return;
+    if (ast_eval_bool_uopt(node->type, v1, &node->value))
+      AST_ERRNO(ast) = AST_ERR_EVAL;
+    return;
+  }
 
-    ast_var_t *v;
-    if (node->left->type == AST_TOK_VAR)
-      v = (ast_var_t *) ast->var + node->left->value.v.lval;
-    else v = &node->left->value;
-    const int dtype = v->dtype;
-    bool bres;
-    long lres;
-    double dres;
+  /* Short-circuit of `&&` and `||`: skip the right operand once the left
+     one decides the result. */
+  if ((node->type == AST_TOK_LAND || node->type == AST_TOK_LOR) &&
+      v1->dtype == AST_DTYPE_BOOL &&
+      v1->v.bval == (node->type == AST_TOK_LOR)) {
+    const bool res = v1->v.bval;
+    ast_set_var_value(&node->value, &res, 0, AST_DTYPE_BOOL);
+    return;
+  }
 
-    switch (node->type) {
-      case AST_TOK_LNOT:
-        if (dtype == AST_DTYPE_BOOL) bres = !v->v.bval;
-        else if (dtype == AST_DTYPE_LONG) bres = !v->v.lval;
-        else if (dtype == AST_DTYPE_DOUBLE) bres = !v->v.dval;
-        else {
+  /* Binary operators. */
+  if (ast_tok_attr[node->right->type].argc != 0)
+    ast_eval_bool(ast, node->right);
+  if (AST_IS_ERROR(ast)) return;
+
+  if (node->right->type == AST_TOK_VAR)
+    v2 = (ast_var_t *) ast->var + node->right->value.v.lval;
+  else v2 = &node->right->value;
+
+  if (ast_eval_bool_bopt(node->type, v1, v2, &node->value))
+    AST_ERRNO(ast) = AST_ERR_EVAL;
+}
+
+/******************************************************************************
+Function `ast_eval_pre`:
+  Pre-evaluate values in the abstract syntax tree.
+Arguments:
+  * `ast`:      interface of the abstract syntax tree;
+  * `node`:     a node of the abstract syntax tree.
+******************************************************************************/
+static void ast_eval_pre(ast_t *ast, ast_node_t *node) {
+  if (AST_IS_ERROR(ast)) return;
+  if (ast_tok_attr[node->type].argc == 0) return;
+  /* Unary operators. */
+  if (ast_tok_attr[node->type].argc == 1) {
+    /* The child node is not evaluated. */
+    if (ast_tok_attr[node->left->type].argc != 0)
+      ast_eval_pre(ast, node->left);
+    if (AST_IS_ERROR(ast)) return;
+
+    if (node->left->type != AST_TOK_NUM && node->left->type != AST_TOK_STRING)
+      return;
+
+    ast_var_t *v = &node->left->value;
+    const int dtype = v->dtype;
+    bool bres;
+    int ires;
+    long lres;
+    float fres;
+    double dres;
+
+    switch (node->type) {
+      case AST_TOK_LNOT:
+        if (dtype == AST_DTYPE_BOOL) bres = !v->v.bval;
+        else if (dtype == AST_DTYPE_LONG) bres = !v->v.lval;
+        else if (dtype == AST_DTYPE_DOUBLE) bres = !v->v.dval;
+        else {
           AST_ERRNO(ast) = AST_ERR_EVAL;
           return;
         }
         ast_set_var_value(&node->value, &bres, 0, AST_DTYPE_BOOL);
+        node->type = AST_TOK_NUM;
         return;
       case AST_TOK_NEG:
-        if (dtype == AST_DTYPE_LONG) {
+        if (dtype == AST_DTYPE_INT) {
+          ires = -v->v.ival;
+          ast_set_var_value(&node->value, &ires, 0, AST_DTYPE_INT);
+        }
+        else if (dtype == AST_DTYPE_LONG) {
           lres = -v->v.lval;
           ast_set_var_value(&node->value, &lres, 0, AST_DTYPE_LONG);
         }
+        else if (dtype == AST_DTYPE_FLOAT) {
+          fres = -v->v.fval;
+          ast_set_var_value(&node->value, &fres, 0, AST_DTYPE_FLOAT);
+        }
         else if (dtype == AST_DTYPE_DOUBLE) {
           dres = -v->v.dval;
           ast_set_var_value(&node->value, &dres, 0, AST_DTYPE_DOUBLE);
         }
         else AST_ERRNO(ast) = AST_ERR_EVAL;
+        node->type = AST_TOK_NUM;
         return;
       case AST_TOK_ABS:
-        if (dtype == AST_DTYPE_LONG) {
-          lres = (v->v.lval < 0) ? -v->v.lval : v->v.lval;
+        if (dtype == AST_DTYPE_INT) {
+          ires = (v->v.ival < 0) ? -v->v.ival: v->v.ival;
+          ast_set_var_value(&node->value, &ires, 0, AST_DTYPE_INT);
+        }
+        else if (dtype == AST_DTYPE_LONG) {
+          lres = (v->v.lval < 0) ? -v->v.lval: v->v.lval;
           ast_set_var_value(&node->value, &lres, 0, AST_DTYPE_LONG);
         }
+        else if (dtype == AST_DTYPE_FLOAT) {
+          fres = fabsf(v->v.fval);
+          ast_set_var_value(&node->value, &fres, 0, AST_DTYPE_FLOAT);
+        }
         else if (dtype == AST_DTYPE_DOUBLE) {
           dres = fabs(v->v.dval);
           ast_set_var_value(&node->value, &dres, 0, AST_DTYPE_DOUBLE);
         }
         else AST_ERRNO(ast) = AST_ERR_EVAL;
+        node->type = AST_TOK_NUM;
         return;
       case AST_TOK_SQRT:
         if (dtype == AST_DTYPE_LONG) dres = (double) v->v.lval;
@@ -1570,6 +2495,7 @@ static void ast_eval_bool(ast_t *ast, ast_node_t *node) {
         }
         dres = sqrt(dres);
         ast_set_var_value(&node->value, &dres, 0, AST_DTYPE_DOUBLE);
+        node->type = AST_TOK_NUM;
         return;
       case AST_TOK_LN:
         if (dtype == AST_DTYPE_LONG) dres = (double) v->v.lval;
@@ -1580,6 +2506,7 @@ static void ast_eval_bool(ast_t *ast, ast_node_t *node) {
         }
         dres = log(dres);
         ast_set_var_value(&node->value, &dres, 0, AST_DTYPE_DOUBLE);
+        node->type = AST_TOK_NUM;
         return;
       case AST_TOK_LOG:
         if (dtype == AST_DTYPE_LONG) dres = (double) v->v.lval;
@@ -1590,6 +2517,7 @@ static void ast_eval_bool(ast_t *ast, ast_node_t *node) {
         }
         dres = log10(dres);
         ast_set_var_value(&node->value, &dres, 0, AST_DTYPE_DOUBLE);
+        node->type = AST_TOK_NUM;
         return;
       case AST_TOK_ISFINITE:
         if (dtype == AST_DTYPE_FLOAT) bres = isfinite(v->v.fval) ? true : false;
@@ -1600,13 +2528,19 @@ static void ast_eval_bool(ast_t *ast, ast_node_t *node) {
           return;
         }
         ast_set_var_value(&node->value, &bres, 0, AST_DTYPE_BOOL);
+        node->type = AST_TOK_NUM;
         return;
       case AST_TOK_BNOT:
-        if (dtype == AST_DTYPE_LONG) {
+        if (dtype == AST_DTYPE_INT) {
+          ires = ~v->v.ival;
+          ast_set_var_value(&node->value, &ires, 0, AST_DTYPE_INT);
+        }
+        else if (dtype == AST_DTYPE_LONG) {
           lres = ~v->v.lval;
           ast_set_var_value(&node->value, &lres, 0, AST_DTYPE_LONG);
         }
         else AST_ERRNO(ast) = AST_ERR_EVAL;
+        node->type = AST_TOK_NUM;
         return;
       default:
         AST_ERRNO(ast) = AST_ERR_EVAL;
@@ -1617,20 +2551,19 @@ static void ast_eval_bool(ast_t *ast, ast_node_t *node) {
   else {
     /* Evaluate child nodes. */
     if (ast_tok_attr[node->left->type].argc != 0)
-      ast_eval_bool(ast, node->left);
+      ast_eval_pre(ast, node->left);
     if (AST_IS_ERROR(ast)) return;
+    if (node->left->type != AST_TOK_NUM && node->left->type != AST_TOK_STRING)
+      return;
+
     if (ast_tok_attr[node->right->type].argc != 0)
-      ast_eval_bool(ast, node->right);
+      ast_eval_pre(ast, node->right);
     if (AST_IS_ERROR(ast)) return;
+    if (node->right->type != AST_TOK_NUM && node->right->type != AST_TOK_STRING)
+      return;
 
-    ast_var_t *v1, *v2;
-    if (node->left->type == AST_TOK_VAR)
-      v1 = (ast_var_t *) ast->var + node->left->value.v.lval;
-    else v1 = &node->left->value;
-    if (node->right->type == AST_TOK_VAR)
-      v2 = (ast_var_t *) ast->var + node->right->value.v.lval;
-    else v2 = &node->right->value;
-
+    ast_var_t *v1 = &node->left->value;
+    ast_var_t *v2 = &node->right->value;
     int dtype = v1->dtype;
     /* Type cast for numerical types. */
     if (v1->dtype != v2->dtype) {
@@ -1649,7 +2582,9 @@ static void ast_eval_bool(ast_t *ast, ast_node_t *node) {
       }
     }
     bool bres;
+    int ires;
     long lres;
+    float fres;
     double dres;
 
     switch (node->type) {
@@ -1659,6 +2594,7 @@ static void ast_eval_bool(ast_t *ast, ast_node_t *node) {
           ast_set_var_value(&node->value, &bres, 0, AST_DTYPE_BOOL);
         }
         else AST_ERRNO(ast) = AST_ERR_EVAL;
+        node->type = AST_TOK_NUM;
         return;
       case AST_TOK_LOR:
         if (dtype == AST_DTYPE_BOOL) {
@@ -1666,6 +2602,7 @@ static void ast_eval_bool(ast_t *ast, ast_node_t *node) {
           ast_set_var_value(&node->value, &bres, 0, AST_DTYPE_BOOL);
         }
         else AST_ERRNO(ast) = AST_ERR_EVAL;
+        node->type = AST_TOK_NUM;
         return;
       case AST_TOK_LT:
         if (dtype == AST_DTYPE_LONG) bres = v1->v.lval < v2->v.lval;
@@ -1675,6 +2612,7 @@ static void ast_eval_bool(ast_t *ast, ast_node_t *node) {
           return;
         }
         ast_set_var_value(&node->value, &bres, 0, AST_DTYPE_BOOL);
+        node->type = AST_TOK_NUM;
         return;
       case AST_TOK_LE:
         if (dtype == AST_DTYPE_LONG) bres = v1->v.lval <= v2->v.lval;
@@ -1684,6 +2622,7 @@ static void ast_eval_bool(ast_t *ast, ast_node_t *node) {
           return;
         }
         ast_set_var_value(&node->value, &bres, 0, AST_DTYPE_BOOL);
+        node->type = AST_TOK_NUM;
         return;
       case AST_TOK_GT:
         if (dtype == AST_DTYPE_LONG) bres = v1->v.lval > v2->v.lval;
@@ -1693,6 +2632,7 @@ static void ast_eval_bool(ast_t *ast, ast_node_t *node) {
           return;
         }
         ast_set_var_value(&node->value, &bres, 0, AST_DTYPE_BOOL);
+        node->type = AST_TOK_NUM;
         return;
       case AST_TOK_GE:
         if (dtype == AST_DTYPE_LONG) bres = v1->v.lval >= v2->v.lval;
@@ -1702,6 +2642,7 @@ static void ast_eval_bool(ast_t *ast, ast_node_t *node) {
           return;
         }
         ast_set_var_value(&node->value, &bres, 0, AST_DTYPE_BOOL);
+        node->type = AST_TOK_NUM;
         return;
       case AST_TOK_EQ:
         if (dtype == AST_DTYPE_BOOL) bres = v1->v.bval == v2->v.bval;
@@ -1716,6 +2657,7 @@ static void ast_eval_bool(ast_t *ast, ast_node_t *node) {
           return;
         }
         ast_set_var_value(&node->value, &bres, 0, AST_DTYPE_BOOL);
+        node->type = AST_TOK_NUM;
         return;
       case AST_TOK_NEQ:
         if (dtype == AST_DTYPE_BOOL) bres = v1->v.bval != v2->v.bval;
@@ -1730,53 +2672,102 @@ static void ast_eval_bool(ast_t *ast, ast_node_t *node) {
           return;
         }
         ast_set_var_value(&node->value, &bres, 0, AST_DTYPE_BOOL);
+        node->type = AST_TOK_NUM;
         return;
       case AST_TOK_ADD:
-        if (dtype == AST_DTYPE_LONG) {
+        if (dtype == AST_DTYPE_INT) {
+          ires = v1->v.ival + v2->v.ival;
+          ast_set_var_value(&node->value, &ires, 0, AST_DTYPE_INT);
+        }
+        else if (dtype == AST_DTYPE_LONG) {
           lres = v1->v.lval + v2->v.lval;
           ast_set_var_value(&node->value, &lres, 0, AST_DTYPE_LONG);
         }
+        else if (dtype == AST_DTYPE_FLOAT) {
+          fres = v1->v.fval + v2->v.fval;
+          ast_set_var_value(&node->value, &fres, 0, AST_DTYPE_FLOAT);
+        }
         else if (dtype == AST_DTYPE_DOUBLE) {
           dres = v1->v.dval + v2->v.dval;
           ast_set_var_value(&node->value, &dres, 0, AST_DTYPE_DOUBLE);
         }
         else AST_ERRNO(ast) = AST_ERR_EVAL;
+        node->type = AST_TOK_NUM;
         return;
       case AST_TOK_MINUS:
-        if (dtype == AST_DTYPE_LONG) {
+        if (dtype == AST_DTYPE_INT) {
+          ires = v1->v.ival - v2->v.ival;
+          ast_set_var_value(&node->value, &ires, 0, AST_DTYPE_INT);
+        }
+        else if (dtype == AST_DTYPE_LONG) {
           lres = v1->v.lval - v2->v.lval;
           ast_set_var_value(&node->value, &lres, 0, AST_DTYPE_LONG);
         }
+        else if (dtype == AST_DTYPE_FLOAT) {
+          fres = v1->v.fval - v2->v.fval;
+          ast_set_var_value(&node->value, &fres, 0, AST_DTYPE_FLOAT);
+        }
         else if (dtype == AST_DTYPE_DOUBLE) {
           dres = v1->v.dval - v2->v.dval;
           ast_set_var_value(&node->value, &dres, 0, AST_DTYPE_DOUBLE);
         }
         else AST_ERRNO(ast) = AST_ERR_EVAL;
+        node->type = AST_TOK_NUM;
         return;
       case AST_TOK_MUL:
-        if (dtype == AST_DTYPE_LONG) {
+        if (dtype == AST_DTYPE_INT) {
+          ires = v1->v.ival * v2->v.ival;
+          ast_set_var_value(&node->value, &ires, 0, AST_DTYPE_INT);
+        }
+        else if (dtype == AST_DTYPE_LONG) {
           lres = v1->v.lval * v2->v.lval;
           ast_set_var_value(&node->value, &lres, 0, AST_DTYPE_LONG);
         }
+        else if (dtype == AST_DTYPE_FLOAT) {
+          fres = v1->v.fval * v2->v.fval;
+          ast_set_var_value(&node->value, &fres, 0, AST_DTYPE_FLOAT);
+        }
         else if (dtype == AST_DTYPE_DOUBLE) {
           dres = v1->v.dval * v2->v.dval;
           ast_set_var_value(&node->value, &dres, 0, AST_DTYPE_DOUBLE);
         }
         else AST_ERRNO(ast) = AST_ERR_EVAL;
+        node->type = AST_TOK_NUM;
         return;
       case AST_TOK_DIV:
-        if (dtype == AST_DTYPE_LONG) {
+        if (dtype == AST_DTYPE_INT) {
+          ires = v1->v.ival / v2->v.ival;
+          ast_set_var_value(&node->value, &ires, 0, AST_DTYPE_INT);
+        }
+        else if (dtype == AST_DTYPE_LONG) {
           lres = v1->v.lval / v2->v.lval;
           ast_set_var_value(&node->value, &lres, 0, AST_DTYPE_LONG);
         }
+        else if (dtype == AST_DTYPE_FLOAT) {
+          fres = v1->v.fval / v2->v.fval;
+          ast_set_var_value(&node->value, &fres, 0, AST_DTYPE_FLOAT);
+        }
         else if (dtype == AST_DTYPE_DOUBLE) {
           dres = v1->v.dval / v2->v.dval;
           ast_set_var_value(&node->value, &dres, 0, AST_DTYPE_DOUBLE);
         }
         else AST_ERRNO(ast) = AST_ERR_EVAL;
+        node->type = AST_TOK_NUM;
         return;
       case AST_TOK_EXP:
-        if (dtype == AST_DTYPE_LONG) {
+        if (dtype == AST_DTYPE_INT) {
+          ires = 0;
+          if (v2->v.ival > UINT8_MAX) {
+            if (v1->v.ival == 1) ires = 1;
+            else if (v1->v.ival == -1) ires = 1 - 2 * (v2->v.ival & 1);
+          }
+          else {
+            int64_t tmp = ipow(v1->v.ival, v2->v.ival);
+            if (tmp <= INT_MAX) ires = (int) tmp;
+          }
+          ast_set_var_value(&node->value, &ires, 0, AST_DTYPE_INT);
+        }
+        else if (dtype == AST_DTYPE_LONG) {
           lres = 0;
           if (v2->v.lval > UINT8_MAX) {
             if (v1->v.lval == 1) lres = 1;
@@ -1788,57 +2779,96 @@ static void ast_eval_bool(ast_t *ast, ast_node_t *node) {
           }
           ast_set_var_value(&node->value, &lres, 0, AST_DTYPE_LONG);
         }
+        else if (dtype == AST_DTYPE_FLOAT) {
+          fres = powf(v1->v.fval, v2->v.fval);
+          ast_set_var_value(&node->value, &fres, 0, AST_DTYPE_FLOAT);
+        }
         else if (dtype == AST_DTYPE_DOUBLE) {
           dres = pow(v1->v.dval, v2->v.dval);
           ast_set_var_value(&node->value, &dres, 0, AST_DTYPE_DOUBLE);
         }
         else AST_ERRNO(ast) = AST_ERR_EVAL;
+        node->type = AST_TOK_NUM;
         return;
       case AST_TOK_REM:
-        if (dtype == AST_DTYPE_LONG) {
+        if (dtype == AST_DTYPE_INT) {
+          ires = v1->v.ival % v2->v.ival;
+          ast_set_var_value(&node->value, &ires, 0, AST_DTYPE_INT);
+        }
+        else if (dtype == AST_DTYPE_LONG) {
           lres = v1->v.lval % v2->v.lval;
           ast_set_var_value(&node->value, &lres, 0, AST_DTYPE_LONG);
         }
+        else if (dtype == AST_DTYPE_FLOAT) {
+          fres = fmod(v1->v.fval, v2->v.fval);
+          ast_set_var_value(&node->value, &fres, 0, AST_DTYPE_FLOAT);
+        }
         else if (dtype == AST_DTYPE_DOUBLE) {
           dres = fmod(v1->v.dval, v2->v.dval);
           ast_set_var_value(&node->value, &dres, 0, AST_DTYPE_DOUBLE);
         }
         else AST_ERRNO(ast) = AST_ERR_EVAL;
+        node->type = AST_TOK_NUM;
         return;
       case AST_TOK_LEFT:
-        if (dtype == AST_DTYPE_LONG) {
+        if (dtype == AST_DTYPE_INT) {
+          ires = v1->v.ival << v2->v.ival;
+          ast_set_var_value(&node->value, &ires, 0, AST_DTYPE_INT);
+        }
+        else if (dtype == AST_DTYPE_LONG) {
           lres = v1->v.lval << v2->v.lval;
           ast_set_var_value(&node->value, &lres, 0, AST_DTYPE_LONG);
         }
         else AST_ERRNO(ast) = AST_ERR_EVAL;
+        node->type = AST_TOK_NUM;
         return;
       case AST_TOK_RIGHT:
-        if (dtype == AST_DTYPE_LONG) {
+        if (dtype == AST_DTYPE_INT) {
+          ires = v1->v.ival >> v2->v.ival;
+          ast_set_var_value(&node->value, &ires, 0, AST_DTYPE_INT);
+        }
+        else if (dtype == AST_DTYPE_LONG) {
           lres = v1->v.lval >> v2->v.lval;
           ast_set_var_value(&node->value, &lres, 0, AST_DTYPE_LONG);
         }
         else AST_ERRNO(ast) = AST_ERR_EVAL;
+        node->type = AST_TOK_NUM;
         return;
       case AST_TOK_BAND:
-        if (dtype == AST_DTYPE_LONG) {
+        if (dtype == AST_DTYPE_INT) {
+          ires = v1->v.ival & v2->v.ival;
+          ast_set_var_value(&node->value, &ires, 0, AST_DTYPE_INT);
+        }
+        else if (dtype == AST_DTYPE_LONG) {
           lres = v1->v.lval & v2->v.lval;
           ast_set_var_value(&node->value, &lres, 0, AST_DTYPE_LONG);
         }
         else AST_ERRNO(ast) = AST_ERR_EVAL;
+        node->type = AST_TOK_NUM;
         return;
       case AST_TOK_BXOR:
-        if (dtype == AST_DTYPE_LONG) {
+        if (dtype == AST_DTYPE_INT) {
+          ires = v1->v.ival ^ v2->v.ival;
+          ast_set_var_value(&node->value, &ires, 0, AST_DTYPE_INT);
+        }
+        else if (dtype == AST_DTYPE_LONG) {
           lres = v1->v.lval ^ v2->v.lval;
           ast_set_var_value(&node->value, &lres, 0, AST_DTYPE_LONG);
         }
         else AST_ERRNO(ast) = AST_ERR_EVAL;
+        node->type = AST_TOK_NUM;
         return;
       case AST_TOK_BOR:
-        if (dtype == AST_DTYPE_LONG) {
+        if (dtype == AST_DTYPE_INT) {
+          ires = v1->v.ival | v2->v.ival;
+          ast_set_var_value(&node->value, &ires, 0, AST_DTYPE_INT);
+        }
+        else if (dtype == AST_DTYPE_LONG) {
           lres = v1->v.lval | v2->v.lval;
           ast_set_var_value(&node->value, &lres, 0, AST_DTYPE_LONG);
         }
         else AST_ERRNO(ast) = AST_ERR_EVAL;
+        node->type = AST_TOK_NUM;
         return;
       default:
         AST_ERRNO(ast) = AST_ERR_EVAL;
@@ -1848,673 +2878,7164 @@ static void ast_eval_bool(ast_t *ast, ast_node_t *node) {
 }
 
 /******************************************************************************
-Function `ast_eval_pre`:
-  Pre-evaluate values in the abstract syntax tree.
+Function `ast_fuse_madd`:
+  Contract `a * b + c`, `c + a * b`, and `a * b - c` in the abstract syntax
+  tree into fused multiply-add nodes, which keep the multiplication node as
+  the left child, and the addend or subtrahend as the right child.
 Arguments:
-  * `ast`:      interface of the abstract syntax tree;
   * `node`:     a node of the abstract syntax tree.
 ******************************************************************************/
-static void ast_eval_pre(ast_t *ast, ast_node_t *node) {
-  if (AST_IS_ERROR(ast)) return;
-  if (ast_tok_attr[node->type].argc == 0) return;
-  /* Unary operators. */
-  if (ast_tok_attr[node->type].argc == 1) {
-    /* The child node is not evaluated. */
-    if (ast_tok_attr[node->left->type].argc != 0)
-      ast_eval_pre(ast, node->left);
-    if (AST_IS_ERROR(ast)) return;
+static void ast_fuse_madd(ast_node_t *node) {
+  const int argc = ast_tok_attr[node->type].argc;
+  if (argc == 0) return;
+  ast_fuse_madd(node->left);
+  if (argc == 1) return;
+  ast_fuse_madd(node->right);
+
+  if (node->type == AST_TOK_ADD) {
+    if (node->left->type != AST_TOK_MUL && node->right->type == AST_TOK_MUL) {
+      ast_node_t *tmp = node->left;
+      node->left = node->right;
+      node->right = tmp;
+    }
+    if (node->left->type == AST_TOK_MUL) node->type = AST_TOK_FMA;
+  }
+  else if (node->type == AST_TOK_MINUS && node->left->type == AST_TOK_MUL)
+    node->type = AST_TOK_FMS;
+}
 
-    if (node->left->type != AST_TOK_NUM && node->left->type != AST_TOK_STRING)
-      return;
 
-    ast_var_t *v = &node->left->value;
-    const int dtype = v->dtype;
-    bool bres;
-    int ires;
-    long lres;
-    float fres;
-    double dres;
+/*============================================================================*\
+                      Functions for the compiled program
+\*============================================================================*/
 
-    switch (node->type) {
-      case AST_TOK_LNOT:
-        if (dtype == AST_DTYPE_BOOL) bres = !v->v.bval;
-        else if (dtype == AST_DTYPE_LONG) bres = !v->v.lval;
-        else if (dtype == AST_DTYPE_DOUBLE) bres = !v->v.dval;
-        else {
-          AST_ERRNO(ast) = AST_ERR_EVAL;
-          return;
-        }
-        ast_set_var_value(&node->value, &bres, 0, AST_DTYPE_BOOL);
-        node->type = AST_TOK_NUM;
-        return;
-      case AST_TOK_NEG:
-        if (dtype == AST_DTYPE_INT) {
-          ires = -v->v.ival;
-          ast_set_var_value(&node->value, &ires, 0, AST_DTYPE_INT);
-        }
-        else if (dtype == AST_DTYPE_LONG) {
-          lres = -v->v.lval;
-          ast_set_var_value(&node->value, &lres, 0, AST_DTYPE_LONG);
-        }
-        else if (dtype == AST_DTYPE_FLOAT) {
-          fres = -v->v.fval;
-          ast_set_var_value(&node->value, &fres, 0, AST_DTYPE_FLOAT);
-        }
-        else if (dtype == AST_DTYPE_DOUBLE) {
-          dres = -v->v.dval;
-          ast_set_var_value(&node->value, &dres, 0, AST_DTYPE_DOUBLE);
-        }
-        else AST_ERRNO(ast) = AST_ERR_EVAL;
-        node->type = AST_TOK_NUM;
-        return;
-      case AST_TOK_ABS:
-        if (dtype == AST_DTYPE_INT) {
-          ires = (v->v.ival < 0) ? -v->v.ival: v->v.ival;
-          ast_set_var_value(&node->value, &ires, 0, AST_DTYPE_INT);
-        }
-        else if (dtype == AST_DTYPE_LONG) {
-          lres = (v->v.lval < 0) ? -v->v.lval: v->v.lval;
-          ast_set_var_value(&node->value, &lres, 0, AST_DTYPE_LONG);
-        }
-        else if (dtype == AST_DTYPE_FLOAT) {
-          fres = fabsf(v->v.fval);
-          ast_set_var_value(&node->value, &fres, 0, AST_DTYPE_FLOAT);
-        }
-        else if (dtype == AST_DTYPE_DOUBLE) {
-          dres = fabs(v->v.dval);
-          ast_set_var_value(&node->value, &dres, 0, AST_DTYPE_DOUBLE);
-        }
-        else AST_ERRNO(ast) = AST_ERR_EVAL;
-        node->type = AST_TOK_NUM;
-        return;
-      case AST_TOK_SQRT:
-        if (dtype == AST_DTYPE_LONG) dres = (double) v->v.lval;
-        else if (dtype == AST_DTYPE_DOUBLE) dres = v->v.dval;
-        else {
-          AST_ERRNO(ast) = AST_ERR_EVAL;
-          return;
-        }
-        dres = sqrt(dres);
-        ast_set_var_value(&node->value, &dres, 0, AST_DTYPE_DOUBLE);
-        node->type = AST_TOK_NUM;
-        return;
-      case AST_TOK_LN:
-        if (dtype == AST_DTYPE_LONG) dres = (double) v->v.lval;
-        else if (dtype == AST_DTYPE_DOUBLE) dres = v->v.dval;
-        else {
-          AST_ERRNO(ast) = AST_ERR_EVAL;
-          return;
-        }
-        dres = log(dres);
-        ast_set_var_value(&node->value, &dres, 0, AST_DTYPE_DOUBLE);
-        node->type = AST_TOK_NUM;
-        return;
-      case AST_TOK_LOG:
-        if (dtype == AST_DTYPE_LONG) dres = (double) v->v.lval;
-        else if (dtype == AST_DTYPE_DOUBLE) dres = v->v.dval;
-        else {
-          AST_ERRNO(ast) = AST_ERR_EVAL;
-          return;
-        }
-        dres = log10(dres);
-        ast_set_var_value(&node->value, &dres, 0, AST_DTYPE_DOUBLE);
-        node->type = AST_TOK_NUM;
-        return;
-      case AST_TOK_ISFINITE:
-        if (dtype == AST_DTYPE_FLOAT) bres = isfinite(v->v.fval) ? true : false;
-        else if (dtype == AST_DTYPE_DOUBLE)
-          bres = isfinite(v->v.dval) ? true : false;
-        else {
-          AST_ERRNO(ast) = AST_ERR_EVAL;
-          return;
-        }
-        ast_set_var_value(&node->value, &bres, 0, AST_DTYPE_BOOL);
-        node->type = AST_TOK_NUM;
-        return;
-      case AST_TOK_BNOT:
-        if (dtype == AST_DTYPE_INT) {
-          ires = ~v->v.ival;
-          ast_set_var_value(&node->value, &ires, 0, AST_DTYPE_INT);
-        }
-        else if (dtype == AST_DTYPE_LONG) {
-          lres = ~v->v.lval;
-          ast_set_var_value(&node->value, &lres, 0, AST_DTYPE_LONG);
-        }
-        else AST_ERRNO(ast) = AST_ERR_EVAL;
-        node->type = AST_TOK_NUM;
-        return;
-      default:
-        AST_ERRNO(ast) = AST_ERR_EVAL;
-        return;
+/******************************************************************************
+Function `ast_count_node`:
+  Count the number of nodes of the abstract syntax tree.
+Arguments:
+  * `node`:     a node of the abstract syntax tree.
+Return:
+  The number of nodes.
+******************************************************************************/
+static long ast_count_node(const ast_node_t *node) {
+  if (!node) return 0;
+  return ast_count_node(node->left) + ast_count_node(node->right) + 1;
+}
+
+/******************************************************************************
+Function `ast_prog_init`:
+  Create an empty compiled program for the abstract syntax tree.
+Arguments:
+  * `ast`:      interface of the abstract syntax tree.
+Return:
+  The compiled program on success; NULL on error.
+******************************************************************************/
+static ast_prog_t *ast_prog_init(ast_t *ast) {
+  if (ast->prog) return (ast_prog_t *) ast->prog;
+  ast_prog_t *prog = malloc(sizeof *prog);
+  if (!prog) return NULL;
+  prog->dtype = ast->dtype;
+  prog->nvar = ast->nvar;
+  prog->vidx = ast->vidx;
+  prog->exp = ast->exp;
+  prog->vtype = NULL;
+  prog->ninstr = prog->depth = 0;
+  prog->instr = NULL;
+  prog->clos = NULL;
+  prog->code = NULL;
+  prog->csize = 0;
+  prog->dl = NULL;
+  prog->ifunc = NULL;
+  prog->lfunc = NULL;
+  prog->ffunc = NULL;
+  prog->dfunc = NULL;
+  prog->math = AST_MATH_EXACT;
+  prog->simd = ast_eval_simd();
+  prog->fma = false;
+
+  /* Record the accepted data types of variables for boolean expressions. */
+  if (ast->dtype == AST_DTYPE_BOOL && ast->nvar) {
+    if (!(prog->vtype = malloc(ast->nvar * sizeof(int)))) {
+      free(prog);
+      return NULL;
     }
+    for (long i = 0; i < ast->nvar; i++)
+      prog->vtype[i] = ((ast_var_t *) ast->var)[i].dtype;
   }
-  /* Binary operators. */
-  else {
-    /* Evaluate child nodes. */
-    if (ast_tok_attr[node->left->type].argc != 0)
-      ast_eval_pre(ast, node->left);
-    if (AST_IS_ERROR(ast)) return;
-    if (node->left->type != AST_TOK_NUM && node->left->type != AST_TOK_STRING)
-      return;
+  ast->prog = prog;
+  return prog;
+}
 
-    if (ast_tok_attr[node->right->type].argc != 0)
-      ast_eval_pre(ast, node->right);
-    if (AST_IS_ERROR(ast)) return;
-    if (node->right->type != AST_TOK_NUM && node->right->type != AST_TOK_STRING)
-      return;
+/******************************************************************************
+Function `ast_prog_valid`:
+  Check if an operator is supported by the evaluator of a given data type.
+Arguments:
+  * `type`:     type of the operator;
+  * `dtype`:    data type of the expression.
+Return:
+  True if the operator is supported; false otherwise.
+******************************************************************************/
+static bool ast_prog_valid(const ast_tok_t type, const ast_dtype_t dtype) {
+  if (type == AST_TOK_NUM || type == AST_TOK_VAR) return true;
+  if (dtype == AST_DTYPE_BOOL) {
+    /* Data types are validated on evaluation for boolean expressions. */
+    if (type == AST_TOK_STRING) return true;
+    return ast_tok_attr[type].type == AST_TOKT_UOPT ||
+      ast_tok_attr[type].type == AST_TOKT_BOPT ||
+      ast_tok_attr[type].type == AST_TOKT_FUNC;
+  }
+  switch (type) {
+    case AST_TOK_NEG:
+    case AST_TOK_ABS:
+    case AST_TOK_ADD:
+    case AST_TOK_MINUS:
+    case AST_TOK_MUL:
+    case AST_TOK_DIV:
+    case AST_TOK_REM:
+    case AST_TOK_EXP:
+      return true;
+    case AST_TOK_SQRT:
+    case AST_TOK_LN:
+    case AST_TOK_LOG:
+    case AST_TOK_FMA:
+    case AST_TOK_FMS:
+      return (dtype & AST_DTYPE_REAL) != 0;
+    case AST_TOK_BNOT:
+    case AST_TOK_LEFT:
+    case AST_TOK_RIGHT:
+    case AST_TOK_BAND:
+    case AST_TOK_BXOR:
+    case AST_TOK_BOR:
+      return (dtype & AST_DTYPE_INTEGER) != 0;
+    default:
+      return false;
+  }
+}
 
-    ast_var_t *v1 = &node->left->value;
-    ast_var_t *v2 = &node->right->value;
-    int dtype = v1->dtype;
-    /* Type cast for numerical types. */
-    if (v1->dtype != v2->dtype) {
-      if (v1->dtype == AST_DTYPE_LONG) {
-        double tmp = (double) v1->v.lval;
-        ast_set_var_value(v1, &tmp, 0, AST_DTYPE_DOUBLE);
-        dtype = AST_DTYPE_DOUBLE;
+/******************************************************************************
+Function `ast_prog_emit`:
+  Append the nodes of the abstract syntax tree to the program in postfix order.
+Arguments:
+  * `ast`:      interface of the abstract syntax tree;
+  * `node`:     a node of the abstract syntax tree;
+  * `prog`:     the compiled program;
+  * `depth`:    current depth of the value stack.
+Return:
+  Zero on success; non-zero on error.
+******************************************************************************/
+static int ast_prog_emit(const ast_t *ast, const ast_node_t *node,
+    ast_prog_t *prog, long *depth) {
+  if (!ast_prog_valid(node->type, ast->dtype)) return AST_ERR_EVAL;
+  const int argc = ast_tok_attr[node->type].argc;
+
+  /* Fused multiply-add pops both factors of the product and the addend. */
+  if (node->type == AST_TOK_FMA || node->type == AST_TOK_FMS) {
+    if (ast_prog_emit(ast, node->left->left, prog, depth) ||
+        ast_prog_emit(ast, node->left->right, prog, depth) ||
+        ast_prog_emit(ast, node->right, prog, depth))
+      return AST_ERR_EVAL;
+    ast_instr_t *instr = prog->instr + prog->ninstr++;
+    instr->op = node->type;
+    instr->value = node->value;
+    instr->jump = 0;
+    *depth -= 2;
+    return 0;
+  }
+  if (argc >= 1 && ast_prog_emit(ast, node->left, prog, depth))
+    return AST_ERR_EVAL;
+
+  /* Branch for the short-circuit of `&&` and `||`, which skips the right
+     operand and the operator if the left operand decides the result. */
+  ast_instr_t *branch = NULL;
+  if (ast->dtype == AST_DTYPE_BOOL &&
+      (node->type == AST_TOK_LAND || node->type == AST_TOK_LOR)) {
+    branch = prog->instr + prog->ninstr++;
+    branch->op = node->type;
+    branch->value = node->value;
+  }
+  if (argc == 2 && ast_prog_emit(ast, node->right, prog, depth))
+    return AST_ERR_EVAL;
+
+  ast_instr_t *instr = prog->instr + prog->ninstr++;
+  instr->op = node->type;
+  instr->value = node->value;
+  instr->jump = 0;
+  if (branch) branch->jump = prog->ninstr;
+
+  /* Literals and variables are pushed, while binary operators pop. */
+  if (argc == 0 && ++(*depth) > prog->depth) prog->depth = *depth;
+  else if (argc == 2) *depth -= 1;
+  return 0;
+}
+
+/******************************************************************************
+Function `ast_prog_eval_int`:
+  Evaluate the compiled program in int type.
+Arguments:
+  * `prog`:     the compiled program;
+  * `var`:      the variable array;
+  * `vidx`:     indices of variables for `var`, NULL if `var` is indexed by
+                the positions of unique variables.
+Return:
+  The resulting integer.
+******************************************************************************/
+static int ast_prog_eval_int(const ast_prog_t *prog, const int *var,
+    const long *vidx) {
+  int stack[prog->depth];
+  int *sp = stack;
+  int64_t res;
+  const ast_instr_t *ip = prog->instr;
+
+  AST_PROG_DISPATCH {
+    AST_PROG_CASE(AST_TOK_NUM)
+      *sp++ = ip->value.v.ival;
+      AST_PROG_NEXT;
+    AST_PROG_CASE(AST_TOK_VAR)
+      if (vidx) *sp++ = var[vidx[ip->value.v.lval] - 1];
+      else *sp++ = var[ip->value.v.lval];
+      AST_PROG_NEXT;
+    AST_PROG_CASE(AST_TOK_NEG)
+      sp[-1] = -sp[-1];
+      AST_PROG_NEXT;
+    AST_PROG_CASE(AST_TOK_ABS)
+      if (sp[-1] < 0) sp[-1] = -sp[-1];
+      AST_PROG_NEXT;
+    AST_PROG_CASE(AST_TOK_BNOT)
+      sp[-1] = ~sp[-1];
+      AST_PROG_NEXT;
+    AST_PROG_CASE(AST_TOK_ADD)
+      sp--;
+      sp[-1] += *sp;
+      AST_PROG_NEXT;
+    AST_PROG_CASE(AST_TOK_MINUS)
+      sp--;
+      sp[-1] -= *sp;
+      AST_PROG_NEXT;
+    AST_PROG_CASE(AST_TOK_MUL)
+      sp--;
+      sp[-1] *= *sp;
+      AST_PROG_NEXT;
+    AST_PROG_CASE(AST_TOK_DIV)
+      sp--;
+      sp[-1] /= *sp;
+      AST_PROG_NEXT;
+    AST_PROG_CASE(AST_TOK_REM)
+      sp--;
+      sp[-1] %= *sp;
+      AST_PROG_NEXT;
+    AST_PROG_CASE(AST_TOK_EXP)
+      sp--;
+      if (*sp > UINT8_MAX) {
+        if (sp[-1] != 1) sp[-1] = (sp[-1] == -1) ? 1 - 2 * (*sp & 1) : 0;
       }
-      else if (v2->dtype == AST_DTYPE_LONG) {
-        double tmp = (double) v2->v.lval;
-        ast_set_var_value(v2, &tmp, 0, AST_DTYPE_DOUBLE);
+      else {
+        res = ipow(sp[-1], *sp);
+        sp[-1] = (res > INT_MAX) ? 0 : (int) res;
+      }
+      AST_PROG_NEXT;
+    AST_PROG_CASE(AST_TOK_LEFT)
+      sp--;
+      sp[-1] <<= *sp;
+      AST_PROG_NEXT;
+    AST_PROG_CASE(AST_TOK_RIGHT)
+      sp--;
+      sp[-1] >>= *sp;
+      AST_PROG_NEXT;
+    AST_PROG_CASE(AST_TOK_BAND)
+      sp--;
+      sp[-1] &= *sp;
+      AST_PROG_NEXT;
+    AST_PROG_CASE(AST_TOK_BXOR)
+      sp--;
+      sp[-1] ^= *sp;
+      AST_PROG_NEXT;
+    AST_PROG_CASE(AST_TOK_BOR)
+      sp--;
+      sp[-1] |= *sp;
+      AST_PROG_NEXT;
+    /* End of the program, or operators not for this data type. */
+    AST_PROG_CASE(AST_TOK_UNDEF)
+    AST_PROG_CASE(AST_TOK_STRING)
+    AST_PROG_CASE(AST_TOK_PAREN_LEFT)
+    AST_PROG_CASE(AST_TOK_PAREN_RIGHT)
+    AST_PROG_CASE(AST_TOK_SQRT)
+    AST_PROG_CASE(AST_TOK_LN)
+    AST_PROG_CASE(AST_TOK_LOG)
+    AST_PROG_CASE(AST_TOK_ISFINITE)
+    AST_PROG_CASE(AST_TOK_LNOT)
+    AST_PROG_CASE(AST_TOK_LT)
+    AST_PROG_CASE(AST_TOK_LE)
+    AST_PROG_CASE(AST_TOK_GT)
+    AST_PROG_CASE(AST_TOK_GE)
+    AST_PROG_CASE(AST_TOK_EQ)
+    AST_PROG_CASE(AST_TOK_NEQ)
+    AST_PROG_CASE(AST_TOK_LAND)
+    AST_PROG_CASE(AST_TOK_LOR)
+    AST_PROG_CASE(AST_TOK_FMA)
+    AST_PROG_CASE(AST_TOK_FMS)
+      return *stack;
+  }
+}
+
+/******************************************************************************
+Function `ast_prog_eval_long`:
+  Evaluate the compiled program in long int type.
+Arguments:
+  * `prog`:     the compiled program;
+  * `var`:      the variable array;
+  * `vidx`:     indices of variables for `var`, NULL if `var` is indexed by
+                the positions of unique variables.
+Return:
+  The resulting long integer.
+******************************************************************************/
+static long ast_prog_eval_long(const ast_prog_t *prog, const long *var,
+    const long *vidx) {
+  long stack[prog->depth];
+  long *sp = stack;
+  int64_t res;
+  const ast_instr_t *ip = prog->instr;
+
+  AST_PROG_DISPATCH {
+    AST_PROG_CASE(AST_TOK_NUM)
+      *sp++ = ip->value.v.lval;
+      AST_PROG_NEXT;
+    AST_PROG_CASE(AST_TOK_VAR)
+      if (vidx) *sp++ = var[vidx[ip->value.v.lval] - 1];
+      else *sp++ = var[ip->value.v.lval];
+      AST_PROG_NEXT;
+    AST_PROG_CASE(AST_TOK_NEG)
+      sp[-1] = -sp[-1];
+      AST_PROG_NEXT;
+    AST_PROG_CASE(AST_TOK_ABS)
+      if (sp[-1] < 0) sp[-1] = -sp[-1];
+      AST_PROG_NEXT;
+    AST_PROG_CASE(AST_TOK_BNOT)
+      sp[-1] = ~sp[-1];
+      AST_PROG_NEXT;
+    AST_PROG_CASE(AST_TOK_ADD)
+      sp--;
+      sp[-1] += *sp;
+      AST_PROG_NEXT;
+    AST_PROG_CASE(AST_TOK_MINUS)
+      sp--;
+      sp[-1] -= *sp;
+      AST_PROG_NEXT;
+    AST_PROG_CASE(AST_TOK_MUL)
+      sp--;
+      sp[-1] *= *sp;
+      AST_PROG_NEXT;
+    AST_PROG_CASE(AST_TOK_DIV)
+      sp--;
+      sp[-1] /= *sp;
+      AST_PROG_NEXT;
+    AST_PROG_CASE(AST_TOK_REM)
+      sp--;
+      sp[-1] %= *sp;
+      AST_PROG_NEXT;
+    AST_PROG_CASE(AST_TOK_EXP)
+      sp--;
+      if (*sp > UINT8_MAX) {
+        if (sp[-1] != 1) sp[-1] = (sp[-1] == -1) ? 1 - 2 * (*sp & 1) : 0;
       }
       else {
-        AST_ERRNO(ast) = AST_ERR_EVAL;
-        return;
+        res = ipow(sp[-1], *sp);
+        sp[-1] = (res > LONG_MAX) ? 0 : (long) res;
       }
+      AST_PROG_NEXT;
+    AST_PROG_CASE(AST_TOK_LEFT)
+      sp--;
+      sp[-1] <<= *sp;
+      AST_PROG_NEXT;
+    AST_PROG_CASE(AST_TOK_RIGHT)
+      sp--;
+      sp[-1] >>= *sp;
+      AST_PROG_NEXT;
+    AST_PROG_CASE(AST_TOK_BAND)
+      sp--;
+      sp[-1] &= *sp;
+      AST_PROG_NEXT;
+    AST_PROG_CASE(AST_TOK_BXOR)
+      sp--;
+      sp[-1] ^= *sp;
+      AST_PROG_NEXT;
+    AST_PROG_CASE(AST_TOK_BOR)
+      sp--;
+      sp[-1] |= *sp;
+      AST_PROG_NEXT;
+    /* End of the program, or operators not for this data type. */
+    AST_PROG_CASE(AST_TOK_UNDEF)
+    AST_PROG_CASE(AST_TOK_STRING)
+    AST_PROG_CASE(AST_TOK_PAREN_LEFT)
+    AST_PROG_CASE(AST_TOK_PAREN_RIGHT)
+    AST_PROG_CASE(AST_TOK_SQRT)
+    AST_PROG_CASE(AST_TOK_LN)
+    AST_PROG_CASE(AST_TOK_LOG)
+    AST_PROG_CASE(AST_TOK_ISFINITE)
+    AST_PROG_CASE(AST_TOK_LNOT)
+    AST_PROG_CASE(AST_TOK_LT)
+    AST_PROG_CASE(AST_TOK_LE)
+    AST_PROG_CASE(AST_TOK_GT)
+    AST_PROG_CASE(AST_TOK_GE)
+    AST_PROG_CASE(AST_TOK_EQ)
+    AST_PROG_CASE(AST_TOK_NEQ)
+    AST_PROG_CASE(AST_TOK_LAND)
+    AST_PROG_CASE(AST_TOK_LOR)
+    AST_PROG_CASE(AST_TOK_FMA)
+    AST_PROG_CASE(AST_TOK_FMS)
+      return *stack;
+  }
+}
+
+/******************************************************************************
+Function `ast_prog_eval_float`:
+  Evaluate the compiled program in float type.
+Arguments:
+  * `prog`:     the compiled program;
+  * `var`:      the variable array;
+  * `vidx`:     indices of variables for `var`, NULL if `var` is indexed by
+                the positions of unique variables.
+Return:
+  The resulting float number.
+******************************************************************************/
+static float ast_prog_eval_float(const ast_prog_t *prog, const float *var,
+    const long *vidx) {
+  float stack[prog->depth];
+  float *sp = stack;
+  const ast_instr_t *ip = prog->instr;
+
+  AST_PROG_DISPATCH {
+    AST_PROG_CASE(AST_TOK_NUM)
+      *sp++ = ip->value.v.fval;
+      AST_PROG_NEXT;
+    AST_PROG_CASE(AST_TOK_VAR)
+      if (vidx) *sp++ = var[vidx[ip->value.v.lval] - 1];
+      else *sp++ = var[ip->value.v.lval];
+      AST_PROG_NEXT;
+    AST_PROG_CASE(AST_TOK_NEG)
+      sp[-1] = -sp[-1];
+      AST_PROG_NEXT;
+    AST_PROG_CASE(AST_TOK_ABS)
+      sp[-1] = fabsf(sp[-1]);
+      AST_PROG_NEXT;
+    AST_PROG_CASE(AST_TOK_SQRT)
+      sp[-1] = sqrtf(sp[-1]);
+      AST_PROG_NEXT;
+    AST_PROG_CASE(AST_TOK_LN)
+      sp[-1] = logf(sp[-1]);
+      AST_PROG_NEXT;
+    AST_PROG_CASE(AST_TOK_LOG)
+      sp[-1] = log10f(sp[-1]);
+      AST_PROG_NEXT;
+    AST_PROG_CASE(AST_TOK_ADD)
+      sp--;
+      sp[-1] += *sp;
+      AST_PROG_NEXT;
+    AST_PROG_CASE(AST_TOK_MINUS)
+      sp--;
+      sp[-1] -= *sp;
+      AST_PROG_NEXT;
+    AST_PROG_CASE(AST_TOK_MUL)
+      sp--;
+      sp[-1] *= *sp;
+      AST_PROG_NEXT;
+    AST_PROG_CASE(AST_TOK_DIV)
+      sp--;
+      sp[-1] /= *sp;
+      AST_PROG_NEXT;
+    AST_PROG_CASE(AST_TOK_EXP)
+      sp--;
+      sp[-1] = powf(sp[-1], *sp);
+      AST_PROG_NEXT;
+    AST_PROG_CASE(AST_TOK_REM)
+      sp--;
+      sp[-1] = fmodf(sp[-1], *sp);
+      AST_PROG_NEXT;
+    AST_PROG_CASE(AST_TOK_FMA)
+      sp -= 2;
+      sp[-1] = fmaf(sp[-1], *sp, sp[1]);
+      AST_PROG_NEXT;
+    AST_PROG_CASE(AST_TOK_FMS)
+      sp -= 2;
+      sp[-1] = fmaf(sp[-1], *sp, -sp[1]);
+      AST_PROG_NEXT;
+    /* End of the program, or operators not for this data type. */
+    AST_PROG_CASE(AST_TOK_UNDEF)
+    AST_PROG_CASE(AST_TOK_STRING)
+    AST_PROG_CASE(AST_TOK_PAREN_LEFT)
+    AST_PROG_CASE(AST_TOK_PAREN_RIGHT)
+    AST_PROG_CASE(AST_TOK_ISFINITE)
+    AST_PROG_CASE(AST_TOK_LNOT)
+    AST_PROG_CASE(AST_TOK_BNOT)
+    AST_PROG_CASE(AST_TOK_LEFT)
+    AST_PROG_CASE(AST_TOK_RIGHT)
+    AST_PROG_CASE(AST_TOK_LT)
+    AST_PROG_CASE(AST_TOK_LE)
+    AST_PROG_CASE(AST_TOK_GT)
+    AST_PROG_CASE(AST_TOK_GE)
+    AST_PROG_CASE(AST_TOK_EQ)
+    AST_PROG_CASE(AST_TOK_NEQ)
+    AST_PROG_CASE(AST_TOK_BAND)
+    AST_PROG_CASE(AST_TOK_BXOR)
+    AST_PROG_CASE(AST_TOK_BOR)
+    AST_PROG_CASE(AST_TOK_LAND)
+    AST_PROG_CASE(AST_TOK_LOR)
+      return *stack;
+  }
+}
+
+/******************************************************************************
+Function `ast_prog_eval_double`:
+  Evaluate the compiled program in double type.
+Arguments:
+  * `prog`:     the compiled program;
+  * `var`:      the variable array;
+  * `vidx`:     indices of variables for `var`, NULL if `var` is indexed by
+                the positions of unique variables.
+Return:
+  The resulting double number.
+******************************************************************************/
+static double ast_prog_eval_double(const ast_prog_t *prog, const double *var,
+    const long *vidx) {
+  double stack[prog->depth];
+  double *sp = stack;
+  const ast_instr_t *ip = prog->instr;
+
+  AST_PROG_DISPATCH {
+    AST_PROG_CASE(AST_TOK_NUM)
+      *sp++ = ip->value.v.dval;
+      AST_PROG_NEXT;
+    AST_PROG_CASE(AST_TOK_VAR)
+      if (vidx) *sp++ = var[vidx[ip->value.v.lval] - 1];
+      else *sp++ = var[ip->value.v.lval];
+      AST_PROG_NEXT;
+    AST_PROG_CASE(AST_TOK_NEG)
+      sp[-1] = -sp[-1];
+      AST_PROG_NEXT;
+    AST_PROG_CASE(AST_TOK_ABS)
+      sp[-1] = fabs(sp[-1]);
+      AST_PROG_NEXT;
+    AST_PROG_CASE(AST_TOK_SQRT)
+      sp[-1] = sqrt(sp[-1]);
+      AST_PROG_NEXT;
+    AST_PROG_CASE(AST_TOK_LN)
+      sp[-1] = log(sp[-1]);
+      AST_PROG_NEXT;
+    AST_PROG_CASE(AST_TOK_LOG)
+      sp[-1] = log10(sp[-1]);
+      AST_PROG_NEXT;
+    AST_PROG_CASE(AST_TOK_ADD)
+      sp--;
+      sp[-1] += *sp;
+      AST_PROG_NEXT;
+    AST_PROG_CASE(AST_TOK_MINUS)
+      sp--;
+      sp[-1] -= *sp;
+      AST_PROG_NEXT;
+    AST_PROG_CASE(AST_TOK_MUL)
+      sp--;
+      sp[-1] *= *sp;
+      AST_PROG_NEXT;
+    AST_PROG_CASE(AST_TOK_DIV)
+      sp--;
+      sp[-1] /= *sp;
+      AST_PROG_NEXT;
+    AST_PROG_CASE(AST_TOK_EXP)
+      sp--;
+      sp[-1] = pow(sp[-1], *sp);
+      AST_PROG_NEXT;
+    AST_PROG_CASE(AST_TOK_REM)
+      sp--;
+      sp[-1] = fmod(sp[-1], *sp);
+      AST_PROG_NEXT;
+    AST_PROG_CASE(AST_TOK_FMA)
+      sp -= 2;
+      sp[-1] = fma(sp[-1], *sp, sp[1]);
+      AST_PROG_NEXT;
+    AST_PROG_CASE(AST_TOK_FMS)
+      sp -= 2;
+      sp[-1] = fma(sp[-1], *sp, -sp[1]);
+      AST_PROG_NEXT;
+    /* End of the program, or operators not for this data type. */
+    AST_PROG_CASE(AST_TOK_UNDEF)
+    AST_PROG_CASE(AST_TOK_STRING)
+    AST_PROG_CASE(AST_TOK_PAREN_LEFT)
+    AST_PROG_CASE(AST_TOK_PAREN_RIGHT)
+    AST_PROG_CASE(AST_TOK_ISFINITE)
+    AST_PROG_CASE(AST_TOK_LNOT)
+    AST_PROG_CASE(AST_TOK_BNOT)
+    AST_PROG_CASE(AST_TOK_LEFT)
+    AST_PROG_CASE(AST_TOK_RIGHT)
+    AST_PROG_CASE(AST_TOK_LT)
+    AST_PROG_CASE(AST_TOK_LE)
+    AST_PROG_CASE(AST_TOK_GT)
+    AST_PROG_CASE(AST_TOK_GE)
+    AST_PROG_CASE(AST_TOK_EQ)
+    AST_PROG_CASE(AST_TOK_NEQ)
+    AST_PROG_CASE(AST_TOK_BAND)
+    AST_PROG_CASE(AST_TOK_BXOR)
+    AST_PROG_CASE(AST_TOK_BOR)
+    AST_PROG_CASE(AST_TOK_LAND)
+    AST_PROG_CASE(AST_TOK_LOR)
+      return *stack;
+  }
+}
+
+/******************************************************************************
+Function `ast_prog_eval_bool`:
+  Evaluate the compiled program in bool type.
+Arguments:
+  * `prog`:     the compiled program;
+  * `var`:      the variable array, indexed by the positions of variables;
+  * `res`:      the resulting boolean value.
+Return:
+  Zero on success; non-zero on error.
+******************************************************************************/
+static int ast_prog_eval_bool(const ast_prog_t *prog, const ast_var_t *var,
+    bool *res) {
+  ast_var_t stack[prog->depth];
+  ast_var_t *sp = stack;
+  const ast_instr_t *ip = prog->instr;
+  const ast_instr_t *end = ip + prog->ninstr;
+
+  for (; ip < end; ip++) {
+    /* Short-circuit branches of `&&` and `||`. */
+    if (ip->jump) {
+      if (sp[-1].dtype == AST_DTYPE_BOOL &&
+          sp[-1].v.bval == (ip->op == AST_TOK_LOR))
+        ip = prog->instr + ip->jump - 1;
+      continue;
     }
-    bool bres;
-    int ires;
-    long lres;
-    float fres;
-    double dres;
+    switch (ast_tok_attr[ip->op].argc) {
+      case 0:
+        if (ip->op == AST_TOK_VAR) *sp++ = var[ip->value.v.lval];
+        else *sp++ = ip->value;
+        break;
+      case 1:
+        if (ast_eval_bool_uopt(ip->op, sp - 1, sp - 1)) return AST_ERR_EVAL;
+        break;
+      default:
+        sp--;
+        if (ast_eval_bool_bopt(ip->op, sp - 1, sp, sp - 1))
+          return AST_ERR_EVAL;
+        break;
+    }
+  }
+  if (stack->dtype != AST_DTYPE_BOOL) return AST_ERR_EVAL;
+  *res = stack->v.bval;
+  return 0;
+}
 
-    switch (node->type) {
-      case AST_TOK_LAND:
-        if (dtype == AST_DTYPE_BOOL) {
-          bres = v1->v.bval && v2->v.bval;
-          ast_set_var_value(&node->value, &bres, 0, AST_DTYPE_BOOL);
-        }
-        else AST_ERRNO(ast) = AST_ERR_EVAL;
-        node->type = AST_TOK_NUM;
-        return;
-      case AST_TOK_LOR:
-        if (dtype == AST_DTYPE_BOOL) {
-          bres = v1->v.bval || v2->v.bval;
-          ast_set_var_value(&node->value, &bres, 0, AST_DTYPE_BOOL);
-        }
-        else AST_ERRNO(ast) = AST_ERR_EVAL;
-        node->type = AST_TOK_NUM;
-        return;
-      case AST_TOK_LT:
-        if (dtype == AST_DTYPE_LONG) bres = v1->v.lval < v2->v.lval;
-        else if (dtype == AST_DTYPE_DOUBLE) bres = v1->v.dval < v2->v.dval;
-        else {
-          AST_ERRNO(ast) = AST_ERR_EVAL;
-          return;
-        }
-        ast_set_var_value(&node->value, &bres, 0, AST_DTYPE_BOOL);
-        node->type = AST_TOK_NUM;
-        return;
-      case AST_TOK_LE:
-        if (dtype == AST_DTYPE_LONG) bres = v1->v.lval <= v2->v.lval;
-        else if (dtype == AST_DTYPE_DOUBLE) bres = v1->v.dval <= v2->v.dval;
-        else {
-          AST_ERRNO(ast) = AST_ERR_EVAL;
-          return;
-        }
-        ast_set_var_value(&node->value, &bres, 0, AST_DTYPE_BOOL);
-        node->type = AST_TOK_NUM;
-        return;
-      case AST_TOK_GT:
-        if (dtype == AST_DTYPE_LONG) bres = v1->v.lval > v2->v.lval;
-        else if (dtype == AST_DTYPE_DOUBLE) bres = v1->v.dval > v2->v.dval;
-        else {
-          AST_ERRNO(ast) = AST_ERR_EVAL;
-          return;
-        }
-        ast_set_var_value(&node->value, &bres, 0, AST_DTYPE_BOOL);
-        node->type = AST_TOK_NUM;
-        return;
-      case AST_TOK_GE:
-        if (dtype == AST_DTYPE_LONG) bres = v1->v.lval >= v2->v.lval;
-        else if (dtype == AST_DTYPE_DOUBLE) bres = v1->v.dval >= v2->v.dval;
-        else {
-          AST_ERRNO(ast) = AST_ERR_EVAL;
-          return;
-        }
-        ast_set_var_value(&node->value, &bres, 0, AST_DTYPE_BOOL);
-        node->type = AST_TOK_NUM;
-        return;
-      case AST_TOK_EQ:
-        if (dtype == AST_DTYPE_BOOL) bres = v1->v.bval == v2->v.bval;
-        else if (dtype == AST_DTYPE_LONG) bres = v1->v.lval == v2->v.lval;
-        else if (dtype == AST_DTYPE_DOUBLE) bres = v1->v.dval == v2->v.dval;
-        else if (dtype == AST_DTYPE_STRING) {
-          if (v1->v.sval.len != v2->v.sval.len) bres = false;
-          else bres = !strncmp(v1->v.sval.str, v2->v.sval.str, v1->v.sval.len);
-        }
-        else {
-          AST_ERRNO(ast) = AST_ERR_EVAL;
-          return;
-        }
-        ast_set_var_value(&node->value, &bres, 0, AST_DTYPE_BOOL);
-        node->type = AST_TOK_NUM;
-        return;
-      case AST_TOK_NEQ:
-        if (dtype == AST_DTYPE_BOOL) bres = v1->v.bval != v2->v.bval;
-        else if (dtype == AST_DTYPE_LONG) bres = v1->v.lval != v2->v.lval;
-        else if (dtype == AST_DTYPE_DOUBLE) bres = v1->v.dval != v2->v.dval;
-        else if (dtype == AST_DTYPE_STRING) {
-          if (v1->v.sval.len != v2->v.sval.len) bres = true;
-          else bres = strncmp(v1->v.sval.str, v2->v.sval.str, v1->v.sval.len);
-        }
-        else {
-          AST_ERRNO(ast) = AST_ERR_EVAL;
-          return;
-        }
-        ast_set_var_value(&node->value, &bres, 0, AST_DTYPE_BOOL);
-        node->type = AST_TOK_NUM;
-        return;
-      case AST_TOK_ADD:
-        if (dtype == AST_DTYPE_INT) {
-          ires = v1->v.ival + v2->v.ival;
-          ast_set_var_value(&node->value, &ires, 0, AST_DTYPE_INT);
-        }
-        else if (dtype == AST_DTYPE_LONG) {
-          lres = v1->v.lval + v2->v.lval;
-          ast_set_var_value(&node->value, &lres, 0, AST_DTYPE_LONG);
-        }
-        else if (dtype == AST_DTYPE_FLOAT) {
-          fres = v1->v.fval + v2->v.fval;
-          ast_set_var_value(&node->value, &fres, 0, AST_DTYPE_FLOAT);
-        }
-        else if (dtype == AST_DTYPE_DOUBLE) {
-          dres = v1->v.dval + v2->v.dval;
-          ast_set_var_value(&node->value, &dres, 0, AST_DTYPE_DOUBLE);
-        }
-        else AST_ERRNO(ast) = AST_ERR_EVAL;
-        node->type = AST_TOK_NUM;
-        return;
-      case AST_TOK_MINUS:
-        if (dtype == AST_DTYPE_INT) {
-          ires = v1->v.ival - v2->v.ival;
-          ast_set_var_value(&node->value, &ires, 0, AST_DTYPE_INT);
-        }
-        else if (dtype == AST_DTYPE_LONG) {
-          lres = v1->v.lval - v2->v.lval;
-          ast_set_var_value(&node->value, &lres, 0, AST_DTYPE_LONG);
-        }
-        else if (dtype == AST_DTYPE_FLOAT) {
-          fres = v1->v.fval - v2->v.fval;
-          ast_set_var_value(&node->value, &fres, 0, AST_DTYPE_FLOAT);
-        }
-        else if (dtype == AST_DTYPE_DOUBLE) {
-          dres = v1->v.dval - v2->v.dval;
-          ast_set_var_value(&node->value, &dres, 0, AST_DTYPE_DOUBLE);
-        }
-        else AST_ERRNO(ast) = AST_ERR_EVAL;
-        node->type = AST_TOK_NUM;
-        return;
-      case AST_TOK_MUL:
-        if (dtype == AST_DTYPE_INT) {
-          ires = v1->v.ival * v2->v.ival;
-          ast_set_var_value(&node->value, &ires, 0, AST_DTYPE_INT);
-        }
-        else if (dtype == AST_DTYPE_LONG) {
-          lres = v1->v.lval * v2->v.lval;
-          ast_set_var_value(&node->value, &lres, 0, AST_DTYPE_LONG);
-        }
-        else if (dtype == AST_DTYPE_FLOAT) {
-          fres = v1->v.fval * v2->v.fval;
-          ast_set_var_value(&node->value, &fres, 0, AST_DTYPE_FLOAT);
-        }
-        else if (dtype == AST_DTYPE_DOUBLE) {
-          dres = v1->v.dval * v2->v.dval;
-          ast_set_var_value(&node->value, &dres, 0, AST_DTYPE_DOUBLE);
-        }
-        else AST_ERRNO(ast) = AST_ERR_EVAL;
-        node->type = AST_TOK_NUM;
-        return;
-      case AST_TOK_DIV:
-        if (dtype == AST_DTYPE_INT) {
-          ires = v1->v.ival / v2->v.ival;
-          ast_set_var_value(&node->value, &ires, 0, AST_DTYPE_INT);
-        }
-        else if (dtype == AST_DTYPE_LONG) {
-          lres = v1->v.lval / v2->v.lval;
-          ast_set_var_value(&node->value, &lres, 0, AST_DTYPE_LONG);
-        }
-        else if (dtype == AST_DTYPE_FLOAT) {
-          fres = v1->v.fval / v2->v.fval;
-          ast_set_var_value(&node->value, &fres, 0, AST_DTYPE_FLOAT);
-        }
-        else if (dtype == AST_DTYPE_DOUBLE) {
-          dres = v1->v.dval / v2->v.dval;
-          ast_set_var_value(&node->value, &dres, 0, AST_DTYPE_DOUBLE);
-        }
-        else AST_ERRNO(ast) = AST_ERR_EVAL;
-        node->type = AST_TOK_NUM;
-        return;
-      case AST_TOK_EXP:
-        if (dtype == AST_DTYPE_INT) {
-          ires = 0;
-          if (v2->v.ival > UINT8_MAX) {
-            if (v1->v.ival == 1) ires = 1;
-            else if (v1->v.ival == -1) ires = 1 - 2 * (v2->v.ival & 1);
-          }
-          else {
-            int64_t tmp = ipow(v1->v.ival, v2->v.ival);
-            if (tmp <= INT_MAX) ires = (int) tmp;
-          }
-          ast_set_var_value(&node->value, &ires, 0, AST_DTYPE_INT);
-        }
-        else if (dtype == AST_DTYPE_LONG) {
-          lres = 0;
-          if (v2->v.lval > UINT8_MAX) {
-            if (v1->v.lval == 1) lres = 1;
-            else if (v1->v.lval == -1) lres = 1 - 2 * (v2->v.lval & 1);
-          }
-          else {
-            int64_t tmp = ipow(v1->v.lval, v2->v.lval);
-            if (tmp <= LONG_MAX) lres = (long) tmp;
-          }
-          ast_set_var_value(&node->value, &lres, 0, AST_DTYPE_LONG);
-        }
-        else if (dtype == AST_DTYPE_FLOAT) {
-          fres = powf(v1->v.fval, v2->v.fval);
-          ast_set_var_value(&node->value, &fres, 0, AST_DTYPE_FLOAT);
-        }
-        else if (dtype == AST_DTYPE_DOUBLE) {
-          dres = pow(v1->v.dval, v2->v.dval);
-          ast_set_var_value(&node->value, &dres, 0, AST_DTYPE_DOUBLE);
-        }
-        else AST_ERRNO(ast) = AST_ERR_EVAL;
-        node->type = AST_TOK_NUM;
+
+/*============================================================================*\
+                Functions for the closure-compiled evaluator
+\*============================================================================*/
+
+/* Kinds of arguments of closure nodes. */
+#define AST_CLOS_VAR            0
+#define AST_CLOS_CONST          1
+#define AST_CLOS_NODE           2
+#define AST_CLOS_NKIND          3
+/* Number of tokens, for tables of handlers. */
+#define AST_CLOS_NTOK           (AST_TOK_FMS + 1)
+
+/* Access arguments of a closure node, given the member of the union. */
+#define AST_CLOS_ARG_var(v, x)          (var[node->x.pos])
+#define AST_CLOS_ARG_const(v, x)        (node->x.v)
+#define AST_CLOS_ARG_node(v, x)         (node->x.node->fn.v(node->x.node, var))
+
+/* Operators that are not functions. */
+#define AST_CLOS_OP_NEG(x)              (-(x))
+#define AST_CLOS_OP_BNOT(x)             (~(x))
+#define AST_CLOS_OP_ADD(x, y)           ((x) + (y))
+#define AST_CLOS_OP_MINUS(x, y)         ((x) - (y))
+#define AST_CLOS_OP_MUL(x, y)           ((x) * (y))
+#define AST_CLOS_OP_DIV(x, y)           ((x) / (y))
+#define AST_CLOS_OP_REM(x, y)           ((x) % (y))
+#define AST_CLOS_OP_LEFT(x, y)          ((x) << (y))
+#define AST_CLOS_OP_RIGHT(x, y)         ((x) >> (y))
+#define AST_CLOS_OP_BAND(x, y)          ((x) & (y))
+#define AST_CLOS_OP_BXOR(x, y)          ((x) ^ (y))
+#define AST_CLOS_OP_BOR(x, y)           ((x) | (y))
+#define AST_CLOS_OP_LT(x, y)            ((x) < (y))
+#define AST_CLOS_OP_LE(x, y)            ((x) <= (y))
+#define AST_CLOS_OP_GT(x, y)            ((x) > (y))
+#define AST_CLOS_OP_GE(x, y)            ((x) >= (y))
+#define AST_CLOS_OP_EQ(x, y)            ((x) == (y))
+#define AST_CLOS_OP_NEQ(x, y)           ((x) != (y))
+
+/* Define handlers for a unary operator with all kinds of arguments. */
+#define AST_CLOS_UFUNC(name, T, v, op, ka)                              \
+  static T ast_clos_##name##_##ka##_##T(const ast_clos_t *node,         \
+      const T *var) {                                                   \
+    (void) var;                                                         \
+    return op(AST_CLOS_ARG_##ka(v, a));                                 \
+  }
+#define AST_CLOS_UFUNCS(name, T, v, op)                                 \
+  AST_CLOS_UFUNC(name, T, v, op, var)                                   \
+  AST_CLOS_UFUNC(name, T, v, op, const)                                 \
+  AST_CLOS_UFUNC(name, T, v, op, node)
+#define AST_CLOS_UTABLE(name, T)                                        \
+  { ast_clos_##name##_var_##T, ast_clos_##name##_const_##T,             \
+    ast_clos_##name##_node_##T }
+
+/* Define handlers for a binary operator with all kinds of arguments. */
+#define AST_CLOS_BFUNC(name, T, v, op, ka, kb)                          \
+  static T ast_clos_##name##_##ka##_##kb##_##T(const ast_clos_t *node,  \
+      const T *var) {                                                   \
+    (void) var;                                                         \
+    return op(AST_CLOS_ARG_##ka(v, a), AST_CLOS_ARG_##kb(v, b));        \
+  }
+#define AST_CLOS_BFUNCS(name, T, v, op)                                 \
+  AST_CLOS_BFUNC(name, T, v, op, var, var)                              \
+  AST_CLOS_BFUNC(name, T, v, op, var, const)                            \
+  AST_CLOS_BFUNC(name, T, v, op, var, node)                             \
+  AST_CLOS_BFUNC(name, T, v, op, const, var)                            \
+  AST_CLOS_BFUNC(name, T, v, op, const, const)                          \
+  AST_CLOS_BFUNC(name, T, v, op, const, node)                           \
+  AST_CLOS_BFUNC(name, T, v, op, node, var)                             \
+  AST_CLOS_BFUNC(name, T, v, op, node, const)                           \
+  AST_CLOS_BFUNC(name, T, v, op, node, node)
+#define AST_CLOS_BTABLE(name, T)                                        \
+  { ast_clos_##name##_var_var_##T, ast_clos_##name##_var_const_##T,     \
+    ast_clos_##name##_var_node_##T, ast_clos_##name##_const_var_##T,    \
+    ast_clos_##name##_const_const_##T,                                  \
+    ast_clos_##name##_const_node_##T, ast_clos_##name##_node_var_##T,   \
+    ast_clos_##name##_node_const_##T, ast_clos_##name##_node_node_##T }
+
+/* Define handlers for fused multiply-add with all kinds of factors, where the
+   addend is always evaluated by the closure node following this one. */
+#define AST_CLOS_FFUNC(name, T, v, op, ka, kb)                          \
+  static T ast_clos_##name##_##ka##_##kb##_##T(const ast_clos_t *node,  \
+      const T *var) {                                                   \
+    return op(AST_CLOS_ARG_##ka(v, a), AST_CLOS_ARG_##kb(v, b),         \
+        node[1].fn.v(node + 1, var));                                   \
+  }
+#define AST_CLOS_FFUNCS(name, T, v, op)                                 \
+  AST_CLOS_FFUNC(name, T, v, op, var, var)                              \
+  AST_CLOS_FFUNC(name, T, v, op, var, const)                            \
+  AST_CLOS_FFUNC(name, T, v, op, var, node)                             \
+  AST_CLOS_FFUNC(name, T, v, op, const, var)                            \
+  AST_CLOS_FFUNC(name, T, v, op, const, const)                          \
+  AST_CLOS_FFUNC(name, T, v, op, const, node)                           \
+  AST_CLOS_FFUNC(name, T, v, op, node, var)                             \
+  AST_CLOS_FFUNC(name, T, v, op, node, const)                           \
+  AST_CLOS_FFUNC(name, T, v, op, node, node)
+
+/* Define handlers for expressions with only a literal or a variable. */
+#define AST_CLOS_LEAF(T, v)                                             \
+  static T ast_clos_leaf_var_##T(const ast_clos_t *node, const T *var) {\
+    return AST_CLOS_ARG_var(v, a);                                      \
+  }                                                                     \
+  static T ast_clos_leaf_const_##T(const ast_clos_t *node,              \
+      const T *var) {                                                   \
+    (void) var;                                                         \
+    return AST_CLOS_ARG_const(v, a);                                    \
+  }
+
+/******************************************************************************
+Function `ast_clos_abs_int`:
+  Absolute value of an integer, the same as the interpreter.
+Arguments:
+  * `x`:        the integer.
+Return:
+  The absolute value.
+******************************************************************************/
+static inline int ast_clos_abs_int(const int x) {
+  return (x < 0) ? -x : x;
+}
+
+/******************************************************************************
+Function `ast_clos_abs_long`:
+  Absolute value of a long integer, the same as the interpreter.
+Arguments:
+  * `x`:        the long integer.
+Return:
+  The absolute value.
+******************************************************************************/
+static inline long ast_clos_abs_long(const long x) {
+  return (x < 0) ? -x : x;
+}
+
+/******************************************************************************
+Function `ast_clos_pow_int`:
+  Integer power, with the same overflow handling as the interpreter.
+Arguments:
+  * `x`:        the base;
+  * `y`:        the exponent.
+Return:
+  The power.
+******************************************************************************/
+static inline int ast_clos_pow_int(const int x, const int y) {
+  if (y > UINT8_MAX) {
+    if (x == 1) return 1;
+    return (x == -1) ? 1 - 2 * (y & 1) : 0;
+  }
+  const int64_t res = ipow(x, y);
+  return (res > INT_MAX) ? 0 : (int) res;
+}
+
+/******************************************************************************
+Function `ast_clos_pow_long`:
+  Long integer power, with the same overflow handling as the interpreter.
+Arguments:
+  * `x`:        the base;
+  * `y`:        the exponent.
+Return:
+  The power.
+******************************************************************************/
+static inline long ast_clos_pow_long(const long x, const long y) {
+  if (y > UINT8_MAX) {
+    if (x == 1) return 1;
+    return (x == -1) ? 1 - 2 * (y & 1) : 0;
+  }
+  const int64_t res = ipow(x, y);
+  return (res > LONG_MAX) ? 0 : (long) res;
+}
+
+/******************************************************************************
+Function `ast_clos_fms_float`:
+  Fused multiply-subtract of float numbers, with a single rounding.
+Arguments:
+  * `x`:        the first factor;
+  * `y`:        the second factor;
+  * `z`:        the subtrahend.
+Return:
+  The result of x * y - z.
+******************************************************************************/
+static inline float ast_clos_fms_float(const float x, const float y,
+    const float z) {
+  return fmaf(x, y, -z);
+}
+
+/******************************************************************************
+Function `ast_clos_fms_double`:
+  Fused multiply-subtract of double numbers, with a single rounding.
+Arguments:
+  * `x`:        the first factor;
+  * `y`:        the second factor;
+  * `z`:        the subtrahend.
+Return:
+  The result of x * y - z.
+******************************************************************************/
+static inline double ast_clos_fms_double(const double x, const double y,
+    const double z) {
+  return fma(x, y, -z);
+}
+
+/* Largest literal exponent for which integer powers are unrolled. */
+#define AST_CLOS_POWI_MAX       4
+
+/******************************************************************************
+Function `ast_clos_powi`:
+  Integer power with a small literal exponent, unrolled into multiplies that
+  wrap around in the same way as `ipow`.
+Arguments:
+  * `x`:        the base;
+  * `e`:        the exponent, from 2 to AST_CLOS_POWI_MAX.
+Return:
+  The power.
+******************************************************************************/
+static inline int64_t ast_clos_powi(const int64_t x, const int e) {
+  const uint64_t b = (uint64_t) x;
+  const uint64_t b2 = b * b;
+  switch (e) {
+    case 2: return (int64_t) b2;
+    case 3: return (int64_t) (b2 * b);
+    default: return (int64_t) (b2 * b2);
+  }
+}
+
+/* Define integer powers with a literal exponent, with the same overflow
+   handling as `ast_clos_pow_int` and `ast_clos_pow_long`. */
+#define AST_CLOS_POWI(e)                                                \
+  static inline int ast_clos_pow##e##_int(const int x) {                \
+    const int64_t res = ast_clos_powi(x, e);                            \
+    return (res > INT_MAX) ? 0 : (int) res;                             \
+  }                                                                     \
+  static inline long ast_clos_pow##e##_long(const long x) {             \
+    const int64_t res = ast_clos_powi(x, e);                            \
+    return (res > LONG_MAX) ? 0 : (long) res;                           \
+  }
+
+AST_CLOS_POWI(2)
+AST_CLOS_POWI(3)
+AST_CLOS_POWI(4)
+
+/* Handlers for the int type. */
+AST_CLOS_LEAF(int, ival)
+AST_CLOS_UFUNCS(neg, int, ival, AST_CLOS_OP_NEG)
+AST_CLOS_UFUNCS(abs, int, ival, ast_clos_abs_int)
+AST_CLOS_UFUNCS(bnot, int, ival, AST_CLOS_OP_BNOT)
+AST_CLOS_BFUNCS(add, int, ival, AST_CLOS_OP_ADD)
+AST_CLOS_BFUNCS(minus, int, ival, AST_CLOS_OP_MINUS)
+AST_CLOS_BFUNCS(mul, int, ival, AST_CLOS_OP_MUL)
+AST_CLOS_BFUNCS(div, int, ival, AST_CLOS_OP_DIV)
+AST_CLOS_BFUNCS(rem, int, ival, AST_CLOS_OP_REM)
+AST_CLOS_BFUNCS(exp, int, ival, ast_clos_pow_int)
+AST_CLOS_UFUNCS(pow2, int, ival, ast_clos_pow2_int)
+AST_CLOS_UFUNCS(pow3, int, ival, ast_clos_pow3_int)
+AST_CLOS_UFUNCS(pow4, int, ival, ast_clos_pow4_int)
+AST_CLOS_BFUNCS(left, int, ival, AST_CLOS_OP_LEFT)
+AST_CLOS_BFUNCS(right, int, ival, AST_CLOS_OP_RIGHT)
+AST_CLOS_BFUNCS(band, int, ival, AST_CLOS_OP_BAND)
+AST_CLOS_BFUNCS(bxor, int, ival, AST_CLOS_OP_BXOR)
+AST_CLOS_BFUNCS(bor, int, ival, AST_CLOS_OP_BOR)
+
+/* Handlers for the long type. */
+AST_CLOS_LEAF(long, lval)
+AST_CLOS_UFUNCS(neg, long, lval, AST_CLOS_OP_NEG)
+AST_CLOS_UFUNCS(abs, long, lval, ast_clos_abs_long)
+AST_CLOS_UFUNCS(bnot, long, lval, AST_CLOS_OP_BNOT)
+AST_CLOS_BFUNCS(add, long, lval, AST_CLOS_OP_ADD)
+AST_CLOS_BFUNCS(minus, long, lval, AST_CLOS_OP_MINUS)
+AST_CLOS_BFUNCS(mul, long, lval, AST_CLOS_OP_MUL)
+AST_CLOS_BFUNCS(div, long, lval, AST_CLOS_OP_DIV)
+AST_CLOS_BFUNCS(rem, long, lval, AST_CLOS_OP_REM)
+AST_CLOS_BFUNCS(exp, long, lval, ast_clos_pow_long)
+AST_CLOS_UFUNCS(pow2, long, lval, ast_clos_pow2_long)
+AST_CLOS_UFUNCS(pow3, long, lval, ast_clos_pow3_long)
+AST_CLOS_UFUNCS(pow4, long, lval, ast_clos_pow4_long)
+AST_CLOS_BFUNCS(left, long, lval, AST_CLOS_OP_LEFT)
+AST_CLOS_BFUNCS(right, long, lval, AST_CLOS_OP_RIGHT)
+AST_CLOS_BFUNCS(band, long, lval, AST_CLOS_OP_BAND)
+AST_CLOS_BFUNCS(bxor, long, lval, AST_CLOS_OP_BXOR)
+AST_CLOS_BFUNCS(bor, long, lval, AST_CLOS_OP_BOR)
+
+/* Handlers for the float type. */
+AST_CLOS_LEAF(float, fval)
+AST_CLOS_UFUNCS(neg, float, fval, AST_CLOS_OP_NEG)
+AST_CLOS_UFUNCS(abs, float, fval, fabsf)
+AST_CLOS_UFUNCS(sqrt, float, fval, sqrtf)
+AST_CLOS_UFUNCS(ln, float, fval, logf)
+AST_CLOS_UFUNCS(log, float, fval, log10f)
+AST_CLOS_BFUNCS(add, float, fval, AST_CLOS_OP_ADD)
+AST_CLOS_BFUNCS(minus, float, fval, AST_CLOS_OP_MINUS)
+AST_CLOS_BFUNCS(mul, float, fval, AST_CLOS_OP_MUL)
+AST_CLOS_BFUNCS(div, float, fval, AST_CLOS_OP_DIV)
+AST_CLOS_BFUNCS(rem, float, fval, fmodf)
+AST_CLOS_BFUNCS(exp, float, fval, powf)
+AST_CLOS_FFUNCS(fma, float, fval, fmaf)
+AST_CLOS_FFUNCS(fms, float, fval, ast_clos_fms_float)
+
+/* Handlers for the double type. */
+AST_CLOS_LEAF(double, dval)
+AST_CLOS_UFUNCS(neg, double, dval, AST_CLOS_OP_NEG)
+AST_CLOS_UFUNCS(abs, double, dval, fabs)
+AST_CLOS_UFUNCS(sqrt, double, dval, sqrt)
+AST_CLOS_UFUNCS(ln, double, dval, log)
+AST_CLOS_UFUNCS(log, double, dval, log10)
+AST_CLOS_BFUNCS(add, double, dval, AST_CLOS_OP_ADD)
+AST_CLOS_BFUNCS(minus, double, dval, AST_CLOS_OP_MINUS)
+AST_CLOS_BFUNCS(mul, double, dval, AST_CLOS_OP_MUL)
+AST_CLOS_BFUNCS(div, double, dval, AST_CLOS_OP_DIV)
+AST_CLOS_BFUNCS(rem, double, dval, fmod)
+AST_CLOS_BFUNCS(exp, double, dval, pow)
+AST_CLOS_FFUNCS(fma, double, dval, fma)
+AST_CLOS_FFUNCS(fms, double, dval, ast_clos_fms_double)
+
+/* Tables of handlers, indexed by the token and kinds of arguments. */
+static const ast_clos_int_t
+    ast_clos_uopt_int[AST_CLOS_NTOK][AST_CLOS_NKIND] = {
+  [AST_TOK_NEG] = AST_CLOS_UTABLE(neg, int),
+  [AST_TOK_ABS] = AST_CLOS_UTABLE(abs, int),
+  [AST_TOK_BNOT] = AST_CLOS_UTABLE(bnot, int)
+};
+static const ast_clos_int_t
+    ast_clos_bopt_int[AST_CLOS_NTOK][AST_CLOS_NKIND * AST_CLOS_NKIND] = {
+  [AST_TOK_ADD] = AST_CLOS_BTABLE(add, int),
+  [AST_TOK_MINUS] = AST_CLOS_BTABLE(minus, int),
+  [AST_TOK_MUL] = AST_CLOS_BTABLE(mul, int),
+  [AST_TOK_DIV] = AST_CLOS_BTABLE(div, int),
+  [AST_TOK_REM] = AST_CLOS_BTABLE(rem, int),
+  [AST_TOK_EXP] = AST_CLOS_BTABLE(exp, int),
+  [AST_TOK_LEFT] = AST_CLOS_BTABLE(left, int),
+  [AST_TOK_RIGHT] = AST_CLOS_BTABLE(right, int),
+  [AST_TOK_BAND] = AST_CLOS_BTABLE(band, int),
+  [AST_TOK_BXOR] = AST_CLOS_BTABLE(bxor, int),
+  [AST_TOK_BOR] = AST_CLOS_BTABLE(bor, int)
+};
+
+/* Handlers of powers with literal exponents, indexed by the exponent. */
+static const ast_clos_int_t
+    ast_clos_powi_int[AST_CLOS_POWI_MAX + 1][AST_CLOS_NKIND] = {
+  [2] = AST_CLOS_UTABLE(pow2, int),
+  [3] = AST_CLOS_UTABLE(pow3, int),
+  [4] = AST_CLOS_UTABLE(pow4, int)
+};
+
+static const ast_clos_long_t
+    ast_clos_uopt_long[AST_CLOS_NTOK][AST_CLOS_NKIND] = {
+  [AST_TOK_NEG] = AST_CLOS_UTABLE(neg, long),
+  [AST_TOK_ABS] = AST_CLOS_UTABLE(abs, long),
+  [AST_TOK_BNOT] = AST_CLOS_UTABLE(bnot, long)
+};
+static const ast_clos_long_t
+    ast_clos_bopt_long[AST_CLOS_NTOK][AST_CLOS_NKIND * AST_CLOS_NKIND] = {
+  [AST_TOK_ADD] = AST_CLOS_BTABLE(add, long),
+  [AST_TOK_MINUS] = AST_CLOS_BTABLE(minus, long),
+  [AST_TOK_MUL] = AST_CLOS_BTABLE(mul, long),
+  [AST_TOK_DIV] = AST_CLOS_BTABLE(div, long),
+  [AST_TOK_REM] = AST_CLOS_BTABLE(rem, long),
+  [AST_TOK_EXP] = AST_CLOS_BTABLE(exp, long),
+  [AST_TOK_LEFT] = AST_CLOS_BTABLE(left, long),
+  [AST_TOK_RIGHT] = AST_CLOS_BTABLE(right, long),
+  [AST_TOK_BAND] = AST_CLOS_BTABLE(band, long),
+  [AST_TOK_BXOR] = AST_CLOS_BTABLE(bxor, long),
+  [AST_TOK_BOR] = AST_CLOS_BTABLE(bor, long)
+};
+
+static const ast_clos_long_t
+    ast_clos_powi_long[AST_CLOS_POWI_MAX + 1][AST_CLOS_NKIND] = {
+  [2] = AST_CLOS_UTABLE(pow2, long),
+  [3] = AST_CLOS_UTABLE(pow3, long),
+  [4] = AST_CLOS_UTABLE(pow4, long)
+};
+
+static const ast_clos_float_t
+    ast_clos_uopt_float[AST_CLOS_NTOK][AST_CLOS_NKIND] = {
+  [AST_TOK_NEG] = AST_CLOS_UTABLE(neg, float),
+  [AST_TOK_ABS] = AST_CLOS_UTABLE(abs, float),
+  [AST_TOK_SQRT] = AST_CLOS_UTABLE(sqrt, float),
+  [AST_TOK_LN] = AST_CLOS_UTABLE(ln, float),
+  [AST_TOK_LOG] = AST_CLOS_UTABLE(log, float)
+};
+static const ast_clos_float_t
+    ast_clos_bopt_float[AST_CLOS_NTOK][AST_CLOS_NKIND * AST_CLOS_NKIND] = {
+  [AST_TOK_ADD] = AST_CLOS_BTABLE(add, float),
+  [AST_TOK_MINUS] = AST_CLOS_BTABLE(minus, float),
+  [AST_TOK_MUL] = AST_CLOS_BTABLE(mul, float),
+  [AST_TOK_DIV] = AST_CLOS_BTABLE(div, float),
+  [AST_TOK_REM] = AST_CLOS_BTABLE(rem, float),
+  [AST_TOK_EXP] = AST_CLOS_BTABLE(exp, float),
+  [AST_TOK_FMA] = AST_CLOS_BTABLE(fma, float),
+  [AST_TOK_FMS] = AST_CLOS_BTABLE(fms, float)
+};
+
+static const ast_clos_double_t
+    ast_clos_uopt_double[AST_CLOS_NTOK][AST_CLOS_NKIND] = {
+  [AST_TOK_NEG] = AST_CLOS_UTABLE(neg, double),
+  [AST_TOK_ABS] = AST_CLOS_UTABLE(abs, double),
+  [AST_TOK_SQRT] = AST_CLOS_UTABLE(sqrt, double),
+  [AST_TOK_LN] = AST_CLOS_UTABLE(ln, double),
+  [AST_TOK_LOG] = AST_CLOS_UTABLE(log, double)
+};
+static const ast_clos_double_t
+    ast_clos_bopt_double[AST_CLOS_NTOK][AST_CLOS_NKIND * AST_CLOS_NKIND] = {
+  [AST_TOK_ADD] = AST_CLOS_BTABLE(add, double),
+  [AST_TOK_MINUS] = AST_CLOS_BTABLE(minus, double),
+  [AST_TOK_MUL] = AST_CLOS_BTABLE(mul, double),
+  [AST_TOK_DIV] = AST_CLOS_BTABLE(div, double),
+  [AST_TOK_REM] = AST_CLOS_BTABLE(rem, double),
+  [AST_TOK_EXP] = AST_CLOS_BTABLE(exp, double),
+  [AST_TOK_FMA] = AST_CLOS_BTABLE(fma, double),
+  [AST_TOK_FMS] = AST_CLOS_BTABLE(fms, double)
+};
+
+/* Choose the handler for a closure node, given the token and arguments. */
+#define AST_CLOS_SELECT(T, v)                                           \
+  if (argc == 0) {                                                      \
+    clos->fn.v = (ka == AST_CLOS_VAR) ? ast_clos_leaf_var_##T :         \
+      ast_clos_leaf_const_##T;                                          \
+  }                                                                     \
+  else if (argc == 1) clos->fn.v = ast_clos_uopt_##T[type][ka];         \
+  else clos->fn.v = ast_clos_bopt_##T[type][ka * AST_CLOS_NKIND + kb];  \
+  return (clos->fn.v) ? 0 : AST_ERR_EVAL;
+
+/******************************************************************************
+Function `ast_clos_select`:
+  Choose the specialised handler for a closure node.
+Arguments:
+  * `clos`:     the closure node;
+  * `dtype`:    data type of the expression;
+  * `type`:     type of the token;
+  * `ka`:       kind of the first argument;
+  * `kb`:       kind of the second argument.
+Return:
+  Zero on success; non-zero if the token is not supported.
+******************************************************************************/
+static int ast_clos_select(ast_clos_t *clos, const ast_dtype_t dtype,
+    const ast_tok_t type, const int ka, const int kb) {
+  const int argc = ast_tok_attr[type].argc;
+
+  /* Integer powers with small literal exponents are unrolled. */
+  if (type == AST_TOK_EXP && kb == AST_CLOS_CONST) {
+    const long e = (dtype == AST_DTYPE_INT) ? clos->b.ival :
+      ((dtype == AST_DTYPE_LONG) ? clos->b.lval : 0);
+    if (e >= 2 && e <= AST_CLOS_POWI_MAX) {
+      if (dtype == AST_DTYPE_INT) clos->fn.ival = ast_clos_powi_int[e][ka];
+      else clos->fn.lval = ast_clos_powi_long[e][ka];
+      return 0;
+    }
+  }
+
+  switch (dtype) {
+    case AST_DTYPE_INT: AST_CLOS_SELECT(int, ival)
+    case AST_DTYPE_LONG: AST_CLOS_SELECT(long, lval)
+    case AST_DTYPE_FLOAT: AST_CLOS_SELECT(float, fval)
+    case AST_DTYPE_DOUBLE: AST_CLOS_SELECT(double, dval)
+    default: return AST_ERR_DTYPE;
+  }
+}
+
+/******************************************************************************
+Function `ast_clos_arg`:
+  Set an argument of a closure node, if it is a literal or a variable.
+Arguments:
+  * `ast`:      interface of the abstract syntax tree;
+  * `node`:     node of the abstract syntax tree for the argument;
+  * `arg`:      the argument to be set.
+Return:
+  Kind of the argument.
+******************************************************************************/
+static int ast_clos_arg(const ast_t *ast, const ast_node_t *node,
+    ast_clos_arg_t *arg) {
+  switch (node->type) {
+    case AST_TOK_NUM:
+      switch (ast->dtype) {
+        case AST_DTYPE_INT: arg->ival = node->value.v.ival; break;
+        case AST_DTYPE_LONG: arg->lval = node->value.v.lval; break;
+        case AST_DTYPE_FLOAT: arg->fval = node->value.v.fval; break;
+        default: arg->dval = node->value.v.dval; break;
+      }
+      return AST_CLOS_CONST;
+    case AST_TOK_VAR:
+      arg->pos = ast->vidx[node->value.v.lval] - 1;
+      return AST_CLOS_VAR;
+    default:
+      return AST_CLOS_NODE;
+  }
+}
+
+/******************************************************************************
+Function `ast_clos_build`:
+  Build the closure of a subtree, with the root stored at the next available
+  position of the array, followed by closures of the children.
+Arguments:
+  * `ast`:      interface of the abstract syntax tree;
+  * `node`:     root node of the subtree;
+  * `clos`:     array of closure nodes;
+  * `num`:      number of closure nodes in use.
+Return:
+  Zero on success; non-zero on error.
+******************************************************************************/
+static int ast_clos_build(const ast_t *ast, const ast_node_t *node,
+    ast_clos_t *clos, long *num) {
+  ast_clos_t *self = clos + (*num)++;
+  const int argc = ast_tok_attr[node->type].argc;
+  const ast_node_t *left = node->left, *right = node->right;
+  int ka = AST_CLOS_VAR, kb = AST_CLOS_VAR;
+
+  /* The arguments of fused multiply-add are the factors, and the addend is
+     placed right after the node. */
+  if (node->type == AST_TOK_FMA || node->type == AST_TOK_FMS) {
+    if (ast_clos_build(ast, right, clos, num)) return AST_ERR_EVAL;
+    right = left->right;
+    left = left->left;
+  }
+
+  if (argc == 0) {
+    if ((ka = ast_clos_arg(ast, node, &self->a)) == AST_CLOS_NODE)
+      return AST_ERR_EVAL;
+  }
+  else {
+    if ((ka = ast_clos_arg(ast, left, &self->a)) == AST_CLOS_NODE) {
+      self->a.node = clos + *num;
+      if (ast_clos_build(ast, left, clos, num)) return AST_ERR_EVAL;
+    }
+    if (argc == 2 &&
+        (kb = ast_clos_arg(ast, right, &self->b)) == AST_CLOS_NODE) {
+      self->b.node = clos + *num;
+      if (ast_clos_build(ast, right, clos, num)) return AST_ERR_EVAL;
+    }
+  }
+  return ast_clos_select(self, ast->dtype, node->type, ka, kb);
+}
+
+/******************************************************************************
+Function `ast_clos_init`:
+  Build the closure-compiled evaluator for the numerical expression.
+Arguments:
+  * `ast`:      interface of the abstract syntax tree.
+Return:
+  Zero on success, or if the expression is not supported by the closures;
+  non-zero on error.
+******************************************************************************/
+static int ast_clos_init(ast_t *ast) {
+  ast_prog_t *prog = ast_prog_init(ast);
+  if (!prog) return AST_ERR_MEMORY;
+  if (prog->clos) return 0;
+  if (!(prog->clos = malloc(ast_count_node(ast->ast) * sizeof(ast_clos_t))))
+    return AST_ERR_MEMORY;
+
+  long num = 0;
+  if (ast_clos_build(ast, (ast_node_t *) ast->ast, prog->clos, &num)) {
+    /* Fall back to the other evaluators. */
+    free(prog->clos);
+    prog->clos = NULL;
+  }
+  return 0;
+}
+
+
+/******************************************************************************
+Function `ast_prog_eval_num`:
+  Evaluate the numerical expression with native code, the closures, or the
+  compiled program, in order of preference.
+Arguments:
+  * `prog`:     the compiled evaluators, with closures or the program;
+  * `var`:      the variable array, indexed by variable indices minus one;
+  * `value`:    address of the variable holding the evaluated value.
+******************************************************************************/
+static void ast_prog_eval_num(const ast_prog_t *prog, const void *var,
+    void *value) {
+  const ast_clos_t *clos = prog->clos;
+  switch (prog->dtype) {
+    case AST_DTYPE_INT:
+      if (prog->ifunc) *((int *) value) = prog->ifunc((const int *) var);
+      else if (clos)
+        *((int *) value) = clos->fn.ival(clos, (const int *) var);
+      else *((int *) value) =
+        ast_prog_eval_int(prog, (const int *) var, prog->vidx);
+      return;
+    case AST_DTYPE_LONG:
+      if (prog->lfunc) *((long *) value) = prog->lfunc((const long *) var);
+      else if (clos)
+        *((long *) value) = clos->fn.lval(clos, (const long *) var);
+      else *((long *) value) =
+        ast_prog_eval_long(prog, (const long *) var, prog->vidx);
+      return;
+    case AST_DTYPE_FLOAT:
+      if (prog->ffunc) *((float *) value) = prog->ffunc((const float *) var);
+      else if (clos)
+        *((float *) value) = clos->fn.fval(clos, (const float *) var);
+      else *((float *) value) =
+        ast_prog_eval_float(prog, (const float *) var, prog->vidx);
+      return;
+    default:
+      if (prog->dfunc) *((double *) value) = prog->dfunc((const double *) var);
+      else if (clos)
+        *((double *) value) = clos->fn.dval(clos, (const double *) var);
+      else *((double *) value) =
+        ast_prog_eval_double(prog, (const double *) var, prog->vidx);
+      return;
+  }
+}
+
+
+/*============================================================================*\
+                      Functions for the vectorised kernels
+\*============================================================================*/
+
+#ifdef AST_SIMD_X86
+/* Target attributes and vector operations of the instruction sets, for the
+   double (PD) and float (PS) types. */
+#define AST_KERN_SSE2_ATTR        __attribute__((target("sse2")))
+#define AST_KERN_SSE2_WIDTH_PD    2
+#define AST_KERN_SSE2_WIDTH_PS    4
+#define AST_KERN_SSE2_LOAD_PD     _mm_loadu_pd
+#define AST_KERN_SSE2_LOAD_PS     _mm_loadu_ps
+#define AST_KERN_SSE2_STORE_PD    _mm_storeu_pd
+#define AST_KERN_SSE2_STORE_PS    _mm_storeu_ps
+#define AST_KERN_SSE2_ADD_PD      _mm_add_pd
+#define AST_KERN_SSE2_ADD_PS      _mm_add_ps
+#define AST_KERN_SSE2_MINUS_PD    _mm_sub_pd
+#define AST_KERN_SSE2_MINUS_PS    _mm_sub_ps
+#define AST_KERN_SSE2_MUL_PD      _mm_mul_pd
+#define AST_KERN_SSE2_MUL_PS      _mm_mul_ps
+#define AST_KERN_SSE2_DIV_PD      _mm_div_pd
+#define AST_KERN_SSE2_DIV_PS      _mm_div_ps
+#define AST_KERN_SSE2_SQRT_PD     _mm_sqrt_pd
+#define AST_KERN_SSE2_SQRT_PS     _mm_sqrt_ps
+#define AST_KERN_SSE2_NEG_PD(x)   _mm_xor_pd(x, _mm_set1_pd(-0.0))
+#define AST_KERN_SSE2_NEG_PS(x)   _mm_xor_ps(x, _mm_set1_ps(-0.0f))
+#define AST_KERN_SSE2_ABS_PD(x)   _mm_andnot_pd(_mm_set1_pd(-0.0), x)
+#define AST_KERN_SSE2_ABS_PS(x)   _mm_andnot_ps(_mm_set1_ps(-0.0f), x)
+#define AST_KERN_SSE2_LT_PD(a, b)   _mm_movemask_pd(_mm_cmplt_pd(a, b))
+#define AST_KERN_SSE2_LE_PD(a, b)   _mm_movemask_pd(_mm_cmple_pd(a, b))
+#define AST_KERN_SSE2_GT_PD(a, b)   _mm_movemask_pd(_mm_cmpgt_pd(a, b))
+#define AST_KERN_SSE2_GE_PD(a, b)   _mm_movemask_pd(_mm_cmpge_pd(a, b))
+#define AST_KERN_SSE2_EQ_PD(a, b)   _mm_movemask_pd(_mm_cmpeq_pd(a, b))
+#define AST_KERN_SSE2_NEQ_PD(a, b)  _mm_movemask_pd(_mm_cmpneq_pd(a, b))
+
+#define AST_KERN_AVX2_ATTR        __attribute__((target("avx2")))
+#define AST_KERN_AVX2_WIDTH_PD    4
+#define AST_KERN_AVX2_WIDTH_PS    8
+#define AST_KERN_AVX2_LOAD_PD     _mm256_loadu_pd
+#define AST_KERN_AVX2_LOAD_PS     _mm256_loadu_ps
+#define AST_KERN_AVX2_STORE_PD    _mm256_storeu_pd
+#define AST_KERN_AVX2_STORE_PS    _mm256_storeu_ps
+#define AST_KERN_AVX2_ADD_PD      _mm256_add_pd
+#define AST_KERN_AVX2_ADD_PS      _mm256_add_ps
+#define AST_KERN_AVX2_MINUS_PD    _mm256_sub_pd
+#define AST_KERN_AVX2_MINUS_PS    _mm256_sub_ps
+#define AST_KERN_AVX2_MUL_PD      _mm256_mul_pd
+#define AST_KERN_AVX2_MUL_PS      _mm256_mul_ps
+#define AST_KERN_AVX2_DIV_PD      _mm256_div_pd
+#define AST_KERN_AVX2_DIV_PS      _mm256_div_ps
+#define AST_KERN_AVX2_SQRT_PD     _mm256_sqrt_pd
+#define AST_KERN_AVX2_SQRT_PS     _mm256_sqrt_ps
+#define AST_KERN_AVX2_NEG_PD(x)   _mm256_xor_pd(x, _mm256_set1_pd(-0.0))
+#define AST_KERN_AVX2_NEG_PS(x)   _mm256_xor_ps(x, _mm256_set1_ps(-0.0f))
+#define AST_KERN_AVX2_ABS_PD(x)   _mm256_andnot_pd(_mm256_set1_pd(-0.0), x)
+#define AST_KERN_AVX2_ABS_PS(x)   _mm256_andnot_ps(_mm256_set1_ps(-0.0f), x)
+#define AST_KERN_AVX2_WIDTH_EPI64 4
+#define AST_KERN_AVX2_LOAD_EPI64(p) _mm256_loadu_si256((const __m256i *) (p))
+#define AST_KERN_AVX2_CMP_PD(a, b, p)                                   \
+  _mm256_movemask_pd(_mm256_cmp_pd(a, b, p))
+#define AST_KERN_AVX2_LT_PD(a, b)   AST_KERN_AVX2_CMP_PD(a, b, _CMP_LT_OQ)
+#define AST_KERN_AVX2_LE_PD(a, b)   AST_KERN_AVX2_CMP_PD(a, b, _CMP_LE_OQ)
+#define AST_KERN_AVX2_GT_PD(a, b)   AST_KERN_AVX2_CMP_PD(a, b, _CMP_GT_OQ)
+#define AST_KERN_AVX2_GE_PD(a, b)   AST_KERN_AVX2_CMP_PD(a, b, _CMP_GE_OQ)
+#define AST_KERN_AVX2_EQ_PD(a, b)   AST_KERN_AVX2_CMP_PD(a, b, _CMP_EQ_OQ)
+#define AST_KERN_AVX2_NEQ_PD(a, b)  AST_KERN_AVX2_CMP_PD(a, b, _CMP_NEQ_UQ)
+#define AST_KERN_AVX2_GT_EPI64(a, b)                                    \
+  _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(a, b)))
+#define AST_KERN_AVX2_EQ_EPI64(a, b)                                    \
+  _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(a, b)))
+#define AST_KERN_AVX2_LT_EPI64(a, b)  AST_KERN_AVX2_GT_EPI64(b, a)
+#define AST_KERN_AVX2_LE_EPI64(a, b)  (AST_KERN_AVX2_GT_EPI64(a, b) ^ 0xf)
+#define AST_KERN_AVX2_GE_EPI64(a, b)  (AST_KERN_AVX2_GT_EPI64(b, a) ^ 0xf)
+#define AST_KERN_AVX2_NEQ_EPI64(a, b) (AST_KERN_AVX2_EQ_EPI64(a, b) ^ 0xf)
+
+/* Fused multiply-add of AVX2 processors, which is kept apart from the other
+   AVX2 kernels, so that their multiplies and additions are never fused. */
+#define AST_KERN_AVX2FMA_ATTR     __attribute__((target("avx2,fma")))
+#define AST_KERN_AVX2FMA_WIDTH_PD 4
+#define AST_KERN_AVX2FMA_WIDTH_PS 8
+#define AST_KERN_AVX2FMA_LOAD_PD  _mm256_loadu_pd
+#define AST_KERN_AVX2FMA_LOAD_PS  _mm256_loadu_ps
+#define AST_KERN_AVX2FMA_STORE_PD _mm256_storeu_pd
+#define AST_KERN_AVX2FMA_STORE_PS _mm256_storeu_ps
+#define AST_KERN_AVX2FMA_FMA_PD   _mm256_fmadd_pd
+#define AST_KERN_AVX2FMA_FMA_PS   _mm256_fmadd_ps
+#define AST_KERN_AVX2FMA_FMS_PD   _mm256_fmsub_pd
+#define AST_KERN_AVX2FMA_FMS_PS   _mm256_fmsub_ps
+
+#define AST_KERN_AVX512_ATTR      __attribute__((target("avx512f")))
+#define AST_KERN_AVX512_WIDTH_PD  8
+#define AST_KERN_AVX512_WIDTH_PS  16
+#define AST_KERN_AVX512_LOAD_PD   _mm512_loadu_pd
+#define AST_KERN_AVX512_LOAD_PS   _mm512_loadu_ps
+#define AST_KERN_AVX512_STORE_PD  _mm512_storeu_pd
+#define AST_KERN_AVX512_STORE_PS  _mm512_storeu_ps
+#define AST_KERN_AVX512_ADD_PD    _mm512_add_pd
+#define AST_KERN_AVX512_ADD_PS    _mm512_add_ps
+#define AST_KERN_AVX512_MINUS_PD  _mm512_sub_pd
+#define AST_KERN_AVX512_MINUS_PS  _mm512_sub_ps
+#define AST_KERN_AVX512_MUL_PD    _mm512_mul_pd
+#define AST_KERN_AVX512_MUL_PS    _mm512_mul_ps
+#define AST_KERN_AVX512_DIV_PD    _mm512_div_pd
+#define AST_KERN_AVX512_DIV_PS    _mm512_div_ps
+#define AST_KERN_AVX512_SQRT_PD   _mm512_sqrt_pd
+#define AST_KERN_AVX512_SQRT_PS   _mm512_sqrt_ps
+#define AST_KERN_AVX512_NEG_PD(x) _mm512_castsi512_pd(_mm512_xor_si512(    \
+      _mm512_castpd_si512(x), _mm512_set1_epi64(INT64_MIN)))
+#define AST_KERN_AVX512_NEG_PS(x) _mm512_castsi512_ps(_mm512_xor_si512(    \
+      _mm512_castps_si512(x), _mm512_set1_epi32(INT32_MIN)))
+#define AST_KERN_AVX512_ABS_PD    _mm512_abs_pd
+#define AST_KERN_AVX512_ABS_PS    _mm512_abs_ps
+#define AST_KERN_AVX512_FMA_PD    _mm512_fmadd_pd
+#define AST_KERN_AVX512_FMA_PS    _mm512_fmadd_ps
+#define AST_KERN_AVX512_FMS_PD    _mm512_fmsub_pd
+#define AST_KERN_AVX512_FMS_PS    _mm512_fmsub_ps
+#define AST_KERN_AVX512_WIDTH_EPI64 8
+#define AST_KERN_AVX512_LOAD_EPI64  _mm512_loadu_si512
+#define AST_KERN_AVX512_LT_PD(a, b)   _mm512_cmp_pd_mask(a, b, _CMP_LT_OQ)
+#define AST_KERN_AVX512_LE_PD(a, b)   _mm512_cmp_pd_mask(a, b, _CMP_LE_OQ)
+#define AST_KERN_AVX512_GT_PD(a, b)   _mm512_cmp_pd_mask(a, b, _CMP_GT_OQ)
+#define AST_KERN_AVX512_GE_PD(a, b)   _mm512_cmp_pd_mask(a, b, _CMP_GE_OQ)
+#define AST_KERN_AVX512_EQ_PD(a, b)   _mm512_cmp_pd_mask(a, b, _CMP_EQ_OQ)
+#define AST_KERN_AVX512_NEQ_PD(a, b)  _mm512_cmp_pd_mask(a, b, _CMP_NEQ_UQ)
+#define AST_KERN_AVX512_LT_EPI64(a, b)                                  \
+  _mm512_cmp_epi64_mask(a, b, _MM_CMPINT_LT)
+#define AST_KERN_AVX512_LE_EPI64(a, b)                                  \
+  _mm512_cmp_epi64_mask(a, b, _MM_CMPINT_LE)
+#define AST_KERN_AVX512_GT_EPI64(a, b)                                  \
+  _mm512_cmp_epi64_mask(a, b, _MM_CMPINT_NLE)
+#define AST_KERN_AVX512_GE_EPI64(a, b)                                  \
+  _mm512_cmp_epi64_mask(a, b, _MM_CMPINT_NLT)
+#define AST_KERN_AVX512_EQ_EPI64(a, b)                                  \
+  _mm512_cmp_epi64_mask(a, b, _MM_CMPINT_EQ)
+#define AST_KERN_AVX512_NEQ_EPI64(a, b)                                 \
+  _mm512_cmp_epi64_mask(a, b, _MM_CMPINT_NE)
+
+/* Define the kernels of unary, binary, and ternary operators for an
+   instruction set and a data type, with the remainders processed by scalar
+   operations. */
+#define AST_KERN_UOP(isa, T, S, name, sop)                              \
+  static AST_KERN_##isa##_ATTR void ast_kern_##name##_##T##_##isa(      \
+      void *dst, const void *src, const size_t n) {                     \
+    T *d = (T *) dst;                                                   \
+    const T *a = (const T *) src;                                       \
+    size_t i = 0;                                                       \
+    for (; i + AST_KERN_##isa##_WIDTH_##S <= n;                         \
+        i += AST_KERN_##isa##_WIDTH_##S)                                \
+      AST_KERN_##isa##_STORE_##S(d + i, AST_KERN_##isa##_##name##_##S(  \
+          AST_KERN_##isa##_LOAD_##S(a + i)));                           \
+    for (; i < n; i++) d[i] = sop(a[i]);                                \
+  }
+#define AST_KERN_BOP(isa, T, S, name, sop)                              \
+  static AST_KERN_##isa##_ATTR void ast_kern_##name##_##T##_##isa(      \
+      void *dst, const void *src1, const void *src2, const size_t n) {  \
+    T *d = (T *) dst;                                                   \
+    const T *a = (const T *) src1;                                      \
+    const T *b = (const T *) src2;                                      \
+    size_t i = 0;                                                       \
+    for (; i + AST_KERN_##isa##_WIDTH_##S <= n;                         \
+        i += AST_KERN_##isa##_WIDTH_##S)                                \
+      AST_KERN_##isa##_STORE_##S(d + i, AST_KERN_##isa##_##name##_##S(  \
+          AST_KERN_##isa##_LOAD_##S(a + i),                             \
+          AST_KERN_##isa##_LOAD_##S(b + i)));                           \
+    for (; i < n; i++) d[i] = sop(a[i], b[i]);                          \
+  }
+
+#define AST_KERN_TOP(isa, T, S, name, sop)                              \
+  static AST_KERN_##isa##_ATTR void ast_kern_##name##_##T##_##isa(      \
+      void *dst, const void *src1, const void *src2, const void *src3,  \
+      const size_t n) {                                                 \
+    T *d = (T *) dst;                                                   \
+    const T *a = (const T *) src1;                                      \
+    const T *b = (const T *) src2;                                      \
+    const T *c = (const T *) src3;                                      \
+    size_t i = 0;                                                       \
+    for (; i + AST_KERN_##isa##_WIDTH_##S <= n;                         \
+        i += AST_KERN_##isa##_WIDTH_##S)                                \
+      AST_KERN_##isa##_STORE_##S(d + i, AST_KERN_##isa##_##name##_##S(  \
+          AST_KERN_##isa##_LOAD_##S(a + i),                             \
+          AST_KERN_##isa##_LOAD_##S(b + i),                             \
+          AST_KERN_##isa##_LOAD_##S(c + i)));                           \
+    for (; i < n; i++) d[i] = sop(a[i], b[i], c[i]);                    \
+  }
+
+/* Define the kernels of comparisons for an instruction set and a data type,
+   with the lane masks of 64 elements packed into a word of the bitmask.
+   The words are written after reading all the elements, so the bitmask can
+   overwrite the first operand. */
+#define AST_KERN_CMP(isa, T, S, name, sop)                              \
+  static AST_KERN_##isa##_ATTR void ast_kern_##name##_##T##_##isa(      \
+      void *dst, const void *src1, const void *src2, const size_t n) {  \
+    uint64_t *d = (uint64_t *) dst;                                     \
+    const T *a = (const T *) src1;                                      \
+    const T *b = (const T *) src2;                                      \
+    for (size_t i = 0; i < n; i += 64, a += 64, b += 64) {              \
+      const size_t m = (n - i < 64) ? n - i : 64;                       \
+      uint64_t w = 0;                                                   \
+      size_t j = 0;                                                     \
+      for (; j + AST_KERN_##isa##_WIDTH_##S <= m;                       \
+          j += AST_KERN_##isa##_WIDTH_##S)                              \
+        w |= (uint64_t) AST_KERN_##isa##_##name##_##S(                  \
+            AST_KERN_##isa##_LOAD_##S(a + j),                           \
+            AST_KERN_##isa##_LOAD_##S(b + j)) << j;                     \
+      for (; j < m; j++) w |= (uint64_t) sop(a[j], b[j]) << j;          \
+      d[i >> 6] = w;                                                    \
+    }                                                                   \
+  }
+#define AST_KERN_CMPS(isa, T, S)                                        \
+  AST_KERN_CMP(isa, T, S, LT, AST_CLOS_OP_LT)                           \
+  AST_KERN_CMP(isa, T, S, LE, AST_CLOS_OP_LE)                           \
+  AST_KERN_CMP(isa, T, S, GT, AST_CLOS_OP_GT)                           \
+  AST_KERN_CMP(isa, T, S, GE, AST_CLOS_OP_GE)                           \
+  AST_KERN_CMP(isa, T, S, EQ, AST_CLOS_OP_EQ)                           \
+  AST_KERN_CMP(isa, T, S, NEQ, AST_CLOS_OP_NEQ)
+
+AST_KERN_CMPS(SSE2, double, PD)
+AST_KERN_CMPS(AVX2, double, PD)
+AST_KERN_CMPS(AVX512, double, PD)
+/* 64-bit integer comparisons are not available with SSE2. */
+#if LONG_MAX == INT64_MAX
+AST_KERN_CMPS(AVX2, long, EPI64)
+AST_KERN_CMPS(AVX512, long, EPI64)
+#endif
+
+/* Define the kernels that are exact, i.e., identical to scalar operations,
+   for an instruction set and a data type. */
+#define AST_KERN_EXACT(isa, T, S, abs, sqrt)                            \
+  AST_KERN_UOP(isa, T, S, NEG, AST_CLOS_OP_NEG)                         \
+  AST_KERN_UOP(isa, T, S, ABS, abs)                                     \
+  AST_KERN_UOP(isa, T, S, SQRT, sqrt)                                   \
+  AST_KERN_BOP(isa, T, S, ADD, AST_CLOS_OP_ADD)                         \
+  AST_KERN_BOP(isa, T, S, MINUS, AST_CLOS_OP_MINUS)                     \
+  AST_KERN_BOP(isa, T, S, MUL, AST_CLOS_OP_MUL)                         \
+  AST_KERN_BOP(isa, T, S, DIV, AST_CLOS_OP_DIV)
+
+AST_KERN_EXACT(SSE2, double, PD, fabs, sqrt)
+AST_KERN_EXACT(SSE2, float, PS, fabsf, sqrtf)
+AST_KERN_EXACT(AVX2, double, PD, fabs, sqrt)
+AST_KERN_EXACT(AVX2, float, PS, fabsf, sqrtf)
+AST_KERN_EXACT(AVX512, double, PD, fabs, sqrt)
+AST_KERN_EXACT(AVX512, float, PS, fabsf, sqrtf)
+
+/* Define the kernels of fused multiply-add, which are identical to the
+   scalar `fma` functions. */
+#define AST_KERN_FUSED(isa)                                             \
+  AST_KERN_TOP(isa, double, PD, FMA, fma)                               \
+  AST_KERN_TOP(isa, double, PD, FMS, ast_clos_fms_double)               \
+  AST_KERN_TOP(isa, float, PS, FMA, fmaf)                               \
+  AST_KERN_TOP(isa, float, PS, FMS, ast_clos_fms_float)
+
+AST_KERN_FUSED(AVX2FMA)
+AST_KERN_FUSED(AVX512)
+
+/* Vector types and operations for the approximations of float functions,
+   which are evaluated in double precision for the halves of the vectors:
+   FV/IV for float and int32 vectors, and DV/HV for the double and int32
+   vectors with half widths. */
+#define AST_KERN_AVX2_FV          __m256
+#define AST_KERN_AVX2_IV          __m256i
+#define AST_KERN_AVX2_DV          __m256d
+#define AST_KERN_AVX2_HV          __m128i
+#define AST_KERN_AVX2_BITS        _mm256_castps_si256
+#define AST_KERN_AVX2_FLOAT       _mm256_castsi256_ps
+#define AST_KERN_AVX2_ISET1       _mm256_set1_epi32
+#define AST_KERN_AVX2_ISUB        _mm256_sub_epi32
+#define AST_KERN_AVX2_ISRAI       _mm256_srai_epi32
+#define AST_KERN_AVX2_ISLLI       _mm256_slli_epi32
+#define AST_KERN_AVX2_FLO(x)      _mm256_cvtps_pd(_mm256_castps256_ps128(x))
+#define AST_KERN_AVX2_FHI(x)      _mm256_cvtps_pd(_mm256_extractf128_ps(x, 1))
+#define AST_KERN_AVX2_ILO(x)                                            \
+  _mm256_cvtepi32_pd(_mm256_castsi256_si128(x))
+#define AST_KERN_AVX2_IHI(x)                                            \
+  _mm256_cvtepi32_pd(_mm256_extracti128_si256(x, 1))
+#define AST_KERN_AVX2_PACK(lo, hi)                                      \
+  _mm256_insertf128_ps(_mm256_castps128_ps256(_mm256_cvtpd_ps(lo)),     \
+      _mm256_cvtpd_ps(hi), 1)
+#define AST_KERN_AVX2_DSET1       _mm256_set1_pd
+#define AST_KERN_AVX2_DADD        _mm256_add_pd
+#define AST_KERN_AVX2_DSUB        _mm256_sub_pd
+#define AST_KERN_AVX2_DMUL        _mm256_mul_pd
+#define AST_KERN_AVX2_DDIV        _mm256_div_pd
+#define AST_KERN_AVX2_DMIN        _mm256_min_pd
+#define AST_KERN_AVX2_DMAX        _mm256_max_pd
+#define AST_KERN_AVX2_DROUND      _mm256_cvtpd_epi32
+#define AST_KERN_AVX2_HTOD        _mm256_cvtepi32_pd
+#define AST_KERN_AVX2_HSET1       _mm_set1_epi32
+#define AST_KERN_AVX2_HADD        _mm_add_epi32
+#define AST_KERN_AVX2_HSUB        _mm_sub_epi32
+#define AST_KERN_AVX2_HSRAI       _mm_srai_epi32
+#define AST_KERN_AVX2_HSLLI       _mm_slli_epi32
+#define AST_KERN_AVX2_HTOF(x)     _mm256_cvtps_pd(_mm_castsi128_ps(x))
+#define AST_KERN_AVX2_OUTSIDE(x, lo, hi)                                \
+  (_mm256_movemask_ps(_mm256_and_ps(                                    \
+      _mm256_cmp_ps(x, _mm256_set1_ps(lo), _CMP_GE_OQ),                 \
+      _mm256_cmp_ps(x, _mm256_set1_ps(hi), _CMP_LE_OQ))) ^ 0xff)
+
+#define AST_KERN_AVX512_FV        __m512
+#define AST_KERN_AVX512_IV        __m512i
+#define AST_KERN_AVX512_DV        __m512d
+#define AST_KERN_AVX512_HV        __m256i
+#define AST_KERN_AVX512_BITS      _mm512_castps_si512
+#define AST_KERN_AVX512_FLOAT     _mm512_castsi512_ps
+#define AST_KERN_AVX512_ISET1     _mm512_set1_epi32
+#define AST_KERN_AVX512_ISUB      _mm512_sub_epi32
+#define AST_KERN_AVX512_ISRAI     _mm512_srai_epi32
+#define AST_KERN_AVX512_ISLLI     _mm512_slli_epi32
+#define AST_KERN_AVX512_FLO(x)    _mm512_cvtps_pd(_mm512_castps512_ps256(x))
+#define AST_KERN_AVX512_FHI(x)                                          \
+  _mm512_cvtps_pd(_mm256_castpd_ps(                                     \
+      _mm512_extractf64x4_pd(_mm512_castps_pd(x), 1)))
+#define AST_KERN_AVX512_ILO(x)                                          \
+  _mm512_cvtepi32_pd(_mm512_castsi512_si256(x))
+#define AST_KERN_AVX512_IHI(x)                                          \
+  _mm512_cvtepi32_pd(_mm512_extracti64x4_epi64(x, 1))
+#define AST_KERN_AVX512_PACK(lo, hi)                                    \
+  _mm512_castpd_ps(_mm512_insertf64x4(_mm512_castpd256_pd512(           \
+      _mm256_castps_pd(_mm512_cvtpd_ps(lo))),                           \
+      _mm256_castps_pd(_mm512_cvtpd_ps(hi)), 1))
+#define AST_KERN_AVX512_DSET1     _mm512_set1_pd
+#define AST_KERN_AVX512_DADD      _mm512_add_pd
+#define AST_KERN_AVX512_DSUB      _mm512_sub_pd
+#define AST_KERN_AVX512_DMUL      _mm512_mul_pd
+#define AST_KERN_AVX512_DDIV      _mm512_div_pd
+#define AST_KERN_AVX512_DMIN      _mm512_min_pd
+#define AST_KERN_AVX512_DMAX      _mm512_max_pd
+#define AST_KERN_AVX512_DROUND    _mm512_cvtpd_epi32
+#define AST_KERN_AVX512_HTOD      _mm512_cvtepi32_pd
+#define AST_KERN_AVX512_HSET1     _mm256_set1_epi32
+#define AST_KERN_AVX512_HADD      _mm256_add_epi32
+#define AST_KERN_AVX512_HSUB      _mm256_sub_epi32
+#define AST_KERN_AVX512_HSRAI     _mm256_srai_epi32
+#define AST_KERN_AVX512_HSLLI     _mm256_slli_epi32
+#define AST_KERN_AVX512_HTOF(x)   _mm512_cvtps_pd(_mm256_castsi256_ps(x))
+#define AST_KERN_AVX512_OUTSIDE(x, lo, hi)                              \
+  ((int) (_mm512_cmp_ps_mask(x, _mm512_set1_ps(lo), _CMP_GE_OQ) &      \
+      _mm512_cmp_ps_mask(x, _mm512_set1_ps(hi), _CMP_LE_OQ)) ^ 0xffff)
+
+/* Shorthand for the vector operations of an instruction set. */
+#define AST_KV(isa, op)           AST_KERN_##isa##_##op
+
+/* Coefficients of the series ln(1 + f) = 2 s sum_k s^2k / (2k + 1), with
+   s = f / (2 + f), for |s| <= 0.2. */
+static const double ast_kern_ln_coef[] = { 1.0 / 17, 1.0 / 15, 1.0 / 13,
+  1.0 / 11, 1.0 / 9, 1.0 / 7, 1.0 / 5, 1.0 / 3, 1 };
+/* Coefficients of the Taylor series of e^r, for |r| <= ln(2) / 2. */
+static const double ast_kern_exp_coef[] = { 1.0 / 3628800, 1.0 / 362880,
+  1.0 / 40320, 1.0 / 5040, 1.0 / 720, 1.0 / 120, 1.0 / 24, 1.0 / 6, 0.5, 1,
+  1 };
+
+#define AST_KERN_LN2              0.69314718055994530942
+#define AST_KERN_LOG2E            1.44269504088896340736
+#define AST_KERN_LOG10E           0.43429448190325182765
+
+/* Define the approximations of float functions for an instruction set, for
+   finite and positive normal numbers. The others are left to the C math
+   library, as well as the remainders of the arrays. */
+#define AST_KERN_FAST(isa)                                              \
+  /* Natural logarithm of the halves of a vector, with x = 2^e (1 + f),  \
+     and f in [-1/3, 1/3). */                                           \
+  static AST_KERN_##isa##_ATTR void ast_kern_lnv_##isa(                 \
+      const AST_KV(isa, FV) x, AST_KV(isa, DV) *res) {                  \
+    const AST_KV(isa, IV) b = AST_KV(isa, ISUB)(AST_KV(isa, BITS)(x),   \
+        AST_KV(isa, ISET1)(0x3f2aaaab));                                \
+    const AST_KV(isa, IV) e = AST_KV(isa, ISRAI)(b, 23);                \
+    const AST_KV(isa, FV) m = AST_KV(isa, FLOAT)(AST_KV(isa, ISUB)(     \
+        AST_KV(isa, BITS)(x), AST_KV(isa, ISLLI)(e, 23)));              \
+    const AST_KV(isa, DV) one = AST_KV(isa, DSET1)(1);                  \
+    const AST_KV(isa, DV) f[2] = { AST_KV(isa, DSUB)(AST_KV(isa, FLO)(m), \
+        one), AST_KV(isa, DSUB)(AST_KV(isa, FHI)(m), one) };            \
+    const AST_KV(isa, DV) ex[2] = { AST_KV(isa, ILO)(e),                \
+        AST_KV(isa, IHI)(e) };                                          \
+    for (int h = 0; h < 2; h++) {                                       \
+      const AST_KV(isa, DV) s = AST_KV(isa, DDIV)(f[h],                 \
+          AST_KV(isa, DADD)(AST_KV(isa, DSET1)(2), f[h]));              \
+      const AST_KV(isa, DV) z = AST_KV(isa, DMUL)(s, s);                \
+      AST_KV(isa, DV) p = AST_KV(isa, DSET1)(ast_kern_ln_coef[0]);      \
+      for (size_t k = 1; k < sizeof ast_kern_ln_coef / sizeof(double); k++) \
+        p = AST_KV(isa, DADD)(AST_KV(isa, DMUL)(p, z),                  \
+            AST_KV(isa, DSET1)(ast_kern_ln_coef[k]));                   \
+      res[h] = AST_KV(isa, DADD)(AST_KV(isa, DMUL)(ex[h],               \
+          AST_KV(isa, DSET1)(AST_KERN_LN2)),                            \
+          AST_KV(isa, DMUL)(AST_KV(isa, DADD)(s, s), p));               \
+    }                                                                   \
+  }                                                                     \
+  /* Exponential function, with e^t = 2^k e^r, and |r| <= ln(2) / 2. */  \
+  static AST_KERN_##isa##_ATTR AST_KV(isa, DV) ast_kern_expv_##isa(     \
+      AST_KV(isa, DV) t) {                                              \
+    t = AST_KV(isa, DMIN)(AST_KV(isa, DMAX)(t,                          \
+        AST_KV(isa, DSET1)(-170)), AST_KV(isa, DSET1)(170));            \
+    const AST_KV(isa, HV) k = AST_KV(isa, DROUND)(AST_KV(isa, DMUL)(t,  \
+        AST_KV(isa, DSET1)(AST_KERN_LOG2E)));                           \
+    const AST_KV(isa, DV) r = AST_KV(isa, DSUB)(t, AST_KV(isa, DMUL)(   \
+        AST_KV(isa, HTOD)(k), AST_KV(isa, DSET1)(AST_KERN_LN2)));       \
+    AST_KV(isa, DV) p = AST_KV(isa, DSET1)(ast_kern_exp_coef[0]);       \
+    for (size_t j = 1; j < sizeof ast_kern_exp_coef / sizeof(double); j++) \
+      p = AST_KV(isa, DADD)(AST_KV(isa, DMUL)(p, r),                    \
+          AST_KV(isa, DSET1)(ast_kern_exp_coef[j]));                    \
+    /* 2^k = 2^k1 2^k2, with both factors being normal float numbers. */ \
+    const AST_KV(isa, HV) bias = AST_KV(isa, HSET1)(127);               \
+    const AST_KV(isa, HV) k1 = AST_KV(isa, HSRAI)(k, 1);                \
+    const AST_KV(isa, HV) k2 = AST_KV(isa, HSUB)(k, k1);                \
+    p = AST_KV(isa, DMUL)(p, AST_KV(isa, HTOF)(AST_KV(isa, HSLLI)(      \
+        AST_KV(isa, HADD)(k1, bias), 23)));                             \
+    return AST_KV(isa, DMUL)(p, AST_KV(isa, HTOF)(AST_KV(isa, HSLLI)(   \
+        AST_KV(isa, HADD)(k2, bias), 23)));                             \
+  }                                                                     \
+  /* Kernels of the natural and common logarithms. */                   \
+  AST_KERN_FAST_LOG(isa, ln, logf, 1)                                   \
+  AST_KERN_FAST_LOG(isa, log, log10f, AST_KERN_LOG10E)                  \
+  /* Kernel of the power function, with x^y = e^(y ln(x)). */           \
+  static AST_KERN_##isa##_ATTR void ast_kern_pow_float_##isa(void *dst, \
+      const void *src1, const void *src2, const size_t n) {             \
+    float *d = (float *) dst;                                           \
+    const float *a = (const float *) src1;                              \
+    const float *b = (const float *) src2;                              \
+    size_t i = 0;                                                       \
+    for (; i + AST_KV(isa, WIDTH_PS) <= n; i += AST_KV(isa, WIDTH_PS)) { \
+      const AST_KV(isa, FV) x = AST_KV(isa, LOAD_PS)(a + i);            \
+      const AST_KV(isa, FV) y = AST_KV(isa, LOAD_PS)(b + i);            \
+      const int bad = AST_KV(isa, OUTSIDE)(x, FLT_MIN, FLT_MAX) |       \
+        AST_KV(isa, OUTSIDE)(y, -FLT_MAX, FLT_MAX);                     \
+      float u[AST_KV(isa, WIDTH_PS)], v[AST_KV(isa, WIDTH_PS)];         \
+      if (bad) {                                                        \
+        AST_KV(isa, STORE_PS)(u, x);                                    \
+        AST_KV(isa, STORE_PS)(v, y);                                    \
+      }                                                                 \
+      AST_KV(isa, DV) t[2];                                             \
+      ast_kern_lnv_##isa(x, t);                                         \
+      t[0] = ast_kern_expv_##isa(AST_KV(isa, DMUL)(t[0],                \
+            AST_KV(isa, FLO)(y)));                                      \
+      t[1] = ast_kern_expv_##isa(AST_KV(isa, DMUL)(t[1],                \
+            AST_KV(isa, FHI)(y)));                                      \
+      AST_KV(isa, STORE_PS)(d + i, AST_KV(isa, PACK)(t[0], t[1]));      \
+      for (int m = bad; m; m &= m - 1)                                  \
+        d[i + __builtin_ctz(m)] =                                       \
+          powf(u[__builtin_ctz(m)], v[__builtin_ctz(m)]);               \
+    }                                                                   \
+    for (; i < n; i++) d[i] = powf(a[i], b[i]);                         \
+  }
+
+/* Define the kernel of a logarithm, which is the natural logarithm scaled
+   by a factor. */
+#define AST_KERN_FAST_LOG(isa, name, func, fac)                         \
+  static AST_KERN_##isa##_ATTR void ast_kern_##name##_float_##isa(      \
+      void *dst, const void *src, const size_t n) {                     \
+    float *d = (float *) dst;                                           \
+    const float *a = (const float *) src;                               \
+    size_t i = 0;                                                       \
+    for (; i + AST_KV(isa, WIDTH_PS) <= n; i += AST_KV(isa, WIDTH_PS)) { \
+      const AST_KV(isa, FV) x = AST_KV(isa, LOAD_PS)(a + i);            \
+      const int bad = AST_KV(isa, OUTSIDE)(x, FLT_MIN, FLT_MAX);        \
+      float u[AST_KV(isa, WIDTH_PS)];                                   \
+      if (bad) AST_KV(isa, STORE_PS)(u, x);                             \
+      AST_KV(isa, DV) t[2];                                             \
+      ast_kern_lnv_##isa(x, t);                                         \
+      AST_KV(isa, STORE_PS)(d + i, AST_KV(isa, PACK)(                   \
+          AST_KV(isa, DMUL)(t[0], AST_KV(isa, DSET1)(fac)),             \
+          AST_KV(isa, DMUL)(t[1], AST_KV(isa, DSET1)(fac))));           \
+      for (int m = bad; m; m &= m - 1)                                  \
+        d[i + __builtin_ctz(m)] = func(u[__builtin_ctz(m)]);            \
+    }                                                                   \
+    for (; i < n; i++) d[i] = func(a[i]);                               \
+  }
+
+AST_KERN_FAST(AVX2)
+AST_KERN_FAST(AVX512)
+
+/* Vector operations of the instruction sets for the int32 (EPI32) and int64
+   (EPI64) types. Shifts with counts out of the range of the type, which are
+   undefined in C, give 0 or the sign bits. */
+#define AST_KERN_SSE2_WIDTH_EPI32   4
+#define AST_KERN_SSE2_WIDTH_EPI64   2
+#define AST_KERN_SSE2_LOAD_EPI32(p) _mm_loadu_si128((const __m128i *) (p))
+#define AST_KERN_SSE2_STORE_EPI32(p, x) _mm_storeu_si128((__m128i *) (p), x)
+#define AST_KERN_SSE2_ADD_EPI32     _mm_add_epi32
+#define AST_KERN_SSE2_ADD_EPI64     _mm_add_epi64
+#define AST_KERN_SSE2_MINUS_EPI32   _mm_sub_epi32
+#define AST_KERN_SSE2_MINUS_EPI64   _mm_sub_epi64
+#define AST_KERN_SSE2_NEG_EPI32(x)  _mm_sub_epi32(_mm_setzero_si128(), x)
+#define AST_KERN_SSE2_NEG_EPI64(x)  _mm_sub_epi64(_mm_setzero_si128(), x)
+#define AST_KERN_SSE2_ABS_EPI32     ast_kern_abs32_SSE2
+#define AST_KERN_SSE2_BNOT_EPI32(x) _mm_xor_si128(x, _mm_set1_epi32(-1))
+#define AST_KERN_SSE2_BAND_EPI32    _mm_and_si128
+#define AST_KERN_SSE2_BXOR_EPI32    _mm_xor_si128
+#define AST_KERN_SSE2_BOR_EPI32     _mm_or_si128
+
+#define AST_KERN_AVX2_WIDTH_EPI32   8
+#define AST_KERN_AVX2_STORE_EPI32(p, x)                                 \
+  _mm256_storeu_si256((__m256i *) (p), x)
+#define AST_KERN_AVX2_ADD_EPI32     _mm256_add_epi32
+#define AST_KERN_AVX2_ADD_EPI64     _mm256_add_epi64
+#define AST_KERN_AVX2_MINUS_EPI32   _mm256_sub_epi32
+#define AST_KERN_AVX2_MINUS_EPI64   _mm256_sub_epi64
+#define AST_KERN_AVX2_MUL_EPI32     _mm256_mullo_epi32
+#define AST_KERN_AVX2_MUL_EPI64     ast_kern_mul64_AVX2
+#define AST_KERN_AVX2_DIV_EPI32     ast_kern_div32_AVX2
+#define AST_KERN_AVX2_REM_EPI32     ast_kern_rem32_AVX2
+#define AST_KERN_AVX2_NEG_EPI32(x)  _mm256_sub_epi32(_mm256_setzero_si256(), x)
+#define AST_KERN_AVX2_NEG_EPI64(x)  _mm256_sub_epi64(_mm256_setzero_si256(), x)
+#define AST_KERN_AVX2_ABS_EPI32     _mm256_abs_epi32
+#define AST_KERN_AVX2_ABS_EPI64     ast_kern_abs64_AVX2
+#define AST_KERN_AVX2_BNOT_EPI32(x) _mm256_xor_si256(x, _mm256_set1_epi32(-1))
+#define AST_KERN_AVX2_BAND_EPI32    _mm256_and_si256
+#define AST_KERN_AVX2_BXOR_EPI32    _mm256_xor_si256
+#define AST_KERN_AVX2_BOR_EPI32     _mm256_or_si256
+#define AST_KERN_AVX2_LEFT_EPI32    _mm256_sllv_epi32
+#define AST_KERN_AVX2_LEFT_EPI64    _mm256_sllv_epi64
+#define AST_KERN_AVX2_RIGHT_EPI32   _mm256_srav_epi32
+#define AST_KERN_AVX2_RIGHT_EPI64   ast_kern_sra64_AVX2
+#define AST_KERN_AVX2_MULU          _mm256_mul_epu32
+#define AST_KERN_AVX2_SLLI64        _mm256_slli_epi64
+#define AST_KERN_AVX2_SRLI64        _mm256_srli_epi64
+#define AST_KERN_AVX2_TRUNC         _mm256_cvttpd_epi32
+#define AST_KERN_AVX2_IPACK(lo, hi)                                     \
+  _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1)
+
+#define AST_KERN_AVX512_WIDTH_EPI32 16
+#define AST_KERN_AVX512_LOAD_EPI32  _mm512_loadu_si512
+#define AST_KERN_AVX512_STORE_EPI32 _mm512_storeu_si512
+#define AST_KERN_AVX512_ADD_EPI32   _mm512_add_epi32
+#define AST_KERN_AVX512_ADD_EPI64   _mm512_add_epi64
+#define AST_KERN_AVX512_MINUS_EPI32 _mm512_sub_epi32
+#define AST_KERN_AVX512_MINUS_EPI64 _mm512_sub_epi64
+#define AST_KERN_AVX512_MUL_EPI32   _mm512_mullo_epi32
+#define AST_KERN_AVX512_MUL_EPI64   ast_kern_mul64_AVX512
+#define AST_KERN_AVX512_DIV_EPI32   ast_kern_div32_AVX512
+#define AST_KERN_AVX512_REM_EPI32   ast_kern_rem32_AVX512
+#define AST_KERN_AVX512_NEG_EPI32(x)                                    \
+  _mm512_sub_epi32(_mm512_setzero_si512(), x)
+#define AST_KERN_AVX512_NEG_EPI64(x)                                    \
+  _mm512_sub_epi64(_mm512_setzero_si512(), x)
+#define AST_KERN_AVX512_ABS_EPI32   _mm512_abs_epi32
+#define AST_KERN_AVX512_ABS_EPI64   _mm512_abs_epi64
+#define AST_KERN_AVX512_BNOT_EPI32(x)                                   \
+  _mm512_xor_si512(x, _mm512_set1_epi32(-1))
+#define AST_KERN_AVX512_BAND_EPI32  _mm512_and_si512
+#define AST_KERN_AVX512_BXOR_EPI32  _mm512_xor_si512
+#define AST_KERN_AVX512_BOR_EPI32   _mm512_or_si512
+#define AST_KERN_AVX512_LEFT_EPI32  _mm512_sllv_epi32
+#define AST_KERN_AVX512_LEFT_EPI64  _mm512_sllv_epi64
+#define AST_KERN_AVX512_RIGHT_EPI32 _mm512_srav_epi32
+#define AST_KERN_AVX512_RIGHT_EPI64 _mm512_srav_epi64
+#define AST_KERN_AVX512_MULU        _mm512_mul_epu32
+#define AST_KERN_AVX512_SLLI64      _mm512_slli_epi64
+#define AST_KERN_AVX512_SRLI64      _mm512_srli_epi64
+#define AST_KERN_AVX512_TRUNC       _mm512_cvttpd_epi32
+#define AST_KERN_AVX512_IPACK(lo, hi)                                   \
+  _mm512_inserti64x4(_mm512_castsi256_si512(lo), hi, 1)
+
+/* Bitwise operations are the same for int32 and int64 vectors. */
+#define AST_KERN_SSE2_LOAD_EPI64    AST_KERN_SSE2_LOAD_EPI32
+#define AST_KERN_SSE2_STORE_EPI64   AST_KERN_SSE2_STORE_EPI32
+#define AST_KERN_SSE2_BNOT_EPI64    AST_KERN_SSE2_BNOT_EPI32
+#define AST_KERN_SSE2_BAND_EPI64    AST_KERN_SSE2_BAND_EPI32
+#define AST_KERN_SSE2_BXOR_EPI64    AST_KERN_SSE2_BXOR_EPI32
+#define AST_KERN_SSE2_BOR_EPI64     AST_KERN_SSE2_BOR_EPI32
+#define AST_KERN_AVX2_LOAD_EPI32    AST_KERN_AVX2_LOAD_EPI64
+#define AST_KERN_AVX2_STORE_EPI64   AST_KERN_AVX2_STORE_EPI32
+#define AST_KERN_AVX2_BNOT_EPI64    AST_KERN_AVX2_BNOT_EPI32
+#define AST_KERN_AVX2_BAND_EPI64    AST_KERN_AVX2_BAND_EPI32
+#define AST_KERN_AVX2_BXOR_EPI64    AST_KERN_AVX2_BXOR_EPI32
+#define AST_KERN_AVX2_BOR_EPI64     AST_KERN_AVX2_BOR_EPI32
+#define AST_KERN_AVX512_STORE_EPI64 AST_KERN_AVX512_STORE_EPI32
+#define AST_KERN_AVX512_BNOT_EPI64  AST_KERN_AVX512_BNOT_EPI32
+#define AST_KERN_AVX512_BAND_EPI64  AST_KERN_AVX512_BAND_EPI32
+#define AST_KERN_AVX512_BXOR_EPI64  AST_KERN_AVX512_BXOR_EPI32
+#define AST_KERN_AVX512_BOR_EPI64   AST_KERN_AVX512_BOR_EPI32
+
+/* Define the multiplication of int64 vectors for an instruction set, with
+   products of the 32-bit halves, as there is no such instruction. */
+#define AST_KERN_MUL64(isa)                                             \
+  static AST_KERN_##isa##_ATTR AST_KV(isa, IV) ast_kern_mul64_##isa(    \
+      const AST_KV(isa, IV) a, const AST_KV(isa, IV) b) {               \
+    const AST_KV(isa, IV) hi = AST_KV(isa, ADD_EPI64)(                  \
+        AST_KV(isa, MULU)(AST_KV(isa, SRLI64)(a, 32), b),               \
+        AST_KV(isa, MULU)(a, AST_KV(isa, SRLI64)(b, 32)));              \
+    return AST_KV(isa, ADD_EPI64)(AST_KV(isa, MULU)(a, b),              \
+        AST_KV(isa, SLLI64)(hi, 32));                                   \
+  }
+
+/* Define the division and remainder of int32 vectors for an instruction set,
+   with the quotients of the halves computed in double precision, which are
+   exact after truncation, as the operands are smaller than 2^53. */
+#define AST_KERN_DIV32(isa)                                             \
+  static AST_KERN_##isa##_ATTR AST_KV(isa, IV) ast_kern_div32_##isa(    \
+      const AST_KV(isa, IV) a, const AST_KV(isa, IV) b) {               \
+    return AST_KV(isa, IPACK)(                                          \
+        AST_KV(isa, TRUNC)(AST_KV(isa, DDIV)(AST_KV(isa, ILO)(a),       \
+            AST_KV(isa, ILO)(b))),                                      \
+        AST_KV(isa, TRUNC)(AST_KV(isa, DDIV)(AST_KV(isa, IHI)(a),       \
+            AST_KV(isa, IHI)(b))));                                     \
+  }                                                                     \
+  static AST_KERN_##isa##_ATTR AST_KV(isa, IV) ast_kern_rem32_##isa(    \
+      const AST_KV(isa, IV) a, const AST_KV(isa, IV) b) {               \
+    return AST_KV(isa, MINUS_EPI32)(a,                                  \
+        AST_KV(isa, MUL_EPI32)(ast_kern_div32_##isa(a, b), b));         \
+  }
+
+AST_KERN_MUL64(AVX2)
+AST_KERN_MUL64(AVX512)
+AST_KERN_DIV32(AVX2)
+AST_KERN_DIV32(AVX512)
+
+/* Absolute values and arithmetic right shifts that are not available for
+   the instruction sets, with the sign bits of elements. */
+static AST_KERN_SSE2_ATTR __m128i ast_kern_abs32_SSE2(const __m128i x) {
+  const __m128i s = _mm_srai_epi32(x, 31);
+  return _mm_sub_epi32(_mm_xor_si128(x, s), s);
+}
+static AST_KERN_AVX2_ATTR __m256i ast_kern_abs64_AVX2(const __m256i x) {
+  const __m256i s = _mm256_cmpgt_epi64(_mm256_setzero_si256(), x);
+  return _mm256_sub_epi64(_mm256_xor_si256(x, s), s);
+}
+static AST_KERN_AVX2_ATTR __m256i ast_kern_sra64_AVX2(const __m256i x,
+    const __m256i n) {
+  const __m256i s = _mm256_cmpgt_epi64(_mm256_setzero_si256(), x);
+  return _mm256_xor_si256(_mm256_srlv_epi64(_mm256_xor_si256(x, s), n), s);
+}
+
+/* Define the integer kernels available for all instruction sets, and the
+   ones requiring AVX2 or later. */
+#define AST_KERN_INTEGER(isa, T, S)                                     \
+  AST_KERN_UOP(isa, T, S, NEG, AST_CLOS_OP_NEG)                         \
+  AST_KERN_UOP(isa, T, S, BNOT, AST_CLOS_OP_BNOT)                       \
+  AST_KERN_BOP(isa, T, S, ADD, AST_CLOS_OP_ADD)                         \
+  AST_KERN_BOP(isa, T, S, MINUS, AST_CLOS_OP_MINUS)                     \
+  AST_KERN_BOP(isa, T, S, BAND, AST_CLOS_OP_BAND)                       \
+  AST_KERN_BOP(isa, T, S, BXOR, AST_CLOS_OP_BXOR)                       \
+  AST_KERN_BOP(isa, T, S, BOR, AST_CLOS_OP_BOR)
+#define AST_KERN_INTEGER_AVX(isa, T, S)                                 \
+  AST_KERN_INTEGER(isa, T, S)                                           \
+  AST_KERN_UOP(isa, T, S, ABS, ast_clos_abs_##T)                        \
+  AST_KERN_BOP(isa, T, S, MUL, AST_CLOS_OP_MUL)                         \
+  AST_KERN_BOP(isa, T, S, LEFT, AST_CLOS_OP_LEFT)                       \
+  AST_KERN_BOP(isa, T, S, RIGHT, AST_CLOS_OP_RIGHT)
+
+#if INT_MAX == INT32_MAX
+AST_KERN_INTEGER(SSE2, int, EPI32)
+AST_KERN_UOP(SSE2, int, EPI32, ABS, ast_clos_abs_int)
+AST_KERN_INTEGER_AVX(AVX2, int, EPI32)
+AST_KERN_BOP(AVX2, int, EPI32, DIV, AST_CLOS_OP_DIV)
+AST_KERN_BOP(AVX2, int, EPI32, REM, AST_CLOS_OP_REM)
+AST_KERN_INTEGER_AVX(AVX512, int, EPI32)
+AST_KERN_BOP(AVX512, int, EPI32, DIV, AST_CLOS_OP_DIV)
+AST_KERN_BOP(AVX512, int, EPI32, REM, AST_CLOS_OP_REM)
+#endif
+#if LONG_MAX == INT64_MAX
+AST_KERN_INTEGER(SSE2, long, EPI64)
+AST_KERN_INTEGER_AVX(AVX2, long, EPI64)
+AST_KERN_INTEGER_AVX(AVX512, long, EPI64)
+#endif
+
+/* Define the kernel converting an array to a wider data type for an
+   instruction set, with the source elements of every vector loaded by `load`
+   and converted by `cvt`. */
+#define AST_KERN_CVT(isa, FT, T, W, load, cvt, store)                   \
+  static AST_KERN_##isa##_ATTR void ast_kern_cvt_##FT##_##T##_##isa(    \
+      void *dst, const void *src, const size_t n) {                     \
+    T *d = (T *) dst;                                                   \
+    const FT *a = (const FT *) src;                                     \
+    size_t i = 0;                                                       \
+    for (; i + W <= n; i += W) store(d + i, cvt(load(a + i)));          \
+    for (; i < n; i++) d[i] = (T) a[i];                                 \
+  }
+
+/* Loads of int32 and float elements for the conversions. */
+#define AST_KERN_LOAD_I64(p)    _mm_loadl_epi64((const __m128i *) (p))
+#define AST_KERN_LOAD_I128(p)   _mm_loadu_si128((const __m128i *) (p))
+#define AST_KERN_LOAD_I256(p)   _mm256_loadu_si256((const __m256i *) (p))
+#define AST_KERN_LOAD_F64(p)    _mm_castsi128_ps(AST_KERN_LOAD_I64(p))
+
+AST_KERN_CVT(SSE2, int, double, 2, AST_KERN_LOAD_I64, _mm_cvtepi32_pd,
+    _mm_storeu_pd)
+AST_KERN_CVT(SSE2, float, double, 2, AST_KERN_LOAD_F64, _mm_cvtps_pd,
+    _mm_storeu_pd)
+AST_KERN_CVT(SSE2, int, float, 4, AST_KERN_LOAD_I128, _mm_cvtepi32_ps,
+    _mm_storeu_ps)
+AST_KERN_CVT(AVX2, int, double, 4, AST_KERN_LOAD_I128, _mm256_cvtepi32_pd,
+    _mm256_storeu_pd)
+AST_KERN_CVT(AVX2, float, double, 4, _mm_loadu_ps, _mm256_cvtps_pd,
+    _mm256_storeu_pd)
+AST_KERN_CVT(AVX2, int, float, 8, AST_KERN_LOAD_I256, _mm256_cvtepi32_ps,
+    _mm256_storeu_ps)
+AST_KERN_CVT(AVX512, int, double, 8, AST_KERN_LOAD_I256, _mm512_cvtepi32_pd,
+    _mm512_storeu_pd)
+AST_KERN_CVT(AVX512, float, double, 8, _mm256_loadu_ps, _mm512_cvtps_pd,
+    _mm512_storeu_pd)
+AST_KERN_CVT(AVX512, int, float, 16, _mm512_loadu_si512,
+    _mm512_cvtepi32_ps, _mm512_storeu_ps)
+#if LONG_MAX == INT64_MAX
+AST_KERN_CVT(AVX2, int, long, 4, AST_KERN_LOAD_I128, _mm256_cvtepi32_epi64,
+    AST_KERN_AVX2_STORE_EPI64)
+AST_KERN_CVT(AVX512, int, long, 8, AST_KERN_LOAD_I256,
+    _mm512_cvtepi32_epi64, _mm512_storeu_si512)
+#endif
+
+/* Define the kernel writing indices of the set bits of a bitmask with
+   AVX-512, which compresses the indices of every group of rows into a
+   contiguous vector. The number of indices is never larger than the index of
+   the current row, so the full vectors stay within the arrays. */
+#define AST_KERN_INDEX(T, W, set1, setr, add, compress, bits)           \
+  static AST_KERN_AVX512_ATTR size_t ast_kern_index_##T##_AVX512(       \
+      void *idx, size_t num, const uint64_t *mask, const size_t base,   \
+      const size_t n) {                                                 \
+    T *id = (T *) idx;                                                  \
+    __m512i v = add(set1(base), setr);                                  \
+    size_t r = 0;                                                       \
+    for (; r + W <= n; r += W) {                                        \
+      const unsigned m = (unsigned) (mask[r >> 6] >> (r & 63)) & bits;  \
+      _mm512_storeu_si512(id + num, compress(m, v));                    \
+      num += __builtin_popcount(m);                                     \
+      v = add(v, set1(W));                                              \
+    }                                                                   \
+    for (; r < n; r++) {                                                \
+      id[num] = (T) (base + r);                                         \
+      num += (mask[r >> 6] >> (r & 63)) & 1;                            \
+    }                                                                   \
+    return num;                                                         \
+  }
+
+AST_KERN_INDEX(uint32_t, 16, _mm512_set1_epi32, _mm512_setr_epi32(0, 1, 2,
+      3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15), _mm512_add_epi32,
+    _mm512_maskz_compress_epi32, 0xffff)
+AST_KERN_INDEX(uint64_t, 8, _mm512_set1_epi64, _mm512_setr_epi64(0, 1, 2,
+      3, 4, 5, 6, 7), _mm512_add_epi64, _mm512_maskz_compress_epi64, 0xff)
+
+/* Tables of the kernels for the instruction sets. */
+#define AST_KERN_UOPS(isa, T)                                           \
+  [AST_TOK_NEG] = ast_kern_NEG_##T##_##isa,                             \
+  [AST_TOK_ABS] = ast_kern_ABS_##T##_##isa,                             \
+  [AST_TOK_SQRT] = ast_kern_SQRT_##T##_##isa
+#define AST_KERN_BOPS(isa, T)                                           \
+  [AST_TOK_ADD] = ast_kern_ADD_##T##_##isa,                             \
+  [AST_TOK_MINUS] = ast_kern_MINUS_##T##_##isa,                         \
+  [AST_TOK_MUL] = ast_kern_MUL_##T##_##isa,                             \
+  [AST_TOK_DIV] = ast_kern_DIV_##T##_##isa
+#define AST_KERN_FMAS(isa, T)                                           \
+  [AST_TOK_FMA] = ast_kern_FMA_##T##_##isa,                             \
+  [AST_TOK_FMS] = ast_kern_FMS_##T##_##isa
+#define AST_KERN_CVTS(isa, T)                                           \
+  [AST_DTYPE_INT] = ast_kern_cvt_int_##T##_##isa,                       \
+  [AST_DTYPE_FLOAT] = ast_kern_cvt_float_##T##_##isa
+#define AST_KERN_INTEGER_UOPS(isa, T)                                   \
+  [AST_TOK_NEG] = ast_kern_NEG_##T##_##isa,                             \
+  [AST_TOK_BNOT] = ast_kern_BNOT_##T##_##isa
+#define AST_KERN_INTEGER_BOPS(isa, T)                                   \
+  [AST_TOK_ADD] = ast_kern_ADD_##T##_##isa,                             \
+  [AST_TOK_MINUS] = ast_kern_MINUS_##T##_##isa,                         \
+  [AST_TOK_BAND] = ast_kern_BAND_##T##_##isa,                           \
+  [AST_TOK_BXOR] = ast_kern_BXOR_##T##_##isa,                           \
+  [AST_TOK_BOR] = ast_kern_BOR_##T##_##isa
+#define AST_KERN_INTEGER_AVX_UOPS(isa, T)                               \
+  AST_KERN_INTEGER_UOPS(isa, T),                                        \
+  [AST_TOK_ABS] = ast_kern_ABS_##T##_##isa
+#define AST_KERN_INTEGER_AVX_BOPS(isa, T)                               \
+  AST_KERN_INTEGER_BOPS(isa, T),                                        \
+  [AST_TOK_MUL] = ast_kern_MUL_##T##_##isa,                             \
+  [AST_TOK_LEFT] = ast_kern_LEFT_##T##_##isa,                           \
+  [AST_TOK_RIGHT] = ast_kern_RIGHT_##T##_##isa
+#define AST_KERN_CMPOPS(isa, T)                                         \
+  [AST_TOK_LT] = ast_kern_LT_##T##_##isa,                               \
+  [AST_TOK_LE] = ast_kern_LE_##T##_##isa,                               \
+  [AST_TOK_GT] = ast_kern_GT_##T##_##isa,                               \
+  [AST_TOK_GE] = ast_kern_GE_##T##_##isa,                               \
+  [AST_TOK_EQ] = ast_kern_EQ_##T##_##isa,                               \
+  [AST_TOK_NEQ] = ast_kern_NEQ_##T##_##isa
+
+static const ast_kern_t ast_kern_double_SSE2 = {
+  .uop = { AST_KERN_UOPS(SSE2, double) },
+  .bop = { AST_KERN_BOPS(SSE2, double) },
+  .cmp = { AST_KERN_CMPOPS(SSE2, double) },
+  .cvt = { AST_KERN_CVTS(SSE2, double) }
+};
+static const ast_kern_t ast_kern_float_SSE2 = {
+  .uop = { AST_KERN_UOPS(SSE2, float) },
+  .bop = { AST_KERN_BOPS(SSE2, float) },
+  .cvt = { [AST_DTYPE_INT] = ast_kern_cvt_int_float_SSE2 }
+};
+static const ast_kern_t ast_kern_double_AVX2 = {
+  .uop = { AST_KERN_UOPS(AVX2, double) },
+  .bop = { AST_KERN_BOPS(AVX2, double) },
+  .cmp = { AST_KERN_CMPOPS(AVX2, double) },
+  .fma = { AST_KERN_FMAS(AVX2FMA, double) },
+  .cvt = { AST_KERN_CVTS(AVX2, double) }
+};
+static const ast_kern_t ast_kern_float_AVX2 = {
+  .uop = { AST_KERN_UOPS(AVX2, float) },
+  .bop = { AST_KERN_BOPS(AVX2, float) },
+  .fma = { AST_KERN_FMAS(AVX2FMA, float) },
+  .cvt = { [AST_DTYPE_INT] = ast_kern_cvt_int_float_AVX2 }
+};
+static const ast_kern_t ast_kern_float_fast_AVX2 = {
+  .uop = { AST_KERN_UOPS(AVX2, float),
+    [AST_TOK_LN] = ast_kern_ln_float_AVX2,
+    [AST_TOK_LOG] = ast_kern_log_float_AVX2 },
+  .bop = { AST_KERN_BOPS(AVX2, float),
+    [AST_TOK_EXP] = ast_kern_pow_float_AVX2 },
+  .fma = { AST_KERN_FMAS(AVX2FMA, float) },
+  .cvt = { [AST_DTYPE_INT] = ast_kern_cvt_int_float_AVX2 }
+};
+static const ast_kern_t ast_kern_double_AVX512 = {
+  .uop = { AST_KERN_UOPS(AVX512, double) },
+  .bop = { AST_KERN_BOPS(AVX512, double) },
+  .cmp = { AST_KERN_CMPOPS(AVX512, double) },
+  .fma = { AST_KERN_FMAS(AVX512, double) },
+  .cvt = { AST_KERN_CVTS(AVX512, double) }
+};
+static const ast_kern_t ast_kern_float_AVX512 = {
+  .uop = { AST_KERN_UOPS(AVX512, float) },
+  .bop = { AST_KERN_BOPS(AVX512, float) },
+  .fma = { AST_KERN_FMAS(AVX512, float) },
+  .cvt = { [AST_DTYPE_INT] = ast_kern_cvt_int_float_AVX512 }
+};
+static const ast_kern_t ast_kern_float_fast_AVX512 = {
+  .uop = { AST_KERN_UOPS(AVX512, float),
+    [AST_TOK_LN] = ast_kern_ln_float_AVX512,
+    [AST_TOK_LOG] = ast_kern_log_float_AVX512 },
+  .bop = { AST_KERN_BOPS(AVX512, float),
+    [AST_TOK_EXP] = ast_kern_pow_float_AVX512 },
+  .fma = { AST_KERN_FMAS(AVX512, float) },
+  .cvt = { [AST_DTYPE_INT] = ast_kern_cvt_int_float_AVX512 }
+};
+#if INT_MAX == INT32_MAX
+static const ast_kern_t ast_kern_int_SSE2 = {
+  .uop = { AST_KERN_INTEGER_UOPS(SSE2, int),
+    [AST_TOK_ABS] = ast_kern_ABS_int_SSE2 },
+  .bop = { AST_KERN_INTEGER_BOPS(SSE2, int) }
+};
+static const ast_kern_t ast_kern_int_AVX2 = {
+  .uop = { AST_KERN_INTEGER_AVX_UOPS(AVX2, int) },
+  .bop = { AST_KERN_INTEGER_AVX_BOPS(AVX2, int),
+    [AST_TOK_DIV] = ast_kern_DIV_int_AVX2,
+    [AST_TOK_REM] = ast_kern_REM_int_AVX2 }
+};
+static const ast_kern_t ast_kern_int_AVX512 = {
+  .uop = { AST_KERN_INTEGER_AVX_UOPS(AVX512, int) },
+  .bop = { AST_KERN_INTEGER_AVX_BOPS(AVX512, int),
+    [AST_TOK_DIV] = ast_kern_DIV_int_AVX512,
+    [AST_TOK_REM] = ast_kern_REM_int_AVX512 }
+};
+#endif
+#if LONG_MAX == INT64_MAX
+static const ast_kern_t ast_kern_long_SSE2 = {
+  .uop = { AST_KERN_INTEGER_UOPS(SSE2, long) },
+  .bop = { AST_KERN_INTEGER_BOPS(SSE2, long) }
+};
+static const ast_kern_t ast_kern_long_AVX2 = {
+  .uop = { AST_KERN_INTEGER_AVX_UOPS(AVX2, long) },
+  .bop = { AST_KERN_INTEGER_AVX_BOPS(AVX2, long) },
+  .cmp = { AST_KERN_CMPOPS(AVX2, long) },
+  .cvt = { [AST_DTYPE_INT] = ast_kern_cvt_int_long_AVX2 }
+};
+static const ast_kern_t ast_kern_long_AVX512 = {
+  .uop = { AST_KERN_INTEGER_AVX_UOPS(AVX512, long) },
+  .bop = { AST_KERN_INTEGER_AVX_BOPS(AVX512, long) },
+  .cmp = { AST_KERN_CMPOPS(AVX512, long) },
+  .cvt = { [AST_DTYPE_INT] = ast_kern_cvt_int_long_AVX512 }
+};
+#endif
+#endif
+
+#ifdef AST_SIMD_VECEXT
+/* Vector types of the portable kernels, with `W` elements of the type `T`,
+   which can be unaligned. Operations on them are lowered by the compiler to
+   the instruction set of the build target, or to scalar operations if the
+   vectors are not supported. */
+#define AST_KERN_GENERIC_VEC(T, W, name)                                \
+  typedef T name __attribute__((vector_size((W) * sizeof(T)),           \
+      aligned(sizeof(T)), may_alias));
+#define AST_KERN_GENERIC_WIDTH(T)       (AST_VECEXT_BYTES / sizeof(T))
+
+AST_KERN_GENERIC_VEC(int, AST_KERN_GENERIC_WIDTH(int), ast_vec_int_t)
+AST_KERN_GENERIC_VEC(long, AST_KERN_GENERIC_WIDTH(long), ast_vec_long_t)
+AST_KERN_GENERIC_VEC(float, AST_KERN_GENERIC_WIDTH(float), ast_vec_float_t)
+AST_KERN_GENERIC_VEC(double, AST_KERN_GENERIC_WIDTH(double),
+    ast_vec_double_t)
+AST_KERN_GENERIC_VEC(int32_t, AST_KERN_GENERIC_WIDTH(int32_t),
+    ast_vec_i32_t)
+AST_KERN_GENERIC_VEC(int64_t, AST_KERN_GENERIC_WIDTH(int64_t),
+    ast_vec_i64_t)
+/* Double vectors with the same number of elements as int vectors. */
+AST_KERN_GENERIC_VEC(double, AST_KERN_GENERIC_WIDTH(int), ast_vec_idbl_t)
+
+#define AST_KERN_GENERIC_LOAD(T, p)     (*(const ast_vec_##T##_t *) (p))
+#define AST_KERN_GENERIC_STORE(T, p)    (*(ast_vec_##T##_t *) (p))
+
+/* Vector operations that are not expressed by the C operators, i.e., the
+   absolute values, with the sign bits cleared for floating-point numbers,
+   and the integer divisions, with quotients computed in double precision,
+   which are exact for 32-bit integers after truncation. */
+#define AST_KERN_GENERIC_ABS_float(x)                                   \
+  ((ast_vec_float_t) ((ast_vec_i32_t) (x) & INT32_MAX))
+#define AST_KERN_GENERIC_ABS_double(x)                                  \
+  ((ast_vec_double_t) ((ast_vec_i64_t) (x) & INT64_MAX))
+#define AST_KERN_GENERIC_ABS_int(x)                                     \
+  (((x) ^ ((x) >> (sizeof(int) * CHAR_BIT - 1))) -                      \
+   ((x) >> (sizeof(int) * CHAR_BIT - 1)))
+#define AST_KERN_GENERIC_ABS_long(x)                                    \
+  (((x) ^ ((x) >> (sizeof(long) * CHAR_BIT - 1))) -                     \
+   ((x) >> (sizeof(long) * CHAR_BIT - 1)))
+#define AST_KERN_GENERIC_DIV_int(x, y)                                  \
+  __builtin_convertvector(__builtin_convertvector(x, ast_vec_idbl_t) /   \
+      __builtin_convertvector(y, ast_vec_idbl_t), ast_vec_int_t)
+#define AST_KERN_GENERIC_REM_int(x, y)                                  \
+  ((x) - AST_KERN_GENERIC_DIV_int(x, y) * (y))
+
+/* Define the portable kernels of unary and binary operators for a data
+   type, with the remainders processed by scalar operations. */
+#define AST_KERN_GENERIC_UOP(T, name, vop, sop)                         \
+  static void ast_kern_##name##_##T##_GENERIC(void *dst,                \
+      const void *src, const size_t n) {                                \
+    T *d = (T *) dst;                                                   \
+    const T *a = (const T *) src;                                       \
+    const size_t w = AST_KERN_GENERIC_WIDTH(T);                         \
+    size_t i = 0;                                                       \
+    for (; i + w <= n; i += w) {                                        \
+      const ast_vec_##T##_t x = AST_KERN_GENERIC_LOAD(T, a + i);        \
+      AST_KERN_GENERIC_STORE(T, d + i) = vop(x);                        \
+    }                                                                   \
+    for (; i < n; i++) d[i] = sop(a[i]);                                \
+  }
+#define AST_KERN_GENERIC_BOP(T, name, vop, sop)                         \
+  static void ast_kern_##name##_##T##_GENERIC(void *dst,                \
+      const void *src1, const void *src2, const size_t n) {             \
+    T *d = (T *) dst;                                                   \
+    const T *a = (const T *) src1;                                      \
+    const T *b = (const T *) src2;                                      \
+    const size_t w = AST_KERN_GENERIC_WIDTH(T);                         \
+    size_t i = 0;                                                       \
+    for (; i + w <= n; i += w) {                                        \
+      const ast_vec_##T##_t x = AST_KERN_GENERIC_LOAD(T, a + i);        \
+      const ast_vec_##T##_t y = AST_KERN_GENERIC_LOAD(T, b + i);        \
+      AST_KERN_GENERIC_STORE(T, d + i) = vop(x, y);                     \
+    }                                                                   \
+    for (; i < n; i++) d[i] = sop(a[i], b[i]);                          \
+  }
+
+/* Define the portable kernels of comparisons for a data type, with the lane
+   masks, i.e., 0 or -1 for every element, packed into words of the bitmask.
+   The words are written after reading all the elements, so the bitmask can
+   overwrite the first operand. */
+#define AST_KERN_GENERIC_CMP(T, name, op)                               \
+  static void ast_kern_##name##_##T##_GENERIC(void *dst,                \
+      const void *src1, const void *src2, const size_t n) {             \
+    uint64_t *d = (uint64_t *) dst;                                     \
+    const T *a = (const T *) src1;                                      \
+    const T *b = (const T *) src2;                                      \
+    const size_t w = AST_KERN_GENERIC_WIDTH(T);                         \
+    for (size_t i = 0; i < n; i += 64, a += 64, b += 64) {              \
+      const size_t m = (n - i < 64) ? n - i : 64;                       \
+      uint64_t bits = 0;                                                \
+      size_t j = 0;                                                     \
+      for (; j + w <= m; j += w) {                                      \
+        const __typeof__(op(AST_KERN_GENERIC_LOAD(T, a),                \
+            AST_KERN_GENERIC_LOAD(T, b))) c = op(                       \
+            AST_KERN_GENERIC_LOAD(T, a + j),                            \
+            AST_KERN_GENERIC_LOAD(T, b + j));                           \
+        for (size_t k = 0; k < w; k++)                                  \
+          bits |= (uint64_t) (c[k] & 1) << (j + k);                     \
+      }                                                                 \
+      for (; j < m; j++) bits |= (uint64_t) op(a[j], b[j]) << j;        \
+      d[i >> 6] = bits;                                                 \
+    }                                                                   \
+  }
+
+/* Define the portable kernel converting an array to a wider data type, with
+   the source elements of every vector loaded as a narrower vector. */
+#define AST_KERN_GENERIC_CVT(FT, T)                                     \
+  static void ast_kern_cvt_##FT##_##T##_GENERIC(void *dst,              \
+      const void *src, const size_t n) {                                \
+    AST_KERN_GENERIC_VEC(FT, AST_KERN_GENERIC_WIDTH(T), ast_vec_src_t)  \
+    T *d = (T *) dst;                                                   \
+    const FT *a = (const FT *) src;                                     \
+    const size_t w = AST_KERN_GENERIC_WIDTH(T);                         \
+    size_t i = 0;                                                       \
+    for (; i + w <= n; i += w)                                          \
+      AST_KERN_GENERIC_STORE(T, d + i) = __builtin_convertvector(       \
+          *(const ast_vec_src_t *) (a + i), ast_vec_##T##_t);           \
+    for (; i < n; i++) d[i] = (T) a[i];                                 \
+  }
+
+/* Define the portable kernels for a data type. */
+#define AST_KERN_GENERIC_ARITH(T, abs)                                  \
+  AST_KERN_GENERIC_UOP(T, NEG, AST_CLOS_OP_NEG, AST_CLOS_OP_NEG)        \
+  AST_KERN_GENERIC_UOP(T, ABS, AST_KERN_GENERIC_ABS_##T, abs)           \
+  AST_KERN_GENERIC_BOP(T, ADD, AST_CLOS_OP_ADD, AST_CLOS_OP_ADD)        \
+  AST_KERN_GENERIC_BOP(T, MINUS, AST_CLOS_OP_MINUS, AST_CLOS_OP_MINUS)
+#define AST_KERN_GENERIC_INTEGER(T)                                     \
+  AST_KERN_GENERIC_ARITH(T, ast_clos_abs_##T)                           \
+  AST_KERN_GENERIC_UOP(T, BNOT, AST_CLOS_OP_BNOT, AST_CLOS_OP_BNOT)     \
+  AST_KERN_GENERIC_BOP(T, BAND, AST_CLOS_OP_BAND, AST_CLOS_OP_BAND)     \
+  AST_KERN_GENERIC_BOP(T, BXOR, AST_CLOS_OP_BXOR, AST_CLOS_OP_BXOR)     \
+  AST_KERN_GENERIC_BOP(T, BOR, AST_CLOS_OP_BOR, AST_CLOS_OP_BOR)
+#define AST_KERN_GENERIC_CMPS(T)                                        \
+  AST_KERN_GENERIC_CMP(T, LT, AST_CLOS_OP_LT)                           \
+  AST_KERN_GENERIC_CMP(T, LE, AST_CLOS_OP_LE)                           \
+  AST_KERN_GENERIC_CMP(T, GT, AST_CLOS_OP_GT)                           \
+  AST_KERN_GENERIC_CMP(T, GE, AST_CLOS_OP_GE)                           \
+  AST_KERN_GENERIC_CMP(T, EQ, AST_CLOS_OP_EQ)                           \
+  AST_KERN_GENERIC_CMP(T, NEQ, AST_CLOS_OP_NEQ)
+
+AST_KERN_GENERIC_ARITH(float, fabsf)
+AST_KERN_GENERIC_BOP(float, MUL, AST_CLOS_OP_MUL, AST_CLOS_OP_MUL)
+AST_KERN_GENERIC_BOP(float, DIV, AST_CLOS_OP_DIV, AST_CLOS_OP_DIV)
+AST_KERN_GENERIC_ARITH(double, fabs)
+AST_KERN_GENERIC_BOP(double, MUL, AST_CLOS_OP_MUL, AST_CLOS_OP_MUL)
+AST_KERN_GENERIC_BOP(double, DIV, AST_CLOS_OP_DIV, AST_CLOS_OP_DIV)
+AST_KERN_GENERIC_CMPS(double)
+AST_KERN_GENERIC_INTEGER(int)
+AST_KERN_GENERIC_BOP(int, MUL, AST_CLOS_OP_MUL, AST_CLOS_OP_MUL)
+AST_KERN_GENERIC_BOP(int, DIV, AST_KERN_GENERIC_DIV_int, AST_CLOS_OP_DIV)
+AST_KERN_GENERIC_BOP(int, REM, AST_KERN_GENERIC_REM_int, AST_CLOS_OP_REM)
+AST_KERN_GENERIC_INTEGER(long)
+AST_KERN_GENERIC_CMPS(long)
+AST_KERN_GENERIC_CVT(int, long)
+AST_KERN_GENERIC_CVT(int, float)
+AST_KERN_GENERIC_CVT(int, double)
+AST_KERN_GENERIC_CVT(float, double)
+
+/* Tables of the portable kernels. */
+#define AST_KERN_GENERIC_UOPS(T)                                        \
+  [AST_TOK_NEG] = ast_kern_NEG_##T##_GENERIC,                           \
+  [AST_TOK_ABS] = ast_kern_ABS_##T##_GENERIC
+#define AST_KERN_GENERIC_BOPS(T)                                        \
+  [AST_TOK_ADD] = ast_kern_ADD_##T##_GENERIC,                           \
+  [AST_TOK_MINUS] = ast_kern_MINUS_##T##_GENERIC
+#define AST_KERN_GENERIC_INTEGER_UOPS(T)                                \
+  AST_KERN_GENERIC_UOPS(T),                                             \
+  [AST_TOK_BNOT] = ast_kern_BNOT_##T##_GENERIC
+#define AST_KERN_GENERIC_INTEGER_BOPS(T)                                \
+  AST_KERN_GENERIC_BOPS(T),                                             \
+  [AST_TOK_BAND] = ast_kern_BAND_##T##_GENERIC,                         \
+  [AST_TOK_BXOR] = ast_kern_BXOR_##T##_GENERIC,                         \
+  [AST_TOK_BOR] = ast_kern_BOR_##T##_GENERIC
+#define AST_KERN_GENERIC_CMPOPS(T)                                      \
+  [AST_TOK_LT] = ast_kern_LT_##T##_GENERIC,                             \
+  [AST_TOK_LE] = ast_kern_LE_##T##_GENERIC,                             \
+  [AST_TOK_GT] = ast_kern_GT_##T##_GENERIC,                             \
+  [AST_TOK_GE] = ast_kern_GE_##T##_GENERIC,                             \
+  [AST_TOK_EQ] = ast_kern_EQ_##T##_GENERIC,                             \
+  [AST_TOK_NEQ] = ast_kern_NEQ_##T##_GENERIC
+
+static const ast_kern_t ast_kern_int_GENERIC = {
+  .uop = { AST_KERN_GENERIC_INTEGER_UOPS(int) },
+  .bop = { AST_KERN_GENERIC_INTEGER_BOPS(int),
+    [AST_TOK_MUL] = ast_kern_MUL_int_GENERIC,
+    [AST_TOK_DIV] = ast_kern_DIV_int_GENERIC,
+    [AST_TOK_REM] = ast_kern_REM_int_GENERIC }
+};
+static const ast_kern_t ast_kern_long_GENERIC = {
+  .uop = { AST_KERN_GENERIC_INTEGER_UOPS(long) },
+  .bop = { AST_KERN_GENERIC_INTEGER_BOPS(long) },
+  .cmp = { AST_KERN_GENERIC_CMPOPS(long) },
+  .cvt = { [AST_DTYPE_INT] = ast_kern_cvt_int_long_GENERIC }
+};
+static const ast_kern_t ast_kern_float_GENERIC = {
+  .uop = { AST_KERN_GENERIC_UOPS(float) },
+  .bop = { AST_KERN_GENERIC_BOPS(float),
+    [AST_TOK_MUL] = ast_kern_MUL_float_GENERIC,
+    [AST_TOK_DIV] = ast_kern_DIV_float_GENERIC },
+  .cvt = { [AST_DTYPE_INT] = ast_kern_cvt_int_float_GENERIC }
+};
+static const ast_kern_t ast_kern_double_GENERIC = {
+  .uop = { AST_KERN_GENERIC_UOPS(double) },
+  .bop = { AST_KERN_GENERIC_BOPS(double),
+    [AST_TOK_MUL] = ast_kern_MUL_double_GENERIC,
+    [AST_TOK_DIV] = ast_kern_DIV_double_GENERIC },
+  .cmp = { AST_KERN_GENERIC_CMPOPS(double) },
+  .cvt = { [AST_DTYPE_INT] = ast_kern_cvt_int_double_GENERIC,
+    [AST_DTYPE_FLOAT] = ast_kern_cvt_float_double_GENERIC }
+};
+#endif
+
+/******************************************************************************
+Function `ast_kern_select`:
+  Choose the vectorised kernels of an instruction set.
+Arguments:
+  * `dtype`:    data type of the operands;
+  * `math`:     accuracy of the mathematical functions;
+  * `simd`:     the instruction set, which is supported by the processor.
+Return:
+  The table of kernels on success; NULL if there is no kernel for the data
+  type or the instruction set.
+******************************************************************************/
+static const ast_kern_t *ast_kern_select(const ast_dtype_t dtype,
+    const ast_math_t math, const ast_simd_t simd) {
+  const bool fast = (math == AST_MATH_FAST);
+  switch (simd) {
+#ifdef AST_SIMD_X86
+    case AST_SIMD_AVX512:
+      switch (dtype) {
+        case AST_DTYPE_DOUBLE: return &ast_kern_double_AVX512;
+        case AST_DTYPE_FLOAT:
+          return fast ? &ast_kern_float_fast_AVX512 : &ast_kern_float_AVX512;
+#if INT_MAX == INT32_MAX
+        case AST_DTYPE_INT: return &ast_kern_int_AVX512;
+#endif
+#if LONG_MAX == INT64_MAX
+        case AST_DTYPE_LONG: return &ast_kern_long_AVX512;
+#endif
+        default: return NULL;
+      }
+    case AST_SIMD_AVX2:
+      switch (dtype) {
+        case AST_DTYPE_DOUBLE: return &ast_kern_double_AVX2;
+        case AST_DTYPE_FLOAT:
+          return fast ? &ast_kern_float_fast_AVX2 : &ast_kern_float_AVX2;
+#if INT_MAX == INT32_MAX
+        case AST_DTYPE_INT: return &ast_kern_int_AVX2;
+#endif
+#if LONG_MAX == INT64_MAX
+        case AST_DTYPE_LONG: return &ast_kern_long_AVX2;
+#endif
+        default: return NULL;
+      }
+    case AST_SIMD_SSE2:
+      switch (dtype) {
+        case AST_DTYPE_DOUBLE: return &ast_kern_double_SSE2;
+        case AST_DTYPE_FLOAT: return &ast_kern_float_SSE2;
+#if INT_MAX == INT32_MAX
+        case AST_DTYPE_INT: return &ast_kern_int_SSE2;
+#endif
+#if LONG_MAX == INT64_MAX
+        case AST_DTYPE_LONG: return &ast_kern_long_SSE2;
+#endif
+        default: return NULL;
+      }
+#endif
+#ifdef AST_SIMD_VECEXT
+    case AST_SIMD_GENERIC:
+      switch (dtype) {
+        case AST_DTYPE_DOUBLE: return &ast_kern_double_GENERIC;
+        case AST_DTYPE_FLOAT: return &ast_kern_float_GENERIC;
+        case AST_DTYPE_INT: return &ast_kern_int_GENERIC;
+        case AST_DTYPE_LONG: return &ast_kern_long_GENERIC;
+        default: return NULL;
+      }
+#endif
+    default:
+      (void) dtype;
+      (void) fast;
+      return NULL;
+  }
+}
+
+/* Define the portable kernel writing indices of the set bits of a bitmask,
+   without branches, as the number of indices is never larger than the index
+   of the current row. */
+#define AST_KERN_INDEX_SCALAR(T)                                        \
+  static size_t ast_kern_index_##T(void *idx, size_t num,               \
+      const uint64_t *mask, const size_t base, const size_t n) {        \
+    T *id = (T *) idx;                                                  \
+    for (size_t r = 0; r < n; r++) {                                    \
+      id[num] = (T) (base + r);                                         \
+      num += (mask[r >> 6] >> (r & 63)) & 1;                            \
+    }                                                                   \
+    return num;                                                         \
+  }
+
+AST_KERN_INDEX_SCALAR(uint32_t)
+AST_KERN_INDEX_SCALAR(uint64_t)
+
+/******************************************************************************
+Function `ast_kern_index`:
+  Choose the kernel writing indices of the set bits of bitmasks.
+Arguments:
+  * `wide`:     true for 64-bit indices, false for 32-bit indices;
+  * `simd`:     the instruction set of the kernels.
+Return:
+  The kernel for the instruction set.
+******************************************************************************/
+static ast_kern_idx_t ast_kern_index(const bool wide, const ast_simd_t simd) {
+#ifdef AST_SIMD_X86
+  if (simd == AST_SIMD_AVX512)
+    return wide ? ast_kern_index_uint64_t_AVX512 :
+      ast_kern_index_uint32_t_AVX512;
+#else
+  (void) simd;
+#endif
+  return wide ? ast_kern_index_uint64_t : ast_kern_index_uint32_t;
+}
+
+
+/*============================================================================*\
+                       Functions for the batch evaluation
+\*============================================================================*/
+
+/* Load an element of a column in its native data type. */
+#define AST_BATCH_LOAD(T, FT)                                           \
+  row[vidx[j] - 1] = (T) ((const FT *) col[j])[i];                      \
+  break;
+
+/* Define the batch evaluation with native code for a data type, for which
+   variables of each row are gathered in the layout of `ast_eval_num`. */
+#define AST_BATCH_FUNC(T, func)                                         \
+  static void ast_batch_##T(const ast_prog_t *prog, T *out,             \
+      const void *const *col, const ast_dtype_t *dtype,                 \
+      const size_t nrows) {                                             \
+    const long nvar = prog->nvar;                                       \
+    const long *vidx = prog->vidx;                                      \
+    T row[nvar ? vidx[nvar - 1] : 1];                                   \
+    for (size_t i = 0; i < nrows; i++) {                                \
+      for (long j = 0; j < nvar; j++) {                                 \
+        switch (dtype[j]) {                                             \
+          case AST_DTYPE_INT:   AST_BATCH_LOAD(T, int)                  \
+          case AST_DTYPE_LONG:  AST_BATCH_LOAD(T, long)                 \
+          case AST_DTYPE_FLOAT: AST_BATCH_LOAD(T, float)                \
+          default:              AST_BATCH_LOAD(T, double)               \
+        }                                                               \
+      }                                                                 \
+      out[i] = prog->func(row);                                         \
+    }                                                                   \
+  }
+
+AST_BATCH_FUNC(int, ifunc)
+AST_BATCH_FUNC(long, lfunc)
+AST_BATCH_FUNC(float, ffunc)
+AST_BATCH_FUNC(double, dfunc)
+
+/* Define the batch evaluation with native code and strided records for a
+   data type. */
+#define AST_STRIDED_FUNC(T, func)                                       \
+  static void ast_strided_##T(const ast_prog_t *prog, T *out,           \
+      const char *base, const size_t stride, const ast_field_t *field,  \
+      const size_t nrows) {                                             \
+    const long nvar = prog->nvar;                                       \
+    const long *vidx = prog->vidx;                                      \
+    const size_t ahead = (stride >= AST_PREFETCH_STRIDE) ?              \
+      AST_PREFETCH_ROWS : 0;                                            \
+    T row[nvar ? vidx[nvar - 1] : 1];                                   \
+    for (size_t i = 0; i < nrows; i++, base += stride) {                \
+      if (i + ahead < nrows && ahead) {                                 \
+        for (long j = 0; j < nvar; j++)                                 \
+          AST_PREFETCH(base + ahead * stride + field[j].offset);        \
+      }                                                                 \
+      for (long j = 0; j < nvar; j++) {                                 \
+        const char *p = base + field[j].offset;                         \
+        switch (field[j].dtype) {                                       \
+          case AST_DTYPE_INT:                                           \
+            row[vidx[j] - 1] = (T) *((const int *) p); break;           \
+          case AST_DTYPE_LONG:                                          \
+            row[vidx[j] - 1] = (T) *((const long *) p); break;          \
+          case AST_DTYPE_FLOAT:                                         \
+            row[vidx[j] - 1] = (T) *((const float *) p); break;         \
+          default:                                                      \
+            row[vidx[j] - 1] = (T) *((const double *) p); break;        \
+        }                                                               \
+      }                                                                 \
+      out[i] = prog->func(row);                                         \
+    }                                                                   \
+  }
+
+AST_STRIDED_FUNC(int, ifunc)
+AST_STRIDED_FUNC(long, lfunc)
+AST_STRIDED_FUNC(float, ffunc)
+AST_STRIDED_FUNC(double, dfunc)
+
+/******************************************************************************
+Function `ast_tile_rows`:
+  Number of rows in a tile for the vectorised batch evaluation, given the
+  number of scratch tiles, which are limited by the stack size.
+Arguments:
+  * `nslot`:    number of scratch tiles.
+Return:
+  The number of rows in a tile.
+******************************************************************************/
+static inline size_t ast_tile_rows(const long nslot) {
+  const size_t rows = (size_t) AST_TILE_ROWS * AST_TILE_SLOTS / nslot;
+  if (rows < 1) return 1;
+  return (rows > AST_TILE_ROWS) ? AST_TILE_ROWS : rows;
+}
+
+/******************************************************************************
+Function `ast_tile_powi_int`:
+  Integer powers of all rows of a tile with a small literal exponent, which
+  are unrolled into multiplies.
+Arguments:
+  * `d`:        the tile for the result, which can be the same as `a`;
+  * `a`:        the bases;
+  * `t`:        a scratch tile;
+  * `e`:        the exponent, from 2 to AST_CLOS_POWI_MAX;
+  * `n`:        number of rows of the tile;
+  * `kern`:     the vectorised kernels, NULL if not available.
+******************************************************************************/
+static void ast_tile_powi_int(int *d, const int *a, int *t, const int e,
+    const size_t n, const ast_kern_t *kern) {
+  /* Overflows of int powers give 0, so products are not wrapped around by
+     the vectorised multiplications. */
+  (void) t;
+  (void) kern;
+  switch (e) {
+    case 2: for (size_t r = 0; r < n; r++) d[r] = ast_clos_pow2_int(a[r]);
+      return;
+    case 3: for (size_t r = 0; r < n; r++) d[r] = ast_clos_pow3_int(a[r]);
+      return;
+    default: for (size_t r = 0; r < n; r++) d[r] = ast_clos_pow4_int(a[r]);
+      return;
+  }
+}
+
+/******************************************************************************
+Function `ast_tile_powi_long`:
+  Long integer powers of all rows of a tile with a small literal exponent,
+  which are unrolled into multiplies.
+Arguments:
+  * `d`:        the tile for the result, which can be the same as `a`;
+  * `a`:        the bases;
+  * `t`:        a scratch tile;
+  * `e`:        the exponent, from 2 to AST_CLOS_POWI_MAX;
+  * `n`:        number of rows of the tile;
+  * `kern`:     the vectorised kernels, NULL if not available.
+******************************************************************************/
+static void ast_tile_powi_long(long *d, const long *a, long *t, const int e,
+    const size_t n, const ast_kern_t *kern) {
+  if (kern && kern->bop[AST_TOK_MUL]) {
+    /* Products wrap around in the same way as `ipow`. */
+    const ast_kern_bop_t mul = kern->bop[AST_TOK_MUL];
+    mul((e == 2) ? d : t, a, a, n);
+    if (e == 3) mul(d, t, a, n);
+    else if (e == 4) mul(d, t, t, n);
+    return;
+  }
+  switch (e) {
+    case 2: for (size_t r = 0; r < n; r++) d[r] = ast_clos_pow2_long(a[r]);
+      return;
+    case 3: for (size_t r = 0; r < n; r++) d[r] = ast_clos_pow3_long(a[r]);
+      return;
+    default: for (size_t r = 0; r < n; r++) d[r] = ast_clos_pow4_long(a[r]);
+      return;
+  }
+}
+
+/* Destination of an operator: the output array for the last instruction, or
+   the scratch tile of the top of the value stack. */
+#define AST_TILE_DST                                                    \
+  d = (ip[1].op == AST_TOK_UNDEF) ? out : tile + (sp - 1 - stack) * cap
+
+/* Apply unary, binary, and fused multiply-add operators to all rows of a
+   tile, with the vectorised kernels if available. */
+#define AST_TILE_UOP(fn)                                                \
+  a = sp[-1];                                                           \
+  AST_TILE_DST;                                                         \
+  if (kern && kern->uop[ip->op]) kern->uop[ip->op](d, a, n);            \
+  else for (size_t r = 0; r < n; r++) d[r] = fn(a[r]);                  \
+  sp[-1] = d;                                                           \
+  break;
+#define AST_TILE_BOP(fn)                                                \
+  b = *--sp;                                                            \
+  a = sp[-1];                                                           \
+  AST_TILE_DST;                                                         \
+  if (kern && kern->bop[ip->op]) kern->bop[ip->op](d, a, b, n);         \
+  else for (size_t r = 0; r < n; r++) d[r] = fn(a[r], b[r]);            \
+  sp[-1] = d;                                                           \
+  break;
+#define AST_TILE_TOP(T, fn)                                             \
+  {                                                                     \
+    const T *c = *--sp;                                                 \
+    b = *--sp;                                                          \
+    a = sp[-1];                                                         \
+    AST_TILE_DST;                                                       \
+    if (kern && kern->fma[ip->op]) kern->fma[ip->op](d, a, b, c, n);    \
+    else for (size_t r = 0; r < n; r++) d[r] = fn(a[r], b[r], c[r]);    \
+    sp[-1] = d;                                                         \
+    break;                                                              \
+  }
+
+/* Powers with small literal exponents, which are the last instructions
+   before the operators, are unrolled into multiplies. */
+#define AST_TILE_POWI(T, val)                                           \
+  if (ip[-1].op == AST_TOK_NUM && ip[-1].value.v.val >= 2 &&            \
+      ip[-1].value.v.val <= AST_CLOS_POWI_MAX) {                        \
+    sp--;                                                               \
+    AST_TILE_DST;                                                       \
+    /* The tile of the literal is used for the intermediate results. */ \
+    ast_tile_powi_##T(d, sp[-1], tile + (sp - stack) * cap,             \
+        ip[-1].value.v.val, n, kern);                                   \
+    sp[-1] = d;                                                         \
+    break;                                                              \
+  }                                                                     \
+  AST_TILE_BOP(ast_clos_pow_##T)
+
+/* Operators specific to integers and real numbers. */
+#define AST_TILE_INTEGER_OPS(T, val)                                    \
+  case AST_TOK_EXP:     AST_TILE_POWI(T, val)                           \
+  case AST_TOK_BNOT:    AST_TILE_UOP(AST_CLOS_OP_BNOT)                  \
+  case AST_TOK_LEFT:    AST_TILE_BOP(AST_CLOS_OP_LEFT)                  \
+  case AST_TOK_RIGHT:   AST_TILE_BOP(AST_CLOS_OP_RIGHT)                 \
+  case AST_TOK_BAND:    AST_TILE_BOP(AST_CLOS_OP_BAND)                  \
+  case AST_TOK_BXOR:    AST_TILE_BOP(AST_CLOS_OP_BXOR)                  \
+  case AST_TOK_BOR:     AST_TILE_BOP(AST_CLOS_OP_BOR)
+#define AST_TILE_REAL_OPS(T, pow, sqrt, ln, log, fma, fms)              \
+  case AST_TOK_EXP:     AST_TILE_BOP(pow)                               \
+  case AST_TOK_SQRT:    AST_TILE_UOP(sqrt)                              \
+  case AST_TOK_LN:      AST_TILE_UOP(ln)                                \
+  case AST_TOK_LOG:     AST_TILE_UOP(log)                               \
+  case AST_TOK_FMA:     AST_TILE_TOP(T, fma)                            \
+  case AST_TOK_FMS:     AST_TILE_TOP(T, fms)
+
+/* Define the vectorised evaluation of a tile for a data type, which applies
+   every instruction of the compiled program to all rows of the tile, before
+   moving on to the next one. */
+#define AST_TILE_FUNC(T, val, abs, rem, OPS)                            \
+  static void ast_tile_##T(const ast_prog_t *prog, T *out,              \
+      const T *const *col, const size_t n, T *tile, const size_t cap,   \
+      const ast_kern_t *kern) {                                         \
+    const T *stack[prog->depth];                                        \
+    const T **sp = stack;                                               \
+    const T *a, *b;                                                     \
+    T *d;                                                               \
+    for (const ast_instr_t *ip = prog->instr; ; ip++) {                 \
+      switch (ip->op) {                                                 \
+        case AST_TOK_NUM:                                               \
+          d = tile + (sp - stack) * cap;                                \
+          for (size_t r = 0; r < n; r++) d[r] = ip->value.v.val;        \
+          *sp++ = d;                                                    \
+          break;                                                        \
+        case AST_TOK_VAR:                                               \
+          *sp++ = col[ip->value.v.lval];                                \
+          break;                                                        \
+        case AST_TOK_NEG:       AST_TILE_UOP(AST_CLOS_OP_NEG)           \
+        case AST_TOK_ABS:       AST_TILE_UOP(abs)                       \
+        case AST_TOK_ADD:       AST_TILE_BOP(AST_CLOS_OP_ADD)           \
+        case AST_TOK_MINUS:     AST_TILE_BOP(AST_CLOS_OP_MINUS)         \
+        case AST_TOK_MUL:       AST_TILE_BOP(AST_CLOS_OP_MUL)           \
+        case AST_TOK_DIV:       AST_TILE_BOP(AST_CLOS_OP_DIV)           \
+        case AST_TOK_REM:       AST_TILE_BOP(rem)                       \
+        OPS                                                             \
+        default:        /* end of the program */                        \
+          if (*stack != out)                                            \
+            for (size_t r = 0; r < n; r++) out[r] = (*stack)[r];        \
+          return;                                                       \
+      }                                                                 \
+    }                                                                   \
+  }
+
+AST_TILE_FUNC(int, ival, ast_clos_abs_int, AST_CLOS_OP_REM,
+    AST_TILE_INTEGER_OPS(int, ival))
+AST_TILE_FUNC(long, lval, ast_clos_abs_long, AST_CLOS_OP_REM,
+    AST_TILE_INTEGER_OPS(long, lval))
+AST_TILE_FUNC(float, fval, fabsf, fmodf,
+    AST_TILE_REAL_OPS(float, powf, sqrtf, logf, log10f, fmaf,
+        ast_clos_fms_float))
+AST_TILE_FUNC(double, dval, fabs, fmod,
+    AST_TILE_REAL_OPS(double, pow, sqrt, log, log10, fma,
+        ast_clos_fms_double))
+
+/* Convert rows of a column to the data type of the expression, with the
+   vectorised kernels if available. */
+#define AST_TILE_CONVERT(T, FT)                                         \
+  {                                                                     \
+    const FT *a = (const FT *) src + i;                                 \
+    if (kern && kern->cvt[dtype]) kern->cvt[dtype](dst, a, n);          \
+    else for (size_t r = 0; r < n; r++) dst[r] = (T) a[r];              \
+    return;                                                             \
+  }
+
+/* Define the conversion of rows of a column to a data type, which is done
+   tile by tile, so that the converted columns are never stored in full. */
+#define AST_TILE_CONVERT_FUNC(T)                                        \
+  static void ast_tile_convert_##T(T *dst, const void *src,             \
+      const ast_dtype_t dtype, const size_t i, const size_t n,          \
+      const ast_kern_t *kern) {                                         \
+    switch (dtype) {                                                    \
+      case AST_DTYPE_INT:       AST_TILE_CONVERT(T, int)                \
+      case AST_DTYPE_LONG:      AST_TILE_CONVERT(T, long)               \
+      default:                  AST_TILE_CONVERT(T, float)              \
+    }                                                                   \
+  }
+
+AST_TILE_CONVERT_FUNC(int)
+AST_TILE_CONVERT_FUNC(long)
+AST_TILE_CONVERT_FUNC(float)
+AST_TILE_CONVERT_FUNC(double)
+
+/* Define the vectorised batch evaluation with columns of variables for a
+   data type, with columns of the other data types converted into tiles. */
+#define AST_TILE_BATCH_FUNC(T)                                          \
+  static void ast_tile_batch_##T(const ast_prog_t *prog, T *out,        \
+      const void *const *cols, const ast_dtype_t *dtype,                \
+      const size_t nrows) {                                             \
+    long nconv = 0;                                                     \
+    for (long j = 0; j < prog->nvar; j++)                               \
+      if (dtype[j] != prog->dtype) nconv++;                             \
+    const size_t cap = ast_tile_rows(prog->depth + nconv);              \
+    const ast_kern_t *kern =                                            \
+      ast_kern_select(prog->dtype, prog->math, prog->simd);             \
+    T tile[(prog->depth + nconv) * cap];                                \
+    const T *col[prog->nvar ? prog->nvar : 1];                          \
+    for (size_t i = 0; i < nrows; i += cap) {                           \
+      const size_t n = (nrows - i < cap) ? nrows - i : cap;             \
+      T *c = tile + prog->depth * cap;                                  \
+      for (long j = 0; j < prog->nvar; j++) {                           \
+        if (dtype[j] == prog->dtype) col[j] = (const T *) cols[j] + i;  \
+        else {                                                          \
+          ast_tile_convert_##T(c, cols[j], dtype[j], i, n, kern);       \
+          col[j] = c;                                                   \
+          c += cap;                                                     \
+        }                                                               \
+      }                                                                 \
+      ast_tile_##T(prog, out + i, col, n, tile, cap, kern);             \
+    }                                                                   \
+  }
+
+AST_TILE_BATCH_FUNC(int)
+AST_TILE_BATCH_FUNC(long)
+AST_TILE_BATCH_FUNC(float)
+AST_TILE_BATCH_FUNC(double)
+
+/* Gather a field of records into a column of the tile. */
+#define AST_TILE_GATHER(T, FT)                                          \
+  for (size_t r = 0; r < n; r++, p += stride) {                         \
+    if (ahead && i + r + ahead < nrows) AST_PREFETCH(p + ahead * stride); \
+    c[r] = (T) *((const FT *) p);                                       \
+  }                                                                     \
+  break;
+
+/* Define the vectorised batch evaluation with strided records for a data
+   type, with variables gathered into columns of the tile first. */
+#define AST_TILE_STRIDED_FUNC(T)                                        \
+  static void ast_tile_strided_##T(const ast_prog_t *prog, T *out,      \
+      const char *base, const size_t stride, const ast_field_t *field,  \
+      const size_t nrows) {                                             \
+    const size_t cap = ast_tile_rows(prog->depth + prog->nvar);         \
+    const ast_kern_t *kern =                                            \
+      ast_kern_select(prog->dtype, prog->math, prog->simd);             \
+    const size_t ahead = (stride >= AST_PREFETCH_STRIDE) ?              \
+      AST_PREFETCH_ROWS : 0;                                            \
+    T tile[(prog->depth + prog->nvar) * cap];                           \
+    const T *col[prog->nvar ? prog->nvar : 1];                          \
+    for (size_t i = 0; i < nrows; i += cap) {                           \
+      const size_t n = (nrows - i < cap) ? nrows - i : cap;             \
+      for (long j = 0; j < prog->nvar; j++) {                           \
+        T *c = tile + (prog->depth + j) * cap;                          \
+        const char *p = base + i * stride + field[j].offset;            \
+        switch (field[j].dtype) {                                       \
+          case AST_DTYPE_INT:   AST_TILE_GATHER(T, int)                 \
+          case AST_DTYPE_LONG:  AST_TILE_GATHER(T, long)                \
+          case AST_DTYPE_FLOAT: AST_TILE_GATHER(T, float)               \
+          default:              AST_TILE_GATHER(T, double)              \
+        }                                                               \
+        col[j] = c;                                                     \
+      }                                                                 \
+      ast_tile_##T(prog, out + i, col, n, tile, cap, kern);             \
+    }                                                                   \
+  }
+
+AST_TILE_STRIDED_FUNC(int)
+AST_TILE_STRIDED_FUNC(long)
+AST_TILE_STRIDED_FUNC(float)
+AST_TILE_STRIDED_FUNC(double)
+
+/******************************************************************************
+Function `ast_batch_check`:
+  Validate the columns of variables for the batch evaluation of a numerical
+  expression, and compile the expression if there is no native code.
+Arguments:
+  * `ast`:      interface of the abstract syntax tree;
+  * `cols`:     columns of variables, where `cols[i]` is for variable `$i+1`;
+  * `dtypes`:   data types of the columns, in the same order as `cols`, or
+                NULL if they are all the same as the expression;
+  * `col`:      the columns indexed by the positions of variables;
+  * `dtype`:    data types of the columns indexed by the positions.
+Return:
+  Zero on success; non-zero on error.
+******************************************************************************/
+static int ast_batch_check(ast_t *ast, const void *const *cols,
+    const ast_dtype_t *dtypes, const void **col, ast_dtype_t *dtype) {
+  if (ast->nvar && !cols) return AST_ERRNO(ast) = AST_ERR_VAR;
+  for (long i = 0; i < ast->nvar; i++) {
+    if (!(col[i] = cols[ast->vidx[i] - 1])) {
+      ast_msg(ast, "column not set for variable", ast->vidx[i], NULL);
+      return AST_ERRNO(ast) = AST_ERR_VAR;
+    }
+    dtype[i] = dtypes ? dtypes[ast->vidx[i] - 1] : ast->dtype;
+    const char *msg = ast_num_cast_check(ast->dtype, dtype[i]);
+    if (msg) {
+      ast_msg(ast, msg, ast->vidx[i], NULL);
+      return AST_ERRNO(ast) = AST_ERR_VAR;
+    }
+  }
+
+  const ast_prog_t *prog = (ast_prog_t *) ast->prog;
+  if (prog->ifunc || prog->lfunc || prog->ffunc || prog->dfunc) return 0;
+  return ast_compile(ast);
+}
+
+/******************************************************************************
+Function `ast_batch_num`:
+  Evaluate the numerical expression for multiple rows, given validated
+  columns of variables, one by one with native code if available, or tile by
+  tile with the compiled program otherwise.
+Arguments:
+  * `prog`:     the compiled program;
+  * `out`:      array for the evaluated values;
+  * `col`:      columns of variables, indexed by the positions;
+  * `dtype`:    data types of the columns;
+  * `nrows`:    number of rows to be evaluated.
+******************************************************************************/
+static void ast_batch_num(const ast_prog_t *prog, void *out,
+    const void *const *col, const ast_dtype_t *dtype, const size_t nrows) {
+  if (prog->ifunc || prog->lfunc || prog->ffunc || prog->dfunc) {
+    switch (prog->dtype) {
+      case AST_DTYPE_INT:
+        ast_batch_int(prog, (int *) out, col, dtype, nrows);
         return;
-      case AST_TOK_REM:
-        if (dtype == AST_DTYPE_INT) {
-          ires = v1->v.ival % v2->v.ival;
-          ast_set_var_value(&node->value, &ires, 0, AST_DTYPE_INT);
-        }
-        else if (dtype == AST_DTYPE_LONG) {
-          lres = v1->v.lval % v2->v.lval;
-          ast_set_var_value(&node->value, &lres, 0, AST_DTYPE_LONG);
-        }
-        else if (dtype == AST_DTYPE_FLOAT) {
-          fres = fmod(v1->v.fval, v2->v.fval);
-          ast_set_var_value(&node->value, &fres, 0, AST_DTYPE_FLOAT);
-        }
-        else if (dtype == AST_DTYPE_DOUBLE) {
-          dres = fmod(v1->v.dval, v2->v.dval);
-          ast_set_var_value(&node->value, &dres, 0, AST_DTYPE_DOUBLE);
-        }
-        else AST_ERRNO(ast) = AST_ERR_EVAL;
-        node->type = AST_TOK_NUM;
+      case AST_DTYPE_LONG:
+        ast_batch_long(prog, (long *) out, col, dtype, nrows);
         return;
-      case AST_TOK_LEFT:
-        if (dtype == AST_DTYPE_INT) {
-          ires = v1->v.ival << v2->v.ival;
-          ast_set_var_value(&node->value, &ires, 0, AST_DTYPE_INT);
-        }
-        else if (dtype == AST_DTYPE_LONG) {
-          lres = v1->v.lval << v2->v.lval;
-          ast_set_var_value(&node->value, &lres, 0, AST_DTYPE_LONG);
-        }
-        else AST_ERRNO(ast) = AST_ERR_EVAL;
-        node->type = AST_TOK_NUM;
+      case AST_DTYPE_FLOAT:
+        ast_batch_float(prog, (float *) out, col, dtype, nrows);
         return;
-      case AST_TOK_RIGHT:
-        if (dtype == AST_DTYPE_INT) {
-          ires = v1->v.ival >> v2->v.ival;
-          ast_set_var_value(&node->value, &ires, 0, AST_DTYPE_INT);
-        }
-        else if (dtype == AST_DTYPE_LONG) {
-          lres = v1->v.lval >> v2->v.lval;
-          ast_set_var_value(&node->value, &lres, 0, AST_DTYPE_LONG);
-        }
-        else AST_ERRNO(ast) = AST_ERR_EVAL;
-        node->type = AST_TOK_NUM;
+      default:
+        ast_batch_double(prog, (double *) out, col, dtype, nrows);
         return;
-      case AST_TOK_BAND:
-        if (dtype == AST_DTYPE_INT) {
-          ires = v1->v.ival & v2->v.ival;
-          ast_set_var_value(&node->value, &ires, 0, AST_DTYPE_INT);
+    }
+  }
+  switch (prog->dtype) {
+    case AST_DTYPE_INT:
+      ast_tile_batch_int(prog, (int *) out, col, dtype, nrows);
+      return;
+    case AST_DTYPE_LONG:
+      ast_tile_batch_long(prog, (long *) out, col, dtype, nrows);
+      return;
+    case AST_DTYPE_FLOAT:
+      ast_tile_batch_float(prog, (float *) out, col, dtype, nrows);
+      return;
+    default:
+      ast_tile_batch_double(prog, (double *) out, col, dtype, nrows);
+      return;
+  }
+}
+
+
+/*============================================================================*\
+           Functions for the batch evaluation of boolean expressions
+\*============================================================================*/
+
+/* Division and remainder of long integers, which give 0 instead of trapping
+   for zero divisors or overflows, as the rows may be skipped by the
+   short-circuits of `&&` and `||` in row-wise evaluations. */
+#define AST_MASK_DIV(x, y)                                              \
+  (((y) == 0 || ((y) == -1 && (x) == LONG_MIN)) ? 0 : (x) / (y))
+#define AST_MASK_REM(x, y)                                              \
+  (((y) == 0 || ((y) == -1 && (x) == LONG_MIN)) ? 0 : (x) % (y))
+
+/* Pack conditions of all rows of a tile into words of the bitmask, which are
+   written after reading the rows, so the bitmask can overwrite the operand. */
+#define AST_MASK_PACK(cond)                                             \
+  for (size_t k = 0, r = 0; k < nw; k++) {                              \
+    uint64_t w = 0;                                                     \
+    for (size_t j = 0; j < AST_MASK_BITS && r < n; j++, r++)            \
+      w |= (uint64_t) (cond) << j;                                      \
+    ((uint64_t *) d)[k] = w;                                            \
+  }                                                                     \
+  return;
+
+/* Apply operators to all rows of a tile, with the vectorised kernels if
+   available. */
+#define AST_MASK_UOP(T, fn)                                             \
+  if (kern && kern->uop[op]) kern->uop[op](d, a, n);                    \
+  else for (size_t r = 0; r < n; r++) ((T *) d)[r] = fn(x[r]);          \
+  return;
+#define AST_MASK_BOP(T, fn)                                             \
+  if (kern && kern->bop[op]) kern->bop[op](d, a, b, n);                 \
+  else for (size_t r = 0; r < n; r++) ((T *) d)[r] = fn(x[r], y[r]);    \
+  return;
+#define AST_MASK_CMP(fn)                                                \
+  if (kern && kern->cmp[op]) {                                          \
+    kern->cmp[op](d, a, b, n);                                          \
+    return;                                                             \
+  }                                                                     \
+  AST_MASK_PACK(fn(x[r], y[r]))
+
+/******************************************************************************
+Function `ast_mask_type`:
+  Data type of the result of an operator for boolean expressions, the same as
+  `ast_eval_bool_uopt` and `ast_eval_bool_bopt`.
+Arguments:
+  * `op`:       type of the operator;
+  * `dtype`:    data type of the operands.
+Return:
+  The data type of the result; AST_DTYPE_NULL if the operator does not apply.
+******************************************************************************/
+static ast_dtype_t ast_mask_type(const ast_tok_t op, const ast_dtype_t dtype) {
+  const bool num = (dtype == AST_DTYPE_LONG || dtype == AST_DTYPE_DOUBLE);
+  switch (op) {
+    case AST_TOK_LNOT:
+    case AST_TOK_EQ:
+    case AST_TOK_NEQ:
+      return AST_DTYPE_BOOL;
+    case AST_TOK_LAND:
+    case AST_TOK_LOR:
+      return (dtype == AST_DTYPE_BOOL) ? AST_DTYPE_BOOL : AST_DTYPE_NULL;
+    case AST_TOK_ISFINITE:
+      return (dtype == AST_DTYPE_DOUBLE) ? AST_DTYPE_BOOL : AST_DTYPE_NULL;
+    case AST_TOK_LT:
+    case AST_TOK_LE:
+    case AST_TOK_GT:
+    case AST_TOK_GE:
+      return num ? AST_DTYPE_BOOL : AST_DTYPE_NULL;
+    case AST_TOK_SQRT:
+    case AST_TOK_LN:
+    case AST_TOK_LOG:
+      return num ? AST_DTYPE_DOUBLE : AST_DTYPE_NULL;
+    case AST_TOK_NEG:
+    case AST_TOK_ABS:
+    case AST_TOK_ADD:
+    case AST_TOK_MINUS:
+    case AST_TOK_MUL:
+    case AST_TOK_DIV:
+    case AST_TOK_REM:
+    case AST_TOK_EXP:
+      return num ? dtype : AST_DTYPE_NULL;
+    case AST_TOK_BNOT:
+    case AST_TOK_LEFT:
+    case AST_TOK_RIGHT:
+    case AST_TOK_BAND:
+    case AST_TOK_BXOR:
+    case AST_TOK_BOR:
+      return (dtype == AST_DTYPE_LONG) ? AST_DTYPE_LONG : AST_DTYPE_NULL;
+    default:
+      return AST_DTYPE_NULL;
+  }
+}
+
+/******************************************************************************
+Function `ast_mask_check`:
+  Check the data types of all the values of the program for boolean
+  expressions, given the data types of variables, which are fixed for all the
+  rows of a batch.
+Arguments:
+  * `prog`:     the compiled program;
+  * `vtype`:    data types of variables, indexed by the positions.
+Return:
+  True if the program can be evaluated for the batch; false otherwise.
+******************************************************************************/
+static bool ast_mask_check(const ast_prog_t *prog, const ast_dtype_t *vtype) {
+  ast_dtype_t stack[prog->depth];
+  ast_dtype_t *sp = stack;
+  const ast_instr_t *end = prog->instr + prog->ninstr;
+
+  for (const ast_instr_t *ip = prog->instr; ip < end; ip++) {
+    if (ip->jump) continue;             /* branches are not taken */
+    ast_dtype_t dtype;
+    switch (ast_tok_attr[ip->op].argc) {
+      case 0:
+        dtype = (ip->op == AST_TOK_VAR) ? vtype[ip->value.v.lval] :
+          (ast_dtype_t) ip->value.dtype;
+        if (dtype != AST_DTYPE_BOOL && dtype != AST_DTYPE_LONG &&
+            dtype != AST_DTYPE_DOUBLE) return false;
+        *sp++ = dtype;
+        continue;
+      case 1:
+        dtype = sp[-1];
+        break;
+      default:
+        dtype = *--sp;
+        /* Mixed long and double operands are cast to double. */
+        if (sp[-1] != dtype) {
+          if ((sp[-1] | dtype) != (AST_DTYPE_LONG | AST_DTYPE_DOUBLE))
+            return false;
+          dtype = AST_DTYPE_DOUBLE;
         }
-        else if (dtype == AST_DTYPE_LONG) {
-          lres = v1->v.lval & v2->v.lval;
-          ast_set_var_value(&node->value, &lres, 0, AST_DTYPE_LONG);
+        break;
+    }
+    if ((sp[-1] = ast_mask_type(ip->op, dtype)) == AST_DTYPE_NULL)
+      return false;
+  }
+  return *stack == AST_DTYPE_BOOL;
+}
+
+/******************************************************************************
+Function `ast_mask_op_long`:
+  Apply an operator to all rows of a tile with long type operands.
+Arguments:
+  * `op`:       type of the operator;
+  * `d`:        the tile for the result, which can be the same as `a`;
+  * `a`:        the first operand;
+  * `b`:        the second operand, unused for unary operators;
+  * `n`:        number of rows of the tile;
+  * `nw`:       number of words for the bitmask of the tile;
+  * `kern`:     the vectorised kernels, NULL if not available.
+******************************************************************************/
+static void ast_mask_op_long(const ast_tok_t op, void *d, const void *a,
+    const void *b, const size_t n, const size_t nw, const ast_kern_t *kern) {
+  const long *x = (const long *) a;
+  const long *y = (const long *) b;
+  switch (op) {
+    case AST_TOK_NEG:   AST_MASK_UOP(long, AST_CLOS_OP_NEG)
+    case AST_TOK_ABS:   AST_MASK_UOP(long, ast_clos_abs_long)
+    case AST_TOK_BNOT:  AST_MASK_UOP(long, AST_CLOS_OP_BNOT)
+    case AST_TOK_SQRT:  AST_MASK_UOP(double, sqrt)
+    case AST_TOK_LN:    AST_MASK_UOP(double, log)
+    case AST_TOK_LOG:   AST_MASK_UOP(double, log10)
+    case AST_TOK_ADD:   AST_MASK_BOP(long, AST_CLOS_OP_ADD)
+    case AST_TOK_MINUS: AST_MASK_BOP(long, AST_CLOS_OP_MINUS)
+    case AST_TOK_MUL:   AST_MASK_BOP(long, AST_CLOS_OP_MUL)
+    case AST_TOK_DIV:   AST_MASK_BOP(long, AST_MASK_DIV)
+    case AST_TOK_REM:   AST_MASK_BOP(long, AST_MASK_REM)
+    case AST_TOK_EXP:   AST_MASK_BOP(long, ast_clos_pow_long)
+    case AST_TOK_LEFT:  AST_MASK_BOP(long, AST_CLOS_OP_LEFT)
+    case AST_TOK_RIGHT: AST_MASK_BOP(long, AST_CLOS_OP_RIGHT)
+    case AST_TOK_BAND:  AST_MASK_BOP(long, AST_CLOS_OP_BAND)
+    case AST_TOK_BXOR:  AST_MASK_BOP(long, AST_CLOS_OP_BXOR)
+    case AST_TOK_BOR:   AST_MASK_BOP(long, AST_CLOS_OP_BOR)
+    case AST_TOK_LT:    AST_MASK_CMP(AST_CLOS_OP_LT)
+    case AST_TOK_LE:    AST_MASK_CMP(AST_CLOS_OP_LE)
+    case AST_TOK_GT:    AST_MASK_CMP(AST_CLOS_OP_GT)
+    case AST_TOK_GE:    AST_MASK_CMP(AST_CLOS_OP_GE)
+    case AST_TOK_EQ:    AST_MASK_CMP(AST_CLOS_OP_EQ)
+    case AST_TOK_NEQ:   AST_MASK_CMP(AST_CLOS_OP_NEQ)
+    default:            AST_MASK_PACK(!x[r])        /* AST_TOK_LNOT */
+  }
+}
+
+/******************************************************************************
+Function `ast_mask_op_double`:
+  Apply an operator to all rows of a tile with double type operands.
+Arguments:
+  * `op`:       type of the operator;
+  * `d`:        the tile for the result, which can be the same as `a`;
+  * `a`:        the first operand;
+  * `b`:        the second operand, unused for unary operators;
+  * `n`:        number of rows of the tile;
+  * `nw`:       number of words for the bitmask of the tile;
+  * `kern`:     the vectorised kernels, NULL if not available.
+******************************************************************************/
+static void ast_mask_op_double(const ast_tok_t op, void *d, const void *a,
+    const void *b, const size_t n, const size_t nw, const ast_kern_t *kern) {
+  const double *x = (const double *) a;
+  const double *y = (const double *) b;
+  switch (op) {
+    case AST_TOK_NEG:   AST_MASK_UOP(double, AST_CLOS_OP_NEG)
+    case AST_TOK_ABS:   AST_MASK_UOP(double, fabs)
+    case AST_TOK_SQRT:  AST_MASK_UOP(double, sqrt)
+    case AST_TOK_LN:    AST_MASK_UOP(double, log)
+    case AST_TOK_LOG:   AST_MASK_UOP(double, log10)
+    case AST_TOK_ADD:   AST_MASK_BOP(double, AST_CLOS_OP_ADD)
+    case AST_TOK_MINUS: AST_MASK_BOP(double, AST_CLOS_OP_MINUS)
+    case AST_TOK_MUL:   AST_MASK_BOP(double, AST_CLOS_OP_MUL)
+    case AST_TOK_DIV:   AST_MASK_BOP(double, AST_CLOS_OP_DIV)
+    case AST_TOK_REM:   AST_MASK_BOP(double, fmod)
+    case AST_TOK_EXP:   AST_MASK_BOP(double, pow)
+    case AST_TOK_LT:    AST_MASK_CMP(AST_CLOS_OP_LT)
+    case AST_TOK_LE:    AST_MASK_CMP(AST_CLOS_OP_LE)
+    case AST_TOK_GT:    AST_MASK_CMP(AST_CLOS_OP_GT)
+    case AST_TOK_GE:    AST_MASK_CMP(AST_CLOS_OP_GE)
+    case AST_TOK_EQ:    AST_MASK_CMP(AST_CLOS_OP_EQ)
+    case AST_TOK_NEQ:   AST_MASK_CMP(AST_CLOS_OP_NEQ)
+    case AST_TOK_ISFINITE: AST_MASK_PACK(isfinite(x[r]) != 0)
+    default:            AST_MASK_PACK(!x[r])        /* AST_TOK_LNOT */
+  }
+}
+
+/******************************************************************************
+Function `ast_mask_op_bool`:
+  Apply an operator to all rows of a tile with bitmasks as operands, word by
+  word.
+Arguments:
+  * `op`:       type of the operator;
+  * `d`:        the bitmask for the result, which can be the same as `a`;
+  * `a`:        the first operand;
+  * `b`:        the second operand, unused for unary operators;
+  * `nw`:       number of words for the bitmask of the tile.
+******************************************************************************/
+static void ast_mask_op_bool(const ast_tok_t op, uint64_t *d,
+    const uint64_t *a, const uint64_t *b, const size_t nw) {
+  switch (op) {
+    case AST_TOK_LAND:
+      for (size_t k = 0; k < nw; k++) d[k] = a[k] & b[k];
+      return;
+    case AST_TOK_LOR:
+      for (size_t k = 0; k < nw; k++) d[k] = a[k] | b[k];
+      return;
+    case AST_TOK_EQ:
+      for (size_t k = 0; k < nw; k++) d[k] = ~(a[k] ^ b[k]);
+      return;
+    case AST_TOK_NEQ:
+      for (size_t k = 0; k < nw; k++) d[k] = a[k] ^ b[k];
+      return;
+    default:                            /* AST_TOK_LNOT */
+      for (size_t k = 0; k < nw; k++) d[k] = ~a[k];
+      return;
+  }
+}
+
+/******************************************************************************
+Function `ast_mask_tile`:
+  Evaluate the boolean expression for a tile, with every instruction of the
+  compiled program applied to all rows of the tile, and the results packed
+  into the bitmask.
+Arguments:
+  * `prog`:     the compiled program;
+  * `out`:      the bitmask of the tile;
+  * `col`:      columns of variables for the tile, indexed by the positions;
+  * `vtype`:    data types of the columns;
+  * `n`:        number of rows of the tile;
+  * `tile`:     scratch tiles for the value stack;
+  * `cap`:      capacity of each scratch tile, a multiple of `AST_MASK_BITS`;
+  * `kl`:       vectorised kernels for long type, NULL if not available;
+  * `kd`:       vectorised kernels for double type, NULL if not available.
+******************************************************************************/
+static void ast_mask_tile(const ast_prog_t *prog, uint64_t *out,
+    const void *const *col, const ast_dtype_t *vtype, const size_t n,
+    ast_cell_t *tile, const size_t cap, const ast_kern_t *kl,
+    const ast_kern_t *kd) {
+  const void *stack[prog->depth];
+  ast_dtype_t type[prog->depth];
+  long sp = 0;
+  const size_t nw = (n + AST_MASK_BITS - 1) / AST_MASK_BITS;
+  const ast_instr_t *end = prog->instr + prog->ninstr;
+
+  for (const ast_instr_t *ip = prog->instr; ip < end; ip++) {
+    if (ip->jump) continue;             /* all rows take both operands */
+    const int argc = ast_tok_attr[ip->op].argc;
+    ast_cell_t *d = tile + (sp - argc) * cap;
+
+    /* Push variables and literals. */
+    if (argc == 0) {
+      if (ip->op == AST_TOK_VAR) {
+        stack[sp] = col[ip->value.v.lval];
+        type[sp++] = vtype[ip->value.v.lval];
+        continue;
+      }
+      switch ((type[sp] = ip->value.dtype)) {
+        case AST_DTYPE_LONG:
+          for (size_t r = 0; r < n; r++) d[r].lval = ip->value.v.lval;
+          break;
+        case AST_DTYPE_DOUBLE:
+          for (size_t r = 0; r < n; r++) d[r].dval = ip->value.v.dval;
+          break;
+        default:
+          for (size_t k = 0; k < nw; k++)
+            d[k].bits = ip->value.v.bval ? UINT64_MAX : 0;
+          break;
+      }
+      stack[sp++] = d;
+      continue;
+    }
+
+    const void *a = stack[sp - argc];
+    const void *b = stack[sp - 1];
+    ast_dtype_t dtype = type[sp - argc];
+    /* Cast the long operand to double in its own scratch tile. */
+    if (argc == 2 && dtype != type[sp - 1]) {
+      ast_cell_t *c = (dtype == AST_DTYPE_LONG) ? d : d + cap;
+      const long *x = (dtype == AST_DTYPE_LONG) ? a : b;
+      for (size_t r = 0; r < n; r++) c[r].dval = (double) x[r];
+      if (dtype == AST_DTYPE_LONG) a = c;
+      else b = c;
+      dtype = AST_DTYPE_DOUBLE;
+    }
+    sp -= argc - 1;
+    type[sp - 1] = ast_mask_type(ip->op, dtype);
+    stack[sp - 1] = d;
+    if (dtype == AST_DTYPE_LONG) ast_mask_op_long(ip->op, d, a, b, n, nw, kl);
+    else if (dtype == AST_DTYPE_DOUBLE)
+      ast_mask_op_double(ip->op, d, a, b, n, nw, kd);
+    else ast_mask_op_bool(ip->op, &d->bits, a, b, nw);
+  }
+
+  /* Copy the result, with the bits beyond the last row cleared. */
+  const uint64_t *res = (const uint64_t *) *stack;
+  for (size_t k = 0; k < nw; k++) out[k] = res[k];
+  if (n % AST_MASK_BITS)
+    out[nw - 1] &= (UINT64_C(1) << (n % AST_MASK_BITS)) - 1;
+}
+
+/******************************************************************************
+Function `ast_mask_batch`:
+  Evaluate the boolean expression tile by tile, given columns of variables.
+Arguments:
+  * `prog`:     the compiled program;
+  * `dst`:      destination of the results;
+  * `cols`:     columns of variables, indexed by the positions;
+  * `dtypes`:   data types of the columns;
+  * `vtype`:    data types of variables for evaluation, i.e., long for int,
+                and double for float;
+  * `nrows`:    number of rows to be evaluated.
+******************************************************************************/
+static void ast_mask_batch(const ast_prog_t *prog, ast_mask_dst_t *dst,
+    const void *const *cols, const ast_dtype_t *dtypes,
+    const ast_dtype_t *vtype, const size_t nrows) {
+  const size_t cap = ast_tile_rows(prog->depth + prog->nvar) /
+    AST_MASK_BITS * AST_MASK_BITS;
+  const ast_kern_t *kl = ast_kern_select(AST_DTYPE_LONG, AST_MATH_EXACT,
+      prog->simd);
+  const ast_kern_t *kd = ast_kern_select(AST_DTYPE_DOUBLE, AST_MATH_EXACT,
+      prog->simd);
+  ast_cell_t tile[(prog->depth + prog->nvar) * cap];
+  const void *col[prog->nvar ? prog->nvar : 1];
+  uint64_t word[cap / AST_MASK_BITS];
+
+  for (size_t i = 0; i < nrows; i += cap) {
+    const size_t n = (nrows - i < cap) ? nrows - i : cap;
+    /* Columns of long and double types are used directly, while the others
+       are converted in the scratch tiles. */
+    for (long j = 0; j < prog->nvar; j++) {
+      ast_cell_t *c = tile + (prog->depth + j) * cap;
+      col[j] = c;
+      switch (dtypes[j]) {
+        case AST_DTYPE_BOOL:
+          for (size_t k = 0, r = 0; r < n; k++) {
+            const bool *v = (const bool *) cols[j] + i;
+            uint64_t w = 0;
+            for (size_t b = 0; b < AST_MASK_BITS && r < n; b++, r++)
+              w |= (uint64_t) v[r] << b;
+            c[k].bits = w;
+          }
+          break;
+        case AST_DTYPE_INT:
+          for (size_t r = 0; r < n; r++)
+            c[r].lval = ((const int *) cols[j])[i + r];
+          break;
+        case AST_DTYPE_FLOAT:
+          for (size_t r = 0; r < n; r++)
+            c[r].dval = ((const float *) cols[j])[i + r];
+          break;
+        case AST_DTYPE_LONG:
+          col[j] = (const long *) cols[j] + i;
+          break;
+        default:
+          col[j] = (const double *) cols[j] + i;
+          break;
+      }
+    }
+    uint64_t *mask = dst->mask ? dst->mask + i / AST_MASK_BITS : word;
+    ast_mask_tile(prog, mask, col, vtype, n, tile, cap, kl, kd);
+    if (dst->idx) dst->num = dst->sel(dst->idx, dst->num, mask, i, n);
+  }
+}
+
+/******************************************************************************
+Function `ast_mask_rows`:
+  Evaluate the boolean expression row by row, given columns of variables, for
+  expressions too deep for scratch tiles on the stack.
+Arguments:
+  * `prog`:     the compiled program;
+  * `dst`:      destination of the results;
+  * `cols`:     columns of variables, indexed by the positions;
+  * `dtypes`:   data types of the columns;
+  * `vtype`:    data types of variables for evaluation;
+  * `nrows`:    number of rows to be evaluated.
+Return:
+  Zero on success; non-zero on error.
+******************************************************************************/
+static int ast_mask_rows(const ast_prog_t *prog, ast_mask_dst_t *dst,
+    const void *const *cols, const ast_dtype_t *dtypes,
+    const ast_dtype_t *vtype, const size_t nrows) {
+  ast_var_t var[prog->nvar ? prog->nvar : 1];
+  for (long j = 0; j < prog->nvar; j++) var[j].dtype = vtype[j];
+
+  uint64_t w = 0;
+  for (size_t i = 0; i < nrows; i++) {
+    for (long j = 0; j < prog->nvar; j++) {
+      switch (dtypes[j]) {
+        case AST_DTYPE_BOOL:
+          var[j].v.bval = ((const bool *) cols[j])[i];
+          break;
+        case AST_DTYPE_INT:
+          var[j].v.lval = ((const int *) cols[j])[i];
+          break;
+        case AST_DTYPE_LONG:
+          var[j].v.lval = ((const long *) cols[j])[i];
+          break;
+        case AST_DTYPE_FLOAT:
+          var[j].v.dval = ((const float *) cols[j])[i];
+          break;
+        default:
+          var[j].v.dval = ((const double *) cols[j])[i];
+          break;
+      }
+    }
+    bool res;
+    if (ast_prog_eval_bool(prog, var, &res)) return AST_ERR_EVAL;
+    w |= (uint64_t) res << (i % AST_MASK_BITS);
+    if (i % AST_MASK_BITS == AST_MASK_BITS - 1 || i == nrows - 1) {
+      const size_t start = i / AST_MASK_BITS * AST_MASK_BITS;
+      if (dst->mask) dst->mask[i / AST_MASK_BITS] = w;
+      if (dst->idx)
+        dst->num = dst->sel(dst->idx, dst->num, &w, start, i + 1 - start);
+      w = 0;
+    }
+  }
+  return 0;
+}
+
+/******************************************************************************
+Function `ast_mask_run`:
+  Evaluate the boolean expression for multiple rows, given validated columns
+  of variables, tile by tile, or row by row for deep expressions.
+Arguments:
+  * `prog`:     the compiled program;
+  * `dst`:      destination of the results;
+  * `cols`:     columns of variables, indexed by the positions;
+  * `dtypes`:   data types of the columns;
+  * `vtype`:    data types of variables for evaluation;
+  * `nrows`:    number of rows to be evaluated.
+Return:
+  Zero on success; non-zero on error.
+******************************************************************************/
+static int ast_mask_run(const ast_prog_t *prog, ast_mask_dst_t *dst,
+    const void *const *cols, const ast_dtype_t *dtypes,
+    const ast_dtype_t *vtype, const size_t nrows) {
+  /* Scratch tiles hold at least one word of the bitmask for every slot. */
+  if (ast_tile_rows(prog->depth + prog->nvar) < AST_MASK_BITS)
+    return ast_mask_rows(prog, dst, cols, dtypes, vtype, nrows);
+  ast_mask_batch(prog, dst, cols, dtypes, vtype, nrows);
+  return 0;
+}
+
+/******************************************************************************
+Function `ast_mask_prep`:
+  Validate the columns of variables for the batch evaluation of a boolean
+  expression, with the same data type conversions as `ast_set_var`, and
+  compile the expression.
+Arguments:
+  * `ast`:      interface of the abstract syntax tree;
+  * `cols`:     columns of variables, where `cols[i]` is for variable `$i+1`;
+  * `dtypes`:   data types of the columns, in the same order as `cols`;
+  * `col`:      the columns indexed by the positions of variables;
+  * `dtype`:    data types of the columns indexed by the positions;
+  * `vtype`:    data types of variables for evaluation.
+Return:
+  Zero on success; non-zero on error.
+******************************************************************************/
+static int ast_mask_prep(ast_t *ast, const void *const *cols,
+    const ast_dtype_t *dtypes, const void **col, ast_dtype_t *dtype,
+    ast_dtype_t *vtype) {
+  if (ast->nvar && (!cols || !dtypes)) return AST_ERRNO(ast) = AST_ERR_VAR;
+  const ast_prog_t *prog = (ast_prog_t *) ast->prog;
+  for (long i = 0; i < ast->nvar; i++) {
+    const long idx = ast->vidx[i] - 1;
+    if (!(col[i] = cols[idx])) {
+      ast_msg(ast, "column not set for variable", ast->vidx[i], NULL);
+      return AST_ERRNO(ast) = AST_ERR_VAR;
+    }
+    switch ((dtype[i] = dtypes[idx])) {
+      case AST_DTYPE_INT: vtype[i] = AST_DTYPE_LONG; break;
+      case AST_DTYPE_FLOAT: vtype[i] = AST_DTYPE_DOUBLE; break;
+      case AST_DTYPE_BOOL:
+      case AST_DTYPE_LONG:
+      case AST_DTYPE_DOUBLE:
+        vtype[i] = dtype[i];
+        break;
+      default: vtype[i] = AST_DTYPE_NULL; break;
+    }
+    if (!(vtype[i] & prog->vtype[i])) {
+      ast_msg(ast, "unexpected data type for variable", ast->vidx[i], NULL);
+      return AST_ERRNO(ast) = AST_ERR_VAR;
+    }
+  }
+
+  if (ast_compile(ast)) return AST_ERRNO(ast);
+  if (!ast_mask_check(prog, vtype)) return AST_ERRNO(ast) = AST_ERR_EVAL;
+  return 0;
+}
+
+/******************************************************************************
+Function `ast_mask_eval`:
+  Validate the columns of variables, and evaluate the boolean expression for
+  multiple rows.
+Arguments:
+  * `ast`:      interface of the abstract syntax tree;
+  * `dst`:      destination of the results;
+  * `cols`:     columns of variables, where `cols[i]` is for variable `$i+1`;
+  * `dtypes`:   data types of the columns, in the same order as `cols`;
+  * `nrows`:    number of rows to be evaluated, which is positive.
+Return:
+  Zero on success; non-zero on error.
+******************************************************************************/
+static int ast_mask_eval(ast_t *ast, ast_mask_dst_t *dst,
+    const void *const *cols, const ast_dtype_t *dtypes, const size_t nrows) {
+  const long nvar = ast->nvar ? ast->nvar : 1;
+  const void *col[nvar];
+  ast_dtype_t dtype[nvar], vtype[nvar];
+  if (ast_mask_prep(ast, cols, dtypes, col, dtype, vtype))
+    return AST_ERRNO(ast);
+  if (ast_mask_run((ast_prog_t *) ast->prog, dst, col, dtype, vtype, nrows))
+    return AST_ERRNO(ast) = AST_ERR_EVAL;
+  return 0;
+}
+
+
+/*============================================================================*\
+                        Functions for the thread pool
+\*============================================================================*/
+
+#ifdef AST_POOL_PTHREAD
+/******************************************************************************
+Function `ast_pool_ncpu`:
+  Number of processors available to the process.
+Return:
+  The number of processors, which is at least 1.
+******************************************************************************/
+static int ast_pool_ncpu(void) {
+#ifdef __linux__
+  cpu_set_t set;
+  if (!sched_getaffinity(0, sizeof(cpu_set_t), &set) && CPU_COUNT(&set) > 0)
+    return CPU_COUNT(&set);
+#endif
+  const long n = sysconf(_SC_NPROCESSORS_ONLN);
+  if (n > 0) return (n > INT_MAX) ? INT_MAX : (int) n;
+  return 1;
+}
+
+/******************************************************************************
+Function `ast_pool_work`:
+  Main loop of a worker thread, which runs jobs of the thread pool until the
+  pool is destroyed.
+Arguments:
+  * `arg`:      the worker thread.
+Return:
+  NULL.
+******************************************************************************/
+static void *ast_pool_work(void *arg) {
+  const ast_worker_t *worker = (ast_worker_t *) arg;
+  ast_pool_t *pool = worker->pool;
+  unsigned long gen = 0;
+
+  pthread_mutex_lock(&pool->lock);
+  for (;;) {
+    while (!pool->stop && pool->gen == gen)
+      pthread_cond_wait(&pool->wake, &pool->lock);
+    if (pool->stop) break;
+    gen = pool->gen;
+    if (worker->id >= pool->active) continue;
+
+    const ast_pool_func_t func = pool->func;
+    void *job = pool->arg;
+    const int nthreads = pool->active;
+    pthread_mutex_unlock(&pool->lock);
+    func(job, worker->id, nthreads);
+    pthread_mutex_lock(&pool->lock);
+    if (--pool->busy == 0) pthread_cond_signal(&pool->done);
+  }
+  pthread_mutex_unlock(&pool->lock);
+  return NULL;
+}
+
+/******************************************************************************
+Function `ast_pool_attr`:
+  Set attributes of a worker thread: the stack size for scratch tiles, and
+  optionally the processor it runs on.
+Arguments:
+  * `attr`:     attributes of the thread;
+  * `id`:       index of the worker thread;
+  * `affinity`: true for binding the thread to a processor.
+Return:
+  Zero on success; non-zero on error.
+******************************************************************************/
+static int ast_pool_attr(pthread_attr_t *attr, const int id,
+    const bool affinity) {
+  size_t size;
+  if (pthread_attr_getstacksize(attr, &size)) return AST_ERR_THREAD;
+  if (size < AST_POOL_STACK &&
+      pthread_attr_setstacksize(attr, AST_POOL_STACK)) return AST_ERR_THREAD;
+
+#ifdef __linux__
+  /* Workers are distributed over the processors available to the process,
+     which are not used if the affinity mask cannot be retrieved. */
+  cpu_set_t avail, set;
+  if (!affinity || sched_getaffinity(0, sizeof(cpu_set_t), &avail)) return 0;
+  int k = id % CPU_COUNT(&avail);
+  CPU_ZERO(&set);
+  for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+    if (CPU_ISSET(cpu, &avail) && k-- == 0) {
+      CPU_SET(cpu, &set);
+      break;
+    }
+  }
+  if (pthread_attr_setaffinity_np(attr, sizeof(cpu_set_t), &set))
+    return AST_ERR_THREAD;
+#else
+  (void) id;
+  (void) affinity;
+#endif
+  return 0;
+}
+#endif
+
+/******************************************************************************
+Function `ast_pool_run`:
+  Run a job with the thread pool, and wait for all the threads.
+Arguments:
+  * `pool`:     the thread pool;
+  * `nthreads`: number of threads for the job, which is at least 1;
+  * `func`:     function of the job;
+  * `arg`:      argument of the job.
+******************************************************************************/
+static void ast_pool_run(ast_pool_t *pool, int nthreads,
+    const ast_pool_func_t func, void *arg) {
+  if (nthreads > pool->nthreads) nthreads = pool->nthreads;
+  if (nthreads <= 1) {
+    func(arg, 0, 1);
+    return;
+  }
+#ifdef AST_POOL_PTHREAD
+  /* Jobs submitted by different threads are run one after another. */
+  pthread_mutex_lock(&pool->run);
+  pthread_mutex_lock(&pool->lock);
+  pool->func = func;
+  pool->arg = arg;
+  pool->active = nthreads;
+  pool->busy = nthreads - 1;
+  pool->gen++;
+  pthread_cond_broadcast(&pool->wake);
+  pthread_mutex_unlock(&pool->lock);
+
+  func(arg, 0, nthreads);
+
+  pthread_mutex_lock(&pool->lock);
+  while (pool->busy) pthread_cond_wait(&pool->done, &pool->lock);
+  pthread_mutex_unlock(&pool->lock);
+  pthread_mutex_unlock(&pool->run);
+#endif
+}
+
+/* The thread pool of the library, which is created on demand with all the
+   processors, and persists until the program exits. */
+#ifdef AST_POOL_PTHREAD
+static ast_pool_t *ast_pool_lib = NULL;
+static pthread_mutex_t ast_pool_lib_lock = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+/******************************************************************************
+Function `ast_pool_default`:
+  Retrieve the thread pool of the library, and create it if necessary.
+Arguments:
+  * `nthreads`: number of threads to be used.
+Return:
+  The thread pool on success; NULL on error.
+******************************************************************************/
+static ast_pool_t *ast_pool_default(const int nthreads) {
+  /* A single thread runs jobs without the workers. */
+  static ast_pool_t serial = { .nthreads = 1 };
+#ifdef AST_POOL_PTHREAD
+  if (nthreads == 1) return &serial;
+  pthread_mutex_lock(&ast_pool_lib_lock);
+  if (!ast_pool_lib) ast_pool_lib = ast_pool_init(0, false);
+  ast_pool_t *pool = ast_pool_lib;
+  pthread_mutex_unlock(&ast_pool_lib_lock);
+  return pool;
+#else
+  (void) nthreads;
+  return &serial;
+#endif
+}
+
+
+/*============================================================================*\
+                   Functions for the work-stealing scheduler
+\*============================================================================*/
+
+/******************************************************************************
+Function `ast_deque_push`:
+  Push a range of rows to the bottom of a queue.
+Arguments:
+  * `deque`:    the queue;
+  * `range`:    the range of rows.
+Return:
+  True on success; false if the queue is full.
+******************************************************************************/
+static bool ast_deque_push(ast_deque_t *deque, const ast_range_t *range) {
+  bool ok = false;
+  AST_SCHED_LOCK(deque);
+  if (deque->bottom < deque->cap) {
+    deque->range[deque->bottom++] = *range;
+    ok = true;
+  }
+  AST_SCHED_UNLOCK(deque);
+  return ok;
+}
+
+/******************************************************************************
+Function `ast_deque_pop`:
+  Take the newest range of rows from the bottom of a queue, by the owner.
+Arguments:
+  * `deque`:    the queue;
+  * `range`:    the range of rows.
+Return:
+  True on success; false if the queue is empty.
+******************************************************************************/
+static bool ast_deque_pop(ast_deque_t *deque, ast_range_t *range) {
+  bool ok = false;
+  AST_SCHED_LOCK(deque);
+  if (deque->top < deque->bottom) {
+    *range = deque->range[--deque->bottom];
+    ok = true;
+  }
+  /* The space of stolen ranges is reused once the queue is empty. */
+  if (deque->top == deque->bottom) deque->top = deque->bottom = 0;
+  AST_SCHED_UNLOCK(deque);
+  return ok;
+}
+
+/******************************************************************************
+Function `ast_deque_steal`:
+  Take the oldest, which is usually the largest, range of rows from the top
+  of a queue, by the other threads.
+Arguments:
+  * `deque`:    the queue;
+  * `range`:    the range of rows.
+Return:
+  True on success; false if the queue is empty.
+******************************************************************************/
+static bool ast_deque_steal(ast_deque_t *deque, ast_range_t *range) {
+  bool ok = false;
+  AST_SCHED_LOCK(deque);
+  if (deque->top < deque->bottom) {
+    *range = deque->range[deque->top++];
+    ok = true;
+  }
+  if (deque->top == deque->bottom) deque->top = deque->bottom = 0;
+  AST_SCHED_UNLOCK(deque);
+  return ok;
+}
+
+/******************************************************************************
+Function `ast_sched_update`:
+  Record the number of evaluated rows and the error of a task.
+Arguments:
+  * `sched`:    the scheduler;
+  * `task`:     the task, or NULL for checking the progress only;
+  * `n`:        number of evaluated rows;
+  * `err`:      the error code.
+Return:
+  Number of rows to be evaluated for all the tasks.
+******************************************************************************/
+static size_t ast_sched_update(ast_sched_t *sched, ast_sched_task_t *task,
+    const size_t n, const int err) {
+  AST_SCHED_LOCK(sched);
+  sched->remain -= n;
+  if (task && err) task->err = err;
+  const size_t remain = sched->remain;
+  AST_SCHED_UNLOCK(sched);
+  return remain;
+}
+
+/******************************************************************************
+Function `ast_sched_eval`:
+  Evaluate a chunk of rows of a task into an array, or a bitmask for
+  boolean expressions.
+Arguments:
+  * `task`:     the task;
+  * `out`:      array for the evaluated values, or the bitmask;
+  * `start`:    index of the first row, which is a multiple of 64;
+  * `n`:        number of rows to be evaluated.
+Return:
+  Zero on success; non-zero on error.
+******************************************************************************/
+static int ast_sched_eval(const ast_sched_task_t *task, void *out,
+    const size_t start, const size_t n) {
+  const ast_prog_t *prog = task->prog;
+  const void *col[prog->nvar ? prog->nvar : 1];
+  for (long j = 0; j < prog->nvar; j++)
+    col[j] = (const char *) task->col[j] + start *
+      ast_dtype_size(task->dtype[j]);
+
+  if (task->vtype) {
+    ast_mask_dst_t dst = { (uint64_t *) out, NULL, NULL, 0 };
+    return ast_mask_run(prog, &dst, col, task->dtype, task->vtype, n) ?
+      AST_ERR_EVAL : 0;
+  }
+  ast_batch_num(prog, out, col, task->dtype, n);
+  return 0;
+}
+
+/******************************************************************************
+Function `ast_sched_batch`:
+  Evaluate a chunk of rows of a batch evaluation task.
+Arguments:
+  * `task`:     the task;
+  * `id`:       index of the thread;
+  * `start`:    index of the first row, which is a multiple of 64;
+  * `n`:        number of rows to be evaluated.
+Return:
+  Zero on success; non-zero on error.
+******************************************************************************/
+static int ast_sched_batch(const ast_sched_task_t *task, const int id,
+    const size_t start, const size_t n) {
+  (void) id;
+  if (task->vtype)
+    return ast_sched_eval(task,
+        (uint64_t *) task->out + start / AST_MASK_BITS, start, n);
+  return ast_sched_eval(task, (char *) task->out + start *
+      ast_dtype_size(task->prog->dtype), start, n);
+}
+
+/******************************************************************************
+Function `ast_sched_work`:
+  Evaluate ranges of rows with a thread of the pool, which takes ranges from
+  its own queue, or steals them from the others once it runs out of work,
+  until all the rows are evaluated.
+Arguments:
+  * `arg`:      the scheduler;
+  * `id`:       index of the thread;
+  * `nthreads`: number of threads for the evaluation.
+******************************************************************************/
+static void ast_sched_work(void *arg, const int id, const int nthreads) {
+  ast_sched_t *sched = (ast_sched_t *) arg;
+  ast_deque_t *own = sched->deque + id;
+  ast_range_t range = { 0, 0, 0 };
+
+  for (;;) {
+    if (!ast_deque_pop(own, &range)) {
+      int i = 1;
+      for (; i < nthreads; i++)
+        if (ast_deque_steal(sched->deque + (id + i) % nthreads, &range))
+          break;
+      if (i == nthreads) {
+        /* Ranges taken by the other threads may still be split. */
+        if (!ast_sched_update(sched, NULL, 0, 0)) return;
+#ifdef AST_POOL_PTHREAD
+        sched_yield();
+#endif
+        continue;
+      }
+    }
+
+    /* Large ranges are split on demand, with the upper halves left for the
+       thread itself or the idle ones, and the alignment of the ranges kept,
+       e.g., at words of the bitmask. */
+    ast_sched_task_t *task = sched->task + range.task;
+    while (range.end - range.start > task->grain) {
+      const size_t half = ((range.end - range.start) / 2 + task->align - 1)
+        / task->align * task->align;
+      const ast_range_t upper = { range.task, range.start + half, range.end };
+      if (!ast_deque_push(own, &upper)) break;
+      range.end = upper.start;
+    }
+
+    int err = 0;
+    for (size_t i = range.start; i < range.end; i += task->grain) {
+      const size_t n = (range.end - i < task->grain) ?
+        range.end - i : task->grain;
+      if (!err) err = task->func(task, id, i, n);
+    }
+    ast_sched_update(sched, task, range.end - range.start, err);
+  }
+}
+
+/******************************************************************************
+Function `ast_sched_prep`:
+  Validate the columns of variables for a task, and compile the expression,
+  with the task set up for batch evaluation by default.
+Arguments:
+  * `ast`:      interface of the abstract syntax tree;
+  * `cols`:     columns of variables, where `cols[i]` is for variable `$i+1`;
+  * `dtypes`:   data types of the columns, in the same order as `cols`;
+  * `nrows`:    number of rows to be evaluated;
+  * `task`:     the task of the scheduler, with arrays for the columns.
+Return:
+  Zero on success; non-zero on error.
+******************************************************************************/
+static int ast_sched_prep(ast_t *ast, const void *const *cols,
+    const ast_dtype_t *dtypes, const size_t nrows, ast_sched_task_t *task) {
+  if (AST_IS_ERROR(ast)) return AST_ERRNO(ast);
+  if (!ast->ast) return AST_ERRNO(ast) = AST_ERR_NOEXP;
+  task->prog = (ast_prog_t *) ast->prog;
+  task->out = NULL;
+  task->nrows = nrows;
+  task->align = AST_MASK_BITS;
+  task->func = ast_sched_batch;
+  task->err = 0;
+  if (!nrows) return 0;
+
+  if (ast->dtype == AST_DTYPE_BOOL) {
+    if (ast_mask_prep(ast, cols, dtypes, task->col, task->dtype,
+        task->vtype)) return AST_ERRNO(ast);
+  }
+  else {
+    task->vtype = NULL;
+    if (ast_batch_check(ast, cols, dtypes, task->col, task->dtype))
+      return AST_ERRNO(ast);
+  }
+  return 0;
+}
+
+/******************************************************************************
+Function `ast_sched_pool`:
+  Retrieve the thread pool for the scheduler, and the number of threads.
+Arguments:
+  * `pool`:     the thread pool, or NULL for the one of the library;
+  * `nthreads`: number of threads, or non-positive for all of the pool,
+                which is updated with the number of threads to be used.
+Return:
+  The thread pool on success; NULL on error.
+******************************************************************************/
+static ast_pool_t *ast_sched_pool(ast_pool_t *pool, int *nthreads) {
+  if (!pool && !(pool = ast_pool_default(*nthreads))) return NULL;
+  if (*nthreads <= 0 || *nthreads > pool->nthreads)
+    *nthreads = pool->nthreads;
+  return pool;
+}
+
+/******************************************************************************
+Function `ast_sched_part`:
+  Size of the initial ranges of a task, which are distributed over the
+  threads.
+Arguments:
+  * `task`:     the task;
+  * `nthreads`: number of threads.
+Return:
+  The number of rows in a range, which is a multiple of the alignment.
+******************************************************************************/
+static size_t ast_sched_part(const ast_sched_task_t *task,
+    const int nthreads) {
+  size_t n = (task->nrows + task->grain - 1) / task->grain;
+  if (n > (size_t) nthreads) n = nthreads;
+  const size_t size = (task->nrows + n - 1) / n;
+  return (size + task->align - 1) / task->align * task->align;
+}
+
+/******************************************************************************
+Function `ast_sched_exec`:
+  Distribute ranges of rows of validated tasks over the threads, and evaluate
+  them with the work-stealing scheduler.
+Arguments:
+  * `pool`:     the thread pool;
+  * `nthreads`: number of threads, which is positive;
+  * `task`:     the tasks;
+  * `ntask`:    number of tasks.
+Return:
+  Zero on success; non-zero on error.
+******************************************************************************/
+static int ast_sched_exec(ast_pool_t *pool, const int nthreads,
+    ast_sched_task_t *task, const size_t ntask) {
+  /* Chunks of rows fit in the cache, and there are a few of them for every
+     thread, so that the work can be balanced by stealing. */
+  size_t nrange = 0, remain = 0;
+  for (size_t i = 0; i < ntask; i++) {
+    if (!task[i].nrows) continue;
+    size_t grain = (task[i].nrows + 4 * nthreads - 1) / (4 * nthreads);
+    if (grain > AST_POOL_ROWS) grain = AST_POOL_ROWS;
+    if (grain < AST_TILE_ROWS) grain = AST_TILE_ROWS;
+    task[i].grain = (grain + task[i].align - 1) / task[i].align *
+      task[i].align;
+    const size_t size = ast_sched_part(task + i, nthreads);
+    nrange += (task[i].nrows + size - 1) / size;
+    remain += task[i].nrows;
+  }
+  if (!nrange) return 0;
+  const int nwork = ((size_t) nthreads > nrange) ? (int) nrange : nthreads;
+
+  /* The initial ranges are distributed over the threads in turn, and the
+     queues have space for the nested splits. */
+  const size_t cap = (nrange + nwork - 1) / nwork + AST_SCHED_DEPTH;
+  ast_range_t *range = malloc(sizeof(ast_range_t) * cap * nwork);
+  if (!range) return AST_ERR_MEMORY;
+  ast_deque_t deque[nwork];
+  ast_sched_t sched;
+  sched.task = task;
+  sched.deque = deque;
+  sched.remain = remain;
+#ifdef AST_POOL_PTHREAD
+  pthread_mutex_init(&sched.lock, NULL);
+#endif
+  for (int i = 0; i < nwork; i++) {
+    deque[i].range = range + cap * i;
+    deque[i].top = deque[i].bottom = 0;
+    deque[i].cap = cap;
+#ifdef AST_POOL_PTHREAD
+    pthread_mutex_init(&deque[i].lock, NULL);
+#endif
+  }
+
+  int next = 0;
+  for (size_t i = 0; i < ntask; i++) {
+    if (!task[i].nrows) continue;
+    const size_t size = ast_sched_part(task + i, nthreads);
+    for (size_t start = 0; start < task[i].nrows; start += size) {
+      const size_t end = (task[i].nrows - start < size) ?
+        task[i].nrows : start + size;
+      const ast_range_t r = { i, start, end };
+      ast_deque_push(deque + next, &r);
+      next = (next + 1) % nwork;
+    }
+  }
+
+  ast_pool_run(pool, nwork, ast_sched_work, &sched);
+
+#ifdef AST_POOL_PTHREAD
+  for (int i = 0; i < nwork; i++) pthread_mutex_destroy(&deque[i].lock);
+  pthread_mutex_destroy(&sched.lock);
+#endif
+  free(range);
+  return 0;
+}
+
+/******************************************************************************
+Function `ast_sched_one`:
+  Evaluate a validated task with the work-stealing scheduler, and record the
+  error in the interface.
+Arguments:
+  * `ast`:      interface of the abstract syntax tree;
+  * `pool`:     the thread pool;
+  * `nthreads`: number of threads, which is positive;
+  * `task`:     the task.
+Return:
+  Zero on success; non-zero on error.
+******************************************************************************/
+static int ast_sched_one(ast_t *ast, ast_pool_t *pool, const int nthreads,
+    ast_sched_task_t *task) {
+  if (ast_sched_exec(pool, nthreads, task, 1))
+    return AST_ERRNO(ast) = AST_ERR_MEMORY;
+  if (task->err) return AST_ERRNO(ast) = task->err;
+  return 0;
+}
+
+/******************************************************************************
+Function `ast_sched_run`:
+  Validate tasks of batch evaluations, and evaluate them with the
+  work-stealing scheduler.
+Arguments:
+  * `pool`:     the thread pool, or NULL for the one of the library;
+  * `nthreads`: number of threads, or non-positive for all of the pool;
+  * `tasks`:    the tasks;
+  * `ntask`:    number of tasks.
+Return:
+  Zero on success; non-zero on error.
+******************************************************************************/
+static int ast_sched_run(ast_pool_t *pool, int nthreads,
+    const ast_task_t *tasks, const size_t ntask) {
+  if (!ntask) return 0;
+  if (!tasks) return AST_ERR_VALUE;
+  long nvar = 0;
+  for (size_t i = 0; i < ntask; i++) {
+    if (!tasks[i].ast) return AST_ERR_INIT;
+    nvar += tasks[i].ast->nvar;
+  }
+
+  /* Columns are validated and the expressions are compiled by the calling
+     thread, so that the workers only read the compiled programs. */
+  int err = 0;
+  ast_sched_task_t *task = malloc(sizeof(ast_sched_task_t) * ntask);
+  const void **col = malloc(sizeof(void *) * (nvar ? nvar : 1));
+  ast_dtype_t *dtype = malloc(sizeof(ast_dtype_t) * 2 * (nvar ? nvar : 1));
+  if (!task || !col || !dtype) err = AST_ERR_MEMORY;
+  else {
+    for (size_t i = 0, pos = 0; i < ntask; i++) {
+      task[i].col = col + pos;
+      task[i].dtype = dtype + 2 * pos;
+      task[i].vtype = task[i].dtype + tasks[i].ast->nvar;
+      pos += tasks[i].ast->nvar;
+      int e = ast_sched_prep(tasks[i].ast, tasks[i].cols, tasks[i].dtypes,
+          tasks[i].nrows, task + i);
+      if (!e && !tasks[i].out)
+        e = AST_ERRNO(tasks[i].ast) = AST_ERR_VALUE;
+      task[i].out = tasks[i].out;
+      if (e && !err) err = e;
+    }
+    if (!err && !(pool = ast_sched_pool(pool, &nthreads)))
+      err = AST_ERR_THREAD;
+    if (!err) err = ast_sched_exec(pool, nthreads, task, ntask);
+  }
+
+  if (err == AST_ERR_MEMORY || err == AST_ERR_THREAD) {
+    for (size_t i = 0; i < ntask; i++) AST_ERRNO(tasks[i].ast) = err;
+  }
+  else if (!err) {
+    for (size_t i = 0; i < ntask; i++) {
+      if (task[i].err) {
+        AST_ERRNO(tasks[i].ast) = task[i].err;
+        if (!err) err = task[i].err;
+      }
+    }
+  }
+  if (task) free(task);
+  if (col) free(col);
+  if (dtype) free(dtype);
+  return err;
+}
+
+/******************************************************************************
+Function `ast_pool_eval`:
+  Validate the columns of variables, and evaluate the expression for multiple
+  rows with the thread pool.
+Arguments:
+  * `ast`:      interface of the abstract syntax tree;
+  * `pool`:     the thread pool, or NULL for the one of the library;
+  * `nthreads`: number of threads, or non-positive for all of the pool;
+  * `out`:      array for the evaluated values, or the bitmask;
+  * `cols`:     columns of variables, where `cols[i]` is for variable `$i+1`;
+  * `dtypes`:   data types of the columns, in the same order as `cols`;
+  * `nrows`:    number of rows to be evaluated.
+Return:
+  Zero on success; non-zero on error.
+******************************************************************************/
+static int ast_pool_eval(ast_t *ast, ast_pool_t *pool, const int nthreads,
+    void *out, const void *const *cols, const ast_dtype_t *dtypes,
+    const size_t nrows) {
+  const ast_task_t task = { ast, out, cols, dtypes, nrows };
+  return ast_sched_run(pool, nthreads, &task, 1);
+}
+
+
+/*============================================================================*\
+                   Functions for the aggregation of expressions
+\*============================================================================*/
+
+/******************************************************************************
+Function `ast_popcount`:
+  Number of set bits of a word of the bitmask.
+Arguments:
+  * `w`:        the word.
+Return:
+  The number of set bits.
+******************************************************************************/
+static inline int ast_popcount(uint64_t w) {
+#ifdef __GNUC__
+  return __builtin_popcountll(w);
+#else
+  int n = 0;
+  for (; w; n++) w &= w - 1;
+  return n;
+#endif
+}
+
+/* Define the reduction of an array of values for a data type. */
+#define AST_REDUCE_FUNC(T)                                              \
+  static double ast_reduce_##T(const T *v, const size_t n,              \
+      const ast_reduce_t op, double acc) {                              \
+    switch (op) {                                                       \
+      case AST_REDUCE_MIN:                                              \
+        for (size_t i = 0; i < n; i++) if (v[i] < acc) acc = v[i];      \
+        return acc;                                                     \
+      case AST_REDUCE_MAX:                                              \
+        for (size_t i = 0; i < n; i++) if (v[i] > acc) acc = v[i];      \
+        return acc;                                                     \
+      case AST_REDUCE_COUNT:                                            \
+        for (size_t i = 0; i < n; i++) acc += (v[i] != 0);              \
+        return acc;                                                     \
+      default:                                                          \
+        for (size_t i = 0; i < n; i++) acc += v[i];                     \
+        return acc;                                                     \
+    }                                                                   \
+  }
+
+AST_REDUCE_FUNC(int)
+AST_REDUCE_FUNC(long)
+AST_REDUCE_FUNC(float)
+AST_REDUCE_FUNC(double)
+
+/******************************************************************************
+Function `ast_reduce_bool`:
+  Reduction of the values of a boolean expression, which are 0 or 1.
+Arguments:
+  * `mask`:     the bitmask;
+  * `n`:        number of rows;
+  * `op`:       the reduction operation;
+  * `acc`:      the accumulated result.
+Return:
+  The accumulated result.
+******************************************************************************/
+static double ast_reduce_bool(const uint64_t *mask, const size_t n,
+    const ast_reduce_t op, double acc) {
+  size_t num = 0;
+  for (size_t i = 0; i < n / AST_MASK_BITS; i++) num += ast_popcount(mask[i]);
+  if (n % AST_MASK_BITS) num += ast_popcount(mask[n / AST_MASK_BITS] &
+      ((UINT64_C(1) << (n % AST_MASK_BITS)) - 1));
+  switch (op) {
+    case AST_REDUCE_MIN: return (num == n) ? fmin(acc, 1) : 0;
+    case AST_REDUCE_MAX: return (num) ? 1 : fmax(acc, 0);
+    default: return acc + num;
+  }
+}
+
+/******************************************************************************
+Function `ast_reduce_merge`:
+  Merge two partial results of a reduction.
+Arguments:
+  * `op`:       the reduction operation;
+  * `a`:        the first partial result;
+  * `b`:        the second partial result.
+Return:
+  The merged result.
+******************************************************************************/
+static inline double ast_reduce_merge(const ast_reduce_t op, const double a,
+    const double b) {
+  switch (op) {
+    case AST_REDUCE_MIN: return (b < a) ? b : a;
+    case AST_REDUCE_MAX: return (b > a) ? b : a;
+    default: return a + b;
+  }
+}
+
+/******************************************************************************
+Function `ast_reduce_init`:
+  Initial value of a reduction, i.e., the result with no row.
+Arguments:
+  * `op`:       the reduction operation.
+Return:
+  The initial value.
+******************************************************************************/
+static inline double ast_reduce_init(const ast_reduce_t op) {
+  switch (op) {
+    case AST_REDUCE_MIN: return HUGE_VAL;
+    case AST_REDUCE_MAX: return -HUGE_VAL;
+    default: return 0;
+  }
+}
+
+/******************************************************************************
+Function `ast_reduce_chunk`:
+  Evaluate the expression tile by tile for a range of rows, and reduce the
+  values of every chunk with a fixed number of rows.
+Arguments:
+  * `task`:     the task;
+  * `id`:       index of the thread;
+  * `start`:    index of the first row, which is a multiple of the chunk;
+  * `n`:        number of rows.
+Return:
+  Zero on success; non-zero on error.
+******************************************************************************/
+static int ast_reduce_chunk(const ast_sched_task_t *task, const int id,
+    const size_t start, const size_t n) {
+  (void) id;
+  const ast_reduce_arg_t *arg = (ast_reduce_arg_t *) task->out;
+  const ast_reduce_t op = arg->op;
+  ast_tile_buf_t buf;
+  for (size_t i = 0; i < n; i += AST_REDUCE_ROWS) {
+    const size_t m = (n - i < AST_REDUCE_ROWS) ? n - i : AST_REDUCE_ROWS;
+    double acc = ast_reduce_init(op);
+    for (size_t j = 0; j < m; j += AST_TILE_ROWS) {
+      const size_t k = (m - j < AST_TILE_ROWS) ? m - j : AST_TILE_ROWS;
+      if (ast_sched_eval(task, &buf, start + i + j, k)) return AST_ERR_EVAL;
+      switch (task->prog->dtype) {
+        case AST_DTYPE_BOOL: acc = ast_reduce_bool(buf.mask, k, op, acc); break;
+        case AST_DTYPE_INT: acc = ast_reduce_int(buf.ival, k, op, acc); break;
+        case AST_DTYPE_LONG: acc = ast_reduce_long(buf.lval, k, op, acc); break;
+        case AST_DTYPE_FLOAT:
+          acc = ast_reduce_float(buf.fval, k, op, acc);
+          break;
+        default: acc = ast_reduce_double(buf.dval, k, op, acc); break;
+      }
+    }
+    arg->part[(start + i) / AST_REDUCE_ROWS] = acc;
+  }
+  return 0;
+}
+
+/******************************************************************************
+Function `ast_sched_real`:
+  Evaluate a tile of rows of a numerical expression, with the values
+  converted to double precision floating-point numbers.
+Arguments:
+  * `task`:     the task;
+  * `val`:      array for the values, with at least `n` elements;
+  * `start`:    index of the first row;
+  * `n`:        number of rows, which is no larger than `AST_TILE_ROWS`.
+Return:
+  Zero on success; non-zero on error.
+******************************************************************************/
+static int ast_sched_real(const ast_sched_task_t *task, double *val,
+    const size_t start, const size_t n) {
+  if (task->prog->dtype == AST_DTYPE_DOUBLE)
+    return ast_sched_eval(task, val, start, n);
+  ast_tile_buf_t buf;
+  if (ast_sched_eval(task, &buf, start, n)) return AST_ERR_EVAL;
+  switch (task->prog->dtype) {
+    case AST_DTYPE_INT:
+      for (size_t i = 0; i < n; i++) val[i] = buf.ival[i];
+      break;
+    case AST_DTYPE_LONG:
+      for (size_t i = 0; i < n; i++) val[i] = buf.lval[i];
+      break;
+    default:
+      for (size_t i = 0; i < n; i++) val[i] = buf.fval[i];
+      break;
+  }
+  return 0;
+}
+
+/******************************************************************************
+Function `ast_hist_bin`:
+  Find the bin of a value for the histogram.
+Arguments:
+  * `arg`:      the histogram;
+  * `v`:        the value.
+Return:
+  Index of the bin; the number of bins if the value is out of range.
+******************************************************************************/
+static inline size_t ast_hist_bin(const ast_hist_arg_t *arg, const double v) {
+  if (!arg->edges) {
+    /* Uniform bins are found with a multiply, which may be rounded up to
+       the number of bins for values right below the upper edge. */
+    if (!(v >= arg->min && v < arg->max)) return arg->nbins;
+    const size_t i = (size_t) ((v - arg->min) * arg->scale);
+    return (i < arg->nbins) ? i : arg->nbins - 1;
+  }
+  const double *e = arg->edges;
+  if (!(v >= e[0] && v < e[arg->nbins])) return arg->nbins;
+  size_t l = 0, u = arg->nbins;
+  while (u - l > 1) {
+    const size_t m = l + ((u - l) >> 1);
+    if (e[m] <= v) l = m;
+    else u = m;
+  }
+  return l;
+}
+
+/******************************************************************************
+Function `ast_hist_chunk`:
+  Evaluate the expressions tile by tile for a range of rows in a round, and
+  add the rows to the partial bins of every chunk with a fixed number of
+  rows.
+Arguments:
+  * `task`:     the task;
+  * `id`:       index of the thread;
+  * `start`:    index of the first row in the round, which is a multiple of
+                the chunk;
+  * `n`:        number of rows.
+Return:
+  Zero on success; non-zero on error.
+******************************************************************************/
+static int ast_hist_chunk(const ast_sched_task_t *task, const int id,
+    const size_t start, const size_t n) {
+  (void) id;
+  const ast_hist_arg_t *arg = (ast_hist_arg_t *) task->out;
+  const ast_sched_task_t *mask = (const ast_sched_task_t *) arg->mask;
+  const ast_sched_task_t *weight = (const ast_sched_task_t *) arg->weight;
+  double val[AST_TILE_ROWS], wt[AST_TILE_ROWS];
+  ast_tile_buf_t sel;
+
+  /* Tiles do not cross the boundaries of chunks. */
+  for (size_t i = 0; i < n; i += AST_TILE_ROWS) {
+    const size_t k = (n - i < AST_TILE_ROWS) ? n - i : AST_TILE_ROWS;
+    const size_t row = arg->base + start + i;
+    double *count = arg->count +
+      arg->stride * ((start + i) / AST_REDUCE_ROWS);
+    if (ast_sched_real(task, val, row, k)) return AST_ERR_EVAL;
+    if (mask && ast_sched_eval(mask, sel.mask, row, k)) return AST_ERR_EVAL;
+    if (weight && ast_sched_real(weight, wt, row, k)) return AST_ERR_EVAL;
+    for (size_t r = 0; r < k; r++) {
+      if (mask && !((sel.mask[r / AST_MASK_BITS] >> (r % AST_MASK_BITS)) & 1))
+        continue;
+      const size_t b = ast_hist_bin(arg, val[r]);
+      if (b < arg->nbins) count[b] += weight ? wt[r] : 1;
+    }
+  }
+  return 0;
+}
+
+/******************************************************************************
+Function `ast_hist_merge`:
+  Merge two partial results of a histogram.
+Arguments:
+  * `a`:        the first partial bins, which are updated with the result;
+  * `b`:        the second partial bins;
+  * `nbins`:    number of bins.
+******************************************************************************/
+static inline void ast_hist_merge(double *a, const double *b,
+    const size_t nbins) {
+  for (size_t i = 0; i < nbins; i++) a[i] += b[i];
+}
+
+/******************************************************************************
+Function `ast_quant_cap`:
+  Update the capacities of the levels of a quantile sketch, which decrease
+  geometrically from the top level.
+Arguments:
+  * `q`:        the quantile sketch.
+******************************************************************************/
+static void ast_quant_cap(ast_quant_t *q) {
+  double c = AST_QUANT_K;
+  for (int h = q->nlev - 1; h >= 0; h--) {
+    const size_t cap = (size_t) ceil(c);
+    q->cap[h] = (cap > AST_QUANT_MIN) ? cap : AST_QUANT_MIN;
+    c *= 2.0 / 3.0;
+  }
+}
+
+/******************************************************************************
+Function `ast_quant_cmp`:
+  Compare two values of a quantile sketch, for sorting.
+Arguments:
+  * `a`:        pointer to the first value;
+  * `b`:        pointer to the second value.
+Return:
+  A negative, zero, or positive integer if the first value is smaller than,
+  equal to, or larger than the second one.
+******************************************************************************/
+static int ast_quant_cmp(const void *a, const void *b) {
+  const double x = *((const double *) a);
+  const double y = *((const double *) b);
+  return (x > y) - (x < y);
+}
+
+/******************************************************************************
+Function `ast_quant_item_cmp`:
+  Compare the values of two items of merged quantile sketches, for sorting.
+Arguments:
+  * `a`:        pointer to the first item;
+  * `b`:        pointer to the second item.
+Return:
+  A negative, zero, or positive integer if the first value is smaller than,
+  equal to, or larger than the second one.
+******************************************************************************/
+static int ast_quant_item_cmp(const void *a, const void *b) {
+  return ast_quant_cmp(&((const ast_quant_item_t *) a)->v,
+      &((const ast_quant_item_t *) b)->v);
+}
+
+/******************************************************************************
+Function `ast_quant_compact`:
+  Compact the full levels of a quantile sketch from the bottom, by sorting
+  the items, and promoting either the odd or the even ones to the next level,
+  chosen at random.
+Arguments:
+  * `q`:        the quantile sketch.
+******************************************************************************/
+static void ast_quant_compact(ast_quant_t *q) {
+  for (int h = 0; h < q->nlev && q->num[h] >= q->cap[h]; h++) {
+    if (h + 1 == q->nlev) {
+      q->num[q->nlev++] = 0;
+      ast_quant_cap(q);
+    }
+    double *v = q->item + (size_t) AST_QUANT_SIZE * h;
+    double *up = v + AST_QUANT_SIZE;
+    const size_t n = q->num[h];
+    qsort(v, n, sizeof(double), ast_quant_cmp);
+
+    /* xorshift64 for the offset; the smallest item of an odd number of
+       items stays at the current level. */
+    q->seed ^= q->seed << 13;
+    q->seed ^= q->seed >> 7;
+    q->seed ^= q->seed << 17;
+    size_t m = q->num[h + 1];
+    for (size_t i = (n & 1) + (q->seed & 1); i < n; i += 2) up[m++] = v[i];
+    q->num[h + 1] = m;
+    q->num[h] = n & 1;
+  }
+}
+
+/******************************************************************************
+Function `ast_quant_chunk`:
+  Evaluate the expression tile by tile for a range of rows, and add the
+  values to the quantile sketch of the thread.
+Arguments:
+  * `task`:     the task;
+  * `id`:       index of the thread;
+  * `start`:    index of the first row;
+  * `n`:        number of rows.
+Return:
+  Zero on success; non-zero on error.
+******************************************************************************/
+static int ast_quant_chunk(const ast_sched_task_t *task, const int id,
+    const size_t start, const size_t n) {
+  ast_quant_t *q = (ast_quant_t *) task->out + id;
+  double val[AST_TILE_ROWS];
+  for (size_t i = 0; i < n; i += AST_TILE_ROWS) {
+    const size_t k = (n - i < AST_TILE_ROWS) ? n - i : AST_TILE_ROWS;
+    if (ast_sched_real(task, val, start + i, k)) return AST_ERR_EVAL;
+    for (size_t r = 0; r < k; r++) {
+      const double v = val[r];
+      if (v != v) continue;             /* NaN is ignored */
+      if (v < q->min) q->min = v;
+      if (v > q->max) q->max = v;
+      q->item[q->num[0]++] = v;
+      if (q->num[0] >= q->cap[0]) ast_quant_compact(q);
+    }
+  }
+  return 0;
+}
+
+/******************************************************************************
+Function `ast_topk_better`:
+  Check whether a row is preferred to another one for the top-k selection,
+  with ties broken by the indices of the rows.
+Arguments:
+  * `a`:        the first row;
+  * `b`:        the second row.
+Return:
+  True if the first row is preferred.
+******************************************************************************/
+static inline bool ast_topk_better(const ast_topk_item_t *a,
+    const ast_topk_item_t *b) {
+  return (a->v > b->v) || (a->v == b->v && a->i < b->i);
+}
+
+/******************************************************************************
+Function `ast_topk_cmp`:
+  Compare two rows of the top-k selection, for sorting the preferred ones
+  to the front.
+Arguments:
+  * `a`:        pointer to the first row;
+  * `b`:        pointer to the second row.
+Return:
+  A negative integer if the first row is preferred, a positive integer if
+  the second row is preferred, and zero if they are the same row.
+******************************************************************************/
+static int ast_topk_cmp(const void *a, const void *b) {
+  const ast_topk_item_t *x = (const ast_topk_item_t *) a;
+  const ast_topk_item_t *y = (const ast_topk_item_t *) b;
+  return ast_topk_better(x, y) ? -1 : (ast_topk_better(y, x) ? 1 : 0);
+}
+
+/******************************************************************************
+Function `ast_topk_push`:
+  Add a row to a bounded heap of the top-k selection, with the least
+  preferred row at the root.
+Arguments:
+  * `heap`:     the heap;
+  * `num`:      number of rows in the heap, which is updated;
+  * `k`:        maximum number of rows in the heap;
+  * `item`:     the row to be added.
+******************************************************************************/
+static void ast_topk_push(ast_topk_item_t *heap, size_t *num, const size_t k,
+    const ast_topk_item_t *item) {
+  size_t j;
+  if (*num < k) {               /* sift up */
+    j = (*num)++;
+    while (j) {
+      const size_t p = (j - 1) >> 1;
+      if (!ast_topk_better(heap + p, item)) break;
+      heap[j] = heap[p];
+      j = p;
+    }
+  }
+  else {                        /* replace the root and sift down */
+    if (!ast_topk_better(item, heap)) return;
+    j = 0;
+    for (size_t c = 1; c < k; c = (j << 1) + 1) {
+      if (c + 1 < k && ast_topk_better(heap + c, heap + c + 1)) c++;
+      if (!ast_topk_better(item, heap + c)) break;
+      heap[j] = heap[c];
+      j = c;
+    }
+  }
+  heap[j] = *item;
+}
+
+/******************************************************************************
+Function `ast_topk_chunk`:
+  Evaluate the expressions tile by tile for a range of rows, and add the
+  rows to the heap of the thread.
+Arguments:
+  * `task`:     the task;
+  * `id`:       index of the thread;
+  * `start`:    index of the first row;
+  * `n`:        number of rows.
+Return:
+  Zero on success; non-zero on error.
+******************************************************************************/
+static int ast_topk_chunk(const ast_sched_task_t *task, const int id,
+    const size_t start, const size_t n) {
+  const ast_topk_arg_t *arg = (ast_topk_arg_t *) task->out;
+  const ast_sched_task_t *filter = (const ast_sched_task_t *) arg->filter;
+  ast_topk_item_t *heap = arg->heap + arg->k * id;
+  size_t num = arg->num[id];
+  double val[AST_TILE_ROWS];
+  ast_tile_buf_t sel;
+  int err = 0;
+
+  for (size_t i = 0; i < n; i += AST_TILE_ROWS) {
+    const size_t k = (n - i < AST_TILE_ROWS) ? n - i : AST_TILE_ROWS;
+    if (filter) {
+      /* Tiles with no selected row are not evaluated. */
+      if ((err = ast_sched_eval(filter, sel.mask, start + i, k))) break;
+      const size_t nw = k / AST_MASK_BITS;
+      uint64_t any = (k % AST_MASK_BITS) ? sel.mask[nw] &
+        ((UINT64_C(1) << (k % AST_MASK_BITS)) - 1) : 0;
+      for (size_t w = 0; w < nw; w++) any |= sel.mask[w];
+      if (!any) continue;
+    }
+    if ((err = ast_sched_real(task, val, start + i, k))) break;
+    for (size_t r = 0; r < k; r++) {
+      if (filter && !((sel.mask[r / AST_MASK_BITS] >> (r % AST_MASK_BITS)) & 1))
+        continue;
+      ast_topk_item_t item;
+      item.v = arg->largest ? val[r] : -val[r];
+      if (item.v != item.v) continue;   /* NaN is ignored */
+      item.i = start + i + r;
+      ast_topk_push(heap, &num, arg->k, &item);
+    }
+  }
+  arg->num[id] = num;
+  return err ? AST_ERR_EVAL : 0;
+}
+
+/******************************************************************************
+Function `ast_group_key`:
+  Evaluate a tile of rows of an integer expression for the keys of groups.
+Arguments:
+  * `task`:     the task;
+  * `key`:      array for the keys, with at least `n` elements;
+  * `start`:    index of the first row;
+  * `n`:        number of rows, which is no larger than `AST_TILE_ROWS`.
+Return:
+  Zero on success; non-zero on error.
+******************************************************************************/
+static int ast_group_key(const ast_sched_task_t *task, long *key,
+    const size_t start, const size_t n) {
+  if (task->prog->dtype == AST_DTYPE_LONG)
+    return ast_sched_eval(task, key, start, n);
+  ast_tile_buf_t buf;
+  if (ast_sched_eval(task, &buf, start, n)) return AST_ERR_EVAL;
+  for (size_t i = 0; i < n; i++) key[i] = buf.ival[i];
+  return 0;
+}
+
+/******************************************************************************
+Function `ast_group_range`:
+  Evaluate the keys tile by tile for a range of rows, and update the range
+  of keys of the thread.
+Arguments:
+  * `task`:     the task;
+  * `id`:       index of the thread;
+  * `start`:    index of the first row;
+  * `n`:        number of rows.
+Return:
+  Zero on success; non-zero on error.
+******************************************************************************/
+static int ast_group_range(const ast_sched_task_t *task, const int id,
+    const size_t start, const size_t n) {
+  ast_group_table_t *t = ((ast_group_arg_t *) task->out)->table + id;
+  long key[AST_TILE_ROWS];
+  long min = t->min, max = t->max;
+  for (size_t i = 0; i < n; i += AST_TILE_ROWS) {
+    const size_t k = (n - i < AST_TILE_ROWS) ? n - i : AST_TILE_ROWS;
+    if (ast_group_key(task, key, start + i, k)) return AST_ERR_EVAL;
+    for (size_t r = 0; r < k; r++) {
+      if (key[r] < min) min = key[r];
+      if (key[r] > max) max = key[r];
+    }
+  }
+  t->min = min;
+  t->max = max;
+  return 0;
+}
+
+/******************************************************************************
+Function `ast_group_add`:
+  Add a value to a group.
+Arguments:
+  * `slot`:     the slot of the group;
+  * `op`:       the aggregation operation;
+  * `v`:        the value.
+******************************************************************************/
+static inline void ast_group_add(ast_group_slot_t *slot, const ast_reduce_t op,
+    const double v) {
+  if (!slot->count) slot->val = ast_reduce_init(op);
+  slot->val = (op == AST_REDUCE_COUNT) ? slot->val + (v != 0) :
+    ast_reduce_merge(op, slot->val, v);
+  slot->count++;
+}
+
+/******************************************************************************
+Function `ast_group_hash`:
+  Hash function of the keys, with the high bits mixed into the low ones.
+Arguments:
+  * `key`:      the key.
+Return:
+  The hash value.
+******************************************************************************/
+static inline size_t ast_group_hash(const long key) {
+  uint64_t h = (uint64_t) key * UINT64_C(0x9E3779B97F4A7C15);
+  h ^= h >> 32;
+  return (size_t) h;
+}
+
+/******************************************************************************
+Function `ast_group_find`:
+  Find the slot of a key in a hash table, which is enlarged if it is more
+  than half full.
+Arguments:
+  * `t`:        the hash table;
+  * `key`:      the key.
+Return:
+  Address of the slot on success; NULL on error.
+******************************************************************************/
+static ast_group_slot_t *ast_group_find(ast_group_table_t *t, const long key) {
+  size_t i = ast_group_hash(key) & (t->cap - 1);
+  while (t->slot[i].count && t->slot[i].key != key) i = (i + 1) & (t->cap - 1);
+  if (t->slot[i].count) return t->slot + i;
+
+  if ((t->num + 1) * 2 > t->cap) {
+    const size_t cap = t->cap << 1;
+    ast_group_slot_t *slot = calloc(cap, sizeof(ast_group_slot_t));
+    if (!slot) return NULL;
+    for (size_t j = 0; j < t->cap; j++) {
+      if (!t->slot[j].count) continue;
+      size_t k = ast_group_hash(t->slot[j].key) & (cap - 1);
+      while (slot[k].count) k = (k + 1) & (cap - 1);
+      slot[k] = t->slot[j];
+    }
+    free(t->slot);
+    t->slot = slot;
+    t->cap = cap;
+    i = ast_group_hash(key) & (cap - 1);
+    while (slot[i].count) i = (i + 1) & (cap - 1);
+  }
+  t->slot[i].key = key;
+  t->num++;
+  return t->slot + i;
+}
+
+/******************************************************************************
+Function `ast_group_merge`:
+  Merge the partial result of a group into another one.
+Arguments:
+  * `a`:        the first partial result, which is updated with the result;
+  * `b`:        the second partial result;
+  * `op`:       the aggregation operation.
+******************************************************************************/
+static inline void ast_group_merge(ast_group_slot_t *a,
+    const ast_group_slot_t *b, const ast_reduce_t op) {
+  a->val = (a->count) ? ast_reduce_merge(op, a->val, b->val) : b->val;
+  a->count += b->count;
+}
+
+/******************************************************************************
+Function `ast_group_chunk`:
+  Evaluate the keys and values tile by tile for a range of rows in a round,
+  aggregate the values of every chunk with a fixed number of rows in the
+  scratch table of the thread, and save the groups of the chunk.
+Arguments:
+  * `task`:     the task;
+  * `id`:       index of the thread;
+  * `start`:    index of the first row in the round, which is a multiple of
+                the chunk;
+  * `n`:        number of rows.
+Return:
+  Zero on success; non-zero on error.
+******************************************************************************/
+static int ast_group_chunk(const ast_sched_task_t *task, const int id,
+    const size_t start, const size_t n) {
+  const ast_group_arg_t *arg = (ast_group_arg_t *) task->out;
+  const ast_sched_task_t *value = (const ast_sched_task_t *) arg->value;
+  ast_group_table_t t = arg->table[id];
+  long key[AST_TILE_ROWS];
+  double val[AST_TILE_ROWS];
+  int err = 0;
+
+  for (size_t c = 0; c < n && !err; c += AST_REDUCE_ROWS) {
+    const size_t m = (n - c < AST_REDUCE_ROWS) ? n - c : AST_REDUCE_ROWS;
+    ast_group_slot_t *run = arg->run + start + c;
+    size_t len = 0;
+    for (size_t i = 0; i < m; i += AST_TILE_ROWS) {
+      const size_t k = (m - i < AST_TILE_ROWS) ? m - i : AST_TILE_ROWS;
+      const size_t row = arg->base + start + c + i;
+      if (ast_group_key(task, key, row, k) ||
+          (value && ast_sched_real(value, val, row, k))) {
+        err = AST_ERR_EVAL;
+        break;
+      }
+      for (size_t r = 0; r < k; r++) {
+        ast_group_slot_t *slot;
+        if (arg->direct) {
+          /* Keys of the chunk are recorded when they first appear. */
+          slot = t.slot + (size_t) (key[r] - arg->min);
+          if (!slot->count) run[len++].key = key[r];
         }
-        else AST_ERRNO(ast) = AST_ERR_EVAL;
-        node->type = AST_TOK_NUM;
-        return;
-      case AST_TOK_BXOR:
-        if (dtype == AST_DTYPE_INT) {
-          ires = v1->v.ival ^ v2->v.ival;
-          ast_set_var_value(&node->value, &ires, 0, AST_DTYPE_INT);
+        else if (!(slot = ast_group_find(&t, key[r]))) {
+          err = AST_ERR_MEMORY;
+          break;
         }
-        else if (dtype == AST_DTYPE_LONG) {
-          lres = v1->v.lval ^ v2->v.lval;
-          ast_set_var_value(&node->value, &lres, 0, AST_DTYPE_LONG);
+        ast_group_add(slot, arg->op, value ? val[r] : 1);
+      }
+      if (err) break;
+    }
+    if (err) break;
+
+    /* Move the groups of the chunk out of the scratch table. */
+    if (arg->direct) {
+      for (size_t j = 0; j < len; j++) {
+        ast_group_slot_t *slot = t.slot + (size_t) (run[j].key - arg->min);
+        run[j].val = slot->val;
+        run[j].count = slot->count;
+        slot->count = 0;
+      }
+    }
+    else {
+      for (size_t j = 0; j < t.cap; j++) {
+        if (!t.slot[j].count) continue;
+        run[len++] = t.slot[j];
+        t.slot[j].count = 0;
+      }
+      t.num = 0;
+    }
+    arg->len[(start + c) / AST_REDUCE_ROWS] = len;
+  }
+  arg->table[id] = t;
+  return err;
+}
+
+/******************************************************************************
+Function `ast_group_cmp`:
+  Compare the keys of two groups, for sorting.
+Arguments:
+  * `a`:        pointer to the first group;
+  * `b`:        pointer to the second group.
+Return:
+  A negative, zero, or positive integer if the first key is smaller than,
+  equal to, or larger than the second one.
+******************************************************************************/
+static int ast_group_cmp(const void *a, const void *b) {
+  const long x = ((const ast_group_slot_t *) a)->key;
+  const long y = ((const ast_group_slot_t *) b)->key;
+  return (x > y) - (x < y);
+}
+
+
+/*============================================================================*\
+                   Functions for the just-in-time compilation
+\*============================================================================*/
+
+#ifdef AST_JIT_X86_64
+
+/* Registers of the x86-64 architecture used by the generated code. */
+#define AST_JIT_XMM_MAX         14      /* xmm0 - xmm13 for the value stack */
+#define AST_JIT_XMM_TMP         15      /* xmm15 as the scratch register    */
+#define AST_JIT_SPILL           (AST_JIT_XMM_MAX * 8)   /* spill area size  */
+
+/* Buffer for the generated machine code. */
+typedef struct {
+  unsigned char *code;          /* the machine code                   */
+  size_t size;                  /* number of bytes of the code        */
+  size_t capacity;              /* allocated space for the code       */
+  bool fail;                    /* true if memory allocation failed   */
+} ast_jit_buf_t;
+
+/******************************************************************************
+Function `ast_jit_emit`:
+  Append bytes to the machine code buffer.
+Arguments:
+  * `buf`:      the machine code buffer;
+  * `bytes`:    the bytes to be appended;
+  * `num`:      number of bytes.
+******************************************************************************/
+static void ast_jit_emit(ast_jit_buf_t *buf, const void *bytes,
+    const size_t num) {
+  if (buf->fail) return;
+  if (buf->size + num > buf->capacity) {
+    size_t size = buf->capacity ? buf->capacity << 1 : 256;
+    while (size < buf->size + num) size <<= 1;
+    unsigned char *tmp = realloc(buf->code, size);
+    if (!tmp) {
+      buf->fail = true;
+      return;
+    }
+    buf->code = tmp;
+    buf->capacity = size;
+  }
+  memcpy(buf->code + buf->size, bytes, num);
+  buf->size += num;
+}
+
+/******************************************************************************
+Function `ast_jit_byte`:
+  Append a single byte to the machine code buffer.
+Arguments:
+  * `buf`:      the machine code buffer;
+  * `byte`:     the byte to be appended.
+******************************************************************************/
+static inline void ast_jit_byte(ast_jit_buf_t *buf, const int byte) {
+  unsigned char c = (unsigned char) byte;
+  ast_jit_emit(buf, &c, 1);
+}
+
+/******************************************************************************
+Function `ast_jit_imm32`:
+  Append a 32-bit little-endian immediate to the machine code buffer.
+Arguments:
+  * `buf`:      the machine code buffer;
+  * `imm`:      the immediate.
+******************************************************************************/
+static void ast_jit_imm32(ast_jit_buf_t *buf, const uint32_t imm) {
+  unsigned char c[4];
+  for (int i = 0; i < 4; i++) c[i] = (imm >> (8 * i)) & 0xFF;
+  ast_jit_emit(buf, c, 4);
+}
+
+/******************************************************************************
+Function `ast_jit_imm64`:
+  Append a 64-bit little-endian immediate to the machine code buffer.
+Arguments:
+  * `buf`:      the machine code buffer;
+  * `imm`:      the immediate.
+******************************************************************************/
+static void ast_jit_imm64(ast_jit_buf_t *buf, const uint64_t imm) {
+  unsigned char c[8];
+  for (int i = 0; i < 8; i++) c[i] = (imm >> (8 * i)) & 0xFF;
+  ast_jit_emit(buf, c, 8);
+}
+
+/******************************************************************************
+Function `ast_jit_sse`:
+  Emit an SSE instruction with two xmm registers, i.e.,
+  [prefix] [REX] 0F opcode ModRM(11, dst, src).
+Arguments:
+  * `buf`:      the machine code buffer;
+  * `prefix`:   the mandatory prefix (0 for none);
+  * `opcode`:   the opcode following 0F;
+  * `dst`:      the destination register;
+  * `src`:      the source register.
+******************************************************************************/
+static void ast_jit_sse(ast_jit_buf_t *buf, const int prefix,
+    const int opcode, const int dst, const int src) {
+  if (prefix) ast_jit_byte(buf, prefix);
+  if (dst >= 8 || src >= 8)
+    ast_jit_byte(buf, 0x40 | ((dst >> 3) << 2) | (src >> 3));
+  ast_jit_byte(buf, 0x0F);
+  ast_jit_byte(buf, opcode);
+  ast_jit_byte(buf, 0xC0 | ((dst & 7) << 3) | (src & 7));
+}
+
+/******************************************************************************
+Function `ast_jit_fma`:
+  Emit a scalar fused multiply-add instruction of the 213 form, i.e.,
+  C4 [RXB 00010] [W vvvv 0 01] opcode ModRM(11, dst, src2), which computes
+  dst = src1 * dst +/- src2 with a single rounding.
+Arguments:
+  * `buf`:      the machine code buffer;
+  * `opcode`:   the opcode following 0F 38;
+  * `dbl`:      true for the double type, false for the float type;
+  * `dst`:      the destination register, which holds the first factor;
+  * `src1`:     the register of the second factor;
+  * `src2`:     the register of the addend.
+******************************************************************************/
+static void ast_jit_fma(ast_jit_buf_t *buf, const int opcode, const bool dbl,
+    const int dst, const int src1, const int src2) {
+  ast_jit_byte(buf, 0xC4);
+  ast_jit_byte(buf, ((~dst & 8) << 4) | 0x40 | ((~src2 & 8) << 2) | 0x02);
+  ast_jit_byte(buf, (dbl ? 0x80 : 0) | ((~src1 & 0xF) << 3) | 0x01);
+  ast_jit_byte(buf, opcode);
+  ast_jit_byte(buf, 0xC0 | ((dst & 7) << 3) | (src2 & 7));
+}
+
+/******************************************************************************
+Function `ast_jit_mem`:
+  Emit an SSE instruction with an xmm register and a memory operand
+  [base + disp32], where the base is either rbx or rsp.
+Arguments:
+  * `buf`:      the machine code buffer;
+  * `prefix`:   the mandatory prefix;
+  * `opcode`:   the opcode following 0F;
+  * `reg`:      the xmm register;
+  * `rsp`:      true for rsp as the base register, false for rbx;
+  * `disp`:     the displacement.
+******************************************************************************/
+static void ast_jit_mem(ast_jit_buf_t *buf, const int prefix,
+    const int opcode, const int reg, const bool rsp, const int32_t disp) {
+  ast_jit_byte(buf, prefix);
+  if (reg >= 8) ast_jit_byte(buf, 0x44);
+  ast_jit_byte(buf, 0x0F);
+  ast_jit_byte(buf, opcode);
+  if (rsp) {
+    ast_jit_byte(buf, 0x84 | ((reg & 7) << 3));
+    ast_jit_byte(buf, 0x24);                    /* SIB for [rsp] */
+  }
+  else ast_jit_byte(buf, 0x83 | ((reg & 7) << 3));
+  ast_jit_imm32(buf, (uint32_t) disp);
+}
+
+/******************************************************************************
+Function `ast_jit_const`:
+  Load a constant bit pattern into an xmm register through rax.
+Arguments:
+  * `buf`:      the machine code buffer;
+  * `reg`:      the xmm register;
+  * `bits`:     the bit pattern;
+  * `dbl`:      true for 64-bit patterns, false for 32-bit ones.
+******************************************************************************/
+static void ast_jit_const(ast_jit_buf_t *buf, const int reg,
+    const uint64_t bits, const bool dbl) {
+  if (dbl) {
+    ast_jit_byte(buf, 0x48);                    /* mov rax, imm64 */
+    ast_jit_byte(buf, 0xB8);
+    ast_jit_imm64(buf, bits);
+    ast_jit_byte(buf, 0x66);                    /* movq xmm, rax */
+    ast_jit_byte(buf, 0x48 | ((reg >> 3) << 2));
+  }
+  else {
+    ast_jit_byte(buf, 0xB8);                    /* mov eax, imm32 */
+    ast_jit_imm32(buf, (uint32_t) bits);
+    ast_jit_byte(buf, 0x66);                    /* movd xmm, eax */
+    if (reg >= 8) ast_jit_byte(buf, 0x44);
+  }
+  ast_jit_byte(buf, 0x0F);
+  ast_jit_byte(buf, 0x6E);
+  ast_jit_byte(buf, 0xC0 | ((reg & 7) << 3));
+}
+
+/******************************************************************************
+Function `ast_jit_call`:
+  Call a function of the math library, with the arguments on top of the
+  value stack. Registers below the arguments are saved on the stack frame,
+  since all xmm registers are caller-saved.
+Arguments:
+  * `buf`:      the machine code buffer;
+  * `func`:     address of the function;
+  * `pos`:      register holding the first argument;
+  * `argc`:     number of arguments;
+  * `prefix`:   prefix for scalar instructions of the data type.
+******************************************************************************/
+static void ast_jit_call(ast_jit_buf_t *buf, const uintptr_t func,
+    const int pos, const int argc, const int prefix) {
+  for (int i = 0; i < pos; i++) ast_jit_mem(buf, prefix, 0x11, i, true, 8 * i);
+  if (pos) for (int i = 0; i < argc; i++) ast_jit_sse(buf, 0, 0x28, i, pos + i);
+  ast_jit_byte(buf, 0x48);                      /* mov rax, imm64 */
+  ast_jit_byte(buf, 0xB8);
+  ast_jit_imm64(buf, (uint64_t) func);
+  ast_jit_byte(buf, 0xFF);                      /* call rax */
+  ast_jit_byte(buf, 0xD0);
+  if (pos) ast_jit_sse(buf, 0, 0x28, pos, 0);
+  for (int i = 0; i < pos; i++) ast_jit_mem(buf, prefix, 0x10, i, true, 8 * i);
+}
+
+/******************************************************************************
+Function `ast_jit_gen`:
+  Generate x86-64 machine code for the compiled program, with the System V
+  calling convention. Intermediate values are kept in xmm registers, and
+  variables are loaded from the array passed as the first argument.
+Arguments:
+  * `prog`:     the compiled program;
+  * `vidx`:     indices of the variables;
+  * `dtype`:    data type of the expression;
+  * `buf`:      the machine code buffer.
+Return:
+  Zero on success; non-zero if the program is not supported.
+******************************************************************************/
+static int ast_jit_gen(const ast_prog_t *prog, const long *vidx,
+    const ast_dtype_t dtype, ast_jit_buf_t *buf) {
+  if (prog->depth > AST_JIT_XMM_MAX) return AST_ERR_EVAL;
+  const bool dbl = (dtype == AST_DTYPE_DOUBLE);
+  const int pre = dbl ? 0xF2 : 0xF3;    /* prefix for scalar instructions */
+  const int width = dbl ? sizeof(double) : sizeof(float);
+  const uint64_t sign = dbl ? UINT64_C(0x8000000000000000) : 0x80000000;
+  /* Fused multiply-add instructions come with AVX2 on x86 processors. */
+  const bool vfma = (ast_eval_simd() >= AST_SIMD_AVX2);
+  int top = -1;                         /* register of the top value */
+
+  /* push rbx; mov rbx, rdi; sub rsp, imm32 */
+  ast_jit_byte(buf, 0x53);
+  ast_jit_byte(buf, 0x48);
+  ast_jit_byte(buf, 0x89);
+  ast_jit_byte(buf, 0xFB);
+  ast_jit_byte(buf, 0x48);
+  ast_jit_byte(buf, 0x81);
+  ast_jit_byte(buf, 0xEC);
+  ast_jit_imm32(buf, AST_JIT_SPILL);
+
+  for (const ast_instr_t *ip = prog->instr; ip->op != AST_TOK_UNDEF; ip++) {
+    uint64_t bits = 0;
+    switch (ip->op) {
+      case AST_TOK_NUM:
+        if (dbl) memcpy(&bits, &ip->value.v.dval, sizeof(double));
+        else {
+          uint32_t fbits;
+          memcpy(&fbits, &ip->value.v.fval, sizeof(float));
+          bits = fbits;
         }
-        else AST_ERRNO(ast) = AST_ERR_EVAL;
-        node->type = AST_TOK_NUM;
-        return;
-      case AST_TOK_BOR:
-        if (dtype == AST_DTYPE_INT) {
-          ires = v1->v.ival | v2->v.ival;
-          ast_set_var_value(&node->value, &ires, 0, AST_DTYPE_INT);
+        ast_jit_const(buf, ++top, bits, dbl);
+        break;
+      case AST_TOK_VAR:
+        if (vidx[ip->value.v.lval] - 1 > INT32_MAX / width) return AST_ERR_VAR;
+        ast_jit_mem(buf, pre, 0x10, ++top, false,
+            (int32_t) (vidx[ip->value.v.lval] - 1) * width);
+        break;
+      case AST_TOK_NEG:                 /* xorps with the sign bit */
+        ast_jit_const(buf, AST_JIT_XMM_TMP, sign, dbl);
+        ast_jit_sse(buf, 0, 0x57, top, AST_JIT_XMM_TMP);
+        break;
+      case AST_TOK_ABS:                 /* andps with the sign bit cleared */
+        ast_jit_const(buf, AST_JIT_XMM_TMP, ~sign & (dbl ? UINT64_MAX :
+              UINT32_MAX), dbl);
+        ast_jit_sse(buf, 0, 0x54, top, AST_JIT_XMM_TMP);
+        break;
+      case AST_TOK_SQRT: ast_jit_sse(buf, pre, 0x51, top, top); break;
+      case AST_TOK_ADD: top--; ast_jit_sse(buf, pre, 0x58, top, top + 1); break;
+      case AST_TOK_MUL: top--; ast_jit_sse(buf, pre, 0x59, top, top + 1); break;
+      case AST_TOK_MINUS:
+        top--;
+        ast_jit_sse(buf, pre, 0x5C, top, top + 1);
+        break;
+      case AST_TOK_DIV: top--; ast_jit_sse(buf, pre, 0x5E, top, top + 1); break;
+      case AST_TOK_LN:
+        ast_jit_call(buf, dbl ? (uintptr_t) &log : (uintptr_t) &logf,
+            top, 1, pre);
+        break;
+      case AST_TOK_LOG:
+        ast_jit_call(buf, dbl ? (uintptr_t) &log10 : (uintptr_t) &log10f,
+            top, 1, pre);
+        break;
+      case AST_TOK_EXP:
+        top--;
+        ast_jit_call(buf, dbl ? (uintptr_t) &pow : (uintptr_t) &powf,
+            top, 2, pre);
+        break;
+      case AST_TOK_REM:
+        top--;
+        ast_jit_call(buf, dbl ? (uintptr_t) &fmod : (uintptr_t) &fmodf,
+            top, 2, pre);
+        break;
+      case AST_TOK_FMA:
+      case AST_TOK_FMS:
+        top -= 2;
+        if (vfma) {                     /* vfmadd213 or vfmsub213 */
+          ast_jit_fma(buf, (ip->op == AST_TOK_FMA) ? 0xA9 : 0xAB, dbl,
+              top, top + 1, top + 2);
+          break;
         }
-        else if (dtype == AST_DTYPE_LONG) {
-          lres = v1->v.lval | v2->v.lval;
-          ast_set_var_value(&node->value, &lres, 0, AST_DTYPE_LONG);
+        if (ip->op == AST_TOK_FMS) {    /* negate the subtrahend */
+          ast_jit_const(buf, AST_JIT_XMM_TMP, sign, dbl);
+          ast_jit_sse(buf, 0, 0x57, top + 2, AST_JIT_XMM_TMP);
         }
-        else AST_ERRNO(ast) = AST_ERR_EVAL;
-        node->type = AST_TOK_NUM;
-        return;
+        ast_jit_call(buf, dbl ? (uintptr_t) &fma : (uintptr_t) &fmaf,
+            top, 3, pre);
+        break;
+      default:
+        return AST_ERR_EVAL;
+    }
+  }
+
+  /* The result is returned in xmm0. */
+  if (top != 0) return AST_ERR_EVAL;
+
+  /* add rsp, imm32; pop rbx; ret */
+  ast_jit_byte(buf, 0x48);
+  ast_jit_byte(buf, 0x81);
+  ast_jit_byte(buf, 0xC4);
+  ast_jit_imm32(buf, AST_JIT_SPILL);
+  ast_jit_byte(buf, 0x5B);
+  ast_jit_byte(buf, 0xC3);
+  return buf->fail ? AST_ERR_MEMORY : 0;
+}
+
+#endif
+
+
+/*============================================================================*\
+                      Functions for the C code generation
+\*============================================================================*/
+
+/* Version of the code generator, for invalidating cached shared objects. */
+#define AST_CODEGEN_VERSION     2
+/* Symbols defined in the generated code. */
+#define AST_CODEGEN_FUNC        "ast_codegen_func"
+#define AST_CODEGEN_EXP         "ast_codegen_exp"
+#define AST_CODEGEN_DTYPE       "ast_codegen_dtype"
+
+/******************************************************************************
+Function `ast_codegen_ctype`:
+  Name of the C type for a given data type.
+Arguments:
+  * `dtype`:    the data type.
+Return:
+  The name of the type.
+******************************************************************************/
+static const char *ast_codegen_ctype(const ast_dtype_t dtype) {
+  switch (dtype) {
+    case AST_DTYPE_INT: return "int";
+    case AST_DTYPE_LONG: return "long";
+    case AST_DTYPE_FLOAT: return "float";
+    default: return "double";
+  }
+}
+
+/******************************************************************************
+Function `ast_codegen_opt`:
+  C operator for a binary operator token.
+Arguments:
+  * `type`:     type of the token.
+Return:
+  The C operator.
+******************************************************************************/
+static const char *ast_codegen_opt(const ast_tok_t type) {
+  switch (type) {
+    case AST_TOK_MUL: return "*";
+    case AST_TOK_DIV: return "/";
+    case AST_TOK_ADD: return "+";
+    case AST_TOK_MINUS: return "-";
+    case AST_TOK_LEFT: return "<<";
+    case AST_TOK_RIGHT: return ">>";
+    case AST_TOK_BAND: return "&";
+    case AST_TOK_BXOR: return "^";
+    default: return "|";
+  }
+}
+
+/******************************************************************************
+Function `ast_codegen_literal`:
+  Print a numerical literal as a C constant with the exact value.
+Arguments:
+  * `fp`:       output file stream;
+  * `dtype`:    data type of the expression;
+  * `v`:        the literal.
+******************************************************************************/
+static void ast_codegen_literal(FILE *fp, const ast_dtype_t dtype,
+    const ast_var_t *v) {
+  switch (dtype) {
+    case AST_DTYPE_INT:
+      if (v->v.ival == INT_MIN) fprintf(fp, "INT_MIN");
+      else fprintf(fp, "%d", v->v.ival);
+      return;
+    case AST_DTYPE_LONG:
+      if (v->v.lval == LONG_MIN) fprintf(fp, "LONG_MIN");
+      else fprintf(fp, "%ldL", v->v.lval);
+      return;
+    case AST_DTYPE_FLOAT:
+      if (isnan(v->v.fval)) fprintf(fp, "NAN");
+      else if (isinf(v->v.fval))
+        fprintf(fp, "%sHUGE_VALF", (v->v.fval < 0) ? "-" : "");
+      else fprintf(fp, "%af", (double) v->v.fval);
+      return;
+    default:
+      if (isnan(v->v.dval)) fprintf(fp, "NAN");
+      else if (isinf(v->v.dval))
+        fprintf(fp, "%sHUGE_VAL", (v->v.dval < 0) ? "-" : "");
+      else fprintf(fp, "%a", v->v.dval);
+      return;
+  }
+}
+
+/******************************************************************************
+Function `ast_codegen_string`:
+  Print a string as a C string literal.
+Arguments:
+  * `fp`:       output file stream;
+  * `str`:      the null terminated string.
+******************************************************************************/
+static void ast_codegen_string(FILE *fp, const char *str) {
+  fputc('"', fp);
+  for (; *str; str++) {
+    const unsigned char c = (unsigned char) *str;
+    /* Escape `?` as well to avoid trigraphs. */
+    if (c == '"' || c == '\\' || c == '?') fprintf(fp, "\\%c", c);
+    else if (isprint(c)) fputc(c, fp);
+    else fprintf(fp, "\\%03o", c);
+  }
+  fputc('"', fp);
+}
+
+/******************************************************************************
+Function `ast_codegen_prog`:
+  Print the C source code of a function that evaluates the compiled program.
+  Every slot of the value stack of the interpreter is a local variable, and
+  every instruction is a statement, with exactly the same operations.
+Arguments:
+  * `ast`:      interface of the abstract syntax tree;
+  * `fp`:       output file stream.
+******************************************************************************/
+static void ast_codegen_prog(const ast_t *ast, FILE *fp) {
+  const ast_prog_t *prog = (ast_prog_t *) ast->prog;
+  const ast_dtype_t dtype = ast->dtype;
+  const char *type = ast_codegen_ctype(dtype);
+  const bool real = (dtype & AST_DTYPE_REAL) != 0;
+  /* Suffix of the math functions. */
+  const char *sfx = (dtype == AST_DTYPE_FLOAT) ? "f" : "";
+
+  fprintf(fp, "/* Generated by libast (code generator version %d). */\n\n"
+      "#include <stdint.h>\n#include <limits.h>\n#include <math.h>\n\n",
+      AST_CODEGEN_VERSION);
+  fprintf(fp, "const char %s[] = ", AST_CODEGEN_EXP);
+  ast_codegen_string(fp, ast->exp);
+  fprintf(fp, ";\nconst int %s = %d;\n\n", AST_CODEGEN_DTYPE, (int) dtype);
+
+  /* Integer power with the same overflow handling as the interpreter. */
+  if (!real) {
+    const char *max = (dtype == AST_DTYPE_INT) ? "INT_MAX" : "LONG_MAX";
+    fprintf(fp, "static %s ast_pow(%s base, %s exp) {\n", type, type, type);
+    fprintf(fp, "  uint8_t e = (uint8_t) exp;\n"
+        "  if (exp > UINT8_MAX || e >= 63) {\n"
+        "    if (base == 1) return 1;\n"
+        "    return (base == -1) ? 1 - 2 * (e & 1) : 0;\n  }\n"
+        "  uint64_t b = (uint64_t) base, r = 1;\n"
+        "  for (; e; e >>= 1) {\n"
+        "    if (e & 1) r *= b;\n"
+        "    b *= b;\n  }\n"
+        "  return ((int64_t) r > %s) ? 0 : (%s) (int64_t) r;\n}\n\n",
+        max, type);
+  }
+
+  fprintf(fp, "%s %s(const %s *v) {\n  %s s0", type, AST_CODEGEN_FUNC,
+      type, type);
+  for (long i = 1; i < prog->depth; i++) fprintf(fp, ", s%ld", i);
+  fprintf(fp, ";\n");
+
+  long k = -1;                  /* position of the top of the stack */
+  for (const ast_instr_t *ip = prog->instr; ip->op != AST_TOK_UNDEF; ip++) {
+    switch (ip->op) {
+      case AST_TOK_NUM:
+        fprintf(fp, "  s%ld = ", ++k);
+        ast_codegen_literal(fp, dtype, &ip->value);
+        fprintf(fp, ";\n");
+        break;
+      case AST_TOK_VAR:
+        fprintf(fp, "  s%ld = v[%ld];\n", ++k, ast->vidx[ip->value.v.lval] - 1);
+        break;
+      case AST_TOK_NEG:
+        fprintf(fp, "  s%ld = -s%ld;\n", k, k);
+        break;
+      case AST_TOK_BNOT:
+        fprintf(fp, "  s%ld = ~s%ld;\n", k, k);
+        break;
+      case AST_TOK_ABS:
+        if (real) fprintf(fp, "  s%ld = fabs%s(s%ld);\n", k, sfx, k);
+        else fprintf(fp, "  if (s%ld < 0) s%ld = -s%ld;\n", k, k, k);
+        break;
+      case AST_TOK_SQRT:
+        fprintf(fp, "  s%ld = sqrt%s(s%ld);\n", k, sfx, k);
+        break;
+      case AST_TOK_LN:
+        fprintf(fp, "  s%ld = log%s(s%ld);\n", k, sfx, k);
+        break;
+      case AST_TOK_LOG:
+        fprintf(fp, "  s%ld = log10%s(s%ld);\n", k, sfx, k);
+        break;
+      case AST_TOK_EXP:
+        k--;
+        if (real)
+          fprintf(fp, "  s%ld = pow%s(s%ld, s%ld);\n", k, sfx, k, k + 1);
+        else fprintf(fp, "  s%ld = ast_pow(s%ld, s%ld);\n", k, k, k + 1);
+        break;
+      case AST_TOK_REM:
+        k--;
+        if (real)
+          fprintf(fp, "  s%ld = fmod%s(s%ld, s%ld);\n", k, sfx, k, k + 1);
+        else fprintf(fp, "  s%ld = s%ld %% s%ld;\n", k, k, k + 1);
+        break;
+      case AST_TOK_FMA:
+      case AST_TOK_FMS:
+        k -= 2;
+        fprintf(fp, "  s%ld = fma%s(s%ld, s%ld, %ss%ld);\n", k, sfx, k, k + 1,
+            (ip->op == AST_TOK_FMA) ? "" : "-", k + 2);
+        break;
+      default:                  /* binary operators with C counterparts */
+        k--;
+        fprintf(fp, "  s%ld = s%ld %s s%ld;\n", k, k, ast_codegen_opt(ip->op),
+            k + 1);
+        break;
+    }
+  }
+  fprintf(fp, "  return s0;\n}\n");
+}
+
+#ifdef AST_CODEGEN_DLOPEN
+
+/******************************************************************************
+Function `ast_codegen_hash`:
+  Compute the 64-bit FNV-1a hash of the expression and data type.
+Arguments:
+  * `ast`:      interface of the abstract syntax tree.
+Return:
+  The hash value.
+******************************************************************************/
+static uint64_t ast_codegen_hash(const ast_t *ast) {
+  uint64_t hash = UINT64_C(0xcbf29ce484222325);
+  const unsigned char *c = (const unsigned char *) ast->exp;
+  for (; *c; c++) hash = (hash ^ *c) * UINT64_C(0x100000001b3);
+  const unsigned char tail[3] = {(unsigned char) ast->dtype,
+    ((ast_prog_t *) ast->prog)->fma, AST_CODEGEN_VERSION};
+  for (int i = 0; i < 3; i++)
+    hash = (hash ^ tail[i]) * UINT64_C(0x100000001b3);
+  return hash;
+}
+
+/******************************************************************************
+Function `ast_codegen_open`:
+  Load a shared object, and check if it is generated for the expression.
+Arguments:
+  * `ast`:      interface of the abstract syntax tree;
+  * `path`:     path of the shared object.
+Return:
+  Handle of the shared object on success; NULL if it is not available.
+******************************************************************************/
+static void *ast_codegen_open(const ast_t *ast, const char *path) {
+  void *dl = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+  if (!dl) return NULL;
+  const char *exp = (const char *) dlsym(dl, AST_CODEGEN_EXP);
+  const int *dtype = (const int *) dlsym(dl, AST_CODEGEN_DTYPE);
+  if (!exp || !dtype || *dtype != (int) ast->dtype || strcmp(exp, ast->exp) ||
+      !dlsym(dl, AST_CODEGEN_FUNC)) {
+    dlclose(dl);
+    return NULL;
+  }
+  return dl;
+}
+
+/******************************************************************************
+Function `ast_codegen_build`:
+  Generate the C source code, and compile it into a shared object. The object
+  is written to a temporary file first, and then renamed to the target path,
+  so that concurrent processes never see incomplete files.
+Arguments:
+  * `ast`:      interface of the abstract syntax tree;
+  * `dir`:      the cache directory;
+  * `path`:     path of the shared object.
+Return:
+  Zero on success; non-zero on error.
+******************************************************************************/
+static int ast_codegen_build(const ast_t *ast, const char *dir,
+    const char *path) {
+  const size_t len = strlen(path) + 16;
+  char *src = malloc(len * 2);
+  if (!src) return AST_ERR_MEMORY;
+  char *obj = src + len;
+
+  /* Write the source code. */
+  sprintf(src, "%s/libast_XXXXXX", dir);
+  int fd = mkstemp(src);
+  if (fd == -1) {
+    free(src);
+    return AST_ERR_EVAL;
+  }
+  FILE *fp = fdopen(fd, "w");
+  if (!fp) {
+    close(fd);
+    unlink(src);
+    free(src);
+    return AST_ERR_EVAL;
+  }
+  ast_codegen_prog(ast, fp);
+  if (fclose(fp)) {
+    unlink(src);
+    free(src);
+    return AST_ERR_EVAL;
+  }
+
+  /* Compile the source code. */
+  sprintf(obj, "%s.XXXXXX", path);
+  if ((fd = mkstemp(obj)) == -1) {
+    unlink(src);
+    free(src);
+    return AST_ERR_EVAL;
+  }
+  close(fd);
+  char *cmd = malloc(strlen(AST_CODEGEN_CC) + len * 2 + 64);
+  int err = AST_ERR_MEMORY;
+  if (cmd) {
+    sprintf(cmd, "%s -x c '%s' -o '%s' -lm >/dev/null 2>&1", AST_CODEGEN_CC,
+        src, obj);
+    err = system(cmd) ? AST_ERR_EVAL : 0;
+    free(cmd);
+  }
+  unlink(src);
+  if (!err && rename(obj, path)) err = AST_ERR_EVAL;
+  if (err) unlink(obj);
+  free(src);
+  return err;
+}
+
+#endif
+
+
+/*============================================================================*\
+                    Interfaces for the parser and evaluator
+\*============================================================================*/
+
+/******************************************************************************
+Function `ast_build`:
+  Build the abstract syntax tree given the expression and data type.
+Arguments:
+  * `ast`:      interface of the abstract syntax tree;
+  * `str`:      null terminated string for the expression;
+  * `dtype`:    data type for the abstract syntax tree;
+  * `eval`:     true for pre-evaluating values.
+Return:
+  Zero on success; non-zero on error.
+******************************************************************************/
+int ast_build(ast_t *ast, const char *str, const ast_dtype_t dtype,
+    const bool eval) {
+  return ast_build_ex(ast, str, dtype, eval, AST_BUILD_DEFAULT);
+}
+
+/******************************************************************************
+Function `ast_build_ex`:
+  Build the abstract syntax tree given the expression, data type, and
+  options for the evaluators.
+Arguments:
+  * `ast`:      interface of the abstract syntax tree;
+  * `str`:      null terminated string for the expression;
+  * `dtype`:    data type for the abstract syntax tree;
+  * `eval`:     true for pre-evaluating values;
+  * `flags`:    bitwise OR of the options, or `AST_BUILD_DEFAULT`.
+Return:
+  Zero on success; non-zero on error.
+******************************************************************************/
+int ast_build_ex(ast_t *ast, const char *str, const ast_dtype_t dtype,
+    const bool eval, const unsigned int flags) {
+  if (!ast) return AST_ERR_INIT;
+  if (ast->ast) return AST_ERRNO(ast) = AST_ERR_EXIST;
+
+  if (!str || *(str = ast_skip_space(str)) == '\0')
+    return AST_ERRNO(ast) = AST_ERR_STRING;
+  if (!(ast->exp = ast_copy_str(str))) return AST_ERRNO(ast) = AST_ERR_MEMORY;
+
+  if (dtype != AST_DTYPE_BOOL && dtype != AST_DTYPE_INT &&
+      dtype != AST_DTYPE_LONG && dtype != AST_DTYPE_FLOAT &&
+      dtype != AST_DTYPE_DOUBLE)
+    return AST_ERRNO(ast) = AST_ERR_DTYPE;
+  ast->dtype = dtype;
+  if (flags & ~(unsigned int) AST_BUILD_FMA)
+    return AST_ERRNO(ast) = AST_ERR_VALUE;
+
+  /* Initialise the first node. */
+  ast_var_t v = {0, .v.ival = 0};
+  ast->ast = ast_create(AST_TOK_UNDEF, v);
+  if (!ast->ast) return AST_ERRNO(ast) = AST_ERR_MEMORY;
+
+  /* Parse the expression. */
+  ast_node_t *node = (ast_node_t *) ast->ast;
+  ast_parse_token(ast, node, ast->exp);
+  if (AST_IS_ERROR(ast)) return AST_ERRNO(ast);
+
+  /* Redirect the root of the abstract syntax tree. */
+  ast->ast = node = ast_root(node);
+
+  /* Reset variable indices. */
+  ast_reset_idx(ast, node);
+  /* Free pre-allocated memory that is not necessary any more. */
+  if (ast->nvar) {
+    if (ast->nvar & (ast->nvar - 1)) {          /* nvar is not power of 2 */
+      long *tmp = realloc(ast->vidx, ast->nvar * sizeof(long));
+      if (tmp) ast->vidx = tmp;         /* do nothing if realloc fails */
+    }
+  }
+
+  /* Allocate memory for variables. */
+  if (ast->nvar) {
+    ast->var = ast_init_var(ast, dtype);
+    if (!ast->var) return AST_ERRNO(ast) = AST_ERR_MEMORY;
+  }
+
+  /* Validate data types for boolean expression. */
+  if (dtype == AST_DTYPE_BOOL) {
+    if (ast_check_dtype(ast, node) != AST_DTYPE_BOOL) {
+      if (AST_IS_ERROR(ast)) return AST_ERRNO(ast);
+      else return AST_ERRNO(ast) = AST_ERR_MISMATCH;
+    }
+  }
+
+  /* Pre-evaluate values. */
+  if (eval) {
+    ast_eval_pre(ast, node);
+    if (AST_IS_ERROR(ast)) return AST_ERRNO(ast);
+  }
+
+  /* Contract multiplications and additions for real numbers. */
+  const bool fma = (flags & AST_BUILD_FMA) && (dtype & AST_DTYPE_REAL);
+  if (fma) ast_fuse_madd(node);
+
+  /* Prepare the evaluators, and build the closure-compiled evaluator for
+     numerical expressions. */
+  ast_prog_t *prog = ast_prog_init(ast);
+  if (!prog) return AST_ERRNO(ast) = AST_ERR_MEMORY;
+  prog->fma = fma;
+  if (dtype != AST_DTYPE_BOOL && ast_clos_init(ast))
+    return AST_ERRNO(ast) = AST_ERR_MEMORY;
+
+  return 0;
+}
+
+/******************************************************************************
+Function `ast_compile`:
+  Compile the abstract syntax tree into a flat postfix program, which is then
+  used by `ast_eval` and `ast_eval_num` instead of the tree.
+Arguments:
+  * `ast`:      interface of the abstract syntax tree.
+Return:
+  Zero on success; non-zero on error.
+******************************************************************************/
+int ast_compile(ast_t *ast) {
+  if (!ast) return AST_ERR_INIT;
+  if (AST_IS_ERROR(ast)) return AST_ERRNO(ast);
+  if (!ast->ast) return AST_ERRNO(ast) = AST_ERR_NOEXP;
+
+  ast_prog_t *prog = ast_prog_init(ast);
+  if (!prog) return AST_ERRNO(ast) = AST_ERR_MEMORY;
+  if (prog->instr) return 0;            /* the program exists already */
+  /* Reserve one more instruction for the end of the program, and branches
+     of `&&` and `||` for boolean expressions. */
+  long size = ast_count_node(ast->ast);
+  if (ast->dtype == AST_DTYPE_BOOL) size <<= 1;
+  prog->instr = malloc((size + 1) * sizeof(ast_instr_t));
+  if (!prog->instr) return AST_ERRNO(ast) = AST_ERR_MEMORY;
+
+  long depth = 0;
+  if (ast_prog_emit(ast, (ast_node_t *) ast->ast, prog, &depth)) {
+    free(prog->instr);
+    prog->instr = NULL;
+    prog->ninstr = prog->depth = 0;
+    return AST_ERRNO(ast) = AST_ERR_EVAL;
+  }
+  prog->instr[prog->ninstr].op = AST_TOK_UNDEF;
+  prog->instr[prog->ninstr].jump = 0;
+  return 0;
+}
+
+/******************************************************************************
+Function `ast_eval_core`:
+  Report the dispatch method of the interpreter for compiled programs, which
+  is chosen at build time.
+Return:
+  `AST_CORE_THREADED` for threaded code with computed goto;
+  `AST_CORE_SWITCH` for a `switch` loop.
+******************************************************************************/
+ast_core_t ast_eval_core(void) {
+#ifdef AST_PROG_THREADED
+  return AST_CORE_THREADED;
+#else
+  return AST_CORE_SWITCH;
+#endif
+}
+
+/******************************************************************************
+Function `ast_jit`:
+  Compile the floating-point type expression into native machine code, which
+  is then used by `ast_eval_num`.
+Arguments:
+  * `ast`:      interface of the abstract syntax tree.
+Return:
+  Zero on success; non-zero if the expression cannot be compiled into
+  machine code, in which case the interpreter is still used for evaluation.
+******************************************************************************/
+int ast_jit(ast_t *ast) {
+  if (!ast) return AST_ERR_INIT;
+  if (AST_IS_ERROR(ast)) return AST_ERRNO(ast);
+  if (!ast->ast) return AST_ERRNO(ast) = AST_ERR_NOEXP;
+  if (ast->dtype != AST_DTYPE_FLOAT && ast->dtype != AST_DTYPE_DOUBLE)
+    return AST_ERR_DTYPE;
+  if (ast_compile(ast)) return AST_ERRNO(ast);
+
+  ast_prog_t *prog = (ast_prog_t *) ast->prog;
+  if (prog->code) return 0;             /* the machine code exists already */
+#ifdef AST_JIT_X86_64
+  ast_jit_buf_t buf = {NULL, 0, 0, false};
+  int err = ast_jit_gen(prog, ast->vidx, ast->dtype, &buf);
+  if (err) {
+    if (buf.code) free(buf.code);
+    return err;
+  }
+
+  /* Copy the code to executable memory that is never writable meanwhile. */
+  void *code = mmap(NULL, buf.size, PROT_READ | PROT_WRITE,
+      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (code == MAP_FAILED) {
+    free(buf.code);
+    return AST_ERR_MEMORY;
+  }
+  memcpy(code, buf.code, buf.size);
+  free(buf.code);
+  if (mprotect(code, buf.size, PROT_READ | PROT_EXEC)) {
+    munmap(code, buf.size);
+    return AST_ERR_MEMORY;
+  }
+
+  prog->code = code;
+  prog->csize = buf.size;
+  if (ast->dtype == AST_DTYPE_DOUBLE) memcpy(&prog->dfunc, &code, sizeof code);
+  else memcpy(&prog->ffunc, &code, sizeof code);
+  return 0;
+#else
+  return AST_ERR_EVAL;
+#endif
+}
+
+/******************************************************************************
+Function `ast_jit_int`:
+  Retrieve the native function compiled for an int type expression.
+Arguments:
+  * `ast`:      interface of the abstract syntax tree.
+Return:
+  The function on success; NULL if it is not available.
+******************************************************************************/
+ast_jit_int_t ast_jit_int(const ast_t *ast) {
+  if (!ast || !ast->prog || ast->dtype != AST_DTYPE_INT) return NULL;
+  return ((ast_prog_t *) ast->prog)->ifunc;
+}
+
+/******************************************************************************
+Function `ast_jit_long`:
+  Retrieve the native function compiled for a long type expression.
+Arguments:
+  * `ast`:      interface of the abstract syntax tree.
+Return:
+  The function on success; NULL if it is not available.
+******************************************************************************/
+ast_jit_long_t ast_jit_long(const ast_t *ast) {
+  if (!ast || !ast->prog || ast->dtype != AST_DTYPE_LONG) return NULL;
+  return ((ast_prog_t *) ast->prog)->lfunc;
+}
+
+/******************************************************************************
+Function `ast_jit_double`:
+  Retrieve the native function compiled for a double type expression.
+Arguments:
+  * `ast`:      interface of the abstract syntax tree.
+Return:
+  The function on success; NULL if it is not available.
+******************************************************************************/
+ast_jit_double_t ast_jit_double(const ast_t *ast) {
+  if (!ast || !ast->prog || ast->dtype != AST_DTYPE_DOUBLE) return NULL;
+  return ((ast_prog_t *) ast->prog)->dfunc;
+}
+
+/******************************************************************************
+Function `ast_jit_float`:
+  Retrieve the native function compiled for a float type expression.
+Arguments:
+  * `ast`:      interface of the abstract syntax tree.
+Return:
+  The function on success; NULL if it is not available.
+******************************************************************************/
+ast_jit_float_t ast_jit_float(const ast_t *ast) {
+  if (!ast || !ast->prog || ast->dtype != AST_DTYPE_FLOAT) return NULL;
+  return ((ast_prog_t *) ast->prog)->ffunc;
+}
+
+/******************************************************************************
+Function `ast_codegen_c`:
+  Print a C99 function that evaluates the numerical expression, with the
+  literals, offsets of variables, and data type built in.
+Arguments:
+  * `ast`:      interface of the abstract syntax tree;
+  * `fp`:       output file stream.
+Return:
+  Zero on success; non-zero on error.
+******************************************************************************/
+int ast_codegen_c(ast_t *ast, FILE *fp) {
+  if (!ast) return AST_ERR_INIT;
+  if (AST_IS_ERROR(ast)) return AST_ERRNO(ast);
+  if (!ast->ast) return AST_ERRNO(ast) = AST_ERR_NOEXP;
+  if (!(ast->dtype & AST_DTYPE_NUMBER)) return AST_ERR_DTYPE;
+  if (!fp) return AST_ERR_VALUE;
+  if (ast_compile(ast)) return AST_ERRNO(ast);
+  ast_codegen_prog(ast, fp);
+  return ferror(fp) ? AST_ERR_EVAL : 0;
+}
+
+/******************************************************************************
+Function `ast_codegen_load`:
+  Compile the C function of the numerical expression into a shared object in
+  the cache directory, and load it for `ast_eval_num`. The shared object is
+  reused if it exists already.
+Arguments:
+  * `ast`:      interface of the abstract syntax tree;
+  * `dir`:      the cache directory.
+Return:
+  Zero on success; non-zero if the shared object cannot be loaded, in which
+  case the interpreter is still used for evaluation.
+******************************************************************************/
+int ast_codegen_load(ast_t *ast, const char *dir) {
+  if (!ast) return AST_ERR_INIT;
+  if (AST_IS_ERROR(ast)) return AST_ERRNO(ast);
+  if (!ast->ast) return AST_ERRNO(ast) = AST_ERR_NOEXP;
+  if (!(ast->dtype & AST_DTYPE_NUMBER)) return AST_ERR_DTYPE;
+  /* Paths are quoted for the shell. */
+  if (!dir || *dir == '\0' || strchr(dir, '\'')) return AST_ERR_STRING;
+  if (ast_compile(ast)) return AST_ERRNO(ast);
+
+  ast_prog_t *prog = (ast_prog_t *) ast->prog;
+  if (prog->dl) return 0;               /* the shared object is loaded */
+#ifdef AST_CODEGEN_DLOPEN
+  char *path = malloc(strlen(dir) + 32);
+  if (!path) return AST_ERR_MEMORY;
+  sprintf(path, "%s/libast_%016" PRIx64 ".so", dir, ast_codegen_hash(ast));
+
+  void *dl = ast_codegen_open(ast, path);
+  if (!dl) {
+    mkdir(dir, 0777);           /* failures are reported by the compilation */
+    int err = ast_codegen_build(ast, dir, path);
+    if (!err && !(dl = ast_codegen_open(ast, path))) err = AST_ERR_EVAL;
+    if (err) {
+      free(path);
+      return err;
+    }
+  }
+  free(path);
+
+  void *func = dlsym(dl, AST_CODEGEN_FUNC);
+  switch (ast->dtype) {
+    case AST_DTYPE_INT: memcpy(&prog->ifunc, &func, sizeof func); break;
+    case AST_DTYPE_LONG: memcpy(&prog->lfunc, &func, sizeof func); break;
+    case AST_DTYPE_FLOAT: memcpy(&prog->ffunc, &func, sizeof func); break;
+    default: memcpy(&prog->dfunc, &func, sizeof func); break;
+  }
+  prog->dl = dl;
+  return 0;
+#else
+  return AST_ERR_EVAL;
+#endif
+}
+
+/******************************************************************************
+Function `ast_eval`:
+  Evaluate the expression given the abstract syntax tree and the variable array.
+Arguments:
+  * `ast`:      interface of the abstract syntax tree;
+  * `value`:    address of the variable holding the evaluated value.
+Return:
+  Zero on success; non-zero on error.
+******************************************************************************/
+int ast_eval(ast_t *ast, void *value) {
+  if (!ast) return AST_ERR_INIT;
+  if (AST_IS_ERROR(ast)) return AST_ERRNO(ast);
+  if (!ast->ast) return AST_ERRNO(ast) = AST_ERR_NOEXP;
+  if (!value) return AST_ERRNO(ast) = AST_ERR_VALUE;
+  for (long i = 0; i < ast->nvar; i++) {
+    if (!((ast_error_t *) ast->error)->vset[i]) {
+      ast_msg(ast, "variable not set", ast->vidx[i], NULL);
+      return AST_ERRNO(ast) = AST_ERR_VAR;
+    }
+  }
+
+  /* Evaluate the compiled program if available. */
+  const ast_prog_t *prog = (ast_prog_t *) ast->prog;
+  if (prog && prog->instr) {
+    switch (ast->dtype) {
+      case AST_DTYPE_BOOL:
+        if (ast_prog_eval_bool(prog, (ast_var_t *) ast->var, (bool *) value))
+          return AST_ERRNO(ast) = AST_ERR_EVAL;
+        break;
+      case AST_DTYPE_INT:
+        *((int *) value) = ast_prog_eval_int(prog, (int *) ast->var, NULL);
+        break;
+      case AST_DTYPE_LONG:
+        *((long *) value) = ast_prog_eval_long(prog, (long *) ast->var, NULL);
+        break;
+      case AST_DTYPE_FLOAT:
+        *((float *) value) =
+          ast_prog_eval_float(prog, (float *) ast->var, NULL);
+        break;
+      case AST_DTYPE_DOUBLE:
+        *((double *) value) =
+          ast_prog_eval_double(prog, (double *) ast->var, NULL);
+        break;
+      default:
+        return AST_ERRNO(ast) = AST_ERR_DTYPE;
+    }
+    return 0;
+  }
+
+  ast_node_t *root = (ast_node_t *) ast->ast;
+  switch (ast->dtype) {
+    case AST_DTYPE_BOOL:
+      ast_eval_bool(ast, root);
+      if (AST_IS_ERROR(ast)) return AST_ERRNO(ast);
+      *((bool *) value) = root->value.v.bval;
+      break;
+    case AST_DTYPE_INT:
+      *((int *) value) = ast_eval_int(ast, root, NULL);
+      if (AST_IS_ERROR(ast)) return AST_ERRNO(ast);
+      break;
+    case AST_DTYPE_LONG:
+      *((long *) value) = ast_eval_long(ast, root, NULL);
+      if (AST_IS_ERROR(ast)) return AST_ERRNO(ast);
+      break;
+    case AST_DTYPE_FLOAT:
+      *((float *) value) = ast_eval_float(ast, root, NULL);
+      if (AST_IS_ERROR(ast)) return AST_ERRNO(ast);
+      break;
+    case AST_DTYPE_DOUBLE:
+      *((double *) value) = ast_eval_double(ast, root, NULL);
+      if (AST_IS_ERROR(ast)) return AST_ERRNO(ast);
+      break;
+    default:
+      return AST_ERRNO(ast) = AST_ERR_DTYPE;
+  }
+  return 0;
+}
+
+/******************************************************************************
+Function `ast_eval_num`:
+  Evaluate the numerical expression given the variable array with the same
+  data type.
+Arguments:
+  * `ast`:      interface of the abstract syntax tree;
+  * `value`:    address of the variable holding the evaluated value;
+  * `var`:      pointer to the variable array;
+  * `size`:     number of elements in the variable array.
+Return:
+  Zero on success; non-zero on error.
+******************************************************************************/
+int ast_eval_num(ast_t *ast, void *value, const void *var, const long size) {
+  if (!ast) return AST_ERR_INIT;
+  if (AST_IS_ERROR(ast)) return AST_ERRNO(ast);
+  if (!ast->ast) return AST_ERRNO(ast) = AST_ERR_NOEXP;
+  if (!value) return AST_ERRNO(ast) = AST_ERR_VALUE;
+  if (!var && size) return AST_ERRNO(ast) = AST_ERR_VAR;
+  if (ast->nvar && size < ast->vidx[ast->nvar - 1])
+    return AST_ERRNO(ast) = AST_ERR_SIZE;
+
+  /* Evaluate with the compiled evaluators if available. */
+  const ast_prog_t *prog = (ast_prog_t *) ast->prog;
+  if (ast->dtype != AST_DTYPE_BOOL && prog && (prog->instr || prog->clos)) {
+    ast_prog_eval_num(prog, var, value);
+    return 0;
+  }
+
+  switch (ast->dtype) {
+    case AST_DTYPE_INT:
+      *((int *) value) =
+        ast_eval_int(ast, (ast_node_t *) ast->ast, (int *) var);
+      break;
+    case AST_DTYPE_LONG:
+      *((long *) value) =
+        ast_eval_long(ast, (ast_node_t *) ast->ast, (long *) var);
+      break;
+    case AST_DTYPE_FLOAT:
+      *((float *) value) =
+        ast_eval_float(ast, (ast_node_t *) ast->ast, (float *) var);
+      break;
+    case AST_DTYPE_DOUBLE:
+      *((double *) value) =
+        ast_eval_double(ast, (ast_node_t *) ast->ast, (double *) var);
+      break;
+    default:
+      return AST_ERRNO(ast) = AST_ERR_DTYPE;
+  }
+  if (AST_IS_ERROR(ast)) return AST_ERRNO(ast);
+  return 0;
+}
+
+/******************************************************************************
+Function `ast_eval_num_batch`:
+  Evaluate the numerical expression for multiple rows, given columns of
+  variables with the same data type.
+Arguments:
+  * `ast`:      interface of the abstract syntax tree;
+  * `out`:      array for the evaluated values, with at least `nrows` elements;
+  * `cols`:     columns of variables, where `cols[i]` is for variable `$i+1`;
+  * `nrows`:    number of rows to be evaluated.
+Return:
+  Zero on success; non-zero on error.
+******************************************************************************/
+int ast_eval_num_batch(ast_t *ast, void *out, const void *const *cols,
+    const size_t nrows) {
+  return ast_eval_num_batch_typed(ast, out, cols, NULL, nrows);
+}
+
+/******************************************************************************
+Function `ast_eval_num_batch_typed`:
+  Evaluate the numerical expression for multiple rows, given columns of
+  variables in their native data types.
+Arguments:
+  * `ast`:      interface of the abstract syntax tree;
+  * `out`:      array for the evaluated values, with at least `nrows` elements;
+  * `cols`:     columns of variables, where `cols[i]` is for variable `$i+1`;
+  * `dtypes`:   data types of the columns, in the same order as `cols`, or
+                NULL if they are all the same as the expression;
+  * `nrows`:    number of rows to be evaluated.
+Return:
+  Zero on success; non-zero on error.
+******************************************************************************/
+int ast_eval_num_batch_typed(ast_t *ast, void *out, const void *const *cols,
+    const ast_dtype_t *dtypes, const size_t nrows) {
+  if (!ast) return AST_ERR_INIT;
+  if (AST_IS_ERROR(ast)) return AST_ERRNO(ast);
+  if (!ast->ast) return AST_ERRNO(ast) = AST_ERR_NOEXP;
+  if (ast->dtype == AST_DTYPE_BOOL) return AST_ERRNO(ast) = AST_ERR_DTYPE;
+  if (!out) return AST_ERRNO(ast) = AST_ERR_VALUE;
+  if (!nrows) return 0;
+
+  /* Columns and their data types, indexed by the positions of variables,
+     which are validated once for all the rows. */
+  const void *col[ast->nvar ? ast->nvar : 1];
+  ast_dtype_t dtype[ast->nvar ? ast->nvar : 1];
+  if (ast_batch_check(ast, cols, dtypes, col, dtype)) return AST_ERRNO(ast);
+  ast_batch_num((ast_prog_t *) ast->prog, out, col, dtype, nrows);
+  return 0;
+}
+
+/******************************************************************************
+Function `ast_eval_num_strided`:
+  Evaluate the numerical expression for multiple rows, given an array of
+  records with variables in their native data types.
+Arguments:
+  * `ast`:      interface of the abstract syntax tree;
+  * `out`:      array for the evaluated values, with at least `nrows` elements;
+  * `base`:     address of the first record;
+  * `stride`:   size of each record in bytes;
+  * `offsets`:  byte offsets of variables in the record, where `offsets[i]` is
+                for variable `$i+1`;
+  * `dtypes`:   data types of variables, in the same order as `offsets`, or
+                NULL if they are all the same as the expression;
+  * `nrows`:    number of rows to be evaluated.
+Return:
+  Zero on success; non-zero on error.
+******************************************************************************/
+int ast_eval_num_strided(ast_t *ast, void *out, const void *base,
+    const size_t stride, const size_t *offsets, const ast_dtype_t *dtypes,
+    const size_t nrows) {
+  if (!ast) return AST_ERR_INIT;
+  if (AST_IS_ERROR(ast)) return AST_ERRNO(ast);
+  if (!ast->ast) return AST_ERRNO(ast) = AST_ERR_NOEXP;
+  if (ast->dtype == AST_DTYPE_BOOL) return AST_ERRNO(ast) = AST_ERR_DTYPE;
+  if (!out) return AST_ERRNO(ast) = AST_ERR_VALUE;
+  if (!nrows) return 0;
+  if (ast->nvar && (!base || !offsets)) return AST_ERRNO(ast) = AST_ERR_VAR;
+
+  /* Validate the data types of variables once for all the records. */
+  for (long i = 0; i < ast->nvar; i++) {
+    const ast_dtype_t dtype = dtypes ? dtypes[ast->vidx[i] - 1] : ast->dtype;
+    const char *msg = ast_num_cast_check(ast->dtype, dtype);
+    if (msg) {
+      ast_msg(ast, msg, ast->vidx[i], NULL);
+      return AST_ERRNO(ast) = AST_ERR_VAR;
+    }
+  }
+
+  /* Fields of the records for the variables. */
+  ast_field_t field[ast->nvar ? ast->nvar : 1];
+  for (long i = 0; i < ast->nvar; i++) {
+    field[i].offset = offsets[ast->vidx[i] - 1];
+    field[i].dtype = dtypes ? dtypes[ast->vidx[i] - 1] : ast->dtype;
+  }
+
+  /* Rows are evaluated one by one with native code if available, or tile by
+     tile with the compiled program otherwise. */
+  const ast_prog_t *prog = (ast_prog_t *) ast->prog;
+  if (prog->ifunc || prog->lfunc || prog->ffunc || prog->dfunc) {
+    switch (ast->dtype) {
+      case AST_DTYPE_INT:
+        ast_strided_int(prog, (int *) out, base, stride, field, nrows);
+        break;
+      case AST_DTYPE_LONG:
+        ast_strided_long(prog, (long *) out, base, stride, field, nrows);
+        break;
+      case AST_DTYPE_FLOAT:
+        ast_strided_float(prog, (float *) out, base, stride, field, nrows);
+        break;
       default:
-        AST_ERRNO(ast) = AST_ERR_EVAL;
-        return;
+        ast_strided_double(prog, (double *) out, base, stride, field, nrows);
+        break;
+    }
+    return 0;
+  }
+
+  if (ast_compile(ast)) return AST_ERRNO(ast);
+  switch (ast->dtype) {
+    case AST_DTYPE_INT:
+      ast_tile_strided_int(prog, (int *) out, base, stride, field, nrows);
+      break;
+    case AST_DTYPE_LONG:
+      ast_tile_strided_long(prog, (long *) out, base, stride, field, nrows);
+      break;
+    case AST_DTYPE_FLOAT:
+      ast_tile_strided_float(prog, (float *) out, base, stride, field, nrows);
+      break;
+    default:
+      ast_tile_strided_double(prog, (double *) out, base, stride, field,
+          nrows);
+      break;
+  }
+  return 0;
+}
+
+/******************************************************************************
+Function `ast_eval_bool_batch`:
+  Evaluate the boolean expression for multiple rows, given columns of
+  variables, with the results packed into a bitmask.
+Arguments:
+  * `ast`:      interface of the abstract syntax tree;
+  * `mask`:     the bitmask, with bit `i % 64` of `mask[i / 64]` for row `i`;
+  * `cols`:     columns of variables, where `cols[i]` is for variable `$i+1`;
+  * `dtypes`:   data types of the columns, in the same order as `cols`;
+  * `nrows`:    number of rows to be evaluated.
+Return:
+  Zero on success; non-zero on error.
+******************************************************************************/
+int ast_eval_bool_batch(ast_t *ast, uint64_t *mask, const void *const *cols,
+    const ast_dtype_t *dtypes, const size_t nrows) {
+  if (!ast) return AST_ERR_INIT;
+  if (AST_IS_ERROR(ast)) return AST_ERRNO(ast);
+  if (!ast->ast) return AST_ERRNO(ast) = AST_ERR_NOEXP;
+  if (ast->dtype != AST_DTYPE_BOOL) return AST_ERRNO(ast) = AST_ERR_DTYPE;
+  if (!mask) return AST_ERRNO(ast) = AST_ERR_VALUE;
+  if (!nrows) return 0;
+  ast_mask_dst_t dst = { mask, NULL, NULL, 0 };
+  return ast_mask_eval(ast, &dst, cols, dtypes, nrows);
+}
+
+/******************************************************************************
+Function `ast_filter_indices`:
+  Evaluate the boolean expression for multiple rows, given columns of
+  variables, and report the indices of rows for which it is true, as
+  32-bit integers.
+Arguments:
+  * `ast`:      interface of the abstract syntax tree;
+  * `idx`:      array for the indices of the selected rows in ascending
+                order, with at least `nrows` elements;
+  * `num`:      number of the selected rows;
+  * `cols`:     columns of variables, where `cols[i]` is for variable `$i+1`;
+  * `dtypes`:   data types of the columns, in the same order as `cols`;
+  * `nrows`:    number of rows to be evaluated.
+Return:
+  Zero on success; non-zero on error.
+******************************************************************************/
+int ast_filter_indices(ast_t *ast, uint32_t *idx, size_t *num,
+    const void *const *cols, const ast_dtype_t *dtypes, const size_t nrows) {
+  if (!ast) return AST_ERR_INIT;
+  if (AST_IS_ERROR(ast)) return AST_ERRNO(ast);
+  if (!ast->ast) return AST_ERRNO(ast) = AST_ERR_NOEXP;
+  if (ast->dtype != AST_DTYPE_BOOL) return AST_ERRNO(ast) = AST_ERR_DTYPE;
+  if (!idx || !num) return AST_ERRNO(ast) = AST_ERR_VALUE;
+  *num = 0;
+  if (!nrows) return 0;
+  /* The indices of all rows have to be representable. */
+  if (nrows - 1 > UINT32_MAX) return AST_ERRNO(ast) = AST_ERR_VALUE;
+  ast_mask_dst_t dst = { NULL, idx, ast_kern_index(false,
+      ((ast_prog_t *) ast->prog)->simd), 0 };
+  if (ast_mask_eval(ast, &dst, cols, dtypes, nrows)) return AST_ERRNO(ast);
+  *num = dst.num;
+  return 0;
+}
+
+/******************************************************************************
+Function `ast_filter_indices64`:
+  Evaluate the boolean expression for multiple rows, given columns of
+  variables, and report the indices of rows for which it is true, as
+  64-bit integers.
+Arguments:
+  * `ast`:      interface of the abstract syntax tree;
+  * `idx`:      array for the indices of the selected rows in ascending
+                order, with at least `nrows` elements;
+  * `num`:      number of the selected rows;
+  * `cols`:     columns of variables, where `cols[i]` is for variable `$i+1`;
+  * `dtypes`:   data types of the columns, in the same order as `cols`;
+  * `nrows`:    number of rows to be evaluated.
+Return:
+  Zero on success; non-zero on error.
+******************************************************************************/
+int ast_filter_indices64(ast_t *ast, uint64_t *idx, size_t *num,
+    const void *const *cols, const ast_dtype_t *dtypes, const size_t nrows) {
+  if (!ast) return AST_ERR_INIT;
+  if (AST_IS_ERROR(ast)) return AST_ERRNO(ast);
+  if (!ast->ast) return AST_ERRNO(ast) = AST_ERR_NOEXP;
+  if (ast->dtype != AST_DTYPE_BOOL) return AST_ERRNO(ast) = AST_ERR_DTYPE;
+  if (!idx || !num) return AST_ERRNO(ast) = AST_ERR_VALUE;
+  *num = 0;
+  if (!nrows) return 0;
+  ast_mask_dst_t dst = { NULL, idx, ast_kern_index(true,
+      ((ast_prog_t *) ast->prog)->simd), 0 };
+  if (ast_mask_eval(ast, &dst, cols, dtypes, nrows)) return AST_ERRNO(ast);
+  *num = dst.num;
+  return 0;
+}
+
+/******************************************************************************
+Function `ast_eval_simd`:
+  Report the instruction set of the vectorised kernels for batch evaluation,
+  which is detected at runtime.
+Return:
+  The most advanced instruction set supported by both the build and the
+  processor; `AST_SIMD_NONE` if there is none.
+******************************************************************************/
+ast_simd_t ast_eval_simd(void) {
+#ifdef AST_SIMD_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f")) return AST_SIMD_AVX512;
+  if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+    return AST_SIMD_AVX2;
+  if (__builtin_cpu_supports("sse2")) return AST_SIMD_SSE2;
+#endif
+#ifdef AST_SIMD_VECEXT
+  return AST_SIMD_GENERIC;
+#else
+  return AST_SIMD_NONE;
+#endif
+}
+
+/******************************************************************************
+Function `ast_set_simd`:
+  Choose the instruction set of the vectorised kernels for batch evaluation,
+  e.g., for comparing the performance of the kernels.
+Arguments:
+  * `ast`:      interface of the abstract syntax tree;
+  * `simd`:     the instruction set, which has to be supported by both the
+                build and the processor; `AST_SIMD_NONE` for portable loops.
+Return:
+  Zero on success; non-zero on error.
+******************************************************************************/
+int ast_set_simd(ast_t *ast, const ast_simd_t simd) {
+  if (!ast) return AST_ERR_INIT;
+  if (AST_IS_ERROR(ast)) return AST_ERRNO(ast);
+  if (!ast->ast) return AST_ERRNO(ast) = AST_ERR_NOEXP;
+  switch (simd) {
+    case AST_SIMD_NONE: break;
+#ifdef AST_SIMD_VECEXT
+    case AST_SIMD_GENERIC: break;
+#endif
+    case AST_SIMD_SSE2:
+    case AST_SIMD_AVX2:
+    case AST_SIMD_AVX512:
+      if (simd <= ast_eval_simd()) break;
+      return AST_ERRNO(ast) = AST_ERR_VALUE;
+    default: return AST_ERRNO(ast) = AST_ERR_VALUE;
+  }
+
+  ast_prog_t *prog = ast_prog_init(ast);
+  if (!prog) return AST_ERRNO(ast) = AST_ERR_MEMORY;
+  prog->simd = simd;
+  return 0;
+}
+
+/******************************************************************************
+Function `ast_set_math`:
+  Choose the accuracy of mathematical functions for batch evaluation of
+  expressions with the float type.
+Arguments:
+  * `ast`:      interface of the abstract syntax tree;
+  * `math`:     `AST_MATH_EXACT` for the C math library, or `AST_MATH_FAST`
+                for vectorised approximations of `ln`, `log`, and `**`.
+Return:
+  Zero on success; non-zero on error.
+******************************************************************************/
+int ast_set_math(ast_t *ast, const ast_math_t math) {
+  if (!ast) return AST_ERR_INIT;
+  if (AST_IS_ERROR(ast)) return AST_ERRNO(ast);
+  if (!ast->ast) return AST_ERRNO(ast) = AST_ERR_NOEXP;
+  if (math != AST_MATH_EXACT && math != AST_MATH_FAST)
+    return AST_ERRNO(ast) = AST_ERR_VALUE;
+
+  ast_prog_t *prog = ast_prog_init(ast);
+  if (!prog) return AST_ERRNO(ast) = AST_ERR_MEMORY;
+  prog->math = math;
+  return 0;
+}
+
+
+/*============================================================================*\
+                      Interfaces for evaluation contexts
+\*============================================================================*/
+
+/******************************************************************************
+Function `ast_compiled`:
+  Retrieve the compiled expression that can be shared by evaluation contexts,
+  and compile the abstract syntax tree if necessary.
+Arguments:
+  * `ast`:      interface of the abstract syntax tree.
+Return:
+  The compiled expression on success; NULL on error.
+******************************************************************************/
+const ast_compiled_t *ast_compiled(ast_t *ast) {
+  if (!ast || AST_IS_ERROR(ast)) return NULL;
+  if (!ast->ast) {
+    AST_ERRNO(ast) = AST_ERR_NOEXP;
+    return NULL;
+  }
+  /* Boolean expressions are evaluated only with the compiled program. */
+  const ast_prog_t *prog = (ast_prog_t *) ast->prog;
+  if (!prog || !prog->clos) {
+    if (ast_compile(ast)) return NULL;
+    prog = (ast_prog_t *) ast->prog;
+  }
+  return prog;
+}
+
+/******************************************************************************
+Function `ast_ctx_init`:
+  Initialise an evaluation context for the compiled expression.
+Arguments:
+  * `comp`:     the compiled expression.
+Return:
+  The pointer to the context on success; NULL on error.
+******************************************************************************/
+ast_ctx_t *ast_ctx_init(const ast_compiled_t *comp) {
+  if (!comp) return NULL;
+  ast_ctx_t *ctx = malloc(sizeof *ctx);
+  if (!ctx) return NULL;
+  ctx->comp = comp;
+  ctx->var = NULL;
+
+  ast_error_t *err = malloc(sizeof(ast_error_t));
+  if (!err) {
+    free(ctx);
+    return NULL;
+  }
+  err->errno = 0;
+  err->vidx = 0;
+  err->tpos = err->msg = NULL;
+  err->vset = NULL;
+  ctx->error = err;
+  if (!comp->nvar) return ctx;
+
+  /* Variables of numerical expressions are indexed in the same way as for
+     `ast_eval_num`, and those of boolean expressions by their positions. */
+  if (!(err->vset = calloc(comp->nvar, sizeof(bool)))) {
+    ast_ctx_destroy(ctx);
+    return NULL;
+  }
+  const long nvar = comp->vidx[comp->nvar - 1];
+  switch (comp->dtype) {
+    case AST_DTYPE_BOOL:
+      ctx->var = calloc(comp->nvar, sizeof(ast_var_t));
+      if (ctx->var) {
+        for (long i = 0; i < comp->nvar; i++)
+          ((ast_var_t *) ctx->var)[i].dtype = comp->vtype[i];
+      }
+      break;
+    case AST_DTYPE_INT: ctx->var = calloc(nvar, sizeof(int)); break;
+    case AST_DTYPE_LONG: ctx->var = calloc(nvar, sizeof(long)); break;
+    case AST_DTYPE_FLOAT: ctx->var = calloc(nvar, sizeof(float)); break;
+    default: ctx->var = calloc(nvar, sizeof(double)); break;
+  }
+  if (!ctx->var) {
+    ast_ctx_destroy(ctx);
+    return NULL;
+  }
+  return ctx;
+}
+
+/******************************************************************************
+Function `ast_ctx_set_var`:
+  Set the value of a variable for the evaluation context.
+Arguments:
+  * `ctx`:      the evaluation context;
+  * `idx`:      index of the variable (starting from 1);
+  * `value`:    pointer to a variable holding the value to be set;
+  * `size`:     length of the string type variable;
+  * `dtype`:    data type of the value.
+Return:
+  Zero on success; non-zero on error.
+******************************************************************************/
+int ast_ctx_set_var(ast_ctx_t *ctx, const long idx, const void *value,
+    const size_t size, const ast_dtype_t dtype) {
+  if (!ctx) return AST_ERR_INIT;
+  if (AST_IS_ERROR(ctx)) return AST_ERRNO(ctx);
+  const ast_compiled_t *comp = ctx->comp;
+  if (!comp->nvar) return 0;
+  if (!value) return AST_ERRNO(ctx) = AST_ERR_VALUE;
+
+  ast_error_t *err = (ast_error_t *) ctx->error;
+  if (idx <= 0) {
+    err->msg = "unexpected variable index";
+    err->vidx = idx;
+    return AST_ERRNO(ctx) = AST_ERR_VAR;
+  }
+
+  /* Nothing to be done if this variable is not required. */
+  const long pos = -ast_vidx_pos(comp->vidx, comp->nvar, idx) - 1;
+  if (pos < 0) return 0;
+  const char *msg = (comp->dtype == AST_DTYPE_BOOL) ?
+    ast_set_var_pos(ctx->var, pos, comp->dtype, comp->vtype[pos], value,
+        size, dtype) :
+    ast_set_var_pos(ctx->var, idx - 1, comp->dtype, AST_DTYPE_NULL, value,
+        size, dtype);
+  if (msg) {
+    err->msg = msg;
+    err->vidx = idx;
+    return AST_ERRNO(ctx) = AST_ERR_VAR;
+  }
+
+  err->vset[pos] = true;
+  return 0;
+}
+
+/******************************************************************************
+Function `ast_ctx_eval`:
+  Evaluate the compiled expression with variables of the evaluation context.
+Arguments:
+  * `ctx`:      the evaluation context;
+  * `value`:    address of the variable holding the evaluated value.
+Return:
+  Zero on success; non-zero on error.
+******************************************************************************/
+int ast_ctx_eval(ast_ctx_t *ctx, void *value) {
+  if (!ctx) return AST_ERR_INIT;
+  if (AST_IS_ERROR(ctx)) return AST_ERRNO(ctx);
+  if (!value) return AST_ERRNO(ctx) = AST_ERR_VALUE;
+  const ast_compiled_t *comp = ctx->comp;
+  ast_error_t *err = (ast_error_t *) ctx->error;
+  for (long i = 0; i < comp->nvar; i++) {
+    if (!err->vset[i]) {
+      err->msg = "variable not set";
+      err->vidx = comp->vidx[i];
+      return AST_ERRNO(ctx) = AST_ERR_VAR;
+    }
+  }
+
+  if (comp->dtype == AST_DTYPE_BOOL) {
+    if (ast_prog_eval_bool(comp, (ast_var_t *) ctx->var, (bool *) value))
+      return AST_ERRNO(ctx) = AST_ERR_EVAL;
+  }
+  else ast_prog_eval_num(comp, ctx->var, value);
+  return 0;
+}
+
+/******************************************************************************
+Function `ast_ctx_destroy`:
+  Release memory allocated for the evaluation context.
+Arguments:
+  * `ctx`:      the evaluation context.
+******************************************************************************/
+void ast_ctx_destroy(ast_ctx_t *ctx) {
+  if (!ctx) return;
+  ast_error_t *err = (ast_error_t *) ctx->error;
+  if (err) {
+    if (err->vset) free(err->vset);
+    free(err);
+  }
+  if (ctx->var) free(ctx->var);
+  free(ctx);
+}
+
+
+/*============================================================================*\
+                   Interfaces for multi-threaded evaluation
+\*============================================================================*/
+
+/******************************************************************************
+Function `ast_pool_init`:
+  Initialise a thread pool for multi-threaded evaluation, with persistent
+  worker threads.
+Arguments:
+  * `nthreads`: number of threads, including the calling thread, or
+                non-positive for the number of available processors;
+  * `affinity`: true for binding the worker threads to processors.
+Return:
+  The pointer to the thread pool on success; NULL on error.
+******************************************************************************/
+ast_pool_t *ast_pool_init(const int nthreads, const bool affinity) {
+  ast_pool_t *pool = malloc(sizeof *pool);
+  if (!pool) return NULL;
+#ifndef AST_POOL_PTHREAD
+  /* Jobs are run by the calling thread without POSIX threads. */
+  (void) nthreads;
+  (void) affinity;
+  pool->nthreads = 1;
+  return pool;
+#else
+  pool->nthreads = 1;
+  pool->worker = NULL;
+  pool->gen = 0;
+  pool->active = pool->busy = 0;
+  pool->stop = false;
+  pool->func = NULL;
+  pool->arg = NULL;
+  if (pthread_mutex_init(&pool->run, NULL)) {
+    free(pool);
+    return NULL;
+  }
+  if (pthread_mutex_init(&pool->lock, NULL)) {
+    pthread_mutex_destroy(&pool->run);
+    free(pool);
+    return NULL;
+  }
+  if (pthread_cond_init(&pool->wake, NULL)) {
+    pthread_mutex_destroy(&pool->lock);
+    pthread_mutex_destroy(&pool->run);
+    free(pool);
+    return NULL;
+  }
+  if (pthread_cond_init(&pool->done, NULL)) {
+    pthread_cond_destroy(&pool->wake);
+    pthread_mutex_destroy(&pool->lock);
+    pthread_mutex_destroy(&pool->run);
+    free(pool);
+    return NULL;
+  }
+
+  const int num = (nthreads > 0) ? nthreads : ast_pool_ncpu();
+  if (num == 1) return pool;
+  if (!(pool->worker = malloc(sizeof(ast_worker_t) * (num - 1)))) {
+    ast_pool_destroy(pool);
+    return NULL;
+  }
+
+  /* The calling thread is the one with index 0. */
+  for (int i = 1; i < num; i++) {
+    ast_worker_t *worker = pool->worker + i - 1;
+    worker->pool = pool;
+    worker->id = i;
+    pthread_attr_t attr;
+    if (pthread_attr_init(&attr)) {
+      ast_pool_destroy(pool);
+      return NULL;
+    }
+    int err = ast_pool_attr(&attr, i, affinity);
+    if (!err) err = pthread_create(&worker->tid, &attr, ast_pool_work, worker);
+    pthread_attr_destroy(&attr);
+    if (err) {
+      ast_pool_destroy(pool);
+      return NULL;
     }
+    pool->nthreads++;
   }
+  return pool;
+#endif
+}
+
+/******************************************************************************
+Function `ast_pool_nthreads`:
+  Report the number of threads of the thread pool.
+Arguments:
+  * `pool`:     the thread pool.
+Return:
+  The number of threads, including the calling thread; 0 on error.
+******************************************************************************/
+int ast_pool_nthreads(const ast_pool_t *pool) {
+  if (!pool) return 0;
+  return pool->nthreads;
+}
+
+/******************************************************************************
+Function `ast_eval_batch_mt`:
+  Evaluate the expression for multiple rows with the thread pool of the
+  library, given columns of variables in their native data types.
+Arguments:
+  * `ast`:      interface of the abstract syntax tree;
+  * `out`:      array for the evaluated values, with at least `nrows`
+                elements, or the bitmask for boolean expressions, with bit
+                `i % 64` of `((uint64_t *) out)[i / 64]` for row `i`;
+  * `cols`:     columns of variables, where `cols[i]` is for variable `$i+1`;
+  * `dtypes`:   data types of the columns, in the same order as `cols`, or
+                NULL for numerical expressions if they are all the same as
+                the expression;
+  * `nrows`:    number of rows to be evaluated;
+  * `nthreads`: number of threads, or non-positive for all the processors.
+Return:
+  Zero on success; non-zero on error.
+******************************************************************************/
+int ast_eval_batch_mt(ast_t *ast, void *out, const void *const *cols,
+    const ast_dtype_t *dtypes, const size_t nrows, const int nthreads) {
+  return ast_pool_eval(ast, NULL, nthreads, out, cols, dtypes, nrows);
 }
 
-
-/*============================================================================*\
-                    Interfaces for the parser and evaluator
-\*============================================================================*/
-
 /******************************************************************************
-Function `ast_build`:
-  Build the abstract syntax tree given the expression and data type.
+Function `ast_eval_batch_pool`:
+  Evaluate the expression for multiple rows with a thread pool, given
+  columns of variables in their native data types.
 Arguments:
   * `ast`:      interface of the abstract syntax tree;
-  * `str`:      null terminated string for the expression;
-  * `dtype`:    data type for the abstract syntax tree;
-  * `eval`:     true for pre-evaluating values.
+  * `pool`:     the thread pool;
+  * `out`:      array for the evaluated values, with at least `nrows`
+                elements, or the bitmask for boolean expressions, with bit
+                `i % 64` of `((uint64_t *) out)[i / 64]` for row `i`;
+  * `cols`:     columns of variables, where `cols[i]` is for variable `$i+1`;
+  * `dtypes`:   data types of the columns, in the same order as `cols`, or
+                NULL for numerical expressions if they are all the same as
+                the expression;
+  * `nrows`:    number of rows to be evaluated.
 Return:
   Zero on success; non-zero on error.
 ******************************************************************************/
-int ast_build(ast_t *ast, const char *str, const ast_dtype_t dtype,
-    const bool eval) {
+int ast_eval_batch_pool(ast_t *ast, ast_pool_t *pool, void *out,
+    const void *const *cols, const ast_dtype_t *dtypes, const size_t nrows) {
   if (!ast) return AST_ERR_INIT;
-  if (ast->ast) return AST_ERRNO(ast) = AST_ERR_EXIST;
-
-  if (!str || *(str = ast_skip_space(str)) == '\0')
-    return AST_ERRNO(ast) = AST_ERR_STRING;
-  if (!(ast->exp = ast_copy_str(str))) return AST_ERRNO(ast) = AST_ERR_MEMORY;
-
-  if (dtype != AST_DTYPE_BOOL && dtype != AST_DTYPE_INT &&
-      dtype != AST_DTYPE_LONG && dtype != AST_DTYPE_FLOAT &&
-      dtype != AST_DTYPE_DOUBLE)
-    return AST_ERRNO(ast) = AST_ERR_DTYPE;
-  ast->dtype = dtype;
+  if (!pool) return AST_ERRNO(ast) = AST_ERR_THREAD;
+  return ast_pool_eval(ast, pool, pool->nthreads, out, cols, dtypes, nrows);
+}
 
-  /* Initialise the first node. */
-  ast_var_t v = {0, .v.ival = 0};
-  ast->ast = ast_create(AST_TOK_UNDEF, v);
-  if (!ast->ast) return AST_ERRNO(ast) = AST_ERR_MEMORY;
+/******************************************************************************
+Function `ast_eval_tasks`:
+  Evaluate expressions for multiple rows with a thread pool, where large
+  tasks are split on demand, and idle threads steal work from the others.
+Arguments:
+  * `pool`:     the thread pool, or NULL for the one of the library;
+  * `tasks`:    the tasks of batch evaluations;
+  * `ntask`:    number of tasks.
+Return:
+  Zero on success; the error code of the first failed task on error.
+******************************************************************************/
+int ast_eval_tasks(ast_pool_t *pool, const ast_task_t *tasks,
+    const size_t ntask) {
+  return ast_sched_run(pool, 0, tasks, ntask);
+}
 
-  /* Parse the expression. */
-  ast_node_t *node = (ast_node_t *) ast->ast;
-  ast_parse_token(ast, node, ast->exp);
+/******************************************************************************
+Function `ast_reduce`:
+  Evaluate the expression for multiple rows with a thread pool, and reduce
+  the values without storing them.
+Arguments:
+  * `ast`:      interface of the abstract syntax tree;
+  * `pool`:     the thread pool, or NULL for the one of the library;
+  * `cols`:     columns of variables, where `cols[i]` is for variable `$i+1`;
+  * `dtypes`:   data types of the columns, in the same order as `cols`, or
+                NULL for numerical expressions if they are all the same as
+                the expression;
+  * `nrows`:    number of rows to be evaluated;
+  * `op`:       the reduction operation;
+  * `result`:   address of the variable holding the result.
+Return:
+  Zero on success; non-zero on error.
+******************************************************************************/
+int ast_reduce(ast_t *ast, ast_pool_t *pool, const void *const *cols,
+    const ast_dtype_t *dtypes, const size_t nrows, const ast_reduce_t op,
+    double *result) {
+  if (!ast) return AST_ERR_INIT;
   if (AST_IS_ERROR(ast)) return AST_ERRNO(ast);
+  if (!result || op < AST_REDUCE_SUM || op > AST_REDUCE_MEAN)
+    return AST_ERRNO(ast) = AST_ERR_VALUE;
+
+  const long nvar = ast->nvar ? ast->nvar : 1;
+  const void *col[nvar];
+  ast_dtype_t dtype[nvar], vtype[nvar];
+  ast_sched_task_t task;
+  task.col = col;
+  task.dtype = dtype;
+  task.vtype = vtype;
+  if (ast_sched_prep(ast, cols, dtypes, nrows, &task)) return AST_ERRNO(ast);
+  if (!nrows) {
+    *result = (op == AST_REDUCE_MEAN) ? NAN : ast_reduce_init(op);
+    return 0;
+  }
 
-  /* Redirect the root of the abstract syntax tree. */
-  ast->ast = node = ast_root(node);
+  int nthreads = 0;
+  if (!(pool = ast_sched_pool(pool, &nthreads)))
+    return AST_ERRNO(ast) = AST_ERR_THREAD;
+  const size_t nchunk = (nrows + AST_REDUCE_ROWS - 1) / AST_REDUCE_ROWS;
+  ast_reduce_arg_t arg;
+  arg.op = op;
+  if (!(arg.part = malloc(sizeof(double) * nchunk)))
+    return AST_ERRNO(ast) = AST_ERR_MEMORY;
+  task.out = &arg;
+  task.align = AST_REDUCE_ROWS;
+  task.func = ast_reduce_chunk;
+  if (ast_sched_one(ast, pool, nthreads, &task)) {
+    free(arg.part);
+    return AST_ERRNO(ast);
+  }
 
-  /* Reset variable indices. */
-  ast_reset_idx(ast, node);
-  /* Free pre-allocated memory that is not necessary any more. */
-  if (ast->nvar) {
-    if (ast->nvar & (ast->nvar - 1)) {          /* nvar is not power of 2 */
-      long *tmp = realloc(ast->vidx, ast->nvar * sizeof(long));
-      if (tmp) ast->vidx = tmp;         /* do nothing if realloc fails */
-    }
+  /* Pairwise merge of the partial results in a fixed order. */
+  for (size_t step = 1; step < nchunk; step <<= 1) {
+    for (size_t i = 0; i + step < nchunk; i += step << 1)
+      arg.part[i] = ast_reduce_merge(op, arg.part[i], arg.part[i + step]);
   }
+  *result = arg.part[0];
+  if (op == AST_REDUCE_MEAN) *result /= nrows;
+  free(arg.part);
+  return 0;
+}
 
-  /* Allocate memory for variables. */
-  if (ast->nvar) {
-    ast->var = ast_init_var(ast, dtype);
-    if (!ast->var) return AST_ERRNO(ast) = AST_ERR_MEMORY;
+/******************************************************************************
+Function `ast_histogram`:
+  Evaluate the expression for multiple rows with a thread pool, and count
+  the values in bins, optionally for selected rows and with weights.
+Arguments:
+  * `ast`:      interface of the abstract syntax tree;
+  * `pool`:     the thread pool, or NULL for the one of the library;
+  * `cols`:     columns of variables, where `cols[i]` is for variable `$i+1`;
+  * `dtypes`:   data types of the columns, in the same order as `cols`, or
+                NULL for numerical expressions if they are all the same as
+                the expressions;
+  * `nrows`:    number of rows to be evaluated;
+  * `bins`:     the bins of the histogram;
+  * `mask`:     boolean expression for selecting the rows, or NULL;
+  * `weight`:   numerical expression for the weights, or NULL;
+  * `counts`:   array for the (weighted) counts of the bins.
+Return:
+  Zero on success; non-zero on error.
+******************************************************************************/
+int ast_histogram(ast_t *ast, ast_pool_t *pool, const void *const *cols,
+    const ast_dtype_t *dtypes, const size_t nrows, const ast_bins_t *bins,
+    ast_t *mask, ast_t *weight, double *counts) {
+  if (!ast) return AST_ERR_INIT;
+  if (AST_IS_ERROR(ast)) return AST_ERRNO(ast);
+  if (ast->dtype == AST_DTYPE_BOOL) return AST_ERRNO(ast) = AST_ERR_DTYPE;
+  if (!bins || !bins->nbins || !counts) return AST_ERRNO(ast) = AST_ERR_VALUE;
+  if (mask && mask->dtype != AST_DTYPE_BOOL)
+    return AST_ERRNO(mask) = AST_ERR_DTYPE;
+  if (weight && weight->dtype == AST_DTYPE_BOOL)
+    return AST_ERRNO(weight) = AST_ERR_DTYPE;
+
+  /* The edges have to be in ascending order. */
+  ast_hist_arg_t arg;
+  arg.nbins = bins->nbins;
+  arg.edges = bins->edges;
+  arg.min = bins->min;
+  arg.max = bins->max;
+  if (arg.edges) {
+    for (size_t i = 0; i < arg.nbins; i++)
+      if (!(arg.edges[i] < arg.edges[i + 1]))
+        return AST_ERRNO(ast) = AST_ERR_VALUE;
+  }
+  else {
+    if (!(arg.min < arg.max) || !isfinite(arg.max - arg.min))
+      return AST_ERRNO(ast) = AST_ERR_VALUE;
+    arg.scale = arg.nbins / (arg.max - arg.min);
   }
 
-  /* Validate data types for boolean expression. */
-  if (dtype == AST_DTYPE_BOOL) {
-    if (ast_check_dtype(ast, node) != AST_DTYPE_BOOL) {
-      if (AST_IS_ERROR(ast)) return AST_ERRNO(ast);
-      else return AST_ERRNO(ast) = AST_ERR_MISMATCH;
+  /* Validate all the expressions with the same columns. */
+  const long nvar = ast->nvar ? ast->nvar : 1;
+  const long nmask = (mask && mask->nvar) ? mask->nvar : 1;
+  const long nwt = (weight && weight->nvar) ? weight->nvar : 1;
+  const void *col[nvar], *mcol[nmask], *wcol[nwt];
+  ast_dtype_t dtype[nvar], mtype[nmask], mvtype[nmask], wtype[nwt];
+  ast_sched_task_t task, mtask, wtask;
+  task.col = col;
+  task.dtype = dtype;
+  mtask.col = mcol;
+  mtask.dtype = mtype;
+  mtask.vtype = mvtype;
+  wtask.col = wcol;
+  wtask.dtype = wtype;
+  if (ast_sched_prep(ast, cols, dtypes, nrows, &task)) return AST_ERRNO(ast);
+  if (mask && ast_sched_prep(mask, cols, dtypes, nrows, &mtask))
+    return AST_ERRNO(mask);
+  if (weight && ast_sched_prep(weight, cols, dtypes, nrows, &wtask))
+    return AST_ERRNO(weight);
+  arg.mask = mask ? &mtask : NULL;
+  arg.weight = weight ? &wtask : NULL;
+  for (size_t i = 0; i < arg.nbins; i++) counts[i] = 0;
+  if (!nrows) return 0;
+
+  /* The partial bins of chunks with `AST_REDUCE_ROWS` rows are merged
+     pairwise in a fixed order, as for `ast_reduce`, so the results do not
+     depend on the number of threads.  The chunks are evaluated in rounds,
+     each with a power-of-two number of chunks, and the merged bins of the
+     rounds are kept in a stack like a binary counter, which preserves the
+     order of merging all the chunks at once. */
+  int nthreads = 0;
+  if (!(pool = ast_sched_pool(pool, &nthreads)))
+    return AST_ERRNO(ast) = AST_ERR_THREAD;
+  arg.stride = (arg.nbins + 7) / 8 * 8;
+  const size_t nchunk = (nrows + AST_REDUCE_ROWS - 1) / AST_REDUCE_ROWS;
+  size_t nround = 1;
+  while (nround < nchunk && nround * 2 * arg.stride <= AST_HIST_PART)
+    nround <<= 1;
+  int nlev = 1;
+  for (size_t i = nchunk / nround; i; i >>= 1) nlev++;
+  if (!(arg.count = malloc(sizeof(double) * arg.stride * (nround + nlev))))
+    return AST_ERRNO(ast) = AST_ERR_MEMORY;
+  double *stack = arg.count + arg.stride * nround;
+  size_t size[nlev];
+  int nstack = 0;
+  task.out = &arg;
+  task.align = AST_REDUCE_ROWS;
+  task.func = ast_hist_chunk;
+
+  for (size_t c = 0; c < nchunk; c += nround) {
+    const size_t m = (nchunk - c < nround) ? nchunk - c : nround;
+    arg.base = c * AST_REDUCE_ROWS;
+    task.nrows = (nrows - arg.base < m * AST_REDUCE_ROWS) ?
+      nrows - arg.base : m * AST_REDUCE_ROWS;
+    for (size_t i = 0; i < arg.stride * m; i++) arg.count[i] = 0;
+    if (ast_sched_one(ast, pool, nthreads, &task)) {
+      free(arg.count);
+      return AST_ERRNO(ast);
+    }
+    for (size_t step = 1; step < m; step <<= 1) {
+      for (size_t i = 0; i + step < m; i += step << 1)
+        ast_hist_merge(arg.count + arg.stride * i,
+            arg.count + arg.stride * (i + step), arg.nbins);
     }
-  }
 
-  /* Pre-evaluate values. */
-  if (eval) {
-    ast_eval_pre(ast, node);
-    if (AST_IS_ERROR(ast)) return AST_ERRNO(ast);
+    /* Push the bins of a complete round to the stack, or merge all of them
+       after the last round. */
+    double *bin = arg.count;
+    size_t num = m;
+    if (c + m < nchunk) {
+      while (nstack && size[nstack - 1] == num) {
+        double *top = stack + arg.stride * (--nstack);
+        ast_hist_merge(top, bin, arg.nbins);
+        bin = top;
+        num <<= 1;
+      }
+      double *dst = stack + arg.stride * nstack;
+      if (bin != dst) memcpy(dst, bin, sizeof(double) * arg.nbins);
+      size[nstack++] = num;
+    }
+    else {
+      while (nstack) {
+        double *top = stack + arg.stride * (--nstack);
+        ast_hist_merge(top, bin, arg.nbins);
+        bin = top;
+      }
+      for (size_t i = 0; i < arg.nbins; i++) counts[i] = bin[i];
+    }
   }
-
+  free(arg.count);
   return 0;
 }
 
 /******************************************************************************
-Function `ast_eval`:
-  Evaluate the expression given the abstract syntax tree and the variable array.
+Function `ast_quantiles`:
+  Evaluate the expression for multiple rows with a thread pool, and estimate
+  quantiles of the values with mergeable sketches of the threads.
 Arguments:
   * `ast`:      interface of the abstract syntax tree;
-  * `value`:    address of the variable holding the evaluated value.
+  * `pool`:     the thread pool, or NULL for the one of the library;
+  * `cols`:     columns of variables, where `cols[i]` is for variable `$i+1`;
+  * `dtypes`:   data types of the columns, in the same order as `cols`, or
+                NULL for numerical expressions if they are all the same as
+                the expression;
+  * `nrows`:    number of rows to be evaluated;
+  * `probs`:    cumulative probabilities of the quantiles, in [0,1];
+  * `nprob`:    number of quantiles;
+  * `out`:      array for the quantiles.
 Return:
   Zero on success; non-zero on error.
 ******************************************************************************/
-int ast_eval(ast_t *ast, void *value) {
+int ast_quantiles(ast_t *ast, ast_pool_t *pool, const void *const *cols,
+    const ast_dtype_t *dtypes, const size_t nrows, const double *probs,
+    const size_t nprob, double *out) {
   if (!ast) return AST_ERR_INIT;
   if (AST_IS_ERROR(ast)) return AST_ERRNO(ast);
-  if (!ast->ast) return AST_ERRNO(ast) = AST_ERR_NOEXP;
-  if (!value) return AST_ERRNO(ast) = AST_ERR_VALUE;
-  for (long i = 0; i < ast->nvar; i++) {
-    if (!((ast_error_t *) ast->error)->vset[i]) {
-      ast_msg(ast, "variable not set", ast->vidx[i], NULL);
-      return AST_ERRNO(ast) = AST_ERR_VAR;
-    }
+  if (ast->dtype == AST_DTYPE_BOOL) return AST_ERRNO(ast) = AST_ERR_DTYPE;
+  if (nprob && (!probs || !out)) return AST_ERRNO(ast) = AST_ERR_VALUE;
+  for (size_t i = 0; i < nprob; i++) {
+    if (!(probs[i] >= 0 && probs[i] <= 1))
+      return AST_ERRNO(ast) = AST_ERR_VALUE;
   }
 
-  ast_node_t *root = (ast_node_t *) ast->ast;
-  switch (ast->dtype) {
-    case AST_DTYPE_BOOL:
-      ast_eval_bool(ast, root);
-      if (AST_IS_ERROR(ast)) return AST_ERRNO(ast);
-      *((bool *) value) = root->value.v.bval;
-      break;
-    case AST_DTYPE_INT:
-      *((int *) value) = ast_eval_int(ast, root, NULL);
-      if (AST_IS_ERROR(ast)) return AST_ERRNO(ast);
-      break;
-    case AST_DTYPE_LONG:
-      *((long *) value) = ast_eval_long(ast, root, NULL);
-      if (AST_IS_ERROR(ast)) return AST_ERRNO(ast);
-      break;
-    case AST_DTYPE_FLOAT:
-      *((float *) value) = ast_eval_float(ast, root, NULL);
-      if (AST_IS_ERROR(ast)) return AST_ERRNO(ast);
-      break;
-    case AST_DTYPE_DOUBLE:
-      *((double *) value) = ast_eval_double(ast, root, NULL);
-      if (AST_IS_ERROR(ast)) return AST_ERRNO(ast);
-      break;
-    default:
-      return AST_ERRNO(ast) = AST_ERR_DTYPE;
+  const long nvar = ast->nvar ? ast->nvar : 1;
+  const void *col[nvar];
+  ast_dtype_t dtype[nvar];
+  ast_sched_task_t task;
+  task.col = col;
+  task.dtype = dtype;
+  if (ast_sched_prep(ast, cols, dtypes, nrows, &task)) return AST_ERRNO(ast);
+  for (size_t i = 0; i < nprob; i++) out[i] = NAN;
+  if (!nrows || !nprob) return 0;
+
+  /* Items at level `h` stand for `2^h` values, and a new level is created
+     only if there are at least `AST_QUANT_MIN * 2^h` values. */
+  int nthreads = 0;
+  if (!(pool = ast_sched_pool(pool, &nthreads)))
+    return AST_ERRNO(ast) = AST_ERR_THREAD;
+  int nlev = 1;
+  for (size_t n = nrows; n; n >>= 1) nlev++;
+  if (nlev > AST_QUANT_LEVELS) nlev = AST_QUANT_LEVELS;
+  ast_quant_t *sk = malloc(sizeof(ast_quant_t) * nthreads);
+  double *item = malloc(sizeof(double) * AST_QUANT_SIZE * nlev * nthreads);
+  if (!sk || !item) {
+    if (sk) free(sk);
+    if (item) free(item);
+    return AST_ERRNO(ast) = AST_ERR_MEMORY;
+  }
+  for (int t = 0; t < nthreads; t++) {
+    sk[t].item = item + (size_t) AST_QUANT_SIZE * nlev * t;
+    sk[t].num[0] = 0;
+    sk[t].nlev = 1;
+    ast_quant_cap(sk + t);
+    sk[t].seed = UINT64_C(0x9E3779B97F4A7C15) ^ (uint64_t) t;
+    sk[t].min = HUGE_VAL;
+    sk[t].max = -HUGE_VAL;
   }
+  task.out = sk;
+  task.func = ast_quant_chunk;
+  if (ast_sched_one(ast, pool, nthreads, &task)) {
+    free(item);
+    free(sk);
+    return AST_ERRNO(ast);
+  }
+
+  /* Merge the sketches of all the threads, with the cumulative weights. */
+  size_t num = 0;
+  double min = HUGE_VAL, max = -HUGE_VAL;
+  for (int t = 0; t < nthreads; t++) {
+    for (int h = 0; h < sk[t].nlev; h++) num += sk[t].num[h];
+    if (sk[t].min < min) min = sk[t].min;
+    if (sk[t].max > max) max = sk[t].max;
+  }
+  if (!num) {           /* all the values are NaN */
+    free(item);
+    free(sk);
+    return 0;
+  }
+  ast_quant_item_t *all = malloc(sizeof(ast_quant_item_t) * num);
+  if (!all) {
+    free(item);
+    free(sk);
+    return AST_ERRNO(ast) = AST_ERR_MEMORY;
+  }
+  num = 0;
+  for (int t = 0; t < nthreads; t++) {
+    for (int h = 0; h < sk[t].nlev; h++) {
+      const double *v = sk[t].item + (size_t) AST_QUANT_SIZE * h;
+      for (size_t i = 0; i < sk[t].num[h]; i++) {
+        all[num].v = v[i];
+        all[num++].w = ldexp(1, h);
+      }
+    }
+  }
+  free(item);
+  free(sk);
+  qsort(all, num, sizeof(ast_quant_item_t), ast_quant_item_cmp);
+  for (size_t i = 1; i < num; i++) all[i].w += all[i - 1].w;
+
+  /* The quantile is the smallest item with a cumulative weight no less than
+     the fraction of the total weight, and the extrema are exact. */
+  for (size_t i = 0; i < nprob; i++) {
+    if (probs[i] == 0) out[i] = min;
+    else if (probs[i] == 1) out[i] = max;
+    else {
+      const double w = probs[i] * all[num - 1].w;
+      size_t l = 0, u = num - 1;
+      while (l < u) {
+        const size_t m = l + ((u - l) >> 1);
+        if (all[m].w < w) l = m + 1;
+        else u = m;
+      }
+      out[i] = all[l].v;
+    }
+  }
+  free(all);
   return 0;
 }
 
 /******************************************************************************
-Function `ast_eval_num`:
-  Evaluate the numerical expression given the variable array with the same
-  data type.
+Function `ast_topk`:
+  Evaluate the expression for multiple rows with a thread pool, and select
+  the rows with the largest or smallest values, optionally from the rows
+  selected by a filter.
 Arguments:
   * `ast`:      interface of the abstract syntax tree;
-  * `value`:    address of the variable holding the evaluated value;
-  * `var`:      pointer to the variable array;
-  * `size`:     number of elements in the variable array.
+  * `pool`:     the thread pool, or NULL for the one of the library;
+  * `cols`:     columns of variables, where `cols[i]` is for variable `$i+1`;
+  * `dtypes`:   data types of the columns, in the same order as `cols`, or
+                NULL for numerical expressions if they are all the same as
+                the expressions;
+  * `nrows`:    number of rows to be evaluated;
+  * `k`:        maximum number of rows to be selected;
+  * `largest`:  true for the largest values, false for the smallest ones;
+  * `filter`:   boolean expression for filtering the rows, or NULL;
+  * `idx`:      array for the indices of the selected rows;
+  * `val`:      array for the values of the selected rows, or NULL;
+  * `num`:      address of the number of selected rows, or NULL.
 Return:
   Zero on success; non-zero on error.
 ******************************************************************************/
-int ast_eval_num(ast_t *ast, void *value, const void *var, const long size) {
+int ast_topk(ast_t *ast, ast_pool_t *pool, const void *const *cols,
+    const ast_dtype_t *dtypes, const size_t nrows, const size_t k,
+    const bool largest, ast_t *filter, size_t *idx, double *val,
+    size_t *num) {
   if (!ast) return AST_ERR_INIT;
   if (AST_IS_ERROR(ast)) return AST_ERRNO(ast);
-  if (!ast->ast) return AST_ERRNO(ast) = AST_ERR_NOEXP;
-  if (!value) return AST_ERRNO(ast) = AST_ERR_VALUE;
-  if (!var && size) return AST_ERRNO(ast) = AST_ERR_VAR;
-  if (ast->nvar && size < ast->vidx[ast->nvar - 1])
-    return AST_ERRNO(ast) = AST_ERR_SIZE;
+  if (ast->dtype == AST_DTYPE_BOOL) return AST_ERRNO(ast) = AST_ERR_DTYPE;
+  if (k && !idx) return AST_ERRNO(ast) = AST_ERR_VALUE;
+  if (filter && filter->dtype != AST_DTYPE_BOOL)
+    return AST_ERRNO(filter) = AST_ERR_DTYPE;
+
+  const long nvar = ast->nvar ? ast->nvar : 1;
+  const long nflt = (filter && filter->nvar) ? filter->nvar : 1;
+  const void *col[nvar], *fcol[nflt];
+  ast_dtype_t dtype[nvar], ftype[nflt], fvtype[nflt];
+  ast_sched_task_t task, ftask;
+  task.col = col;
+  task.dtype = dtype;
+  ftask.col = fcol;
+  ftask.dtype = ftype;
+  ftask.vtype = fvtype;
+  if (ast_sched_prep(ast, cols, dtypes, nrows, &task)) return AST_ERRNO(ast);
+  if (filter && ast_sched_prep(filter, cols, dtypes, nrows, &ftask))
+    return AST_ERRNO(filter);
+  for (size_t i = 0; i < k; i++) {
+    idx[i] = SIZE_MAX;
+    if (val) val[i] = NAN;
+  }
+  if (num) *num = 0;
+  if (!nrows || !k) return 0;
+
+  /* Every thread keeps at most `k` rows, which are merged in the end. */
+  int nthreads = 0;
+  if (!(pool = ast_sched_pool(pool, &nthreads)))
+    return AST_ERRNO(ast) = AST_ERR_THREAD;
+  ast_topk_arg_t arg;
+  arg.k = (k < nrows) ? k : nrows;
+  arg.largest = largest;
+  arg.filter = filter ? &ftask : NULL;
+  arg.heap = malloc(sizeof(ast_topk_item_t) * arg.k * nthreads);
+  arg.num = calloc(nthreads, sizeof(size_t));
+  if (!arg.heap || !arg.num) {
+    if (arg.heap) free(arg.heap);
+    if (arg.num) free(arg.num);
+    return AST_ERRNO(ast) = AST_ERR_MEMORY;
+  }
+  task.out = &arg;
+  task.func = ast_topk_chunk;
+  if (ast_sched_one(ast, pool, nthreads, &task)) {
+    free(arg.heap);
+    free(arg.num);
+    return AST_ERRNO(ast);
+  }
 
-  switch (ast->dtype) {
-    case AST_DTYPE_INT:
-      *((int *) value) =
-        ast_eval_int(ast, (ast_node_t *) ast->ast, (int *) var);
-      break;
-    case AST_DTYPE_LONG:
-      *((long *) value) =
-        ast_eval_long(ast, (ast_node_t *) ast->ast, (long *) var);
-      break;
-    case AST_DTYPE_FLOAT:
-      *((float *) value) =
-        ast_eval_float(ast, (ast_node_t *) ast->ast, (float *) var);
-      break;
-    case AST_DTYPE_DOUBLE:
-      *((double *) value) =
-        ast_eval_double(ast, (ast_node_t *) ast->ast, (double *) var);
-      break;
-    default:
-      return AST_ERRNO(ast) = AST_ERR_DTYPE;
+  /* Gather the heaps, and sort the rows with ties broken by the indices,
+     so the result does not depend on the number of threads. */
+  size_t n = 0;
+  for (int t = 0; t < nthreads; t++) {
+    memmove(arg.heap + n, arg.heap + arg.k * t,
+        sizeof(ast_topk_item_t) * arg.num[t]);
+    n += arg.num[t];
   }
-  if (AST_IS_ERROR(ast)) return AST_ERRNO(ast);
+  qsort(arg.heap, n, sizeof(ast_topk_item_t), ast_topk_cmp);
+  if (n > arg.k) n = arg.k;
+  for (size_t i = 0; i < n; i++) {
+    idx[i] = arg.heap[i].i;
+    if (val) val[i] = largest ? arg.heap[i].v : -arg.heap[i].v;
+  }
+  if (num) *num = n;
+  free(arg.heap);
+  free(arg.num);
   return 0;
 }
 
+/******************************************************************************
+Function `ast_groupby`:
+  Evaluate an integer expression for the keys, and a numerical expression for
+  the values, for multiple rows with a thread pool, and aggregate the values
+  of the rows with the same key.
+Arguments:
+  * `key`:      interface of the abstract syntax tree for the keys;
+  * `value`:    interface of the abstract syntax tree for the values, or NULL
+                for a value of 1 for every row;
+  * `pool`:     the thread pool, or NULL for the one of the library;
+  * `cols`:     columns of variables, where `cols[i]` is for variable `$i+1`;
+  * `dtypes`:   data types of the columns, in the same order as `cols`, or
+                NULL for numerical expressions if they are all the same as
+                the expressions;
+  * `nrows`:    number of rows to be evaluated;
+  * `op`:       the aggregation operation;
+  * `group`:    the groups, with arrays allocated by this function.
+Return:
+  Zero on success; non-zero on error.
+******************************************************************************/
+int ast_groupby(ast_t *key, ast_t *value, ast_pool_t *pool,
+    const void *const *cols, const ast_dtype_t *dtypes, const size_t nrows,
+    const ast_reduce_t op, ast_group_t *group) {
+  if (!key) return AST_ERR_INIT;
+  if (AST_IS_ERROR(key)) return AST_ERRNO(key);
+  if (key->dtype != AST_DTYPE_INT && key->dtype != AST_DTYPE_LONG)
+    return AST_ERRNO(key) = AST_ERR_DTYPE;
+  if (!group || op < AST_REDUCE_SUM || op > AST_REDUCE_MEAN)
+    return AST_ERRNO(key) = AST_ERR_VALUE;
+  if (value && value->dtype == AST_DTYPE_BOOL)
+    return AST_ERRNO(value) = AST_ERR_DTYPE;
+
+  const long nvar = key->nvar ? key->nvar : 1;
+  const long nval = (value && value->nvar) ? value->nvar : 1;
+  const void *col[nvar], *vcol[nval];
+  ast_dtype_t dtype[nvar], vtype[nval];
+  ast_sched_task_t task, vtask;
+  task.col = col;
+  task.dtype = dtype;
+  vtask.col = vcol;
+  vtask.dtype = vtype;
+  if (ast_sched_prep(key, cols, dtypes, nrows, &task)) return AST_ERRNO(key);
+  if (value && ast_sched_prep(value, cols, dtypes, nrows, &vtask))
+    return AST_ERRNO(value);
+  group->num = 0;
+  group->key = NULL;
+  group->val = NULL;
+  group->count = NULL;
+  if (!nrows) return 0;
+
+  int nthreads = 0;
+  if (!(pool = ast_sched_pool(pool, &nthreads)))
+    return AST_ERRNO(key) = AST_ERR_THREAD;
+  ast_group_table_t *tab = calloc(nthreads, sizeof(ast_group_table_t));
+  if (!tab) return AST_ERRNO(key) = AST_ERR_MEMORY;
+  ast_group_arg_t arg;
+  arg.op = (op == AST_REDUCE_MEAN) ? AST_REDUCE_SUM : op;
+  arg.value = value ? &vtask : NULL;
+  arg.table = tab;
+  for (int t = 0; t < nthreads; t++) {
+    tab[t].min = LONG_MAX;
+    tab[t].max = LONG_MIN;
+  }
+
+  /* The keys are indexed directly if the range is small, which requires
+     an extra pass over the keys. */
+  task.out = &arg;
+  task.func = ast_group_range;
+  if (ast_sched_one(key, pool, nthreads, &task)) {
+    free(tab);
+    return AST_ERRNO(key);
+  }
+  long min = LONG_MAX, max = LONG_MIN;
+  for (int t = 0; t < nthreads; t++) {
+    if (tab[t].min < min) min = tab[t].min;
+    if (tab[t].max > max) max = tab[t].max;
+  }
+  const uint64_t range = (uint64_t) max - (uint64_t) min;
+  arg.direct = (range < AST_GROUP_DIRECT && range < nrows);
+  arg.min = min;
+
+  /* Chunks with `AST_REDUCE_ROWS` rows are aggregated by the threads in
+     rounds, and the groups of the chunks are merged in the order of the
+     chunks, so the results do not depend on the number of threads. */
+  const size_t nchunk = (nrows + AST_REDUCE_ROWS - 1) / AST_REDUCE_ROWS;
+  size_t nround = AST_GROUP_PART / AST_REDUCE_ROWS;
+  if (!nround) nround = 1;
+  if (nround > nchunk) nround = nchunk;
+  const size_t cap = arg.direct ? (size_t) range + 1 : AST_GROUP_INIT;
+  ast_group_table_t all;
+  all.cap = cap;
+  all.num = 0;
+  all.slot = calloc(cap, sizeof(ast_group_slot_t));
+  arg.run = malloc(sizeof(ast_group_slot_t) * nround * AST_REDUCE_ROWS);
+  arg.len = malloc(sizeof(size_t) * nround);
+  int err = (all.slot && arg.run && arg.len) ? 0 : AST_ERR_MEMORY;
+  for (int t = 0; t < nthreads; t++) {
+    tab[t].cap = cap;
+    tab[t].num = 0;
+    if (!(tab[t].slot = calloc(cap, sizeof(ast_group_slot_t))))
+      err = AST_ERR_MEMORY;
+  }
+  task.align = AST_REDUCE_ROWS;
+  task.func = ast_group_chunk;
+
+  for (size_t c = 0; c < nchunk && !err; c += nround) {
+    const size_t m = (nchunk - c < nround) ? nchunk - c : nround;
+    arg.base = c * AST_REDUCE_ROWS;
+    task.nrows = (nrows - arg.base < m * AST_REDUCE_ROWS) ?
+      nrows - arg.base : m * AST_REDUCE_ROWS;
+    if ((err = ast_sched_one(key, pool, nthreads, &task))) break;
+    for (size_t j = 0; j < m && !err; j++) {
+      const ast_group_slot_t *run = arg.run + j * AST_REDUCE_ROWS;
+      for (size_t k = 0; k < arg.len[j]; k++) {
+        ast_group_slot_t *slot = arg.direct ?
+          all.slot + (size_t) (run[k].key - min) :
+          ast_group_find(&all, run[k].key);
+        if (!slot) {
+          err = AST_ERR_MEMORY;
+          break;
+        }
+        ast_group_merge(slot, run + k, arg.op);
+      }
+    }
+  }
+
+  /* Collect the groups in ascending order of keys. */
+  size_t num = 0;
+  if (!err) {
+    for (size_t j = 0; j < all.cap; j++) {
+      if (!all.slot[j].count) continue;
+      all.slot[num] = all.slot[j];
+      if (arg.direct) all.slot[num].key = min + (long) j;
+      num++;
+    }
+    if (!arg.direct)
+      qsort(all.slot, num, sizeof(ast_group_slot_t), ast_group_cmp);
+  }
+
+  if (!err && !(group->key = malloc(sizeof(long) * num)))
+    err = AST_ERR_MEMORY;
+  if (!err && !(group->val = malloc(sizeof(double) * num)))
+    err = AST_ERR_MEMORY;
+  if (!err && !(group->count = malloc(sizeof(size_t) * num)))
+    err = AST_ERR_MEMORY;
+  if (!err) {
+    group->num = num;
+    for (size_t j = 0; j < num; j++) {
+      group->key[j] = all.slot[j].key;
+      group->val[j] = (op == AST_REDUCE_MEAN) ?
+        all.slot[j].val / all.slot[j].count : all.slot[j].val;
+      group->count[j] = all.slot[j].count;
+    }
+  }
+  else ast_group_destroy(group);
+
+  if (all.slot) free(all.slot);
+  if (arg.run) free(arg.run);
+  if (arg.len) free(arg.len);
+  for (int t = 0; t < nthreads; t++) if (tab[t].slot) free(tab[t].slot);
+  free(tab);
+  return err ? (AST_ERRNO(key) = err) : 0;
+}
+
+/******************************************************************************
+Function `ast_pool_destroy`:
+  Terminate the worker threads and release memory allocated for the thread
+  pool.
+Arguments:
+  * `pool`:     the thread pool.
+******************************************************************************/
+void ast_pool_destroy(ast_pool_t *pool) {
+  if (!pool) return;
+#ifdef AST_POOL_PTHREAD
+  pthread_mutex_lock(&pool->lock);
+  pool->stop = true;
+  pthread_cond_broadcast(&pool->wake);
+  pthread_mutex_unlock(&pool->lock);
+  for (int i = 1; i < pool->nthreads; i++)
+    pthread_join(pool->worker[i - 1].tid, NULL);
+  if (pool->worker) free(pool->worker);
+  pthread_cond_destroy(&pool->done);
+  pthread_cond_destroy(&pool->wake);
+  pthread_mutex_destroy(&pool->lock);
+  pthread_mutex_destroy(&pool->run);
+#endif
+  free(pool);
+}
+
+/******************************************************************************
+Function `ast_group_destroy`:
+  Release memory allocated for the results of a group-by aggregation.
+Arguments:
+  * `group`:    the groups.
+******************************************************************************/
+void ast_group_destroy(ast_group_t *group) {
+  if (!group) return;
+  if (group->key) free(group->key);
+  if (group->val) free(group->val);
+  if (group->count) free(group->count);
+  group->num = 0;
+  group->key = NULL;
+  group->val = NULL;
+  group->count = NULL;
+}
+
 
 /*============================================================================*\
                           Function for error handling
 \*============================================================================*/
 
 /******************************************************************************
-Function `ast_perror`:
-  Print the error message if there is an error.
+Function `ast_print_error`:
+  Print the error message given the data structure for error handling.
 Arguments:
-  * `ast`:      interface of the abstract syntax tree;
+  * `err`:      data structure for error handling;
+  * `exp`:      the expression string;
   * `fp`:       output file stream;
   * `msg`:      string to be printed before the error message.
 ******************************************************************************/
-void ast_perror(const ast_t *ast, FILE *fp, const char *msg) {
+static void ast_print_error(const ast_error_t *err, const char *exp,
+    FILE *fp, const char *msg) {
   const char *sep, *errmsg;
-  if (!ast) {
-    if (!msg || *msg == '\0') msg = sep = "";
-    else sep = " ";
-    fprintf(fp, "%s%sthe abstract syntax tree is not initialised.\n", msg, sep);
-    return;
-  }
-
-  if(!(AST_IS_ERROR(ast))) return;
-  const ast_error_t *err = (ast_error_t *) ast->error;
-  switch (AST_ERRNO(ast)) {
+  switch (err->errno) {
     case AST_ERR_MEMORY:
       errmsg = "failed to allocate memory";
       break;
@@ -2556,6 +10077,9 @@ void ast_perror(const ast_t *ast, FILE *fp, const char *msg) {
     case AST_ERR_MISMATCH:
       errmsg = "conflict data types in the expression";
       break;
+    case AST_ERR_THREAD:
+      errmsg = "failed to start the threads for evaluation";
+      break;
     default:
       errmsg = "unknown error";
       break;
@@ -2566,12 +10090,12 @@ void ast_perror(const ast_t *ast, FILE *fp, const char *msg) {
   fprintf(fp, "%s%s%s", msg, sep, errmsg);
 
   /* Print the specifier of the error location. */
-  if (AST_ERRNO(ast) == AST_ERR_TOKEN && ast->exp && err->tpos) {
-    fprintf(fp, "\n%s\n", ast->exp);
-    for (ptrdiff_t i = 0; i < err->tpos - ast->exp; i++) fprintf(fp, " ");
+  if (err->errno == AST_ERR_TOKEN && exp && err->tpos) {
+    fprintf(fp, "\n%s\n", exp);
+    for (ptrdiff_t i = 0; i < err->tpos - exp; i++) fprintf(fp, " ");
     fprintf(fp, "^");
   }
-  if (AST_ERRNO(ast) == AST_ERR_VAR && err->vidx) {
+  if (err->errno == AST_ERR_VAR && err->vidx) {
     if (err->vidx >= 0 && err->vidx < 10)
       fprintf(fp, ": %c%ld", AST_VAR_FLAG, err->vidx);
     else
@@ -2581,3 +10105,45 @@ void ast_perror(const ast_t *ast, FILE *fp, const char *msg) {
   fprintf(fp, "\n");
 }
 
+/******************************************************************************
+Function `ast_perror`:
+  Print the error message if there is an error.
+Arguments:
+  * `ast`:      interface of the abstract syntax tree;
+  * `fp`:       output file stream;
+  * `msg`:      string to be printed before the error message.
+******************************************************************************/
+void ast_perror(const ast_t *ast, FILE *fp, const char *msg) {
+  if (!ast) {
+    const char *sep;
+    if (!msg || *msg == '\0') msg = sep = "";
+    else sep = " ";
+    fprintf(fp, "%s%sthe abstract syntax tree is not initialised.\n", msg, sep);
+    return;
+  }
+
+  if(!(AST_IS_ERROR(ast))) return;
+  ast_print_error((ast_error_t *) ast->error, ast->exp, fp, msg);
+}
+
+/******************************************************************************
+Function `ast_ctx_perror`:
+  Print the error message of the evaluation context if there is an error.
+Arguments:
+  * `ctx`:      the evaluation context;
+  * `fp`:       output file stream;
+  * `msg`:      string to be printed before the error message.
+******************************************************************************/
+void ast_ctx_perror(const ast_ctx_t *ctx, FILE *fp, const char *msg) {
+  if (!ctx) {
+    const char *sep;
+    if (!msg || *msg == '\0') msg = sep = "";
+    else sep = " ";
+    fprintf(fp, "%s%sthe evaluation context is not initialised.\n", msg, sep);
+    return;
+  }
+
+  if(!(AST_IS_ERROR(ctx))) return;
+  ast_print_error((ast_error_t *) ctx->error, ctx->comp->exp, fp, msg);
+}
+
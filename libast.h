@@ -32,6 +32,7 @@
 #define _LIBAST_H_
 
 #include <stdio.h>
+#include <stdint.h>
 #include <stdbool.h>
 
 /*============================================================================*\
@@ -57,6 +58,64 @@ typedef enum {
   AST_DTYPE_STRING = 32
 } ast_dtype_t;
 
+/* Dispatch methods of the interpreter for compiled programs. */
+typedef enum {
+  AST_CORE_SWITCH   = 0,        /* a `switch` loop over instructions    */
+  AST_CORE_THREADED = 1         /* threaded code with computed goto     */
+} ast_core_t;
+
+/* Instruction sets of the vectorised kernels for batch evaluation. */
+typedef enum {
+  AST_SIMD_NONE    = 0,         /* portable C loops                     */
+  AST_SIMD_GENERIC = 1,         /* vector extensions of GCC or Clang    */
+  AST_SIMD_SSE2    = 2,         /* SSE2 of x86 processors               */
+  AST_SIMD_AVX2    = 3,         /* AVX2 and FMA of x86 processors       */
+  AST_SIMD_AVX512  = 4          /* AVX-512 of x86 processors            */
+} ast_simd_t;
+
+/* Accuracy of the mathematical functions for batch evaluation. */
+typedef enum {
+  AST_MATH_EXACT  = 0,          /* the C math library                   */
+  AST_MATH_FAST   = 1           /* vectorised approximations            */
+} ast_math_t;
+
+/* Options for building the abstract syntax tree, which can be combined. */
+typedef enum {
+  AST_BUILD_DEFAULT = 0,        /* no option                            */
+  AST_BUILD_FMA     = 1         /* fused multiply-add for real numbers  */
+} ast_build_t;
+
+/* Operations for reducing the values of an expression. */
+typedef enum {
+  AST_REDUCE_SUM   = 0,         /* sum of the values                    */
+  AST_REDUCE_MIN   = 1,         /* minimum of the values                */
+  AST_REDUCE_MAX   = 2,         /* maximum of the values                */
+  AST_REDUCE_COUNT = 3,         /* number of non-zero values            */
+  AST_REDUCE_MEAN  = 4          /* mean of the values                   */
+} ast_reduce_t;
+
+/* Bins of histograms, given by the edges, or the range of uniform bins. */
+typedef struct {
+  size_t nbins;                 /* Number of bins.                      */
+  const double *edges;          /* `nbins + 1` edges, or NULL.          */
+  double min;                   /* Lower edge of uniform bins.          */
+  double max;                   /* Upper edge of uniform bins.          */
+} ast_bins_t;
+
+/* Results of group-by aggregations, in ascending order of the keys. */
+typedef struct {
+  size_t num;                   /* Number of groups.                    */
+  long *key;                    /* Keys of the groups.                  */
+  double *val;                  /* Aggregated values of the groups.     */
+  size_t *count;                /* Number of rows of the groups.        */
+} ast_group_t;
+
+/* Native functions compiled from numerical expressions. */
+typedef int (*ast_jit_int_t) (const int *);
+typedef long (*ast_jit_long_t) (const long *);
+typedef float (*ast_jit_float_t) (const float *);
+typedef double (*ast_jit_double_t) (const double *);
+
 /* The interface of the abstract syntax tree. */
 typedef struct {
   ast_dtype_t dtype;    /* Data type for the expression.        */
@@ -65,9 +124,32 @@ typedef struct {
   long *vidx;           /* Unique indices of variables.         */
   char *exp;            /* A copy of the expression string.     */
   void *ast;            /* The root node of the AST.            */
+  void *prog;           /* The compiled program of the AST.     */
   void *error;          /* Data structure for error handling.   */
 } ast_t;
 
+/* The compiled expression, which is read-only on evaluation. */
+typedef struct ast_prog_struct ast_compiled_t;
+
+/* The context for evaluating a compiled expression. */
+typedef struct {
+  const ast_compiled_t *comp;   /* The compiled expression.             */
+  void *var;                    /* The list of variables.               */
+  void *error;                  /* Data structure for error handling.   */
+} ast_ctx_t;
+
+/* The thread pool for multi-threaded evaluation. */
+typedef struct ast_pool_struct ast_pool_t;
+
+/* The task of evaluating an expression for multiple rows. */
+typedef struct {
+  ast_t *ast;                   /* The abstract syntax tree.            */
+  void *out;                    /* The evaluated values or bitmask.     */
+  const void *const *cols;      /* The columns of variables.            */
+  const ast_dtype_t *dtypes;    /* Data types of the columns.           */
+  size_t nrows;                 /* Number of rows to be evaluated.      */
+} ast_task_t;
+
 
 /*============================================================================*\
                             Definitions of functions
@@ -95,6 +177,121 @@ Return:
 int ast_build(ast_t *ast, const char *str, const ast_dtype_t dtype,
     const bool eval);
 
+/******************************************************************************
+Function `ast_build_ex`:
+  Build the abstract syntax tree given the expression, data type, and
+  options for the evaluators.
+Arguments:
+  * `ast`:      interface of the abstract syntax tree;
+  * `str`:      null terminated string for the expression;
+  * `dtype`:    data type for the abstract syntax tree;
+  * `eval`:     true for pre-evaluating values;
+  * `flags`:    bitwise OR of the options, or `AST_BUILD_DEFAULT`.
+Return:
+  Zero on success; non-zero on error.
+******************************************************************************/
+int ast_build_ex(ast_t *ast, const char *str, const ast_dtype_t dtype,
+    const bool eval, const unsigned int flags);
+
+/******************************************************************************
+Function `ast_compile`:
+  Compile the abstract syntax tree into a flat postfix program, which is then
+  used by `ast_eval` and `ast_eval_num` instead of the tree.
+Arguments:
+  * `ast`:      interface of the abstract syntax tree.
+Return:
+  Zero on success; non-zero on error.
+******************************************************************************/
+int ast_compile(ast_t *ast);
+
+/******************************************************************************
+Function `ast_eval_core`:
+  Report the dispatch method of the interpreter for compiled programs, which
+  is chosen at build time.
+Return:
+  `AST_CORE_THREADED` for threaded code with computed goto;
+  `AST_CORE_SWITCH` for a `switch` loop.
+******************************************************************************/
+ast_core_t ast_eval_core(void);
+
+/******************************************************************************
+Function `ast_jit`:
+  Compile the floating-point type expression into native machine code, which
+  is then used by `ast_eval_num`.
+Arguments:
+  * `ast`:      interface of the abstract syntax tree.
+Return:
+  Zero on success; non-zero if the expression cannot be compiled into
+  machine code, in which case the interpreter is still used for evaluation.
+******************************************************************************/
+int ast_jit(ast_t *ast);
+
+/******************************************************************************
+Function `ast_jit_int`:
+  Retrieve the native function compiled for an int type expression.
+Arguments:
+  * `ast`:      interface of the abstract syntax tree.
+Return:
+  The function on success; NULL if it is not available.
+******************************************************************************/
+ast_jit_int_t ast_jit_int(const ast_t *ast);
+
+/******************************************************************************
+Function `ast_jit_long`:
+  Retrieve the native function compiled for a long type expression.
+Arguments:
+  * `ast`:      interface of the abstract syntax tree.
+Return:
+  The function on success; NULL if it is not available.
+******************************************************************************/
+ast_jit_long_t ast_jit_long(const ast_t *ast);
+
+/******************************************************************************
+Function `ast_jit_float`:
+  Retrieve the native function compiled for a float type expression.
+Arguments:
+  * `ast`:      interface of the abstract syntax tree.
+Return:
+  The function on success; NULL if it is not available.
+******************************************************************************/
+ast_jit_float_t ast_jit_float(const ast_t *ast);
+
+/******************************************************************************
+Function `ast_jit_double`:
+  Retrieve the native function compiled for a double type expression.
+Arguments:
+  * `ast`:      interface of the abstract syntax tree.
+Return:
+  The function on success; NULL if it is not available.
+******************************************************************************/
+ast_jit_double_t ast_jit_double(const ast_t *ast);
+
+/******************************************************************************
+Function `ast_codegen_c`:
+  Print a C99 function that evaluates the numerical expression, with the
+  literals, offsets of variables, and data type built in.
+Arguments:
+  * `ast`:      interface of the abstract syntax tree;
+  * `fp`:       output file stream.
+Return:
+  Zero on success; non-zero on error.
+******************************************************************************/
+int ast_codegen_c(ast_t *ast, FILE *fp);
+
+/******************************************************************************
+Function `ast_codegen_load`:
+  Compile the C function of the numerical expression into a shared object in
+  the cache directory, and load it for `ast_eval_num`. The shared object is
+  reused if it exists already.
+Arguments:
+  * `ast`:      interface of the abstract syntax tree;
+  * `dir`:      the cache directory.
+Return:
+  Zero on success; non-zero if the shared object cannot be loaded, in which
+  case the interpreter is still used for evaluation.
+******************************************************************************/
+int ast_codegen_load(ast_t *ast, const char *dir);
+
 /******************************************************************************
 Function `ast_set_var`:
   Set the value of a variable in the variable array
@@ -135,6 +332,395 @@ Return:
 ******************************************************************************/
 int ast_eval_num(ast_t *ast, void *value, const void *var, const long size);
 
+/******************************************************************************
+Function `ast_eval_num_batch`:
+  Evaluate the numerical expression for multiple rows, given columns of
+  variables with the same data type.
+Arguments:
+  * `ast`:      interface of the abstract syntax tree;
+  * `out`:      array for the evaluated values, with at least `nrows` elements;
+  * `cols`:     columns of variables, where `cols[i]` is for variable `$i+1`;
+  * `nrows`:    number of rows to be evaluated.
+Return:
+  Zero on success; non-zero on error.
+******************************************************************************/
+int ast_eval_num_batch(ast_t *ast, void *out, const void *const *cols,
+    const size_t nrows);
+
+/******************************************************************************
+Function `ast_eval_num_batch_typed`:
+  Evaluate the numerical expression for multiple rows, given columns of
+  variables in their native data types.
+Arguments:
+  * `ast`:      interface of the abstract syntax tree;
+  * `out`:      array for the evaluated values, with at least `nrows` elements;
+  * `cols`:     columns of variables, where `cols[i]` is for variable `$i+1`;
+  * `dtypes`:   data types of the columns, in the same order as `cols`, or
+                NULL if they are all the same as the expression;
+  * `nrows`:    number of rows to be evaluated.
+Return:
+  Zero on success; non-zero on error.
+******************************************************************************/
+int ast_eval_num_batch_typed(ast_t *ast, void *out, const void *const *cols,
+    const ast_dtype_t *dtypes, const size_t nrows);
+
+/******************************************************************************
+Function `ast_eval_num_strided`:
+  Evaluate the numerical expression for multiple rows, given an array of
+  records with variables in their native data types.
+Arguments:
+  * `ast`:      interface of the abstract syntax tree;
+  * `out`:      array for the evaluated values, with at least `nrows` elements;
+  * `base`:     address of the first record;
+  * `stride`:   size of each record in bytes;
+  * `offsets`:  byte offsets of variables in the record, where `offsets[i]` is
+                for variable `$i+1`;
+  * `dtypes`:   data types of variables, in the same order as `offsets`, or
+                NULL if they are all the same as the expression;
+  * `nrows`:    number of rows to be evaluated.
+Return:
+  Zero on success; non-zero on error.
+******************************************************************************/
+int ast_eval_num_strided(ast_t *ast, void *out, const void *base,
+    const size_t stride, const size_t *offsets, const ast_dtype_t *dtypes,
+    const size_t nrows);
+
+/******************************************************************************
+Function `ast_eval_bool_batch`:
+  Evaluate the boolean expression for multiple rows, given columns of
+  variables, with the results packed into a bitmask.
+Arguments:
+  * `ast`:      interface of the abstract syntax tree;
+  * `mask`:     the bitmask, with bit `i % 64` of `mask[i / 64]` for row `i`;
+  * `cols`:     columns of variables, where `cols[i]` is for variable `$i+1`;
+  * `dtypes`:   data types of the columns, in the same order as `cols`;
+  * `nrows`:    number of rows to be evaluated.
+Return:
+  Zero on success; non-zero on error.
+******************************************************************************/
+int ast_eval_bool_batch(ast_t *ast, uint64_t *mask, const void *const *cols,
+    const ast_dtype_t *dtypes, const size_t nrows);
+
+/******************************************************************************
+Function `ast_filter_indices`:
+  Evaluate the boolean expression for multiple rows, given columns of
+  variables, and report the indices of rows for which it is true, as
+  32-bit integers.
+Arguments:
+  * `ast`:      interface of the abstract syntax tree;
+  * `idx`:      array for the indices of the selected rows in ascending
+                order, with at least `nrows` elements;
+  * `num`:      number of the selected rows;
+  * `cols`:     columns of variables, where `cols[i]` is for variable `$i+1`;
+  * `dtypes`:   data types of the columns, in the same order as `cols`;
+  * `nrows`:    number of rows to be evaluated.
+Return:
+  Zero on success; non-zero on error.
+******************************************************************************/
+int ast_filter_indices(ast_t *ast, uint32_t *idx, size_t *num,
+    const void *const *cols, const ast_dtype_t *dtypes, const size_t nrows);
+
+/******************************************************************************
+Function `ast_filter_indices64`:
+  Evaluate the boolean expression for multiple rows, given columns of
+  variables, and report the indices of rows for which it is true, as
+  64-bit integers.
+Arguments:
+  * `ast`:      interface of the abstract syntax tree;
+  * `idx`:      array for the indices of the selected rows in ascending
+                order, with at least `nrows` elements;
+  * `num`:      number of the selected rows;
+  * `cols`:     columns of variables, where `cols[i]` is for variable `$i+1`;
+  * `dtypes`:   data types of the columns, in the same order as `cols`;
+  * `nrows`:    number of rows to be evaluated.
+Return:
+  Zero on success; non-zero on error.
+******************************************************************************/
+int ast_filter_indices64(ast_t *ast, uint64_t *idx, size_t *num,
+    const void *const *cols, const ast_dtype_t *dtypes, const size_t nrows);
+
+/******************************************************************************
+Function `ast_eval_simd`:
+  Report the instruction set of the vectorised kernels for batch evaluation,
+  which is detected at runtime.
+Return:
+  The most advanced instruction set supported by both the build and the
+  processor; `AST_SIMD_NONE` if there is none.
+******************************************************************************/
+ast_simd_t ast_eval_simd(void);
+
+/******************************************************************************
+Function `ast_set_simd`:
+  Choose the instruction set of the vectorised kernels for batch evaluation,
+  e.g., for comparing the performance of the kernels.
+Arguments:
+  * `ast`:      interface of the abstract syntax tree;
+  * `simd`:     the instruction set, which has to be supported by both the
+                build and the processor; `AST_SIMD_NONE` for portable loops.
+Return:
+  Zero on success; non-zero on error.
+******************************************************************************/
+int ast_set_simd(ast_t *ast, const ast_simd_t simd);
+
+/******************************************************************************
+Function `ast_set_math`:
+  Choose the accuracy of mathematical functions for batch evaluation of
+  expressions with the float type.
+Arguments:
+  * `ast`:      interface of the abstract syntax tree;
+  * `math`:     `AST_MATH_EXACT` for the C math library, or `AST_MATH_FAST`
+                for vectorised approximations of `ln`, `log`, and `**`.
+Return:
+  Zero on success; non-zero on error.
+******************************************************************************/
+int ast_set_math(ast_t *ast, const ast_math_t math);
+
+/******************************************************************************
+Function `ast_compiled`:
+  Retrieve the compiled expression that can be shared by evaluation contexts,
+  and compile the abstract syntax tree if necessary.
+Arguments:
+  * `ast`:      interface of the abstract syntax tree.
+Return:
+  The compiled expression on success; NULL on error.
+******************************************************************************/
+const ast_compiled_t *ast_compiled(ast_t *ast);
+
+/******************************************************************************
+Function `ast_ctx_init`:
+  Initialise an evaluation context for the compiled expression.
+Arguments:
+  * `comp`:     the compiled expression.
+Return:
+  The pointer to the context on success; NULL on error.
+******************************************************************************/
+ast_ctx_t *ast_ctx_init(const ast_compiled_t *comp);
+
+/******************************************************************************
+Function `ast_ctx_set_var`:
+  Set the value of a variable for the evaluation context.
+Arguments:
+  * `ctx`:      the evaluation context;
+  * `idx`:      index of the variable (starting from 1);
+  * `value`:    pointer to a variable holding the value to be set;
+  * `size`:     length of the string type variable;
+  * `dtype`:    data type of the value.
+Return:
+  Zero on success; non-zero on error.
+******************************************************************************/
+int ast_ctx_set_var(ast_ctx_t *ctx, const long idx, const void *value,
+    const size_t size, const ast_dtype_t dtype);
+
+/******************************************************************************
+Function `ast_ctx_eval`:
+  Evaluate the compiled expression with variables of the evaluation context.
+Arguments:
+  * `ctx`:      the evaluation context;
+  * `value`:    address of the variable holding the evaluated value.
+Return:
+  Zero on success; non-zero on error.
+******************************************************************************/
+int ast_ctx_eval(ast_ctx_t *ctx, void *value);
+
+/******************************************************************************
+Function `ast_pool_init`:
+  Initialise a thread pool for multi-threaded evaluation, with persistent
+  worker threads.
+Arguments:
+  * `nthreads`: number of threads, including the calling thread, or
+                non-positive for the number of available processors;
+  * `affinity`: true for binding the worker threads to processors.
+Return:
+  The pointer to the thread pool on success; NULL on error.
+******************************************************************************/
+ast_pool_t *ast_pool_init(const int nthreads, const bool affinity);
+
+/******************************************************************************
+Function `ast_pool_nthreads`:
+  Report the number of threads of the thread pool.
+Arguments:
+  * `pool`:     the thread pool.
+Return:
+  The number of threads, including the calling thread; 0 on error.
+******************************************************************************/
+int ast_pool_nthreads(const ast_pool_t *pool);
+
+/******************************************************************************
+Function `ast_eval_batch_mt`:
+  Evaluate the expression for multiple rows with the thread pool of the
+  library, given columns of variables in their native data types.
+Arguments:
+  * `ast`:      interface of the abstract syntax tree;
+  * `out`:      array for the evaluated values, with at least `nrows`
+                elements, or the bitmask for boolean expressions, with bit
+                `i % 64` of `((uint64_t *) out)[i / 64]` for row `i`;
+  * `cols`:     columns of variables, where `cols[i]` is for variable `$i+1`;
+  * `dtypes`:   data types of the columns, in the same order as `cols`, or
+                NULL for numerical expressions if they are all the same as
+                the expression;
+  * `nrows`:    number of rows to be evaluated;
+  * `nthreads`: number of threads, or non-positive for all the processors.
+Return:
+  Zero on success; non-zero on error.
+******************************************************************************/
+int ast_eval_batch_mt(ast_t *ast, void *out, const void *const *cols,
+    const ast_dtype_t *dtypes, const size_t nrows, const int nthreads);
+
+/******************************************************************************
+Function `ast_eval_batch_pool`:
+  Evaluate the expression for multiple rows with a thread pool, given
+  columns of variables in their native data types.
+Arguments:
+  * `ast`:      interface of the abstract syntax tree;
+  * `pool`:     the thread pool;
+  * `out`:      array for the evaluated values, with at least `nrows`
+                elements, or the bitmask for boolean expressions, with bit
+                `i % 64` of `((uint64_t *) out)[i / 64]` for row `i`;
+  * `cols`:     columns of variables, where `cols[i]` is for variable `$i+1`;
+  * `dtypes`:   data types of the columns, in the same order as `cols`, or
+                NULL for numerical expressions if they are all the same as
+                the expression;
+  * `nrows`:    number of rows to be evaluated.
+Return:
+  Zero on success; non-zero on error.
+******************************************************************************/
+int ast_eval_batch_pool(ast_t *ast, ast_pool_t *pool, void *out,
+    const void *const *cols, const ast_dtype_t *dtypes, const size_t nrows);
+
+/******************************************************************************
+Function `ast_eval_tasks`:
+  Evaluate expressions for multiple rows with a thread pool, where large
+  tasks are split on demand, and idle threads steal work from the others.
+Arguments:
+  * `pool`:     the thread pool, or NULL for the one of the library;
+  * `tasks`:    the tasks of batch evaluations;
+  * `ntask`:    number of tasks.
+Return:
+  Zero on success; the error code of the first failed task on error.
+******************************************************************************/
+int ast_eval_tasks(ast_pool_t *pool, const ast_task_t *tasks,
+    const size_t ntask);
+
+/******************************************************************************
+Function `ast_reduce`:
+  Evaluate the expression for multiple rows with a thread pool, and reduce
+  the values without storing them.
+Arguments:
+  * `ast`:      interface of the abstract syntax tree;
+  * `pool`:     the thread pool, or NULL for the one of the library;
+  * `cols`:     columns of variables, where `cols[i]` is for variable `$i+1`;
+  * `dtypes`:   data types of the columns, in the same order as `cols`, or
+                NULL for numerical expressions if they are all the same as
+                the expression;
+  * `nrows`:    number of rows to be evaluated;
+  * `op`:       the reduction operation;
+  * `result`:   address of the variable holding the result.
+Return:
+  Zero on success; non-zero on error.
+******************************************************************************/
+int ast_reduce(ast_t *ast, ast_pool_t *pool, const void *const *cols,
+    const ast_dtype_t *dtypes, const size_t nrows, const ast_reduce_t op,
+    double *result);
+
+/******************************************************************************
+Function `ast_histogram`:
+  Evaluate the expression for multiple rows with a thread pool, and count
+  the values in bins, optionally for selected rows and with weights.  The
+  partial bins of chunks of rows are merged in a fixed order, so the results
+  do not depend on the number of threads.
+Arguments:
+  * `ast`:      interface of the abstract syntax tree;
+  * `pool`:     the thread pool, or NULL for the one of the library;
+  * `cols`:     columns of variables, where `cols[i]` is for variable `$i+1`;
+  * `dtypes`:   data types of the columns, in the same order as `cols`, or
+                NULL for numerical expressions if they are all the same as
+                the expressions;
+  * `nrows`:    number of rows to be evaluated;
+  * `bins`:     the bins of the histogram;
+  * `mask`:     boolean expression for selecting the rows, or NULL;
+  * `weight`:   numerical expression for the weights, or NULL;
+  * `counts`:   array for the (weighted) counts of the bins.
+Return:
+  Zero on success; non-zero on error.
+******************************************************************************/
+int ast_histogram(ast_t *ast, ast_pool_t *pool, const void *const *cols,
+    const ast_dtype_t *dtypes, const size_t nrows, const ast_bins_t *bins,
+    ast_t *mask, ast_t *weight, double *counts);
+
+/******************************************************************************
+Function `ast_quantiles`:
+  Evaluate the expression for multiple rows with a thread pool, and estimate
+  quantiles of the values with mergeable sketches of the threads.
+Arguments:
+  * `ast`:      interface of the abstract syntax tree;
+  * `pool`:     the thread pool, or NULL for the one of the library;
+  * `cols`:     columns of variables, where `cols[i]` is for variable `$i+1`;
+  * `dtypes`:   data types of the columns, in the same order as `cols`, or
+                NULL for numerical expressions if they are all the same as
+                the expression;
+  * `nrows`:    number of rows to be evaluated;
+  * `probs`:    cumulative probabilities of the quantiles, in [0,1];
+  * `nprob`:    number of quantiles;
+  * `out`:      array for the quantiles.
+Return:
+  Zero on success; non-zero on error.
+******************************************************************************/
+int ast_quantiles(ast_t *ast, ast_pool_t *pool, const void *const *cols,
+    const ast_dtype_t *dtypes, const size_t nrows, const double *probs,
+    const size_t nprob, double *out);
+
+/******************************************************************************
+Function `ast_topk`:
+  Evaluate the expression for multiple rows with a thread pool, and select
+  the rows with the largest or smallest values, optionally from the rows
+  selected by a filter.
+Arguments:
+  * `ast`:      interface of the abstract syntax tree;
+  * `pool`:     the thread pool, or NULL for the one of the library;
+  * `cols`:     columns of variables, where `cols[i]` is for variable `$i+1`;
+  * `dtypes`:   data types of the columns, in the same order as `cols`, or
+                NULL for numerical expressions if they are all the same as
+                the expressions;
+  * `nrows`:    number of rows to be evaluated;
+  * `k`:        maximum number of rows to be selected;
+  * `largest`:  true for the largest values, false for the smallest ones;
+  * `filter`:   boolean expression for filtering the rows, or NULL;
+  * `idx`:      array for the indices of the selected rows;
+  * `val`:      array for the values of the selected rows, or NULL;
+  * `num`:      address of the number of selected rows, or NULL.
+Return:
+  Zero on success; non-zero on error.
+******************************************************************************/
+int ast_topk(ast_t *ast, ast_pool_t *pool, const void *const *cols,
+    const ast_dtype_t *dtypes, const size_t nrows, const size_t k,
+    const bool largest, ast_t *filter, size_t *idx, double *val,
+    size_t *num);
+
+/******************************************************************************
+Function `ast_groupby`:
+  Evaluate an integer expression for the keys, and a numerical expression for
+  the values, for multiple rows with a thread pool, and aggregate the values
+  of the rows with the same key.  The groups of chunks of rows are merged in
+  a fixed order, so the results do not depend on the number of threads.
+Arguments:
+  * `key`:      interface of the abstract syntax tree for the keys;
+  * `value`:    interface of the abstract syntax tree for the values, or NULL
+                for a value of 1 for every row;
+  * `pool`:     the thread pool, or NULL for the one of the library;
+  * `cols`:     columns of variables, where `cols[i]` is for variable `$i+1`;
+  * `dtypes`:   data types of the columns, in the same order as `cols`, or
+                NULL for numerical expressions if they are all the same as
+                the expressions;
+  * `nrows`:    number of rows to be evaluated;
+  * `op`:       the aggregation operation;
+  * `group`:    the groups, with arrays allocated by this function.
+Return:
+  Zero on success; non-zero on error.
+******************************************************************************/
+int ast_groupby(ast_t *key, ast_t *value, ast_pool_t *pool,
+    const void *const *cols, const ast_dtype_t *dtypes, const size_t nrows,
+    const ast_reduce_t op, ast_group_t *group);
+
 /******************************************************************************
 Function `ast_perror`:
   Print the error message if there is an error.
@@ -145,6 +731,16 @@ Arguments:
 ******************************************************************************/
 void ast_perror(const ast_t *ast, FILE *fp, const char *msg);
 
+/******************************************************************************
+Function `ast_ctx_perror`:
+  Print the error message of the evaluation context if there is an error.
+Arguments:
+  * `ctx`:      the evaluation context;
+  * `fp`:       output file stream;
+  * `msg`:      string to be printed before the error message.
+******************************************************************************/
+void ast_ctx_perror(const ast_ctx_t *ctx, FILE *fp, const char *msg);
+
 /******************************************************************************
 Function `ast_destroy`:
   Release memory allocated for the abstract syntax tree.
@@ -153,4 +749,29 @@ Arguments:
 ******************************************************************************/
 void ast_destroy(ast_t *ast);
 
+/******************************************************************************
+Function `ast_ctx_destroy`:
+  Release memory allocated for the evaluation context.
+Arguments:
+  * `ctx`:      the evaluation context.
+******************************************************************************/
+void ast_ctx_destroy(ast_ctx_t *ctx);
+
+/******************************************************************************
+Function `ast_pool_destroy`:
+  Terminate the worker threads and release memory allocated for the thread
+  pool.
+Arguments:
+  * `pool`:     the thread pool.
+******************************************************************************/
+void ast_pool_destroy(ast_pool_t *pool);
+
+/******************************************************************************
+Function `ast_group_destroy`:
+  Release memory allocated for the results of a group-by aggregation.
+Arguments:
+  * `group`:    the groups.
+******************************************************************************/
+void ast_group_destroy(ast_group_t *group);
+
 #endif